@@ -6,20 +6,21 @@
  */
 
 #include <WiFi.h>
-#include "esp_sleep.h"
-#include "esp_system.h"
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLEUtils.h>
+#include "hal.h"
 #include "config.h"
-#include "sensor.h"
-#include "espnow_comm.h"
 #include "provisioning.h"
+#include "profiler.h"
+#include "report_policy.h"
+#include "wake_cycle.h"
+#include "energy.h"
+#include "node_log.h"
 
 // Define the cloud node MAC address here (declared extern in config.h)
 uint8_t cloudNodeAddress[6] = {0x0C, 0x4E, 0xA0, 0x4D, 0x54, 0x8C}; // REPLACE WITH ACTUAL MAC
 //uint8_t cloudNodeAddress[6] = {0x0C, 0x4E, 0xA0, 0x4D, 0x54, 0x78}; //oil2
-struct_message sensorData;
 
 // Device properties (can be updated via BLE)
 // Default values - will be overridden if stored values exist
@@ -27,6 +28,10 @@ float emptyDistanceCm = 120.0f;
 float fullDistanceCm = 20.0f;
 float tankCapacityLitres = 900.0f;
 uint32_t refreshRateSeconds = 300;
+ReportThresholds reportThresholds = {
+  REPORT_DEADBAND_DISTANCE_CM, REPORT_DEADBAND_LEVEL_PERCENT, REPORT_DEADBAND_BATTERY_V,
+  REPORT_URGENT_LEVEL_DELTA, REPORT_HEARTBEAT_CYCLES
+};
 
 // BLE variables
 BLEServer* pServer = NULL;
@@ -36,132 +41,92 @@ bool provisioningMode = false;
 unsigned long provisioningStartTime = 0;
 
 void setup() {
-  Serial.begin(115200);
-  delay(1500);
+  PROFILE_BEGIN_CYCLE();
+  {
+    PROFILE_SCOPE(PHASE_BOOT);
+    Serial.begin(115200);
+    // Console settle time; records left over from the last wake print in it
+    logBegin();
+    logIdleDelay(1500);
+  }
 
-  LOG("Sensor Node Booting");
-  Serial.println("========================================");
+  LOG_I("Sensor Node Booting");
 
-  // Load stored device properties (if any)
-  if (hasStoredProperties()) {
-    loadDeviceProperties();
-  } else {
-    Serial.println("No stored properties - using defaults");
-    Serial.printf("  Min Distance: %.1f cm\n", fullDistanceCm);
-    Serial.printf("  Max Distance: %.1f cm\n", emptyDistanceCm);
-    Serial.printf("  Refresh Rate: %u seconds\n", refreshRateSeconds);
-    Serial.printf("  Total Litres: %.1f L\n", tankCapacityLitres);
-  }
-  
-  // Load stored cloud node MAC address (if any)
-  if (!loadCloudNodeMAC(cloudNodeAddress)) {
-    Serial.println("No stored Cloud Node MAC - using default from code");
-    Serial.print("  Default Cloud MAC: ");
-    for (int i = 0; i < 6; i++) {
-      Serial.printf("%02X", cloudNodeAddress[i]);
-      if (i < 5) Serial.print(":");
-    }
-    Serial.println();
-  }
-  Serial.println("========================================");
+  // Deep-sleep wakes use the RTC config cache
+  HalResetReason reset_reason = halResetReason();
+  loadWakeConfig(reset_reason);
 
-  // Check reset reason - only enable Bluetooth on cold boot
-  esp_reset_reason_t reset_reason = esp_reset_reason();
-  Serial.print("Reset reason: ");
+  // Only enable Bluetooth on cold boot
   switch(reset_reason) {
-    case ESP_RST_POWERON:
-      Serial.println("Power-on reset (cold boot)");
+    case HAL_RESET_POWERON:
+      LOG_I("Reset reason: Power-on reset (cold boot)");
       
       // Check if we have stored WiFi credentials
       if (hasStoredWiFiCredentials()) {
-        Serial.println("Found stored WiFi credentials");
+        LOG_I("Found stored WiFi credentials");
         
         // Try to connect with stored credentials
         if (connectToStoredWiFi()) {
-          Serial.println(" Connected to WiFi with stored credentials");
+          LOG_I("Connected to WiFi with stored credentials");
           // WiFi is connected, skip provisioning
           
           // Enable basic BLE advertising for pairing only
           BLEDevice::init(BT_DEVICE_NAME);
           pServer = BLEDevice::createServer();
           BLEDevice::startAdvertising();
+          energyBegin(POWER_BLE);
           btEnabled = true;
           btStartTime = millis();
-          Serial.println(" BLE ENABLED for pairing (2 minutes)");
+          LOG_I("BLE ENABLED for pairing (2 minutes)");
         } else {
-          Serial.println(" Failed to connect with stored credentials");
-          Serial.println("Entering provisioning mode...");
+          LOG_W("Failed to connect with stored credentials - entering provisioning mode...");
           
           // Clear invalid credentials and enter provisioning
           clearStoredWiFiCredentials();
           initializeProvisioning();
+          energyBegin(POWER_BLE);
           provisioningMode = true;
           provisioningStartTime = millis();
-          Serial.println(" BLE Provisioning ACTIVE (5 minutes)");
+          LOG_I("BLE Provisioning ACTIVE (5 minutes)");
         }
       } else {
         // No stored credentials - enter provisioning mode
-        Serial.println("No stored WiFi credentials found");
-        Serial.println("Entering provisioning mode...");
+        LOG_I("No stored WiFi credentials found - entering provisioning mode...");
         initializeProvisioning();
+        energyBegin(POWER_BLE);
         provisioningMode = true;
         provisioningStartTime = millis();
-        Serial.println(" BLE Provisioning ACTIVE (5 minutes)");
+        LOG_I("BLE Provisioning ACTIVE (5 minutes)");
       }
       
-      Serial.print("Device name: ");
-      Serial.println(BT_DEVICE_NAME);
-      Serial.println("✓ Device is now visible via BLE");
-      Serial.print("Search for '");
-      Serial.print(BT_DEVICE_NAME);
-      Serial.println("' to connect");
+      LOG_I("✓ Device is now visible via BLE - search for '%s' to connect", BT_DEVICE_NAME);
       break;
-    case ESP_RST_DEEPSLEEP:
-      Serial.println("Wake from deep sleep (Bluetooth disabled)");
+    case HAL_RESET_DEEPSLEEP:
+      LOG_I("Reset reason: Wake from deep sleep (Bluetooth disabled)");
       break;
     default:
-      Serial.print("Other reset: ");
-      Serial.println(reset_reason);
+      LOG_W("Reset reason: Other reset: %d", halResetCode());
       break;
   }
-  Serial.println("========================================");
 
-  pinMode(TRIG_PIN, OUTPUT);
-  digitalWrite(TRIG_PIN, LOW);
-  pinMode(ECHO_PIN, INPUT);
+  halPinOutput(TRIG_PIN);
+  halPinWrite(TRIG_PIN, false);
+  halPinInput(ECHO_PIN);
 
   // Don't initialize ESP-NOW if we're in provisioning mode without WiFi
   if (!provisioningMode || WiFi.status() == WL_CONNECTED) {
-    // Set device as a Wi-Fi Station
-    WiFi.mode(WIFI_STA);
-
-    // Print MAC address
-    Serial.print("Sensor Node MAC Address: ");
-    Serial.println(WiFi.macAddress());
-    
-    Serial.print("Target Cloud Node MAC: ");
-    for (int i = 0; i < 6; i++) {
-      Serial.printf("%02X", cloudNodeAddress[i]);
-      if (i < 5) Serial.print(":");
-    }
-    Serial.println();
-    Serial.println("⚠️ Make sure this matches your Cloud Node's MAC!");
-    Serial.println("========================================");
-
-    // Initialize ESP-NOW and find Cloud Node
-    if (!initializeESPNOW()) {
-      LOG("ESP-NOW initialization failed");
-      ESP.restart();
-    }
+    // ESP-NOW is brought up by the wake pipeline, overlapped with the sensor read
+    LOG_D("ESP-NOW bring-up deferred to the wake pipeline");
   } else {
-    Serial.println("Skipping ESP-NOW initialization - waiting for WiFi provisioning");
-    Serial.println("========================================");
+    LOG_I("Skipping ESP-NOW initialization - waiting for WiFi provisioning");
   }
 
-  LOG("Sensor Node Setup complete");
+  LOG_I("Sensor Node Setup complete");
 }
 
 void loop() {
+  PROFILE_HANDLE_SERIAL();
+
   // Handle WiFi provisioning if in provisioning mode
   if (provisioningMode) {
     handleProvisioning();
@@ -169,74 +134,55 @@ void loop() {
     // Check if provisioning timeout has expired
     if (millis() - provisioningStartTime >= PROVISIONING_TIMEOUT_MS) {
       if (WiFi.status() != WL_CONNECTED) {
-        Serial.println("Provisioning timeout - no WiFi connection");
-        Serial.println("Restarting to retry...");
-        delay(1000);
+        LOG_W("Provisioning timeout - no WiFi connection, restarting to retry...");
+        logIdleDelay(1000);
+        energyEndWake(0);
         ESP.restart();
       } else {
         // WiFi connected, exit provisioning mode
-        Serial.println("Exiting provisioning mode - WiFi connected");
+        LOG_I("Exiting provisioning mode - WiFi connected");
         provisioningMode = false;
         
         // Initialize ESP-NOW now that we have WiFi
-        WiFi.mode(WIFI_STA);
-        Serial.print("Sensor Node MAC Address: ");
-        Serial.println(WiFi.macAddress());
-        
-        if (!initializeESPNOW()) {
-          LOG("ESP-NOW initialization failed");
+        if (!bringUpRadio()) {
+          LOG_E("ESP-NOW initialization failed");
+          energyEndWake(0);
           ESP.restart();
         }
       }
     }
     
     // Stay in provisioning loop
-    delay(100);
+    logIdleDelay(100);
     return;
   }
   
   // Check if BLE timeout has expired (for basic pairing mode)
   if (btEnabled && (millis() - btStartTime >= BT_TIMEOUT_MS)) {
-    Serial.println("BLE timeout - disabling BLE");
+    LOG_I("BLE timeout - disabling BLE");
     BLEDevice::deinit();
+    energyEnd(POWER_BLE);
     btEnabled = false;
   }
 
-  LOG("Loop start - Reading sensor");
+  uint64_t sleepUs = runWakeCycle();
 
-  float batteryVoltage = readBatteryVoltage();
-  float d = readSmoothedDistanceCm();
-  
-  if (isnan(d)) {
-    LOG("Distance read FAILED - using fallback value");
-    d = 80.0f;
-  } else {
-    LOG("Distance read OK");
-  }
+  {
+    PROFILE_SCOPE(PHASE_SLEEP_PREP);
 
-  // Calculate values
-  sensorData.distance_cm = d;
-  float pct = (emptyDistanceCm - d) / (emptyDistanceCm - fullDistanceCm) * 100.0f;
-  
-  // Clamp percentage between 0-100%
-  if (pct < 0.0f) pct = 0.0f;
-  if (pct > 100.0f) pct = 100.0f;
-  
-  sensorData.level_percent = pct;
-  sensorData.litres_remaining = (pct / 100.0f) * tankCapacityLitres;
-  sensorData.timestamp = millis();
-  sensorData.battery_v = batteryVoltage;
-  Serial.print("Battery Voltage(V): "); Serial.println(batteryVoltage, 2);
-  Serial.print("Distance(cm): "); Serial.println(sensorData.distance_cm);
-  Serial.print("Level(%): "); Serial.println(sensorData.level_percent);
-  Serial.print("Litres: "); Serial.println(sensorData.litres_remaining);
-
-  // Send sensor data (handles retries and channel rescanning internally)
-  sendSensorData(sensorData);
-
-  LOG("Entering deep sleep for 1 hour");
-  delay(1000);
-  
-  //esp_sleep_enable_timer_wakeup(SLEEP_TIME_US);
-  //esp_deep_sleep_start();
+    // Keep the BLE pairing window open for its full length before sleeping
+    if (btEnabled) {
+      unsigned long elapsed = millis() - btStartTime;
+      if (elapsed < BT_TIMEOUT_MS) {
+        LOG_I("Waiting for the BLE pairing window to close");
+        logIdleDelay(BT_TIMEOUT_MS - elapsed);
+      }
+      BLEDevice::deinit();
+      energyEnd(POWER_BLE);
+      btEnabled = false;
+    }
+
+    LOG_I("Entering deep sleep");
+  }
+  enterDeepSleep(sleepUs);
 }
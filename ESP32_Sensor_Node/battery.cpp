@@ -0,0 +1,184 @@
+/*
+ * Battery Monitor and Power Governor Implementation
+ */
+
+#include "battery.h"
+#include "hal.h"
+#include "measure_math.h"
+#include "node_clock.h"
+#include "node_log.h"
+#include "profiler.h"
+#include "reading_batch.h"
+#include <string.h>
+
+static_assert(GOVERNOR_CONSERVE_SAMPLES >= 1 && GOVERNOR_CONSERVE_SAMPLES <= samplesPerUpdate &&
+              GOVERNOR_CRITICAL_SAMPLES >= 1 && GOVERNOR_CRITICAL_SAMPLES <= samplesPerUpdate,
+              "governor sample limits must be 1..samplesPerUpdate");
+
+static const uint32_t BATTERY_STATE_MAGIC = 0x42415431;  // "BAT1"
+
+typedef struct BatteryState {
+  uint32_t magic;
+  uint64_t lastMs;            // Node clock of the last measurement
+  float voltage;              // Smoothed voltage (0 = never measured)
+  float trendMvPerDay;        // Smoothed change of the smoothed voltage
+  uint16_t wakesSinceMeasure;
+  uint8_t governor;           // GovernorState
+  uint8_t reserved;
+  uint32_t stateWakes[GOVERNOR_STATE_COUNT];
+} BatteryState;
+
+// RTC memory battery state (survives deep sleep)
+RTC_DATA_ATTR BatteryState batteryState;
+
+static bool stateValid() {
+  return batteryState.magic == BATTERY_STATE_MAGIC;
+}
+
+// The battery stage may initialise the state while the sensor stage reads
+// the governor, so both sides take the critical section
+static void stateInit() {
+  halCriticalEnter();
+  if (!stateValid()) {
+    memset(&batteryState, 0, sizeof(batteryState));
+    batteryState.magic = BATTERY_STATE_MAGIC;
+  }
+  halCriticalExit();
+}
+
+float readBatteryVoltage() {
+  PROFILE_SCOPE(PHASE_BATTERY);
+  stateInit();
+
+  // Once the governor has stepped down, wakes are rare and every one measures
+  int every = batteryState.governor == GOVERNOR_NORMAL ? BATTERY_MEASURE_EVERY_WAKES : 1;
+  if (batteryState.voltage > 0.0f) {
+    batteryState.wakesSinceMeasure++;
+    if (batteryState.wakesSinceMeasure < every) {
+      return batteryState.voltage;
+    }
+  }
+
+  // Averaging N conversions cuts the ADC noise by sqrt(N)
+  uint32_t sumMv = 0;
+  for (int i = 0; i < BATTERY_OVERSAMPLES; i++) {
+    sumMv += halAnalogReadMilliVolts(BATTERY_VOLTAGE_PIN);
+  }
+#if ENABLE_FIXED_POINT
+  float volts = batteryMilliVoltsFromSum(sumMv, BATTERY_OVERSAMPLES) / 1000.0f;
+#else
+  float volts = batteryVoltsFromSum(sumMv, BATTERY_OVERSAMPLES);
+#endif
+  batteryRecord(volts, nodeClockMs());
+
+  LOG_D("Battery measured: %lu mV at the pin over %d samples, %.3f V (smoothed %.3f V)",
+        (unsigned long)(sumMv / BATTERY_OVERSAMPLES), BATTERY_OVERSAMPLES, volts, batteryState.voltage);
+  return batteryState.voltage;
+}
+
+void batteryRecord(float volts, uint64_t nowMs) {
+  stateInit();
+
+  if (batteryState.voltage <= 0.0f) {
+    batteryState.voltage = volts;
+  } else {
+    float previous = batteryState.voltage;
+    batteryState.voltage += BATTERY_TREND_SMOOTHING * (volts - previous);
+    if (nowMs > batteryState.lastMs) {
+      float days = (float)(nowMs - batteryState.lastMs) / 86400000.0f;
+      float slope = (batteryState.voltage - previous) * 1000.0f / days;
+      batteryState.trendMvPerDay += BATTERY_TREND_SMOOTHING * (slope - batteryState.trendMvPerDay);
+    }
+  }
+  batteryState.lastMs = nowMs;
+  batteryState.wakesSinceMeasure = 0;
+}
+
+float batteryVoltage() {
+  return stateValid() ? batteryState.voltage : 0.0f;
+}
+
+float batteryTrendMvPerDay() {
+  return stateValid() ? batteryState.trendMvPerDay : 0.0f;
+}
+
+bool governorUpdate() {
+  stateInit();
+
+  GovernorState state = (GovernorState)batteryState.governor;
+  GovernorState next = state;
+  float v = batteryState.voltage;
+
+  if (ENABLE_POWER_GOVERNOR && v > 0.0f) {
+    // Step down at a threshold; step back up only past it plus the hysteresis
+    float conserveBelow = GOVERNOR_CONSERVE_V + (state != GOVERNOR_NORMAL ? GOVERNOR_HYSTERESIS_V : 0.0f);
+    float criticalBelow = GOVERNOR_CRITICAL_V + (state == GOVERNOR_CRITICAL ? GOVERNOR_HYSTERESIS_V : 0.0f);
+    if (v < criticalBelow) {
+      next = GOVERNOR_CRITICAL;
+    } else if (v < conserveBelow) {
+      next = GOVERNOR_CONSERVE;
+    } else {
+      next = GOVERNOR_NORMAL;
+    }
+  }
+
+  batteryState.governor = (uint8_t)next;
+  batteryState.stateWakes[next]++;
+  return next != state;
+}
+
+// Read-only: the sensor stage asks while the battery stage may be measuring
+GovernorState governorState() {
+  halCriticalEnter();
+  GovernorState state = stateValid() ? (GovernorState)batteryState.governor : GOVERNOR_NORMAL;
+  halCriticalExit();
+  return state;
+}
+
+uint32_t governorSleepS(uint32_t sleepS) {
+  uint32_t factor = 1;
+  switch (governorState()) {
+    case GOVERNOR_CONSERVE: factor = GOVERNOR_CONSERVE_SLEEP_FACTOR; break;
+    case GOVERNOR_CRITICAL: factor = GOVERNOR_CRITICAL_SLEEP_FACTOR; break;
+    default: break;
+  }
+  if (factor == 1) return sleepS;
+
+  uint64_t stretched = (uint64_t)sleepS * factor;
+  if (stretched < GOVERNOR_MAX_SLEEP_S) return (uint32_t)stretched;
+  return sleepS > GOVERNOR_MAX_SLEEP_S ? sleepS : GOVERNOR_MAX_SLEEP_S;
+}
+
+int governorSampleLimit() {
+  switch (governorState()) {
+    case GOVERNOR_CONSERVE: return GOVERNOR_CONSERVE_SAMPLES;
+    case GOVERNOR_CRITICAL: return GOVERNOR_CRITICAL_SAMPLES;
+    default: return samplesPerUpdate;
+  }
+}
+
+uint8_t governorSendMask() {
+  switch (governorState()) {
+    case GOVERNOR_CONSERVE: return GOVERNOR_CONSERVE_SEND_MASK;
+    case GOVERNOR_CRITICAL: return GOVERNOR_CRITICAL_SEND_MASK;
+    default: return 0xFF;
+  }
+}
+
+uint32_t governorWakes(GovernorState state) {
+  return stateValid() && state < GOVERNOR_STATE_COUNT ? batteryState.stateWakes[state] : 0;
+}
+
+const char* governorStateName(GovernorState state) {
+  switch (state) {
+    case GOVERNOR_NORMAL:   return "normal";
+    case GOVERNOR_CONSERVE: return "conserve";
+    case GOVERNOR_CRITICAL: return "critical";
+    default: break;
+  }
+  return "?";
+}
+
+void batteryReset() {
+  memset(&batteryState, 0, sizeof(batteryState));
+}
@@ -0,0 +1,60 @@
+/*
+ * Battery Monitor and Power Governor
+ *
+ * Measures the battery every BATTERY_MEASURE_EVERY_WAKES wakes from
+ * BATTERY_OVERSAMPLES calibrated ADC conversions and keeps a smoothed
+ * voltage and its trend in RTC memory. The governor turns that voltage
+ * into a power state (normal, conserve, critical, with hysteresis), and
+ * the wake cycle asks it how long to sleep, how many pings to fire and
+ * which sends can wait. Thresholds are in config.h.
+ */
+
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include <stdint.h>
+#include "config.h"
+
+enum GovernorState : uint8_t {
+  GOVERNOR_NORMAL = 0,
+  GOVERNOR_CONSERVE,
+  GOVERNOR_CRITICAL,
+  GOVERNOR_STATE_COUNT
+};
+
+// Pipeline stage: smoothed battery voltage. Measures only when due and
+// returns the RTC value otherwise
+float readBatteryVoltage();
+
+// Fold a new measurement (volts) taken at nowMs into the smoothed voltage
+// and trend. readBatteryVoltage() calls this; exposed for host tests
+void batteryRecord(float volts, uint64_t nowMs);
+
+// Smoothed voltage (0 before the first measurement) and its trend in mV/day
+float batteryVoltage();
+float batteryTrendMvPerDay();
+
+// Re-evaluate the power state from the smoothed voltage. Call once per
+// wake after the battery stage. Returns true if the state changed
+bool governorUpdate();
+
+GovernorState governorState();
+
+// Sleep stretched for the current state (at most GOVERNOR_MAX_SLEEP_S)
+uint32_t governorSleepS(uint32_t sleepS);
+
+// Most pings one reading may fire in the current state
+int governorSampleLimit();
+
+// BATCH_REASON_* flags that may still bring the radio up
+uint8_t governorSendMask();
+
+// Wakes spent in each state since power-on
+uint32_t governorWakes(GovernorState state);
+
+const char* governorStateName(GovernorState state);
+
+// Forget the measurements and go back to normal
+void batteryReset();
+
+#endif // BATTERY_H
@@ -0,0 +1,108 @@
+/*
+ * Gateway Channel Discovery Implementation
+ */
+
+#include "channel_discovery.h"
+#include <string.h>
+
+static const uint32_t DISCOVERY_TABLE_MAGIC = 0x44534331;  // "DSC1"
+static const uint8_t DISCOVERY_MAX_SUCCESSES = 8;
+
+// Channel order used to break ties - common AP channels first
+static const uint8_t priorOrder[DISCOVERY_CHANNELS] = {1, 6, 11, 2, 3, 4, 5, 7, 8, 9, 10, 12, 13};
+
+static int channelScore(const DiscoveryTable& table, int channel, int hintChannel) {
+  const ChannelStats& stats = table.channels[channel - 1];
+  // Successes saturate so an old favourite cannot outrank a fresh answer for long
+  int score = stats.successes * 4 - stats.failures * 8;
+
+  // Recent successes count more: +64 for this scan, halving per scan since
+  if (stats.lastSuccessScan != 0) {
+    uint16_t age = (uint16_t)(table.scans - stats.lastSuccessScan);
+    score += age < 6 ? (64 >> age) : 0;
+  }
+
+  if (channel == hintChannel) {
+    score += 128;
+  }
+  return score;
+}
+
+void discoveryInit(DiscoveryTable& table) {
+  if (table.magic == DISCOVERY_TABLE_MAGIC) return;
+  memset(&table, 0, sizeof(table));
+  table.magic = DISCOVERY_TABLE_MAGIC;
+}
+
+void discoveryRankChannels(const DiscoveryTable& table, int hintChannel, uint8_t order[DISCOVERY_CHANNELS]) {
+  int scores[DISCOVERY_CHANNELS];
+  for (int i = 0; i < DISCOVERY_CHANNELS; i++) {
+    order[i] = priorOrder[i];
+    scores[i] = channelScore(table, priorOrder[i], hintChannel);
+  }
+
+  // Stable insertion sort so ties keep the prior order
+  for (int i = 1; i < DISCOVERY_CHANNELS; i++) {
+    uint8_t channel = order[i];
+    int score = scores[i];
+    int j = i - 1;
+    while (j >= 0 && scores[j] < score) {
+      order[j + 1] = order[j];
+      scores[j + 1] = scores[j];
+      j--;
+    }
+    order[j + 1] = channel;
+    scores[j + 1] = score;
+  }
+}
+
+uint32_t discoveryAckTimeoutUs(const DiscoveryTable& table) {
+  if (table.ackLatencyUs == 0) return DISCOVERY_ACK_DEFAULT_US;
+
+  uint32_t timeoutUs = table.ackLatencyUs * DISCOVERY_ACK_LATENCY_FACTOR;
+  if (timeoutUs < DISCOVERY_ACK_MIN_US) timeoutUs = DISCOVERY_ACK_MIN_US;
+  if (timeoutUs > DISCOVERY_ACK_MAX_US) timeoutUs = DISCOVERY_ACK_MAX_US;
+  return timeoutUs;
+}
+
+void discoveryRecord(DiscoveryTable& table, int channel, bool success, uint32_t ackUs) {
+  if (channel < 1 || channel > DISCOVERY_CHANNELS) return;
+  ChannelStats& stats = table.channels[channel - 1];
+
+  if (success) {
+    if (stats.successes < DISCOVERY_MAX_SUCCESSES) stats.successes++;
+    stats.failures = 0;
+    stats.lastSuccessScan = table.scans == 0 ? 1 : table.scans;
+
+    // Smooth the ack latency (1/4 weight for the new sample)
+    if (table.ackLatencyUs == 0) {
+      table.ackLatencyUs = ackUs;
+    } else {
+      table.ackLatencyUs = (table.ackLatencyUs * 3 + ackUs) / 4;
+    }
+  } else if (stats.failures < 255) {
+    stats.failures++;
+  }
+}
+
+int discoverChannel(DiscoveryTable& table, int hintChannel, ChannelProbeFn probe) {
+  discoveryInit(table);
+  table.scans++;
+  if (table.scans == 0) table.scans = 1;  // 0 means "never" in lastSuccessScan
+
+  uint8_t order[DISCOVERY_CHANNELS];
+  discoveryRankChannels(table, hintChannel, order);
+
+  for (int pass = 0; pass < DISCOVERY_PASSES; pass++) {
+    for (int i = 0; i < DISCOVERY_CHANNELS; i++) {
+      int channel = order[i];
+      uint32_t ackUs = 0;
+      bool acked = probe(channel, discoveryAckTimeoutUs(table), &ackUs);
+      discoveryRecord(table, channel, acked, ackUs);
+      if (acked) {
+        return channel;
+      }
+    }
+  }
+  return 0;
+}
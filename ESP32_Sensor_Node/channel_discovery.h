@@ -0,0 +1,52 @@
+/*
+ * Gateway Channel Discovery
+ *
+ * Keeps a per-channel success/recency score table (in RTC memory on the
+ * node) and probes channels in score order. Ack waits adapt to the
+ * measured radio turnaround. The engine only talks to the radio through a
+ * probe callback, so it can be driven by a simulated gateway on a host.
+ */
+
+#ifndef CHANNEL_DISCOVERY_H
+#define CHANNEL_DISCOVERY_H
+
+#include <stdint.h>
+#include "config.h"
+
+#define DISCOVERY_CHANNELS 13  // WiFi channels 1-13
+
+typedef struct ChannelStats {
+  uint8_t successes;         // Acked probes/sends (saturates at 8)
+  uint8_t failures;          // Saturating count of failed probes since last success
+  uint16_t lastSuccessScan;  // Scan number of the last success (0 = never)
+} ChannelStats;
+
+typedef struct DiscoveryTable {
+  uint32_t magic;
+  uint16_t scans;            // Discovery runs since the table was created
+  uint16_t reserved;
+  uint32_t ackLatencyUs;     // Smoothed send-to-callback latency (0 = unknown)
+  ChannelStats channels[DISCOVERY_CHANNELS];
+} DiscoveryTable;
+
+// Try one channel: send a probe and wait up to ackTimeoutUs for the send
+// callback. Returns true if the Cloud Node acked; ackUs gets the latency.
+typedef bool (*ChannelProbeFn)(int channel, uint32_t ackTimeoutUs, uint32_t* ackUs);
+
+// Reset the table if it is uninitialised (e.g. after power-on)
+void discoveryInit(DiscoveryTable& table);
+
+// Fill order[] with channels 1-13, best score first.
+// hintChannel (0 = none) gets a bonus, e.g. the channel cached from last wake
+void discoveryRankChannels(const DiscoveryTable& table, int hintChannel, uint8_t order[DISCOVERY_CHANNELS]);
+
+// Ack wait for the next probe, derived from the smoothed latency
+uint32_t discoveryAckTimeoutUs(const DiscoveryTable& table);
+
+// Record the outcome of a probe or a normal send on a channel
+void discoveryRecord(DiscoveryTable& table, int channel, bool success, uint32_t ackUs);
+
+// Probe channels in score order. Returns the channel that answered, or 0
+int discoverChannel(DiscoveryTable& table, int hintChannel, ChannelProbeFn probe);
+
+#endif // CHANNEL_DISCOVERY_H
@@ -11,6 +11,15 @@
 static const unsigned long BT_TIMEOUT_MS = 2ULL * 60ULL * 1000ULL; // 2 minutes
 static const char* BT_DEVICE_NAME = "ESP32-Sensor-Node";
 static const unsigned long PROVISIONING_TIMEOUT_MS = 5ULL * 60ULL * 1000ULL; // 5 minutes for WiFi provisioning
+// Set to 1 to also publish device info in binary TLV form (device_info.h)
+// on its own characteristic. The JSON characteristic is always there.
+#ifndef ENABLE_DEVICE_INFO_TLV
+#define ENABLE_DEVICE_INFO_TLV 1
+#endif
+// ATT MTU the node offers when a client connects. A notify carries MTU - 3
+// bytes, so the BLE maximum of 517 fits the longest device info JSON. The
+// client may settle on less; device info is then only notified if it fits.
+static const uint16_t BLE_MTU = 517;
 
 // ----------- Pins (change to suit your ESP32-C3 Super Mini wiring) -----------
 // SR04M-2 board labeled RX/TX but can work in standard trigger/echo mode
@@ -26,8 +35,138 @@ static const int BATTERY_VOLTAGE_PIN = 0;  // ADC pin for battery voltage via vo
 // Therefore: Battery_Voltage = ADC_Voltage * 2.0
 static const float VOLTAGE_DIVIDER_RATIO = 2.0f;
 
+// ----------- Firmware -----------
+// Bump on every release so profiler history can be compared across versions
+#define FIRMWARE_VERSION 0x0100  // 1.0
+
+// ----------- RTC Memory -----------
+// RTC_DATA_ATTR places a variable in RTC slow memory, which survives deep
+// sleep. Every module that keeps state across wakes takes it from here.
+// Host tools keep that state in plain RAM; the simulation passes its own
+// definition on the command line (see hal_linux.cpp).
+#ifdef ARDUINO
+#include <esp_attr.h>
+#endif
+#ifndef RTC_DATA_ATTR
+#define RTC_DATA_ATTR
+#endif
+
+// ----------- Wake-cycle Profiler -----------
+// Set to 1 to time each wake phase and keep a history in RTC memory.
+// When 0 the profiler compiles out completely.
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 0
+#endif
+// Set to 1 to append the previous cycle's awake time to struct_message
+// (the Cloud Node must use the same struct layout)
+#ifndef PROFILER_IN_FRAME
+#define PROFILER_IN_FRAME 0
+#endif
+#define PROFILER_HISTORY_LEN 8  // Number of cycles kept in RTC memory
+
+// ----------- Wake Pipeline -----------
+// Set to 1 to bring the radio up while the battery and sensor are read,
+// joining only at transmit time. 0 runs the stages one after another.
+#ifndef ENABLE_WAKE_PIPELINE
+#define ENABLE_WAKE_PIPELINE 1
+#endif
+
+// ----------- Wire Format -----------
+//   WIRE_FORMAT_V2     - compact versioned frames with quantized fields (wire_format.h)
+//   WIRE_FORMAT_LEGACY - raw struct_message (and v1 batch frames) for older Cloud Nodes
+#define WIRE_FORMAT_LEGACY 1
+#define WIRE_FORMAT_V2 2
+#ifndef WIRE_FORMAT
+#define WIRE_FORMAT WIRE_FORMAT_V2
+#endif
+
+// ----------- Store-and-Forward Batching -----------
+// Buffer readings in RTC memory and send them as one frame every
+// BATCH_SEND_EVERY_WAKES wakes. Sent sooner when the oldest reading reaches
+// BATCH_MAX_AGE_S, the buffer is full, or the level moves by
+// BATCH_TRIGGER_LEVEL_DELTA percent. 0 sends a single reading every wake.
+#ifndef ENABLE_BATCHING
+#define ENABLE_BATCHING 1
+#endif
+static const int BATCH_SEND_EVERY_WAKES = 4;
+static const uint32_t BATCH_MAX_AGE_S = 30UL * 60UL;  // 30 minutes
+static const float BATCH_TRIGGER_LEVEL_DELTA = 5.0f;
+
+// ----------- Report-on-Change -----------
+// Skip readings (and the radio) while distance, level and battery stay
+// within their deadbands of the last reported reading. A heartbeat goes out
+// after REPORT_HEARTBEAT_CYCLES suppressed wakes; a level move of
+// REPORT_URGENT_LEVEL_DELTA goes out immediately. The values below are
+// defaults - they can be changed through the properties JSON.
+#ifndef ENABLE_REPORT_ON_CHANGE
+#define ENABLE_REPORT_ON_CHANGE 1
+#endif
+static const float REPORT_DEADBAND_DISTANCE_CM = 1.0f;
+static const float REPORT_DEADBAND_LEVEL_PERCENT = 1.0f;
+static const float REPORT_DEADBAND_BATTERY_V = 0.05f;
+static const float REPORT_URGENT_LEVEL_DELTA = 5.0f;
+static const uint16_t REPORT_HEARTBEAT_CYCLES = 12;  // 1 hour at 5-minute wakes
+
 // ----------- Deep Sleep Configuration -----------
-static const uint64_t SLEEP_TIME_US = 5ULL * 60ULL * 1000000ULL; // 1 hour
+// Sleep defaults to refreshRateSeconds. With ENABLE_ADAPTIVE_SLEEP it
+// shortens while the level moves (aiming for SLEEP_TARGET_DELTA_PCT per
+// wake) and stretches by SLEEP_STRETCH_FACTOR per wake while the level is
+// static or the battery is below SLEEP_LOW_BATTERY_V.
+#ifndef ENABLE_ADAPTIVE_SLEEP
+#define ENABLE_ADAPTIVE_SLEEP 1
+#endif
+static const uint32_t SLEEP_MIN_S = 60;                // Floor while filling/draining
+static const uint32_t SLEEP_MAX_S = 60UL * 60UL;       // Ceiling while static (1 hour)
+static const float SLEEP_TARGET_DELTA_PCT = 1.0f;      // Level change wanted per wake when moving
+static const float SLEEP_LEVEL_NOISE_PCT = 1.0f;       // Per-wake changes up to this count as static
+static const float SLEEP_STATIC_RATE_PCT_PER_H = 0.5f; // Below this rate the tank is static
+static const float SLEEP_RATE_SMOOTHING = 0.5f;        // EWMA weight of the newest rate
+static const float SLEEP_STRETCH_FACTOR = 1.5f;
+static const float SLEEP_LOW_BATTERY_V = 3.5f;
+
+// ----------- Battery Governor -----------
+// The battery is measured every BATTERY_MEASURE_EVERY_WAKES wakes (every
+// wake outside normal) as the mean of BATTERY_OVERSAMPLES calibrated ADC
+// conversions; wakes in between reuse the smoothed voltage in RTC memory.
+// With ENABLE_POWER_GOVERNOR the node steps down to conserve / critical as
+// that voltage falls below the thresholds, and back up once it is
+// GOVERNOR_HYSTERESIS_V above them. Conserve and critical multiply the
+// sleep, cap the pings per reading and only send for the BATCH_REASON_*
+// flags in their send mask.
+#ifndef ENABLE_POWER_GOVERNOR
+#define ENABLE_POWER_GOVERNOR 1
+#endif
+static const int BATTERY_OVERSAMPLES = 16;
+static const int BATTERY_MEASURE_EVERY_WAKES = 12;
+static const float BATTERY_TREND_SMOOTHING = 0.3f;     // EWMA weight of the newest measurement
+static const float GOVERNOR_CONSERVE_V = 3.6f;
+static const float GOVERNOR_CRITICAL_V = 3.4f;
+static const float GOVERNOR_HYSTERESIS_V = 0.05f;
+static const uint32_t GOVERNOR_CONSERVE_SLEEP_FACTOR = 2;
+static const uint32_t GOVERNOR_CRITICAL_SLEEP_FACTOR = 4;
+static const uint32_t GOVERNOR_MAX_SLEEP_S = 6UL * 60UL * 60UL;  // 6 hours
+static const int GOVERNOR_CONSERVE_SAMPLES = 3;
+static const int GOVERNOR_CRITICAL_SAMPLES = 1;
+// Scheduled sends and heartbeats are the non-essential traffic. The
+// BATCH_REASON_* flags come from reading_batch.h where the masks are used.
+#define GOVERNOR_CONSERVE_SEND_MASK \
+  (BATCH_REASON_AGE | BATCH_REASON_FULL | BATCH_REASON_CHANGE | BATCH_REASON_URGENT)
+#define GOVERNOR_CRITICAL_SEND_MASK (BATCH_REASON_FULL | BATCH_REASON_CHANGE | BATCH_REASON_URGENT)
+
+// ----------- Energy Accounting -----------
+// Current of each power state in microamps. CPU active applies to the
+// whole awake time; radio, sensor and BLE currents are added on top while
+// they are on. Deep sleep includes the battery divider (~20 uA at 4 V).
+// Measure your board and edit these - the mAh totals are only as good as they are.
+static const uint32_t ENERGY_CPU_ACTIVE_UA = 22000;
+static const uint32_t ENERGY_RADIO_RX_UA = 60000;
+static const uint32_t ENERGY_RADIO_TX_UA = 200000;
+static const uint32_t ENERGY_SENSOR_UA = 8000;
+static const uint32_t ENERGY_BLE_UA = 12000;
+static const uint32_t ENERGY_DEEP_SLEEP_UA = 30;
+static const uint32_t ENERGY_TX_BITRATE_KBPS = 1000;   // ESP-NOW default rate
+static const uint32_t ENERGY_TX_OVERHEAD_BYTES = 60;   // 802.11 + ESP-NOW headers and the ack
+static const float ENERGY_BATTERY_MAH = 2000.0f;       // For the projected battery life
 
 // ----------- Tank calibration (EDIT THESE) -----------
 // These values can be updated via BLE from the frontend
@@ -37,9 +176,105 @@ extern float fullDistanceCm;
 extern float tankCapacityLitres;
 extern uint32_t refreshRateSeconds;
 
+// ----------- Tank Geometry -----------
+// Litres come from a strapping table of 2^TANK_STRAP_SEGMENTS_LOG2 + 1
+// volume fractions, built from the tank shape (or calibration points) when
+// the properties are written. 64 segments (132 bytes) keep horizontal
+// cylinders and capsules within 0.05 % of capacity; 32 reach 0.14 % near
+// the top and bottom, where the cross-section changes fastest (sim/tank_bench.cpp)
+#ifndef TANK_STRAP_SEGMENTS_LOG2
+#define TANK_STRAP_SEGMENTS_LOG2 6
+#endif
+static const int TANK_CALIBRATION_MAX_POINTS = 12;  // Pairs in the "strapping" property
+
 // ----------- Measurement settings -----------
 static const int samplesPerUpdate = 7;
 static const float speedOfSoundCmPerUs = 0.0343f;
+static const float SENSOR_MIN_RANGE_CM = 20.0f;   // SR04M-2 range: 20cm to 620cm
+static const float SENSOR_MAX_RANGE_CM = 620.0f;
+static const unsigned long SENSOR_STABILIZE_MS = 50;  // Settle time after power-up
+
+// Acquisition mode:
+//   SENSOR_ACQ_BURST    - power the sensor once and fire all pings back to back
+//   SENSOR_ACQ_PER_PING - power cycle the sensor for every ping (original path, for A/B tests)
+#define SENSOR_ACQ_PER_PING 0
+#define SENSOR_ACQ_BURST 1
+#ifndef SENSOR_ACQUISITION_MODE
+#define SENSOR_ACQUISITION_MODE SENSOR_ACQ_BURST
+#endif
+
+// Burst timing is derived from emptyDistanceCm:
+//   echo timeout = flight time to emptyDistanceCm * ECHO_RANGE_MARGIN and back
+//   ping spacing = echo timeout * ECHO_DECAY_FACTOR, at least ECHO_DECAY_MIN_MS
+static const float ECHO_RANGE_MARGIN = 1.25f;
+static const float ECHO_DECAY_FACTOR = 2.0f;
+static const unsigned long ECHO_DECAY_MIN_MS = 20;
+static const unsigned long PER_PING_ECHO_TIMEOUT_US = 30000UL;  // Fixed timeout of the per-ping path
+static const unsigned long PER_PING_INTERVAL_MS = 120;          // Fixed spacing of the per-ping path
+
+// Echo capture backend:
+//   ECHO_BACKEND_INTERRUPT - GPIO interrupt + esp_timer timestamps (CPU free during flight)
+//   ECHO_BACKEND_PULSEIN   - busy-wait in pulseIn()
+#define ECHO_BACKEND_PULSEIN 0
+#define ECHO_BACKEND_INTERRUPT 1
+#ifndef SENSOR_ECHO_BACKEND
+#define SENSOR_ECHO_BACKEND ECHO_BACKEND_INTERRUPT
+#endif
+
+// Adaptive sampling: stop pinging as soon as the accepted samples agree.
+// Takes at least adaptiveMinSamples and at most adaptiveMaxSamples pings and
+// stops once their range (max - min) is within adaptiveToleranceCm.
+// Noisy readings that never converge fall back to the DISTANCE_FILTER chain.
+#ifndef ENABLE_ADAPTIVE_SAMPLING
+#define ENABLE_ADAPTIVE_SAMPLING 1
+#endif
+static const int adaptiveMinSamples = 3;
+static const int adaptiveMaxSamples = samplesPerUpdate;
+static const float adaptiveToleranceCm = 0.5f;
+
+// Filter chain that turns a burst into one reading (distance_filter.h):
+//   DISTANCE_FILTER_TRIMMED_MEAN - mean without the lowest and highest sample (5+ samples)
+//   DISTANCE_FILTER_MEDIAN       - median
+//   DISTANCE_FILTER_HAMPEL       - drop samples > K scaled MADs from the median, then mean
+//                                  (isolated spikes, e.g. foam)
+//   DISTANCE_FILTER_BIN_MODE     - mean of the largest cluster within the bin width
+//                                  (baffle or sidewall echoes that repeat)
+#define DISTANCE_FILTER_TRIMMED_MEAN 0
+#define DISTANCE_FILTER_MEDIAN 1
+#define DISTANCE_FILTER_HAMPEL 2
+#define DISTANCE_FILTER_BIN_MODE 3
+#ifndef DISTANCE_FILTER
+#define DISTANCE_FILTER DISTANCE_FILTER_TRIMMED_MEAN
+#endif
+#define DISTANCE_FILTER_HAMPEL_K_TENTHS 30  // K = 3.0
+#define DISTANCE_FILTER_BIN_WIDTH_MM 20     // 2 cm
+
+// Set to 1 to run the measurement path (echo time to distance, filter
+// chain, adaptive mean, level, litres, battery ADC) in integer and Q16.16
+// fixed point (measure_math.h). The ESP32-C3 has no FPU, so every float
+// operation there is a software routine. 0 keeps the float path.
+#ifndef ENABLE_FIXED_POINT
+#define ENABLE_FIXED_POINT 1
+#endif
+
+// Cross-wake level estimator (level_estimator.h): a Kalman filter on
+// distance and rate kept in RTC memory. While its prediction is tighter
+// than LEVEL_ESTIMATOR_MAX_SIGMA_CM a wake fires only LEVEL_ESTIMATOR_PINGS
+// pings and fuses them; pings further than LEVEL_ESTIMATOR_GATE_SIGMA
+// standard deviations from the prediction (refill, echo off something
+// else) escalate to the full reading above.
+#ifndef ENABLE_LEVEL_ESTIMATOR
+#define ENABLE_LEVEL_ESTIMATOR 1
+#endif
+static const int LEVEL_ESTIMATOR_PINGS = 2;
+static const float LEVEL_ESTIMATOR_PING_SIGMA_CM = 0.3f;     // Noise of a single ping
+static const float LEVEL_ESTIMATOR_BURST_SIGMA_CM = 0.15f;   // Noise of a filtered full reading
+static const float LEVEL_ESTIMATOR_RATE_SIGMA_CM_H = 10.0f;  // Rate uncertainty of a new track
+static const float LEVEL_ESTIMATOR_ACCEL_CM2_H3 = 10.0f;     // Process noise: rate changes (cm/h per sqrt(h))^2
+static const float LEVEL_ESTIMATOR_DRIFT_CM2_H = 0.05f;      // Process noise: distance drift (temperature)
+static const float LEVEL_ESTIMATOR_GATE_SIGMA = 3.5f;
+static const float LEVEL_ESTIMATOR_MAX_SIGMA_CM = 3.0f;
+static const float LEVEL_ESTIMATOR_CONFIDENCE_CM = 1.0f;     // Confidence = P(|error| <= this)
 
 // ----------- ESP-NOW Configuration -----------
 // MAC Address of the Cloud ESP32 (EDIT THIS after you get it from Cloud Node)
@@ -50,6 +285,36 @@ extern uint8_t cloudNodeAddress[6]; // REPLACE WITH ACTUAL MAC in ESP32_Sensor_N
 // Set to 0 to enable auto-scanning, or set to a specific channel (1-13) to skip scanning
 #define WIFI_CHANNEL 0  // 0 = auto-scan, or set to specific channel (1-13)
 
+// Channel discovery: channels are probed in score order (past successes and
+// recency). The ack wait is DISCOVERY_ACK_LATENCY_FACTOR x the smoothed
+// send-callback latency, clamped to [DISCOVERY_ACK_MIN_US, DISCOVERY_ACK_MAX_US].
+static const uint32_t DISCOVERY_ACK_DEFAULT_US = 100000;  // Before any latency is known
+static const uint32_t DISCOVERY_ACK_MIN_US = 20000;
+static const uint32_t DISCOVERY_ACK_MAX_US = 250000;
+static const uint32_t DISCOVERY_ACK_LATENCY_FACTOR = 4;
+static const int DISCOVERY_PASSES = 2;  // Full passes over all channels before giving up
+
+// Sensor frames: wait for the send callback per attempt, and retry on the
+// same channel before rescanning
+static const uint32_t SENSOR_TX_ACK_TIMEOUT_MS = 500;
+static const uint8_t SENSOR_TX_RETRIES = 1;
+
+// ----------- Transmit Slots -----------
+// Nodes that power on together would otherwise wake, and transmit, in
+// lockstep. With ENABLE_TX_SLOTS each deep sleep is trimmed so the next
+// wake starts in this node's slot of a TX_SLOT_COUNT x TX_SLOT_WIDTH_MS
+// frame (node ID slot, or one assigned by the gateway) plus up to
+// TX_SLOT_JITTER_MS of jitter, and sensor frame retries wait a random
+// 0-TX_SLOT_BACKOFF_MAX_MS first. See tx_slot.h.
+#ifndef ENABLE_TX_SLOTS
+#define ENABLE_TX_SLOTS 1
+#endif
+static const uint16_t TX_SLOT_COUNT = 200;
+static const uint16_t TX_SLOT_WIDTH_MS = 50;        // 10 s frame
+static const uint16_t TX_SLOT_JITTER_MS = 20;
+static const uint16_t TX_SLOT_BACKOFF_MAX_MS = 40;
+static const uint16_t TX_SLOT_LISTEN_MS = 5;        // Wait for an assignment after a delivered frame (0 = never)
+
 // Structure to send data
 typedef struct struct_message {
   float distance_cm;
@@ -57,11 +322,32 @@ typedef struct struct_message {
   float litres_remaining;
   uint32_t timestamp;
   float battery_v;
+#if ENABLE_PROFILER && PROFILER_IN_FRAME
+  uint32_t last_cycle_us;     // Awake time of the previous wake cycle
+#endif
 } struct_message;
 
-// Logging macro
-#define LOG(msg) do { \
-  Serial.print("["); Serial.print(millis()); Serial.print(" ms] "); Serial.println(msg); \
-} while (0)
+// ----------- Logging (node_log.h) -----------
+// Messages above LOG_LEVEL compile out completely
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+// When stored records are formatted and printed:
+//   LOG_DRAIN_IMMEDIATE - as they are logged (blocking, like plain Serial prints)
+//   LOG_DRAIN_IDLE      - in idle waits (console delay at boot, BLE window, ...)
+//   LOG_DRAIN_AT_SLEEP  - once, right before deep sleep
+#define LOG_DRAIN_IMMEDIATE 0
+#define LOG_DRAIN_IDLE      1
+#define LOG_DRAIN_AT_SLEEP  2
+#ifndef LOG_DRAIN_MODE
+#define LOG_DRAIN_MODE LOG_DRAIN_IDLE
+#endif
+#define LOG_RING_BYTES 1024      // RTC memory for stored records (oldest dropped when full)
+#define LOG_MAX_STRING_LEN 48    // String arguments are copied, truncated to this
 
 #endif // CONFIG_H
@@ -0,0 +1,80 @@
+/*
+ * RTC Configuration Cache Implementation
+ */
+
+#include "config_cache.h"
+#include <string.h>
+
+static const uint32_t CONFIG_SNAPSHOT_MAGIC = 0x43464731;  // "CFG1"
+
+// RTC memory snapshot (survives deep sleep, zeroed on power-on)
+RTC_DATA_ATTR ConfigSnapshot configSnapshot;
+
+uint32_t computeCrc32(const void* data, size_t length) {
+  const uint8_t* bytes = (const uint8_t*)data;
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= bytes[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+  }
+  return ~crc;
+}
+
+static uint32_t snapshotCrc(const ConfigSnapshot& snapshot) {
+  return computeCrc32(&snapshot, offsetof(ConfigSnapshot, crc));
+}
+
+static bool snapshotValid() {
+  return configSnapshot.magic == CONFIG_SNAPSHOT_MAGIC &&
+         configSnapshot.version == CONFIG_SNAPSHOT_VERSION &&
+         configSnapshot.size == sizeof(ConfigSnapshot) &&
+         configSnapshot.crc == snapshotCrc(configSnapshot);
+}
+
+bool restoreConfigSnapshot() {
+  if (!snapshotValid()) {
+    return false;
+  }
+
+  emptyDistanceCm = configSnapshot.emptyDistanceCm;
+  fullDistanceCm = configSnapshot.fullDistanceCm;
+  tankCapacityLitres = configSnapshot.tankCapacityLitres;
+  refreshRateSeconds = configSnapshot.refreshRateSeconds;
+  reportThresholds = configSnapshot.reportThresholds;
+  memcpy(cloudNodeAddress, configSnapshot.cloudMAC, 6);
+  tankSetTable(configSnapshot.tankTable);
+  return true;
+}
+
+void refreshConfigSnapshot() {
+  // Keep the known channel across resets that preserve RTC memory
+  uint8_t channel = snapshotValid() ? configSnapshot.channel : 0;
+
+  memset(&configSnapshot, 0, sizeof(configSnapshot));
+  configSnapshot.magic = CONFIG_SNAPSHOT_MAGIC;
+  configSnapshot.version = CONFIG_SNAPSHOT_VERSION;
+  configSnapshot.size = sizeof(ConfigSnapshot);
+  configSnapshot.emptyDistanceCm = emptyDistanceCm;
+  configSnapshot.fullDistanceCm = fullDistanceCm;
+  configSnapshot.tankCapacityLitres = tankCapacityLitres;
+  configSnapshot.refreshRateSeconds = refreshRateSeconds;
+  configSnapshot.reportThresholds = reportThresholds;
+  memcpy(configSnapshot.cloudMAC, cloudNodeAddress, 6);
+  configSnapshot.channel = channel;
+  configSnapshot.tankTable = tankActiveTable();
+  configSnapshot.crc = snapshotCrc(configSnapshot);
+}
+
+int getCachedChannel() {
+  return snapshotValid() ? configSnapshot.channel : 0;
+}
+
+void setCachedChannel(int channel) {
+  if (!snapshotValid()) {
+    refreshConfigSnapshot();
+  }
+  configSnapshot.channel = (uint8_t)channel;
+  configSnapshot.crc = snapshotCrc(configSnapshot);
+}
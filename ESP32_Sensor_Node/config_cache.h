@@ -0,0 +1,53 @@
+/*
+ * RTC Configuration Cache
+ *
+ * Keeps a validated copy of the device configuration in RTC memory so
+ * deep-sleep wakes can skip the NVS reads. The snapshot carries a
+ * version and a CRC; NVS is only read on cold boot or when it fails.
+ */
+
+#ifndef CONFIG_CACHE_H
+#define CONFIG_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+#include "report_policy.h"
+#include "tank_geometry.h"
+
+// Bump whenever ConfigSnapshot changes layout
+#define CONFIG_SNAPSHOT_VERSION 3
+
+typedef struct ConfigSnapshot {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;               // sizeof(ConfigSnapshot) when written
+  float emptyDistanceCm;
+  float fullDistanceCm;
+  float tankCapacityLitres;
+  uint32_t refreshRateSeconds;
+  ReportThresholds reportThresholds;
+  uint8_t cloudMAC[6];
+  uint8_t channel;             // Last channel the Cloud Node answered on (0 = unknown)
+  uint8_t reserved;
+  TankStrapTable tankTable;
+  uint32_t crc;                // CRC32 of every field above
+} ConfigSnapshot;
+
+// CRC32 (IEEE 802.3, reflected) over a byte buffer
+uint32_t computeCrc32(const void* data, size_t length);
+
+// Validate the RTC snapshot and apply it to the config globals
+// Returns false (and leaves the globals untouched) if it is missing or corrupt
+bool restoreConfigSnapshot();
+
+// Capture the current config globals into the RTC snapshot
+void refreshConfigSnapshot();
+
+// Last known Cloud Node channel from the snapshot (0 if unknown)
+int getCachedChannel();
+
+// Store the Cloud Node channel in the snapshot
+void setCachedChannel(int channel);
+
+#endif // CONFIG_CACHE_H
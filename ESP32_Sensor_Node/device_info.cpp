@@ -0,0 +1,219 @@
+/*
+ * Device Info Serializer Implementation
+ */
+
+#include "device_info.h"
+#include "wire_format.h"
+#include <string.h>
+
+// Numbers beyond this are clamped so the JSON length stays bounded
+static const double DEVICE_INFO_NUMBER_LIMIT = 999999999.0;
+
+// ----- JSON -----
+
+typedef struct JsonOut {
+  char* buffer;
+  size_t capacity;
+  size_t length;
+  bool overflow;
+} JsonOut;
+
+static void appendBytes(JsonOut& out, const char* text, size_t length) {
+  if (out.overflow || out.length + length >= out.capacity) {
+    out.overflow = true;
+    return;
+  }
+  memcpy(out.buffer + out.length, text, length);
+  out.length += length;
+}
+
+static void appendText(JsonOut& out, const char* text) {
+  appendBytes(out, text, strlen(text));
+}
+
+static void appendUnsigned(JsonOut& out, uint64_t value) {
+  char digits[20];
+  int n = 0;
+  do {
+    digits[n++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  char text[20];
+  for (int i = 0; i < n; i++) text[i] = digits[n - 1 - i];
+  appendBytes(out, text, (size_t)n);
+}
+
+// value with a fixed number of decimals (like String(value, decimals))
+static void appendFixed(JsonOut& out, float value, int decimals) {
+  double v = value;
+  if (!(v == v)) v = 0;  // NaN
+  if (v > DEVICE_INFO_NUMBER_LIMIT) v = DEVICE_INFO_NUMBER_LIMIT;
+  if (v < -DEVICE_INFO_NUMBER_LIMIT) v = -DEVICE_INFO_NUMBER_LIMIT;
+
+  uint64_t scale = 1;
+  for (int i = 0; i < decimals; i++) scale *= 10;
+  bool negative = v < 0;
+  uint64_t scaled = (uint64_t)((negative ? -v : v) * (double)scale + 0.5);
+
+  if (negative && scaled != 0) appendBytes(out, "-", 1);
+  appendUnsigned(out, scaled / scale);
+  if (decimals == 0) return;
+
+  appendBytes(out, ".", 1);
+  uint64_t fraction = scaled % scale;
+  for (uint64_t digit = scale / 10; digit > 0; digit /= 10) {
+    char c = (char)('0' + fraction / digit % 10);
+    appendBytes(out, &c, 1);
+  }
+}
+
+static void appendMac(JsonOut& out, const uint8_t mac[6]) {
+  static const char HEX_DIGITS[] = "0123456789ABCDEF";
+  char text[17];
+  for (int i = 0; i < 6; i++) {
+    text[i * 3] = HEX_DIGITS[mac[i] >> 4];
+    text[i * 3 + 1] = HEX_DIGITS[mac[i] & 0x0F];
+    if (i < 5) text[i * 3 + 2] = ':';
+  }
+  appendBytes(out, text, sizeof(text));
+}
+
+size_t deviceInfoWriteJson(const DeviceInfo& info, char* buffer, size_t capacity) {
+  if (capacity == 0) return 0;
+  JsonOut out = {buffer, capacity, 0, false};
+
+  appendText(out, "{\"macAddress\":\"");
+  appendMac(out, info.mac);
+  appendText(out, "\",\"deviceType\":\"tank_meter\",\"properties\":{\"minDistance\":");
+  appendFixed(out, info.minDistance, 1);
+  appendText(out, ",\"maxDistance\":");
+  appendFixed(out, info.maxDistance, 1);
+  appendText(out, ",\"refreshRate\":");
+  appendUnsigned(out, info.refreshRate);
+  appendText(out, ",\"totalLitres\":");
+  appendFixed(out, info.totalLitres, 1);
+  appendText(out, ",\"deadbandDistance\":");
+  appendFixed(out, info.thresholds.distanceCm, 1);
+  appendText(out, ",\"deadbandLevel\":");
+  appendFixed(out, info.thresholds.levelPercent, 1);
+  appendText(out, ",\"deadbandBattery\":");
+  appendFixed(out, info.thresholds.batteryV, 2);
+  appendText(out, ",\"urgentDelta\":");
+  appendFixed(out, info.thresholds.urgentLevelPercent, 1);
+  appendText(out, ",\"heartbeatCycles\":");
+  appendUnsigned(out, info.thresholds.heartbeatCycles);
+  appendText(out, ",\"cloudNodeMAC\":\"");
+  appendMac(out, info.cloudNodeMAC);
+  appendText(out, "\"}}");
+
+  if (out.overflow) {
+    buffer[0] = '\0';
+    return 0;
+  }
+  buffer[out.length] = '\0';
+  return out.length;
+}
+
+// ----- Binary TLV -----
+
+static void put16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+  put16(p, (uint16_t)v);
+  put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint32_t get32(const uint8_t* p, uint8_t length) {
+  uint32_t v = 0;
+  for (int i = length - 1; i >= 0; i--) v = v << 8 | p[i];
+  return v;
+}
+
+// Scale and clamp to 0..max
+static uint32_t quantize(float value, float scale, uint32_t max) {
+  double v = (double)value * scale + 0.5;
+  if (!(v > 0)) return 0;
+  if (v >= (double)max) return max;
+  return (uint32_t)v;
+}
+
+static bool addU16(WireWriter& writer, uint8_t type, uint32_t value) {
+  uint8_t bytes[2];
+  put16(bytes, (uint16_t)value);
+  return wireAddTlv(writer, type, bytes, sizeof(bytes));
+}
+
+static bool addU32(WireWriter& writer, uint8_t type, uint32_t value) {
+  uint8_t bytes[4];
+  put32(bytes, value);
+  return wireAddTlv(writer, type, bytes, sizeof(bytes));
+}
+
+size_t deviceInfoWriteTlv(const DeviceInfo& info, uint8_t* buffer, size_t capacity) {
+  if (capacity < 2) return 0;
+  buffer[0] = DEVICE_INFO_MAGIC;
+  buffer[1] = DEVICE_INFO_VERSION;
+
+  // Same TLV layout as the sensor frame extensions, so reuse its writer
+  WireWriter writer = {buffer, capacity, 2, 0, true, false};
+  const ReportThresholds& t = info.thresholds;
+  uint8_t deviceType = DEVICE_TYPE_TANK_METER;
+
+  addU16(writer, DEVICE_INFO_TLV_FIRMWARE, FIRMWARE_VERSION);
+  wireAddTlv(writer, DEVICE_INFO_TLV_MAC, info.mac, 6);
+  wireAddTlv(writer, DEVICE_INFO_TLV_CLOUD_MAC, info.cloudNodeMAC, 6);
+  wireAddTlv(writer, DEVICE_INFO_TLV_DEVICE_TYPE, &deviceType, 1);
+  addU16(writer, DEVICE_INFO_TLV_MIN_DISTANCE, quantize(info.minDistance, 10.0f, 0xFFFF));
+  addU16(writer, DEVICE_INFO_TLV_MAX_DISTANCE, quantize(info.maxDistance, 10.0f, 0xFFFF));
+  addU32(writer, DEVICE_INFO_TLV_REFRESH_RATE, info.refreshRate);
+  addU32(writer, DEVICE_INFO_TLV_TOTAL_LITRES, quantize(info.totalLitres, 10.0f, 0xFFFFFFFF));
+  addU16(writer, DEVICE_INFO_TLV_DEADBAND_DISTANCE, quantize(t.distanceCm, 10.0f, 0xFFFF));
+  addU16(writer, DEVICE_INFO_TLV_DEADBAND_LEVEL, quantize(t.levelPercent, 10.0f, 0xFFFF));
+  addU16(writer, DEVICE_INFO_TLV_DEADBAND_BATTERY, quantize(t.batteryV, 1000.0f, 0xFFFF));
+  addU16(writer, DEVICE_INFO_TLV_URGENT_DELTA, quantize(t.urgentLevelPercent, 10.0f, 0xFFFF));
+  addU16(writer, DEVICE_INFO_TLV_HEARTBEAT, t.heartbeatCycles);
+
+  return writer.overflow ? 0 : writer.length;
+}
+
+bool deviceInfoFitsNotify(size_t length, uint16_t mtu) {
+  return mtu > DEVICE_INFO_ATT_HEADER_LEN && length <= (size_t)(mtu - DEVICE_INFO_ATT_HEADER_LEN);
+}
+
+bool deviceInfoReadTlv(const uint8_t* data, size_t length, DeviceInfo& info) {
+  if (length < 2 || data[0] != DEVICE_INFO_MAGIC || data[1] != DEVICE_INFO_VERSION) return false;
+
+  // TLVs must tile the rest exactly
+  for (size_t pos = 2; pos < length; ) {
+    if (pos + 2 > length || pos + 2 + data[pos + 1] > length) return false;
+    uint8_t type = data[pos];
+    uint8_t size = data[pos + 1];
+    const uint8_t* value = data + pos + 2;
+    pos += 2 + size;
+
+    if (type == DEVICE_INFO_TLV_MAC || type == DEVICE_INFO_TLV_CLOUD_MAC) {
+      if (size != 6) continue;
+      memcpy(type == DEVICE_INFO_TLV_MAC ? info.mac : info.cloudNodeMAC, value, 6);
+      continue;
+    }
+    if (size != 2 && size != 4) continue;  // Not a number we know
+    uint32_t v = get32(value, size);
+    switch (type) {
+      case DEVICE_INFO_TLV_MIN_DISTANCE:      info.minDistance = v / 10.0f; break;
+      case DEVICE_INFO_TLV_MAX_DISTANCE:      info.maxDistance = v / 10.0f; break;
+      case DEVICE_INFO_TLV_REFRESH_RATE:      info.refreshRate = v; break;
+      case DEVICE_INFO_TLV_TOTAL_LITRES:      info.totalLitres = v / 10.0f; break;
+      case DEVICE_INFO_TLV_DEADBAND_DISTANCE: info.thresholds.distanceCm = v / 10.0f; break;
+      case DEVICE_INFO_TLV_DEADBAND_LEVEL:    info.thresholds.levelPercent = v / 10.0f; break;
+      case DEVICE_INFO_TLV_DEADBAND_BATTERY:  info.thresholds.batteryV = v / 1000.0f; break;
+      case DEVICE_INFO_TLV_URGENT_DELTA:      info.thresholds.urgentLevelPercent = v / 10.0f; break;
+      case DEVICE_INFO_TLV_HEARTBEAT:         info.thresholds.heartbeatCycles = (uint16_t)v; break;
+      default: break;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,82 @@
+/*
+ * Device Info Serializer
+ *
+ * Encodes the device info the frontend reads over BLE, into
+ * caller-provided buffers and without touching the heap:
+ *
+ *   JSON (Device Info characteristic, as before)
+ *     {"macAddress":"..","deviceType":"tank_meter","properties":{..}}
+ *     Numbers are written with fixed decimals by integer arithmetic,
+ *     not printf, so newlib's float formatting never allocates.
+ *
+ *   Binary (Device Info TLV characteristic)
+ *     0  u8   DEVICE_INFO_MAGIC
+ *     1  u8   DEVICE_INFO_VERSION
+ *     2  TLVs until the end: u8 type, u8 length, little-endian value
+ *   Fits one notify once the ATT MTU is DEVICE_INFO_TLV_MAX_LEN + 3 or
+ *   more, where the JSON needs several hundred bytes. The node offers
+ *   BLE_MTU and checks each payload with deviceInfoFitsNotify().
+ *
+ * No Arduino dependencies, so the encoders can be checked on the host.
+ */
+
+#ifndef DEVICE_INFO_H
+#define DEVICE_INFO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+#include "report_policy.h"
+
+#define DEVICE_INFO_MAGIC 0xD1
+#define DEVICE_INFO_VERSION 1
+
+#define DEVICE_INFO_JSON_MAX_LEN 384  // Longest JSON is 360 bytes (numbers at their clamp limits)
+#define DEVICE_INFO_TLV_MAX_LEN 72
+#define DEVICE_INFO_ATT_HEADER_LEN 3  // Opcode + handle in front of every notify
+
+static_assert(BLE_MTU >= DEVICE_INFO_JSON_MAX_LEN + DEVICE_INFO_ATT_HEADER_LEN,
+              "BLE_MTU must fit the device info JSON in one notify");
+
+// TLV types (unknown types are skipped by the decoder)
+#define DEVICE_INFO_TLV_FIRMWARE          0x01  // u16 FIRMWARE_VERSION (as WIRE_TLV_FIRMWARE)
+#define DEVICE_INFO_TLV_MAC               0x10  // 6 bytes, node station MAC
+#define DEVICE_INFO_TLV_CLOUD_MAC         0x11  // 6 bytes, Cloud Node MAC
+#define DEVICE_INFO_TLV_DEVICE_TYPE       0x12  // u8 DEVICE_TYPE_*
+#define DEVICE_INFO_TLV_MIN_DISTANCE      0x20  // u16 mm
+#define DEVICE_INFO_TLV_MAX_DISTANCE      0x21  // u16 mm
+#define DEVICE_INFO_TLV_REFRESH_RATE      0x22  // u32 seconds
+#define DEVICE_INFO_TLV_TOTAL_LITRES      0x23  // u32 decilitres
+#define DEVICE_INFO_TLV_DEADBAND_DISTANCE 0x30  // u16 mm
+#define DEVICE_INFO_TLV_DEADBAND_LEVEL    0x31  // u16 0.1 %
+#define DEVICE_INFO_TLV_DEADBAND_BATTERY  0x32  // u16 mV
+#define DEVICE_INFO_TLV_URGENT_DELTA      0x33  // u16 0.1 %
+#define DEVICE_INFO_TLV_HEARTBEAT         0x34  // u16 wakes
+
+#define DEVICE_TYPE_TANK_METER 1
+
+typedef struct DeviceInfo {
+  uint8_t mac[6];
+  uint8_t cloudNodeMAC[6];
+  float minDistance;             // cm
+  float maxDistance;             // cm
+  uint32_t refreshRate;          // seconds
+  float totalLitres;
+  ReportThresholds thresholds;
+} DeviceInfo;
+
+// Write the JSON into buffer (NUL-terminated). Returns its length
+// without the NUL, or 0 if it does not fit
+size_t deviceInfoWriteJson(const DeviceInfo& info, char* buffer, size_t capacity);
+
+// Write the binary TLV form. Returns its length, or 0 if it does not fit
+size_t deviceInfoWriteTlv(const DeviceInfo& info, uint8_t* buffer, size_t capacity);
+
+// True if a payload of length bytes fits one notify at this ATT MTU
+bool deviceInfoFitsNotify(size_t length, uint16_t mtu);
+
+// Read the binary TLV form (dashboard/host side). Fields whose TLV is
+// missing are left untouched. Returns false if it is not device info
+bool deviceInfoReadTlv(const uint8_t* data, size_t length, DeviceInfo& info);
+
+#endif // DEVICE_INFO_H
@@ -0,0 +1,388 @@
+/*
+ * Device Storage Implementation
+ */
+
+#include "device_storage.h"
+#include "hal.h"
+#include "espnow_comm.h"
+#include "config_cache.h"
+#include "node_log.h"
+#include <stddef.h>
+#include <string.h>
+
+static const uint32_t DEVICE_CONFIG_MAGIC = 0x44434631;  // "DCF1"
+static const uint32_t TANK_GEOMETRY_MAGIC = 0x544E4B31;  // "TNK1"
+
+// Version 1 of the record, before the tank geometry moved into it
+typedef struct DeviceConfigRecordV1 {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  float fullDistanceCm;
+  float emptyDistanceCm;
+  uint32_t refreshRateSeconds;
+  float tankCapacityLitres;
+  ReportThresholds reportThresholds;
+  uint8_t cloudMAC[6];
+  uint8_t flags;
+  uint8_t reserved;
+  uint32_t crc;
+} DeviceConfigRecordV1;
+
+// The tank record version 1 firmware kept beside it
+#define LEGACY_TANK_KEY "tank"
+
+typedef struct TankGeometryRecordV1 {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;
+  TankGeometry geometry;
+  TankStrapTable table;
+  uint32_t crc;
+} TankGeometryRecordV1;
+
+// Entries written by older firmware (migrated, then removed)
+static const char* const LEGACY_KEYS[] = {
+  "minDist", "maxDist", "refreshRate", "totalLitres",
+  "dbDist", "dbLevel", "dbBatt", "urgentDelta", "heartbeat", "cloudMAC",
+  LEGACY_TANK_KEY
+};
+
+// Copy of the record in flash, read once per wake
+static DeviceConfigRecord storedConfig;
+static bool storedLoaded = false;
+static bool storedInFlash = false;
+
+static uint32_t recordCrc(const DeviceConfigRecord& record) {
+  return computeCrc32(&record, offsetof(DeviceConfigRecord, crc));
+}
+
+static bool recordValid(const DeviceConfigRecord& record, size_t length) {
+  return length == sizeof(DeviceConfigRecord) &&
+         record.magic == DEVICE_CONFIG_MAGIC &&
+         record.version == DEVICE_CONFIG_VERSION &&
+         record.size == sizeof(DeviceConfigRecord) &&
+         record.crc == recordCrc(record);
+}
+
+// Member by member, so the struct padding stays zero for the compare
+static void setThresholds(DeviceConfigRecord& record, const ReportThresholds& thresholds) {
+  record.reportThresholds.distanceCm = thresholds.distanceCm;
+  record.reportThresholds.levelPercent = thresholds.levelPercent;
+  record.reportThresholds.batteryV = thresholds.batteryV;
+  record.reportThresholds.urgentLevelPercent = thresholds.urgentLevelPercent;
+  record.reportThresholds.heartbeatCycles = thresholds.heartbeatCycles;
+}
+
+// Record holding the compiled-in defaults (the globals before any load)
+static void defaultRecord(DeviceConfigRecord& record) {
+  memset(&record, 0, sizeof(record));
+  record.fullDistanceCm = fullDistanceCm;
+  record.emptyDistanceCm = emptyDistanceCm;
+  record.refreshRateSeconds = refreshRateSeconds;
+  record.tankCapacityLitres = tankCapacityLitres;
+  setThresholds(record, reportThresholds);
+  memcpy(record.cloudMAC, cloudNodeAddress, 6);
+  tankDefaultGeometry(record.tankGeometry);
+  tankBuildTable(record.tankGeometry, fullDistanceCm, emptyDistanceCm, tankCapacityLitres, record.tankTable);
+}
+
+// Fill record from a version 1 record. Returns false if data is not one
+static bool readV1Record(const void* data, size_t length, DeviceConfigRecord& record) {
+  DeviceConfigRecordV1 v1;
+  if (length != sizeof(v1)) {
+    return false;
+  }
+  memcpy(&v1, data, sizeof(v1));
+  if (v1.magic != DEVICE_CONFIG_MAGIC || v1.version != 1 || v1.size != sizeof(v1) ||
+      v1.crc != computeCrc32(&v1, offsetof(DeviceConfigRecordV1, crc))) {
+    return false;
+  }
+
+  record.fullDistanceCm = v1.fullDistanceCm;
+  record.emptyDistanceCm = v1.emptyDistanceCm;
+  record.refreshRateSeconds = v1.refreshRateSeconds;
+  record.tankCapacityLitres = v1.tankCapacityLitres;
+  setThresholds(record, v1.reportThresholds);
+  memcpy(record.cloudMAC, v1.cloudMAC, 6);
+  record.flags = v1.flags;
+  return true;
+}
+
+// Take the geometry from the version 1 tank record. Returns false if there is none
+static bool readLegacyTank(DeviceConfigRecord& record) {
+  TankGeometryRecordV1 tank;
+  halNvsOpen("device", true); // Read-only
+  size_t length = halNvsGetBytes(LEGACY_TANK_KEY, &tank, sizeof(tank));
+  halNvsClose();
+
+  if (length != sizeof(tank) || tank.magic != TANK_GEOMETRY_MAGIC || tank.version != 1 ||
+      tank.size != sizeof(tank) || tank.crc != computeCrc32(&tank, offsetof(TankGeometryRecordV1, crc))) {
+    if (length > 0) {
+      LOG_E("✗ Stored tank geometry is corrupt - using a vertical tank");
+    }
+    return false;
+  }
+  record.tankGeometry = tank.geometry;
+  return true;
+}
+
+// Fill record from the per-key entries. Returns false if there are none
+static bool readLegacyKeys(DeviceConfigRecord& record) {
+  halNvsOpen("device", true); // Read-only
+  bool found = false;
+
+  if (halNvsHasKey("minDist") && halNvsHasKey("maxDist") &&
+      halNvsHasKey("refreshRate") && halNvsHasKey("totalLitres")) {
+    record.fullDistanceCm = halNvsGetFloat("minDist", 20.0f);
+    record.emptyDistanceCm = halNvsGetFloat("maxDist", 120.0f);
+    record.refreshRateSeconds = halNvsGetU32("refreshRate", 300);
+    record.tankCapacityLitres = halNvsGetFloat("totalLitres", 900.0f);
+    record.flags |= DEVICE_CONFIG_HAS_PROPERTIES;
+    found = true;
+  }
+
+  // Report thresholds are optional (older firmware did not store them)
+  if (halNvsHasKey("heartbeat")) {
+    ReportThresholds thresholds;
+    thresholds.distanceCm = halNvsGetFloat("dbDist", REPORT_DEADBAND_DISTANCE_CM);
+    thresholds.levelPercent = halNvsGetFloat("dbLevel", REPORT_DEADBAND_LEVEL_PERCENT);
+    thresholds.batteryV = halNvsGetFloat("dbBatt", REPORT_DEADBAND_BATTERY_V);
+    thresholds.urgentLevelPercent = halNvsGetFloat("urgentDelta", REPORT_URGENT_LEVEL_DELTA);
+    thresholds.heartbeatCycles = halNvsGetU16("heartbeat", REPORT_HEARTBEAT_CYCLES);
+    if (reportThresholdsValid(thresholds)) {
+      setThresholds(record, thresholds);
+    }
+    found = true;
+  }
+
+  if (halNvsHasKey("cloudMAC")) {
+    if (halNvsGetBytes("cloudMAC", record.cloudMAC, 6) == 6) {
+      record.flags |= DEVICE_CONFIG_HAS_CLOUD_MAC;
+    }
+    found = true;
+  }
+
+  halNvsClose();
+  return found;
+}
+
+static void removeLegacyKeys() {
+  halNvsOpen("device", false);
+  for (size_t i = 0; i < sizeof(LEGACY_KEYS) / sizeof(LEGACY_KEYS[0]); i++) {
+    if (halNvsHasKey(LEGACY_KEYS[i])) {
+      halNvsRemove(LEGACY_KEYS[i]);
+    }
+  }
+  halNvsClose();
+}
+
+// Write record if it differs from the one in flash. Returns false if the write failed
+static bool writeConfig(DeviceConfigRecord& record, bool& changed) {
+  record.magic = DEVICE_CONFIG_MAGIC;
+  record.version = DEVICE_CONFIG_VERSION;
+  record.size = sizeof(DeviceConfigRecord);
+  record.crc = recordCrc(record);
+
+  changed = !storedInFlash || memcmp(&record, &storedConfig, sizeof(record)) != 0;
+  if (!changed) {
+    return true;
+  }
+
+  halNvsOpen("device", false);
+  size_t written = halNvsPutBytes(DEVICE_CONFIG_KEY, &record, sizeof(record));
+  halNvsClose();
+
+  if (written != sizeof(record)) {
+    return false;
+  }
+  storedConfig = record;
+  storedInFlash = true;
+  return true;
+}
+
+// Read the record (once per wake), migrating a version 1 record or the
+// per-key entries if there is no current one
+static void loadStoredConfig() {
+  if (storedLoaded) {
+    return;
+  }
+  storedLoaded = true;
+
+  DeviceConfigRecord record;
+  halNvsOpen("device", true); // Read-only
+  size_t length = halNvsGetBytes(DEVICE_CONFIG_KEY, &record, sizeof(record));
+  halNvsClose();
+
+  if (recordValid(record, length)) {
+    storedConfig = record;
+    storedInFlash = true;
+    return;
+  }
+
+  defaultRecord(storedConfig);
+  DeviceConfigRecord migrated = storedConfig;
+  bool fromV1 = readV1Record(&record, length, migrated);
+  if (!fromV1 && length > 0) {
+    LOG_E("✗ Stored device config is corrupt - ignoring it");
+  }
+  bool fromKeys = !fromV1 && readLegacyKeys(migrated);
+  if (!fromV1 && !fromKeys) {
+    return;
+  }
+  readLegacyTank(migrated);
+  tankBuildTable(migrated.tankGeometry, migrated.fullDistanceCm, migrated.emptyDistanceCm,
+                 migrated.tankCapacityLitres, migrated.tankTable);
+
+  // Old entries go only once the record holding them is safely written
+  bool changed;
+  if (writeConfig(migrated, changed)) {
+    removeLegacyKeys();
+    LOG_I("✓ Migrated %s to one NVS record", fromV1 ? "version 1 device config" : "per-key device properties");
+  } else {
+    storedConfig = migrated;  // Use them this wake; retry on the next boot
+    LOG_E("✗ Failed to migrate device properties - will retry on next boot");
+  }
+}
+
+// Update the ESP-NOW peer if the radio is already up
+static void updatePeer(const uint8_t* macAddress) {
+  if (isESPNOWInitialized()) {
+    LOG_I("Updating ESP-NOW peer with new MAC address...");
+    if (updateCloudNodePeer((uint8_t*)macAddress)) {
+      LOG_I("✓ ESP-NOW peer updated successfully");
+    } else {
+      LOG_E("✗ Failed to update ESP-NOW peer - will retry on next boot");
+    }
+  }
+}
+
+static void logWriteResult(bool ok, bool changed) {
+  if (!ok) {
+    LOG_E("✗ Failed to write device config to NVS");
+  } else if (!changed) {
+    LOG_I("  (unchanged - NVS write skipped)");
+  }
+}
+
+void saveDeviceProperties(float minDist, float maxDist, uint32_t refreshRate, float totalLitres,
+                          const ReportThresholds& thresholds, const uint8_t* cloudMAC,
+                          const TankGeometry* geometry) {
+  loadStoredConfig();
+
+  DeviceConfigRecord record = storedConfig;
+  record.fullDistanceCm = minDist;
+  record.emptyDistanceCm = maxDist;
+  record.refreshRateSeconds = refreshRate;
+  record.tankCapacityLitres = totalLitres;
+  setThresholds(record, thresholds);
+  record.flags |= DEVICE_CONFIG_HAS_PROPERTIES;
+  bool macChanged = cloudMAC != nullptr && memcmp(cloudMAC, cloudNodeAddress, 6) != 0;
+  if (cloudMAC != nullptr) {
+    memcpy(record.cloudMAC, cloudMAC, 6);
+    record.flags |= DEVICE_CONFIG_HAS_CLOUD_MAC;
+  }
+
+  // The table depends on the distances and capacity, so it is rebuilt even
+  // when the shape stays
+  if (geometry != nullptr) {
+    record.tankGeometry = *geometry;
+  }
+  bool tankFits = tankBuildTable(record.tankGeometry, minDist, maxDist, totalLitres, record.tankTable);
+
+  bool changed;
+  bool ok = writeConfig(record, changed);
+  tankSetTable(record.tankTable);
+
+  // Update global variables
+  fullDistanceCm = minDist;
+  emptyDistanceCm = maxDist;
+  refreshRateSeconds = refreshRate;
+  tankCapacityLitres = totalLitres;
+  reportThresholds = thresholds;
+  if (cloudMAC != nullptr) {
+    memcpy(cloudNodeAddress, cloudMAC, 6);
+  }
+  refreshConfigSnapshot();
+
+  LOG_I("✓ Device properties saved to NVS: %.1f-%.1f cm, %u s, %.1f L",
+        minDist, maxDist, (unsigned)refreshRate, totalLitres);
+  LOG_I("  Deadbands: %.1f cm, %.1f %%, %.2f V, Urgent Delta: %.1f %%, Heartbeat: %u wakes",
+        thresholds.distanceCm, thresholds.levelPercent, thresholds.batteryV,
+        thresholds.urgentLevelPercent, thresholds.heartbeatCycles);
+  LOG_I("  Tank: %s, %d-point strapping table", tankShapeName((TankShape)record.tankTable.shape), TANK_STRAP_POINTS);
+  if (!tankFits) {
+    LOG_W("  Tank %s does not fit the properties - litres follow the level until it is set again",
+          tankShapeName((TankShape)record.tankGeometry.shape));
+  }
+  if (cloudMAC != nullptr) {
+    LOG_I("  Cloud Node MAC: " LOG_MAC_FMT, LOG_MAC_ARGS(cloudMAC));
+  }
+  logWriteResult(ok, changed);
+
+  if (macChanged) {
+    updatePeer(cloudMAC);
+  }
+}
+
+bool loadDeviceProperties() {
+  loadStoredConfig();
+  if (!(storedConfig.flags & DEVICE_CONFIG_HAS_PROPERTIES)) {
+    return false;
+  }
+
+  fullDistanceCm = storedConfig.fullDistanceCm;
+  emptyDistanceCm = storedConfig.emptyDistanceCm;
+  refreshRateSeconds = storedConfig.refreshRateSeconds;
+  tankCapacityLitres = storedConfig.tankCapacityLitres;
+  if (reportThresholdsValid(storedConfig.reportThresholds)) {
+    reportThresholds = storedConfig.reportThresholds;
+  }
+  tankSetTable(storedConfig.tankTable);
+
+  LOG_I("✓ Loaded stored device properties: %.1f-%.1f cm, %u s, %.1f L",
+        fullDistanceCm, emptyDistanceCm, (unsigned)refreshRateSeconds, tankCapacityLitres);
+  LOG_I("  Report Deadbands: %.1f cm, %.1f %%, %.2f V (urgent %.1f %%, heartbeat %u)",
+        reportThresholds.distanceCm, reportThresholds.levelPercent, reportThresholds.batteryV,
+        reportThresholds.urgentLevelPercent, reportThresholds.heartbeatCycles);
+  LOG_I("  Tank: %s", tankShapeName((TankShape)storedConfig.tankTable.shape));
+
+  return true;
+}
+
+bool hasStoredProperties() {
+  loadStoredConfig();
+  return (storedConfig.flags & DEVICE_CONFIG_HAS_PROPERTIES) != 0;
+}
+
+void saveCloudNodeMAC(const uint8_t* macAddress) {
+  loadStoredConfig();
+
+  DeviceConfigRecord record = storedConfig;
+  memcpy(record.cloudMAC, macAddress, 6);
+  record.flags |= DEVICE_CONFIG_HAS_CLOUD_MAC;
+  bool changed;
+  bool ok = writeConfig(record, changed);
+
+  // Update global cloud node address
+  memcpy(cloudNodeAddress, macAddress, 6);
+  refreshConfigSnapshot();
+
+  LOG_I("✓ Cloud Node MAC saved: " LOG_MAC_FMT, LOG_MAC_ARGS(macAddress));
+  logWriteResult(ok, changed);
+
+  if (changed) {
+    updatePeer(macAddress);
+  }
+}
+
+bool loadCloudNodeMAC(uint8_t* macAddress) {
+  loadStoredConfig();
+  if (!(storedConfig.flags & DEVICE_CONFIG_HAS_CLOUD_MAC)) {
+    return false;
+  }
+
+  memcpy(macAddress, storedConfig.cloudMAC, 6);
+  LOG_I("✓ Loaded stored Cloud Node MAC: " LOG_MAC_FMT, LOG_MAC_ARGS(macAddress));
+  return true;
+}
@@ -0,0 +1,64 @@
+/*
+ * Device Storage
+ *
+ * Device properties, report thresholds and the Cloud Node MAC in the
+ * "device" NVS namespace, as one versioned record under the key
+ * DEVICE_CONFIG_KEY. The record is read with a single getBytes per boot
+ * and written with a single putBytes (atomic in NVS), and only when its
+ * contents changed. The per-key entries older firmware wrote are
+ * migrated into the record on the first boot and then removed. Goes
+ * through the HAL, so the boot path can run in the host simulation.
+ *
+ * The record also holds the tank geometry and the strapping table built
+ * from it. The table is rebuilt on every properties write, since it
+ * depends on the distances and the capacity too. Version 1 records and
+ * the separate "tank" record that went with them are migrated the same
+ * way as the per-key entries.
+ */
+
+#ifndef DEVICE_STORAGE_H
+#define DEVICE_STORAGE_H
+
+#include <stdint.h>
+#include "config.h"
+#include "report_policy.h"
+#include "tank_geometry.h"
+
+#define DEVICE_CONFIG_KEY "config"
+
+// Bump whenever DeviceConfigRecord changes layout
+#define DEVICE_CONFIG_VERSION 2
+
+// DeviceConfigRecord.flags
+#define DEVICE_CONFIG_HAS_PROPERTIES 0x01  // Tank properties were set by the user
+#define DEVICE_CONFIG_HAS_CLOUD_MAC  0x02  // cloudMAC was set by the user
+
+typedef struct DeviceConfigRecord {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;               // sizeof(DeviceConfigRecord) when written
+  float fullDistanceCm;        // minDistance
+  float emptyDistanceCm;       // maxDistance
+  uint32_t refreshRateSeconds;
+  float tankCapacityLitres;
+  ReportThresholds reportThresholds;
+  uint8_t cloudMAC[6];
+  uint8_t flags;               // DEVICE_CONFIG_*
+  uint8_t reserved;
+  TankGeometry tankGeometry;
+  TankStrapTable tankTable;    // Built from tankGeometry and the properties above
+  uint32_t crc;                // CRC32 of every field above
+} DeviceConfigRecord;
+
+// Property storage functions
+// Save properties and thresholds in one write (cloudMAC may be nullptr to
+// keep the stored one, geometry nullptr to keep the stored tank shape)
+void saveDeviceProperties(float minDist, float maxDist, uint32_t refreshRate, float totalLitres,
+                          const ReportThresholds& thresholds, const uint8_t* cloudMAC,
+                          const TankGeometry* geometry);
+bool loadDeviceProperties();
+bool hasStoredProperties();
+void saveCloudNodeMAC(const uint8_t* macAddress);
+bool loadCloudNodeMAC(uint8_t* macAddress);
+
+#endif // DEVICE_STORAGE_H
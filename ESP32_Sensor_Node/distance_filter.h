@@ -0,0 +1,261 @@
+/*
+ * Distance Filter Chains
+ *
+ * Turns one burst of ping distances into a single reading. A chain is
+ * put together at compile time from a sample capacity and policy stages:
+ *
+ *   FilterChain<N, Estimator, Rejectors...>::run(samples, count)
+ *
+ * The samples are sorted with a sorting network generated for N at
+ * compile time (Batcher's odd-even merge sort, fully unrolled; unused
+ * slots are padded with +inf). Each rejector then drops outliers from
+ * the sorted samples in place, in order, and the estimator reduces what
+ * is left to one distance. Stages are structs with static inline
+ * functions, so a chain compiles down to straight-line code with no
+ * heap use and no indirect calls.
+ *
+ * Samples are float cm, or Q16.16 cm in an int32_t (q16_t, measure_math.h)
+ * for the fixed-point path; run() takes either, and SampleMath<T> holds
+ * the few operations whose arithmetic differs.
+ *
+ * Estimators:  MedianEstimate, TrimmedMeanEstimate<Trim, MinCount>,
+ *              BinModeEstimate<BinWidthMm>
+ * Rejectors:   HampelReject<KTenths, MadFloorMm>
+ *
+ * DISTANCE_FILTER in config.h picks the chain sensor.cpp uses
+ * (DistanceFilterChain below). No Arduino dependencies, so chains can
+ * be benchmarked and checked on the host (sim/filter_bench.cpp).
+ */
+
+#ifndef DISTANCE_FILTER_H
+#define DISTANCE_FILTER_H
+
+#include <stdint.h>
+#include <math.h>
+#include <type_traits>
+#include <utility>
+#include "config.h"
+#include "measure_math.h"
+
+// ----- Sample arithmetic -----
+
+template <typename T>
+struct SampleMath;
+
+template <>
+struct SampleMath<float> {
+  static inline float invalid() { return NAN; }
+  static inline bool valid(float v) { return !isnan(v); }
+  static inline float pad() { return INFINITY; }  // Sorts after every sample
+  static inline float fromMm(int mm) { return mm / 10.0f; }
+  static inline float midpoint(float a, float b) { return 0.5f * (a + b); }
+  static inline float mean(float sum, int n) { return sum / (float)n; }
+  static inline float distance(float a, float b) { return fabsf(a - b); }
+  static inline float madToSigma(float mad) { return mad * 1.4826f; }
+  static inline float tenths(float x, int t) { return t / 10.0f * x; }
+};
+
+// Q16.16 cm. Sums stay in 32 bits: FilterChain caps N at Q16_SUM_MAX_SAMPLES
+template <>
+struct SampleMath<q16_t> {
+  static inline q16_t invalid() { return 0; }
+  static inline bool valid(q16_t v) { return v != 0; }
+  static inline q16_t pad() { return INT32_MAX; }
+  static inline q16_t fromMm(int mm) { return (q16_t)(mm * (Q16_ONE / 10)); }
+  static inline q16_t midpoint(q16_t a, q16_t b) { return a + (b - a) / 2; }
+  static inline q16_t mean(q16_t sum, int n) { return (sum + n / 2) / n; }
+  static inline q16_t distance(q16_t a, q16_t b) { return a > b ? a - b : b - a; }
+  static inline q16_t madToSigma(q16_t mad) { return (q16_t)(((int64_t)mad * 97164 + Q16_ONE / 2) >> 16); }
+  static inline q16_t tenths(q16_t x, int t) { return (q16_t)((int64_t)x * t / 10); }
+};
+
+// ----- Sorting networks -----
+
+// Visit Batcher's odd-even merge sort comparators for n inputs (any n)
+template <typename Visit>
+constexpr void sortNetworkVisit(int n, Visit visit) {
+  for (int p = 1; p < n; p *= 2) {
+    for (int k = p; k >= 1; k /= 2) {
+      for (int j = k % p; j + k < n; j += 2 * k) {
+        for (int i = 0; i < k && i + j + k < n; i++) {
+          if ((i + j) / (2 * p) == (i + j + k) / (2 * p)) {
+            visit(i + j, i + j + k);
+          }
+        }
+      }
+    }
+  }
+}
+
+constexpr int sortNetworkSize(int n) {
+  int size = 0;
+  sortNetworkVisit(n, [&size](int, int) { size++; });
+  return size;
+}
+
+template <int N>
+struct SortNetwork {
+  static constexpr int SIZE = sortNetworkSize(N);
+
+  struct Table {
+    uint8_t lo[SIZE > 0 ? SIZE : 1];
+    uint8_t hi[SIZE > 0 ? SIZE : 1];
+  };
+
+  static constexpr Table build() {
+    Table table = {};
+    int m = 0;
+    sortNetworkVisit(N, [&table, &m](int a, int b) {
+      table.lo[m] = (uint8_t)a;
+      table.hi[m] = (uint8_t)b;
+      m++;
+    });
+    return table;
+  }
+
+  static constexpr Table TABLE = build();
+
+  template <typename T>
+  static inline void exchange(T* v, int a, int b) {
+    T x = v[a];
+    T y = v[b];
+    v[a] = x < y ? x : y;
+    v[b] = x < y ? y : x;
+  }
+
+  template <typename T, size_t... I>
+  static inline void unrolled(T* v, std::index_sequence<I...>) {
+    (void)v;  // Unused when N is 1
+    (exchange(v, TABLE.lo[I], TABLE.hi[I]), ...);
+  }
+
+  // Sort all N values ascending
+  template <typename T>
+  static inline void sort(T* v) {
+    unrolled(v, std::make_index_sequence<SIZE>());
+  }
+};
+
+// ----- Estimators (sorted samples in, one distance out) -----
+
+struct MedianEstimate {
+  template <typename T>
+  static inline T estimate(const T* v, int n) {
+    return n % 2 == 1 ? v[n / 2] : SampleMath<T>::midpoint(v[n / 2 - 1], v[n / 2]);
+  }
+};
+
+// Mean after dropping Trim samples at each end, once there are at least
+// MinCount (the original readSmoothedDistanceCm() was <1, 5>)
+template <int Trim, int MinCount = 2 * Trim + 3>
+struct TrimmedMeanEstimate {
+  static_assert(Trim >= 0 && MinCount > 2 * Trim, "trim would drop every sample");
+
+  template <typename T>
+  static inline T estimate(const T* v, int n) {
+    int start = n >= MinCount ? Trim : 0;
+    int end = n - start;
+    T sum = 0;
+    for (int i = start; i < end; i++) sum += v[i];
+    return SampleMath<T>::mean(sum, end - start);
+  }
+};
+
+// Mean of the largest cluster of samples that fits in BinWidthMm (a
+// sliding bin, so a cluster is never split by a bin edge). Baffle and
+// sidewall echoes form their own, smaller clusters. Ties go to the
+// nearer cluster
+template <int BinWidthMm>
+struct BinModeEstimate {
+  template <typename T>
+  static inline T estimate(const T* v, int n) {
+    const T width = SampleMath<T>::fromMm(BinWidthMm);
+    int bestStart = 0;
+    int bestCount = 0;
+    int start = 0;
+    for (int end = 0; end < n; end++) {
+      while (v[end] - v[start] > width) start++;
+      if (end - start + 1 > bestCount) {
+        bestCount = end - start + 1;
+        bestStart = start;
+      }
+    }
+    T sum = 0;
+    for (int i = bestStart; i < bestStart + bestCount; i++) sum += v[i];
+    return SampleMath<T>::mean(sum, bestCount);
+  }
+};
+
+// ----- Rejectors (sorted samples in, sorted survivors out; returns the count) -----
+
+// Hampel identifier: drop samples further than K (KTenths / 10) scaled
+// MADs from the median. MadFloorMm keeps a burst of identical readings
+// from rejecting a sample one quantization step away
+template <int KTenths, int MadFloorMm = 2>
+struct HampelReject {
+  static_assert(KTenths >= 10, "K below 1 could reject the median samples");
+
+  template <int N, typename T>
+  static inline int apply(T* v, int n) {
+    typedef SampleMath<T> M;
+    if (n < 3) return n;
+    T median = MedianEstimate::estimate(v, n);
+
+    T deviation[N];
+    for (int i = 0; i < N; i++) {
+      deviation[i] = i < n ? M::distance(v[i], median) : M::pad();
+    }
+    SortNetwork<N>::sort(deviation);
+    T mad = M::madToSigma(MedianEstimate::estimate(deviation, n));  // Gaussian-consistent
+    if (mad < M::fromMm(MadFloorMm)) mad = M::fromMm(MadFloorMm);
+
+    T limit = M::tenths(mad, KTenths);
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+      if (M::distance(v[i], median) <= limit) v[kept++] = v[i];
+    }
+    return kept;  // Never 0: the median sample itself is within the limit
+  }
+};
+
+// ----- Chain -----
+
+template <int N, typename Estimator, typename... Rejectors>
+struct FilterChain {
+  static_assert(N >= 1 && N <= 255, "sample capacity out of range");
+
+  static const int CAPACITY = N;
+
+  // Reduce count samples (all valid; beyond N are ignored) to one
+  // distance. Returns NAN (0 for q16_t) if count is 0
+  template <typename T>
+  static inline T run(const T* samples, int count) {
+    static_assert(!std::is_integral<T>::value || N <= Q16_SUM_MAX_SAMPLES,
+                  "Q16.16 sums of N samples would overflow");
+    if (count <= 0) return SampleMath<T>::invalid();
+    if (count > N) count = N;
+
+    T v[N];
+    for (int i = 0; i < N; i++) v[i] = i < count ? samples[i] : SampleMath<T>::pad();
+    SortNetwork<N>::sort(v);
+
+    int n = count;
+    ((n = Rejectors::template apply<N>(v, n)), ...);
+    return Estimator::estimate(v, n);
+  }
+};
+
+// ----- Chain selected in config.h -----
+
+#if DISTANCE_FILTER == DISTANCE_FILTER_MEDIAN
+typedef FilterChain<samplesPerUpdate, MedianEstimate> DistanceFilterChain;
+#elif DISTANCE_FILTER == DISTANCE_FILTER_HAMPEL
+typedef FilterChain<samplesPerUpdate, TrimmedMeanEstimate<0>,
+                    HampelReject<DISTANCE_FILTER_HAMPEL_K_TENTHS>> DistanceFilterChain;
+#elif DISTANCE_FILTER == DISTANCE_FILTER_BIN_MODE
+typedef FilterChain<samplesPerUpdate, BinModeEstimate<DISTANCE_FILTER_BIN_WIDTH_MM>> DistanceFilterChain;
+#else
+typedef FilterChain<samplesPerUpdate, TrimmedMeanEstimate<1, 5>> DistanceFilterChain;
+#endif
+
+#endif // DISTANCE_FILTER_H
@@ -0,0 +1,171 @@
+/*
+ * Interrupt-Driven Echo Capture Implementation
+ */
+
+#include "echo_capture.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "esp_timer.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#define ECHO_ISR_ATTR IRAM_ATTR
+static portMUX_TYPE echoMux = portMUX_INITIALIZER_UNLOCKED;
+#define ECHO_ENTER_CRITICAL() portENTER_CRITICAL(&echoMux)
+#define ECHO_EXIT_CRITICAL() portEXIT_CRITICAL(&echoMux)
+#define ECHO_ENTER_CRITICAL_ISR() portENTER_CRITICAL_ISR(&echoMux)
+#define ECHO_EXIT_CRITICAL_ISR() portEXIT_CRITICAL_ISR(&echoMux)
+#else
+#define ECHO_ISR_ATTR
+#define ECHO_ENTER_CRITICAL()
+#define ECHO_EXIT_CRITICAL()
+#define ECHO_ENTER_CRITICAL_ISR()
+#define ECHO_EXIT_CRITICAL_ISR()
+#endif
+
+// Time allowed between the trigger and the start of the echo pulse
+// (the transducer burst takes ~200 us before ECHO goes high)
+static const uint32_t ECHO_START_GRACE_US = 1000;
+
+// Capture state shared with the interrupt
+static volatile EchoStatus echoState = ECHO_IDLE;
+static volatile bool echoRiseSeen = false;
+static volatile uint64_t echoArmUs = 0;
+static volatile uint64_t echoRiseUs = 0;
+static volatile uint64_t echoFallUs = 0;
+static uint32_t echoTimeout = 0;
+#ifdef ARDUINO
+static TaskHandle_t echoWaiter = NULL;  // Task to wake on the falling edge
+#endif
+
+#ifndef ARDUINO
+static uint64_t fakeClockUs = 0;
+
+void echoCaptureSetFakeClockUs(uint64_t us) {
+  fakeClockUs = us;
+}
+#endif
+
+static uint64_t echoNowUs() {
+#ifdef ARDUINO
+  return (uint64_t)esp_timer_get_time();
+#else
+  return fakeClockUs;
+#endif
+}
+
+void ECHO_ISR_ATTR echoCaptureOnEdge(bool level, uint64_t timestampUs) {
+  ECHO_ENTER_CRITICAL_ISR();
+  if (echoState == ECHO_PENDING) {
+    if (level && !echoRiseSeen) {
+      echoRiseUs = timestampUs;
+      echoRiseSeen = true;
+    } else if (!level && echoRiseSeen) {
+      echoFallUs = timestampUs;
+      echoState = ECHO_DONE;
+#ifdef ARDUINO
+      if (echoWaiter != NULL) {
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(echoWaiter, &woken);
+        portYIELD_FROM_ISR(woken);
+      }
+#endif
+    }
+  }
+  ECHO_EXIT_CRITICAL_ISR();
+}
+
+#ifdef ARDUINO
+static void ECHO_ISR_ATTR echoIsr() {
+  echoCaptureOnEdge(gpio_get_level((gpio_num_t)ECHO_PIN) != 0, (uint64_t)esp_timer_get_time());
+}
+#endif
+
+void echoCaptureBegin() {
+#ifdef ARDUINO
+  pinMode(ECHO_PIN, INPUT);
+  attachInterrupt(digitalPinToInterrupt(ECHO_PIN), echoIsr, CHANGE);
+#endif
+  echoState = ECHO_IDLE;
+}
+
+void echoCaptureEnd() {
+#ifdef ARDUINO
+  detachInterrupt(digitalPinToInterrupt(ECHO_PIN));
+#endif
+  echoState = ECHO_IDLE;
+}
+
+void echoStartPing(uint32_t timeoutUs) {
+#ifdef ARDUINO
+  digitalWrite(TRIG_PIN, LOW);
+  delayMicroseconds(2);
+  ulTaskNotifyTake(pdTRUE, 0);  // Drop a wake-up left over from the last ping
+#endif
+
+  ECHO_ENTER_CRITICAL();
+  echoTimeout = timeoutUs;
+  echoRiseSeen = false;
+  echoArmUs = echoNowUs();
+#ifdef ARDUINO
+  echoWaiter = xTaskGetCurrentTaskHandle();
+#endif
+  echoState = ECHO_PENDING;
+  ECHO_EXIT_CRITICAL();
+
+#ifdef ARDUINO
+  digitalWrite(TRIG_PIN, HIGH);
+  delayMicroseconds(10);
+  digitalWrite(TRIG_PIN, LOW);
+#endif
+}
+
+EchoStatus echoPoll(uint32_t* durationUs) {
+  ECHO_ENTER_CRITICAL();
+  EchoStatus state = echoState;
+  bool riseSeen = echoRiseSeen;
+  uint64_t armUs = echoArmUs;
+  uint64_t riseUs = echoRiseUs;
+  uint64_t fallUs = echoFallUs;
+  ECHO_EXIT_CRITICAL();
+
+  if (state == ECHO_DONE) {
+    uint64_t width = fallUs - riseUs;
+    if (width > echoTimeout) {
+      state = ECHO_TIMEOUT;  // Pulse longer than the gate - treat like pulseIn()
+    } else if (durationUs != nullptr) {
+      *durationUs = (uint32_t)width;
+    }
+  } else if (state == ECHO_PENDING) {
+    uint64_t now = echoNowUs();
+    bool noRise = !riseSeen && (now - armUs > (uint64_t)echoTimeout + ECHO_START_GRACE_US);
+    bool tooWide = riseSeen && (now - riseUs > echoTimeout);
+    if (noRise || tooWide) {
+      state = ECHO_TIMEOUT;
+    }
+  }
+
+  if (state == ECHO_TIMEOUT) {
+    ECHO_ENTER_CRITICAL();
+    echoState = ECHO_TIMEOUT;
+    ECHO_EXIT_CRITICAL();
+  }
+  return state;
+}
+
+// Blocks instead of spinning: the falling edge wakes the task, and a one
+// tick wait bounds how late a timeout is noticed. While the echo is in
+// flight the scheduler runs the wake pipeline's radio and battery tasks,
+// or idles the core
+EchoStatus echoAwait(uint32_t* durationUs) {
+  EchoStatus state;
+  while ((state = echoPoll(durationUs)) == ECHO_PENDING) {
+#ifdef ARDUINO
+    ulTaskNotifyTake(pdTRUE, 1);
+#else
+    break;  // Host code advances the fake clock and polls itself
+#endif
+  }
+  return state;
+}
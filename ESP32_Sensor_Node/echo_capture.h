@@ -0,0 +1,49 @@
+/*
+ * Interrupt-Driven Echo Capture
+ *
+ * Timestamps ECHO edges from a GPIO interrupt using esp_timer instead of
+ * spinning in pulseIn(). A ping is started with echoStartPing() and the
+ * caller polls (or awaits) the result, so other work can run while the
+ * echo is in flight. On host builds the edges and the clock are fed in by
+ * the caller, so the state machine can run against synthetic timings.
+ */
+
+#ifndef ECHO_CAPTURE_H
+#define ECHO_CAPTURE_H
+
+#include <stdint.h>
+#include "config.h"
+
+typedef enum EchoStatus {
+  ECHO_IDLE = 0,   // No ping in progress
+  ECHO_PENDING,    // Ping fired, echo not complete yet
+  ECHO_DONE,       // Echo pulse captured
+  ECHO_TIMEOUT     // No (complete) echo within the timeout
+} EchoStatus;
+
+// Attach the ECHO interrupt (call after the sensor is powered)
+void echoCaptureBegin();
+
+// Detach the ECHO interrupt
+void echoCaptureEnd();
+
+// Fire the trigger pulse and arm the capture
+// timeoutUs bounds both the wait for the rising edge and the pulse width
+void echoStartPing(uint32_t timeoutUs);
+
+// Check the ping in progress. On ECHO_DONE, durationUs gets the pulse width
+EchoStatus echoPoll(uint32_t* durationUs);
+
+// Wait until the ping in progress completes or times out. On ESP32 the
+// calling task blocks until the falling edge, so other tasks get the CPU
+EchoStatus echoAwait(uint32_t* durationUs);
+
+// Edge source: called from the GPIO interrupt on ESP32, or by host code
+void echoCaptureOnEdge(bool level, uint64_t timestampUs);
+
+#ifndef ARDUINO
+// Host builds use a fake clock driven by the caller
+void echoCaptureSetFakeClockUs(uint64_t us);
+#endif
+
+#endif // ECHO_CAPTURE_H
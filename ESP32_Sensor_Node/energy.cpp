@@ -0,0 +1,152 @@
+/*
+ * Energy Accounting Implementation
+ */
+
+#include "energy.h"
+#include "hal.h"
+#include <string.h>
+
+static const uint32_t ENERGY_LEDGER_MAGIC = 0x4E524731;  // "NRG1"
+
+// Charges are kept in uA x us (picocoulombs); 1 mAh = 3.6e12
+static const double PC_PER_MAH = 3.6e12;
+
+typedef struct EnergyLedger {
+  uint32_t magic;
+  uint32_t wakes;
+  uint64_t elapsedUs;                        // Awake + sleep time covered by the totals
+  uint64_t chargePc[POWER_STATE_COUNT];
+  uint64_t lastWakePc;
+} EnergyLedger;
+
+// RTC memory totals (survive deep sleep)
+RTC_DATA_ATTR EnergyLedger energyLedger;
+
+static const uint32_t stateCurrentUa[POWER_STATE_COUNT] = {
+  ENERGY_CPU_ACTIVE_UA, ENERGY_RADIO_RX_UA, ENERGY_RADIO_TX_UA,
+  ENERGY_SENSOR_UA, ENERGY_BLE_UA, ENERGY_DEEP_SLEEP_UA
+};
+
+static const char* const stateNames[POWER_STATE_COUNT] = {
+  "cpu", "rx", "tx", "sensor", "ble", "sleep"
+};
+
+// This wake
+static uint64_t stateUs[POWER_STATE_COUNT];
+static uint64_t stateStartUs[POWER_STATE_COUNT];
+static bool stateOpen[POWER_STATE_COUNT];
+
+static void ensureLedger() {
+  if (energyLedger.magic != ENERGY_LEDGER_MAGIC) {
+    memset(&energyLedger, 0, sizeof(energyLedger));
+    energyLedger.magic = ENERGY_LEDGER_MAGIC;
+  }
+}
+
+// The wake pipeline's tasks open and close states concurrently, so the
+// per-wake accumulators are only touched inside a critical section
+void energyBegin(PowerState state) {
+  if (state >= POWER_STATE_COUNT) return;
+  uint64_t now = halMicros();
+  halCriticalEnter();
+  if (!stateOpen[state]) {
+    stateOpen[state] = true;
+    stateStartUs[state] = now;
+  }
+  halCriticalExit();
+}
+
+void energyEnd(PowerState state) {
+  if (state >= POWER_STATE_COUNT) return;
+  uint64_t now = halMicros();
+  halCriticalEnter();
+  if (stateOpen[state]) {
+    stateOpen[state] = false;
+    stateUs[state] += now - stateStartUs[state];
+  }
+  halCriticalExit();
+}
+
+void energyAddTxFrame(size_t length) {
+  // Airtime at the ESP-NOW bit rate, headers and the ack included
+  uint64_t bits = (uint64_t)(length + ENERGY_TX_OVERHEAD_BYTES) * 8ULL;
+  halCriticalEnter();
+  stateUs[POWER_RADIO_TX] += bits * 1000ULL / ENERGY_TX_BITRATE_KBPS;
+  halCriticalExit();
+}
+
+void energyEndWake(uint64_t sleepUs) {
+  ensureLedger();
+
+  for (int i = 0; i < POWER_STATE_COUNT; i++) {
+    energyEnd((PowerState)i);
+  }
+  // The CPU is active from boot to now
+  uint64_t awakeUs = halMicros();
+  stateUs[POWER_CPU] = awakeUs;
+  stateUs[POWER_DEEP_SLEEP] = sleepUs;
+
+  uint64_t wakePc = 0;
+  for (int i = 0; i < POWER_STATE_COUNT; i++) {
+    uint64_t pc = stateUs[i] * stateCurrentUa[i];
+    energyLedger.chargePc[i] += pc;
+    if (i != POWER_DEEP_SLEEP) wakePc += pc;
+    stateUs[i] = 0;
+  }
+
+  energyLedger.lastWakePc = wakePc;
+  energyLedger.elapsedUs += awakeUs + sleepUs;
+  energyLedger.wakes++;
+}
+
+float energyLastWakeMah() {
+  ensureLedger();
+  return (float)(energyLedger.lastWakePc / PC_PER_MAH);
+}
+
+float energyTotalMah() {
+  ensureLedger();
+  uint64_t total = 0;
+  for (int i = 0; i < POWER_STATE_COUNT; i++) {
+    total += energyLedger.chargePc[i];
+  }
+  return (float)(total / PC_PER_MAH);
+}
+
+float energyStateMah(PowerState state) {
+  ensureLedger();
+  if (state >= POWER_STATE_COUNT) return 0;
+  return (float)(energyLedger.chargePc[state] / PC_PER_MAH);
+}
+
+uint32_t energyWakes() {
+  ensureLedger();
+  return energyLedger.wakes;
+}
+
+float energyElapsedHours() {
+  ensureLedger();
+  return (float)(energyLedger.elapsedUs / 3.6e9);
+}
+
+float energyMahPerDay() {
+  float hours = energyElapsedHours();
+  if (hours <= 0) return 0;
+  return energyTotalMah() / hours * 24.0f;
+}
+
+float energyProjectedDays(float batteryMah) {
+  float perDay = energyMahPerDay();
+  if (perDay <= 0) return 0;
+  return batteryMah / perDay;
+}
+
+const char* powerStateName(PowerState state) {
+  if (state >= POWER_STATE_COUNT) return "?";
+  return stateNames[state];
+}
+
+void energyReset() {
+  memset(&energyLedger, 0, sizeof(energyLedger));
+  energyLedger.magic = ENERGY_LEDGER_MAGIC;
+}
@@ -0,0 +1,62 @@
+/*
+ * Energy Accounting
+ *
+ * Integrates the time spent in each hardware power state during a wake
+ * and charges it at the currents set in config.h (ENERGY_*_UA). CPU
+ * active covers the whole awake time; radio, sensor and BLE are added on
+ * top while they are on. Running totals per state, the elapsed time and
+ * the wake count live in RTC memory, so mAh per day and the projected
+ * battery life can be read on any wake.
+ *
+ * Only uses the HAL clock, so the host simulation charges the same way.
+ */
+
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+// Hardware power states (order matches the summary columns)
+enum PowerState : uint8_t {
+  POWER_CPU = 0,       // CPU active (whole awake time)
+  POWER_RADIO_RX,      // WiFi/ESP-NOW up and listening
+  POWER_RADIO_TX,      // Frame airtime
+  POWER_SENSOR,        // Ultrasonic sensor powered via SENSOR_POWER_PIN
+  POWER_BLE,           // BLE advertising / provisioning
+  POWER_DEEP_SLEEP,
+  POWER_STATE_COUNT
+};
+
+// Start or stop timing a state in this wake (nested calls are ignored)
+void energyBegin(PowerState state);
+void energyEnd(PowerState state);
+
+// Charge the airtime of one frame of length bytes at the TX current
+void energyAddTxFrame(size_t length);
+
+// Close the open states, charge this wake plus the coming sleep and fold
+// both into the RTC totals. Call right before deep sleep or a restart
+void energyEndWake(uint64_t sleepUs);
+
+// Charge of the last completed wake (awake part only), in mAh
+float energyLastWakeMah();
+
+// Totals since power-on (or energyReset())
+float energyTotalMah();
+float energyStateMah(PowerState state);
+uint32_t energyWakes();
+float energyElapsedHours();
+
+// Average consumption and battery life at that rate (0 until a wake completed)
+float energyMahPerDay();
+float energyProjectedDays(float batteryMah);
+
+// Short name for logs
+const char* powerStateName(PowerState state);
+
+// Clear the RTC totals
+void energyReset();
+
+#endif // ENERGY_H
@@ -3,326 +3,288 @@
  */
 
 #include "espnow_comm.h"
+#include "profiler.h"
+#include "config_cache.h"
+#include "channel_discovery.h"
+#include "espnow_tx.h"
+#include "wire_format.h"
+#include "energy.h"
+#include "tx_slot.h"
+#include "node_log.h"
 
 int detectedChannel = 0;
-bool dataSent = false;
-bool sendSuccess = false;
-
-// RTC memory to store last successful channel (survives deep sleep)
-RTC_DATA_ATTR int savedChannel = 0;
-
-// Helper function to try a specific channel
-int tryChannel(int channel) {
-  // Set WiFi channel
-  esp_wifi_set_promiscuous(true);
-  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
-  esp_wifi_set_promiscuous(false);
-  
-  // Remove existing peer if any
-  esp_now_del_peer(cloudNodeAddress);
-  
-  // Register peer on this channel
-  esp_now_peer_info_t peerInfo;
-  memset(&peerInfo, 0, sizeof(peerInfo));
-  memcpy(peerInfo.peer_addr, cloudNodeAddress, 6);
-  peerInfo.channel = channel;
-  peerInfo.encrypt = false;
-  
-  if (esp_now_add_peer(&peerInfo) == ESP_OK) {
-    // Try sending test data multiple times per channel
-    for (int attempt = 0; attempt < 2; attempt++) {
-      dataSent = false;
-      sendSuccess = false;
-      
-      // Send a test message
-      struct_message testData;
-      testData.distance_cm = 0;
-      testData.level_percent = 0;
-      testData.litres_remaining = 0;
-      testData.timestamp = millis();
-      
-      esp_err_t result = esp_now_send(cloudNodeAddress, (uint8_t *) &testData, sizeof(testData));
-      
-      if (result == ESP_OK) {
-        // Wait for callback with longer timeout
-        unsigned long startWait = millis();
-        while (!dataSent && (millis() - startWait < 1000)) {
-          delay(10);
-        }
-        
-        if (sendSuccess) {
-          LOG("Cloud Node found!");
-          // Don't remove peer - we'll keep using it
-          return channel;
-        }
-      }
-      delay(200);  // Wait between attempts
-    }
-    
-    // Remove peer for next attempt
-    esp_now_del_peer(cloudNodeAddress);
+static bool espnowInitialized = false;
+
+// RTC memory channel score table (survives deep sleep)
+RTC_DATA_ATTR DiscoveryTable discoveryTable;
+
+#if ENABLE_TX_SLOTS
+static const TxPolicy sensorTxPolicy = { SENSOR_TX_ACK_TIMEOUT_MS, SENSOR_TX_RETRIES, TX_SLOT_BACKOFF_MAX_MS };
+
+// Slot assignment from the Cloud Node, handed over by the receive callback
+static uint8_t assignmentFrame[TX_SLOT_ASSIGN_LEN];
+static volatile bool assignmentPending = false;
+#else
+static const TxPolicy sensorTxPolicy = { SENSOR_TX_ACK_TIMEOUT_MS, SENSOR_TX_RETRIES, 0 };
+#endif
+
+// Store last successful channel in the RTC config snapshot (survives deep sleep)
+static void rememberChannel(int channel) {
+  if (getCachedChannel() == channel) return;
+  setCachedChannel(channel);
+  LOG_I("Saved channel %d to RTC memory", channel);
+}
+
+#if ENABLE_TX_SLOTS
+// Runs in the radio task: keep the frame for the main task
+static void onRadioReceive(const uint8_t mac[HAL_MAC_LEN], const uint8_t* data, size_t length) {
+  if (memcmp(mac, cloudNodeAddress, HAL_MAC_LEN) != 0 || length != TX_SLOT_ASSIGN_LEN ||
+      data[0] != TX_SLOT_ASSIGN_MAGIC) {
+    return;
   }
-  
-  return 0;  // Failed to connect on this channel
+  halCriticalEnter();
+  memcpy(assignmentFrame, data, TX_SLOT_ASSIGN_LEN);
+  assignmentPending = true;
+  halCriticalExit();
 }
 
-void OnDataSent(const wifi_tx_info_t *tx_info, esp_now_send_status_t status) {
-  Serial.print("Last Packet Send Status: ");
-  if (status == ESP_NOW_SEND_SUCCESS) {
-    Serial.println("Delivery Success");
-    dataSent = true;
-    sendSuccess = true;
-  } else {
-    Serial.println("Delivery Fail");
-    dataSent = true;
-    sendSuccess = false;
+// Give the Cloud Node TX_SLOT_LISTEN_MS to answer a delivered frame with a slot assignment
+static void listenForSlotAssignment() {
+  if (TX_SLOT_LISTEN_MS > 0) delay(TX_SLOT_LISTEN_MS);
+
+  uint8_t frame[TX_SLOT_ASSIGN_LEN];
+  halCriticalEnter();
+  bool pending = assignmentPending;
+  if (pending) memcpy(frame, assignmentFrame, sizeof(frame));
+  assignmentPending = false;
+  halCriticalExit();
+
+  if (pending && txSlotApplyAssignment(frame, sizeof(frame))) {
+    const TxSlotPlan& plan = txSlotPlan();
+    if (plan.assigned) {
+      LOG_I("Cloud Node assigned transmit slot %u of %u (%u ms)",
+            plan.slot, plan.count, plan.widthMs);
+    } else {
+      LOG_I("Cloud Node released the slot - back to slot %u", plan.slot);
+    }
   }
 }
+#endif
 
-int scanForCloudNode() {
-  LOG("Starting channel scan...");
-  Serial.print("Looking for Cloud Node MAC: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.printf("%02X", cloudNodeAddress[i]);
-    if (i < 5) Serial.print(":");
+// A frame was delivered on the current channel
+static void onFrameDelivered() {
+  // Save the successful channel for next time
+  rememberChannel(detectedChannel);
+#if ENABLE_TX_SLOTS
+  listenForSlotAssignment();
+#endif
+}
+
+// Set the radio channel used for ESP-NOW
+static void setRadioChannel(int channel) {
+  halRadioSetChannel(channel);
+}
+
+// Register the Cloud Node peer on a channel (modified in place if it already exists)
+static bool registerCloudPeer(int channel) {
+  return halRadioSetPeer(cloudNodeAddress, channel);
+}
+
+// Discovery probe: send a test frame on a channel and wait for the send callback
+static bool probeChannel(int channel, uint32_t ackTimeoutUs, uint32_t* ackUs) {
+  unsigned long ackWaitMs = ackTimeoutUs / 1000;
+
+  setRadioChannel(channel);
+  if (!registerCloudPeer(channel)) {
+    LOG_W("Trying channel %d (ack wait %lu ms)... peer error", channel, ackWaitMs);
+    return false;
   }
-  Serial.println();
-  
-  // If we have a saved channel from last time, try it first
-  if (savedChannel > 0 && savedChannel <= 13) {
-    Serial.print("Trying saved channel ");
-    Serial.print(savedChannel);
-    Serial.println(" first...");
-    
-    int result = tryChannel(savedChannel);
-    if (result > 0) {
-      Serial.println("SUCCESS on saved channel!");
-      return result;
-    }
-    Serial.println("Saved channel failed, scanning all channels...");
+
+  struct_message testData;
+  memset(&testData, 0, sizeof(testData));
+  testData.timestamp = millis();
+
+  TxPolicy policy = { ackTimeoutUs / 1000 + 1, 0, 0 };
+  TxHandle handle = txSubmit(cloudNodeAddress, &testData, sizeof(testData), policy);
+  if (handle == TX_INVALID_HANDLE) {
+    LOG_W("Trying channel %d (ack wait %lu ms)... send error", channel, ackWaitMs);
+    return false;
   }
-  
-  // Try common channels first (1, 6, 11), then all others
-  int channelsToTry[] = {1, 6, 11, 2, 3, 4, 5, 7, 8, 9, 10, 12, 13};
-  int numChannels = sizeof(channelsToTry) / sizeof(channelsToTry[0]);
-  
-  for (int i = 0; i < numChannels; i++) {
-    int channel = channelsToTry[i];
-    
-    // Skip if this is the saved channel we already tried
-    if (channel == savedChannel) {
-      continue;
-    }
-    
-    Serial.print("Trying channel ");
-    Serial.print(channel);
-    Serial.print("... ");
-    
-    int result = tryChannel(channel);
-    if (result > 0) {
-      Serial.println("SUCCESS!");
-      return result;
-    }
-    Serial.println("no response");
-    
-    delay(100);
+
+  // Returns the moment the send callback fires
+  if (txAwait(handle, ackUs) == TX_DELIVERED) {
+    LOG_D("Trying channel %d (ack wait %lu ms)... SUCCESS!", channel, ackWaitMs);
+    return true;
+  }
+  LOG_D("Trying channel %d (ack wait %lu ms)... no response", channel, ackWaitMs);
+  return false;
+}
+
+int scanForCloudNode() {
+  LOG_I("Starting channel scan for Cloud Node MAC " LOG_MAC_FMT, LOG_MAC_ARGS(cloudNodeAddress));
+
+  // Probe channels in score order, last wake's channel first
+  int channel = discoverChannel(discoveryTable, getCachedChannel(), probeChannel);
+  if (channel > 0) {
+    LOG_I("Cloud Node found!");
+    return channel;
   }
   
-  LOG("Channel scan failed - Cloud Node not found on any channel");
-  Serial.println("⚠️ CHECK:");
-  Serial.println("  1. Is Cloud Node running and connected to WiFi?");
-  Serial.println("  2. Is the MAC address correct?");
-  Serial.println("  3. Are devices within range (~100m)?");
+  LOG_E("Channel scan failed - Cloud Node not found on any channel");
+  LOG_W("CHECK: Cloud Node running and on WiFi? MAC address correct? Within range (~100m)?");
   return 0;
 }
 
 bool initializeESPNOW() {
-  // Init ESP-NOW first
-  if (esp_now_init() != ESP_OK) {
-    LOG("Error initializing ESP-NOW");
+  PROFILE_SCOPE(PHASE_RADIO_INIT);
+
+  // Init ESP-NOW first (the radio stays on until deep sleep)
+  energyBegin(POWER_RADIO_RX);
+  if (!halRadioInit()) {
+    LOG_E("Error initializing ESP-NOW");
     return false;
   }
 
-  // Register send callback
-  esp_now_register_send_cb(OnDataSent);
+  // Set up the transmit layer (registers the send callback)
+  if (!txInit()) {
+    LOG_E("Error initializing ESP-NOW transmit layer");
+    return false;
+  }
+#if ENABLE_TX_SLOTS
+  halRadioOnReceive(onRadioReceive);
+#endif
 
   // Determine WiFi channel
   if (WIFI_CHANNEL == 0) {
     // Auto-scan for channel
-    LOG("Auto-scan mode enabled");
+    LOG_D("Auto-scan mode enabled");
     detectedChannel = scanForCloudNode();
     
     if (detectedChannel == 0) {
-      LOG("Failed to find Cloud Node - will retry on next wake");
+      LOG_W("Failed to find Cloud Node - will retry on next wake");
       // Try channel 1 as fallback
       detectedChannel = 1;
       
       // Set WiFi channel
-      esp_wifi_set_promiscuous(true);
-      esp_wifi_set_channel(detectedChannel, WIFI_SECOND_CHAN_NONE);
-      esp_wifi_set_promiscuous(false);
+      setRadioChannel(detectedChannel);
       
       // Register peer (Cloud Node) on fallback channel
-      esp_now_peer_info_t peerInfo;
-      memset(&peerInfo, 0, sizeof(peerInfo));
-      memcpy(peerInfo.peer_addr, cloudNodeAddress, 6);
-      peerInfo.channel = detectedChannel;
-      peerInfo.encrypt = false;
-
-      // Add peer        
-      if (esp_now_add_peer(&peerInfo) != ESP_OK){
-        LOG("Failed to add peer");
+      if (!registerCloudPeer(detectedChannel)) {
+        LOG_E("Failed to add peer");
         return false;
       }
     } else {
       // Channel found and peer already added during scan
-      LOG("Using detected channel - peer already registered");
+      LOG_D("Using detected channel - peer already registered");
       // Save the successful channel for next time
-      savedChannel = detectedChannel;
-      Serial.print("Saved channel ");
-      Serial.print(savedChannel);
-      Serial.println(" to RTC memory");
+      rememberChannel(detectedChannel);
     }
   } else {
     // Use specified channel
     detectedChannel = WIFI_CHANNEL;
-    LOG("Using pre-configured channel");
+    LOG_D("Using pre-configured channel");
     
     // Set WiFi channel
-    esp_wifi_set_promiscuous(true);
-    esp_wifi_set_channel(detectedChannel, WIFI_SECOND_CHAN_NONE);
-    esp_wifi_set_promiscuous(false);
+    setRadioChannel(detectedChannel);
     
     // Register peer (Cloud Node) on the specified channel
-    esp_now_peer_info_t peerInfo;
-    memset(&peerInfo, 0, sizeof(peerInfo));
-    memcpy(peerInfo.peer_addr, cloudNodeAddress, 6);
-    peerInfo.channel = detectedChannel;
-    peerInfo.encrypt = false;
-
-    // Add peer        
-    if (esp_now_add_peer(&peerInfo) != ESP_OK){
-      LOG("Failed to add peer");
+    if (!registerCloudPeer(detectedChannel)) {
+      LOG_E("Failed to add peer");
       return false;
     }
   }
   
-  Serial.print("WiFi Channel set to: ");
-  Serial.println(detectedChannel);
+  LOG_I("WiFi Channel set to: %d", detectedChannel);
   
+  espnowInitialized = true;
   return true;
 }
 
-bool sendSensorData(struct_message &data) {
-  Serial.print("Sending data via ESP-NOW on channel ");
-  Serial.println(detectedChannel);
-  dataSent = false;
-  sendSuccess = false;
+bool isESPNOWInitialized() {
+  return espnowInitialized;
+}
+
+bool sendFrame(const uint8_t* frame, size_t length) {
+  PROFILE_SCOPE(PHASE_SEND);
+
+  LOG_I("Sending data via ESP-NOW on channel %d", detectedChannel);
   
-  esp_err_t result = esp_now_send(cloudNodeAddress, (uint8_t *) &data, sizeof(data));
+  TxHandle handle = txSubmit(cloudNodeAddress, frame, length, sensorTxPolicy);
+  if (handle == TX_INVALID_HANDLE) {
+    LOG_E("Error sending the data");
+    return false;
+  }
+  LOG_D("Frame queued");
+
+  // Wait for the send callback (retries handled by the transmit layer)
+  uint32_t latencyUs = 0;
+  TxStatus status = txAwait(handle, &latencyUs);
+  discoveryRecord(discoveryTable, detectedChannel, status == TX_DELIVERED, latencyUs);
+
+  if (status == TX_DELIVERED) {
+    LOG_I("Send confirmed successful (%lu us)", (unsigned long)latencyUs);
+    onFrameDelivered();
+    return true;
+  }
+
+  LOG_W("Send failed - Cloud Node may have changed channels, rescanning...");
   
-  if (result == ESP_OK) {
-    LOG("Sent with success");
-    
-    // Wait for send callback
-    unsigned long startWait = millis();
-    while (!dataSent && (millis() - startWait < 2000)) {
-      delay(10);
-    }
-    
-    // Check if send was actually successful
-    if (!sendSuccess) {
-      LOG("Send failed - Cloud Node may have changed channels");
-      LOG("Rescanning for Cloud Node...");
-      
-      // Remove the old peer
-      esp_now_del_peer(cloudNodeAddress);
-      
-      // Scan for the Cloud Node on a new channel
-      int newChannel = scanForCloudNode();
-      
-      if (newChannel > 0) {
-        detectedChannel = newChannel;
-        Serial.print("Found Cloud Node on new channel: ");
-        Serial.println(detectedChannel);
-        
-        // Try sending again on the new channel
-        LOG("Retrying send on new channel...");
-        dataSent = false;
-        sendSuccess = false;
-        
-        result = esp_now_send(cloudNodeAddress, (uint8_t *) &data, sizeof(data));
-        
-        if (result == ESP_OK) {
-          startWait = millis();
-          while (!dataSent && (millis() - startWait < 2000)) {
-            delay(10);
-          }
-          
-          if (sendSuccess) {
-            LOG("Retry successful!");
-            // Save the successful channel for next time
-            savedChannel = detectedChannel;
-            Serial.print("Saved channel ");
-            Serial.print(savedChannel);
-            Serial.println(" to RTC memory");
-            return true;
-          } else {
-            LOG("Retry failed");
-            return false;
-          }
-        }
-      } else {
-        LOG("Could not find Cloud Node on any channel");
-        return false;
-      }
-    } else {
-      LOG("Send confirmed successful");
-      // Save the successful channel for next time
-      if (savedChannel != detectedChannel) {
-        savedChannel = detectedChannel;
-        Serial.print("Saved channel ");
-        Serial.print(savedChannel);
-        Serial.println(" to RTC memory");
-      }
-      return true;
-    }
-  } else {
-    LOG("Error sending the data");
+  // Scan for the Cloud Node on a new channel
+  int newChannel = scanForCloudNode();
+  if (newChannel == 0) {
+    LOG_E("Could not find Cloud Node on any channel");
     return false;
   }
+
+  detectedChannel = newChannel;
+  LOG_I("Found Cloud Node on new channel %d - retrying send", detectedChannel);
   
+  // Try sending again on the new channel
+  handle = txSubmit(cloudNodeAddress, frame, length, sensorTxPolicy);
+  if (handle != TX_INVALID_HANDLE && txAwait(handle, nullptr) == TX_DELIVERED) {
+    LOG_I("Retry successful!");
+    onFrameDelivered();
+    return true;
+  }
+
+  LOG_E("Retry failed");
   return false;
 }
 
+bool sendSensorData(struct_message &data) {
+#if WIRE_FORMAT == WIRE_FORMAT_V2
+  uint8_t frame[WIRE_V2_HEADER_LEN + WIRE_V2_RECORD_LEN + 16];
+  WireWriter writer;
+  wireBegin(writer, frame, sizeof(frame), wireLocalNodeId(), wireNextSequence(), 0);
+  wireAddReading(writer, data, 0);
+  wireAddNodeTlvs(writer);
+  return sendFrame(frame, wireFinish(writer));
+#else
+  return sendFrame((const uint8_t *) &data, sizeof(data));
+#endif
+}
+
 bool updateCloudNodePeer(uint8_t* newMacAddress) {
-  Serial.println("Updating ESP-NOW peer with new cloud node MAC...");
+  LOG_I("Updating ESP-NOW peer with new cloud node MAC...");
   
   // Remove the old peer if it exists
-  esp_now_del_peer(cloudNodeAddress);
+  halRadioRemovePeer(cloudNodeAddress);
   
   // Copy new MAC address to cloudNodeAddress (already done in saveCloudNodeMAC, but just to be safe)
   memcpy(cloudNodeAddress, newMacAddress, 6);
   
-  Serial.print("New Cloud Node MAC: ");
-  for (int i = 0; i < 6; i++) {
-    Serial.printf("%02X", cloudNodeAddress[i]);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.println();
+  LOG_I("New Cloud Node MAC: " LOG_MAC_FMT, LOG_MAC_ARGS(cloudNodeAddress));
   
   // Scan for the new cloud node
   int newChannel = scanForCloudNode();
   
   if (newChannel > 0) {
     detectedChannel = newChannel;
-    savedChannel = newChannel;
-    Serial.print("✓ Found new Cloud Node on channel: ");
-    Serial.println(detectedChannel);
+    rememberChannel(newChannel);
+    LOG_I("✓ Found new Cloud Node on channel: %d", detectedChannel);
     return true;
   } else {
-    Serial.println("✗ Could not find new Cloud Node on any channel");
-    Serial.println("  ESP-NOW peer will be updated on next reboot");
+    LOG_E("✗ Could not find new Cloud Node on any channel - peer will be updated on next reboot");
     return false;
   }
 }
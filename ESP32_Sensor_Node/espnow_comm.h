@@ -7,19 +7,11 @@
 #ifndef ESPNOW_COMM_H
 #define ESPNOW_COMM_H
 
-#include <Arduino.h>
-#include <esp_now.h>
-#include <WiFi.h>
-#include <esp_wifi.h>
+#include "hal.h"
 #include "config.h"
 
 // Global variables for ESP-NOW status
 extern int detectedChannel;
-extern bool dataSent;
-extern bool sendSuccess;
-
-// Callback when data is sent
-void OnDataSent(const wifi_tx_info_t *tx_info, esp_now_send_status_t status);
 
 // Scan WiFi channels to find the Cloud Node
 // Returns the channel number if found, or 0 if not found
@@ -28,10 +20,17 @@ int scanForCloudNode();
 // Initialize ESP-NOW and set up the peer connection
 bool initializeESPNOW();
 
+// True once initializeESPNOW() has succeeded on this boot
+bool isESPNOWInitialized();
+
 // Send sensor data to the Cloud Node
 // Returns true if send was successful, false otherwise
 bool sendSensorData(struct_message &data);
 
+// Send a raw frame (e.g. a reading batch) to the Cloud Node, rescanning
+// channels if it is not acked. Returns true if it was delivered
+bool sendFrame(const uint8_t* frame, size_t length);
+
 // Update ESP-NOW peer with new cloud node MAC address
 bool updateCloudNodePeer(uint8_t* newMacAddress);
 
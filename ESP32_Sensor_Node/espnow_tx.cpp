@@ -0,0 +1,264 @@
+/*
+ * ESP-NOW Transmit Layer Implementation
+ */
+
+#include "espnow_tx.h"
+#include "energy.h"
+#include "tx_slot.h"
+
+// ESP-NOW reports completions in send order, so callbacks are matched to
+// attempts through a FIFO. Retries and timeouts leave a stale entry
+// behind; its tag no longer matches the slot and the callback is ignored.
+#define TX_FIFO_LEN (TX_MAX_IN_FLIGHT * 4)
+
+typedef enum TxSlotState : uint8_t {
+  SLOT_FREE = 0,
+  SLOT_SENDING,     // Attempt handed to ESP-NOW, waiting for the callback
+  SLOT_COMPLETED,   // Callback fired for the current attempt
+  SLOT_BACKOFF,     // Attempt failed, waiting out the backoff before the retry
+  SLOT_FINAL        // Final status set, waiting to be released
+} TxSlotState;
+
+typedef struct TxSlot {
+  volatile TxSlotState state;
+  volatile bool acked;          // Result of the current attempt
+  volatile uint8_t tag;         // Bumped on every attempt
+  volatile uint64_t doneUs;     // Callback time of the current attempt
+  TxStatus status;
+  uint8_t generation;           // Bumped on every submit, part of the handle
+  uint8_t attempts;
+  TxPolicy policy;
+  uint64_t attemptUs;           // Start of the current attempt
+  uint64_t retryUs;             // End of the backoff (SLOT_BACKOFF)
+  uint8_t peer[HAL_MAC_LEN];
+  uint8_t length;
+  uint8_t data[HAL_RADIO_MAX_PAYLOAD];
+  HalSignal done;               // Given by the send callback
+} TxSlot;
+
+typedef struct TxFifoEntry {
+  uint8_t slot;
+  uint8_t tag;
+} TxFifoEntry;
+
+static TxSlot slots[TX_MAX_IN_FLIGHT];
+static TxFifoEntry fifo[TX_FIFO_LEN];
+static int fifoHead = 0;
+static int fifoCount = 0;
+static bool txReady = false;
+
+static uint64_t txNowUs() {
+  return halMicros();
+}
+
+static TxHandle makeHandle(int index) {
+  return (slots[index].generation << 8) | index;
+}
+
+// Slot for a handle, or nullptr if it is stale
+static TxSlot* slotFor(TxHandle handle) {
+  if (handle < 0) return nullptr;
+  int index = handle & 0xFF;
+  if (index >= TX_MAX_IN_FLIGHT) return nullptr;
+  TxSlot* slot = &slots[index];
+  if (slot->state == SLOT_FREE || slot->generation != ((handle >> 8) & 0xFF)) return nullptr;
+  return slot;
+}
+
+static void txOnDataSent(bool acked) {
+  TxSlot* completed = nullptr;
+
+  halCriticalEnter();
+  if (fifoCount > 0) {
+    TxFifoEntry entry = fifo[fifoHead];
+    fifoHead = (fifoHead + 1) % TX_FIFO_LEN;
+    fifoCount--;
+
+    TxSlot* slot = &slots[entry.slot];
+    if (slot->state == SLOT_SENDING && slot->tag == entry.tag) {
+      slot->acked = acked;
+      slot->doneUs = txNowUs();
+      slot->state = SLOT_COMPLETED;
+      completed = slot;
+    }
+  }
+  halCriticalExit();
+
+  if (completed != nullptr) {
+    halSignalGive(completed->done);
+  }
+}
+
+// Hand the slot's frame to ESP-NOW
+static bool startAttempt(int index) {
+  TxSlot* slot = &slots[index];
+  slot->attempts++;
+
+  halCriticalEnter();
+  if (fifoCount >= TX_FIFO_LEN) {
+    halCriticalExit();
+    return false;
+  }
+  slot->tag++;
+  slot->state = SLOT_SENDING;
+  fifo[(fifoHead + fifoCount) % TX_FIFO_LEN] = { (uint8_t)index, slot->tag };
+  fifoCount++;
+  halCriticalExit();
+
+  halSignalTake(slot->done, 0);  // Drop a completion left over from a stale attempt
+  slot->attemptUs = txNowUs();
+
+  if (!halRadioSend(slot->peer, slot->data, slot->length)) {
+    // Not accepted, so no callback will come - take our entry back off the tail
+    halCriticalEnter();
+    fifoCount--;
+    slot->tag++;
+    halCriticalExit();
+    return false;
+  }
+  energyAddTxFrame(slot->length);
+  return true;
+}
+
+static void finishSlot(TxSlot* slot, TxStatus status) {
+  slot->status = status;
+  slot->state = SLOT_FINAL;
+}
+
+// Send again if retries are left (keep trying while ESP-NOW refuses the frame)
+static void retryOrFinish(int index, TxStatus failure) {
+  TxSlot* slot = &slots[index];
+  while (slot->attempts <= slot->policy.maxRetries) {
+    if (startAttempt(index)) return;
+  }
+  finishSlot(slot, failure);
+}
+
+// Advance a slot: apply a completed callback, or a timeout, and retry if allowed
+static void serviceSlot(int index) {
+  TxSlot* slot = &slots[index];
+  bool attemptFailed = false;
+  TxStatus failure = TX_FAILED;
+
+  if (slot->state == SLOT_BACKOFF) {
+    if (txNowUs() >= slot->retryUs) retryOrFinish(index, slot->status);
+    return;
+  }
+
+  if (slot->state == SLOT_COMPLETED) {
+    if (slot->acked) {
+      finishSlot(slot, TX_DELIVERED);
+      return;
+    }
+    attemptFailed = true;
+  } else if (slot->state == SLOT_SENDING &&
+             txNowUs() - slot->attemptUs > (uint64_t)slot->policy.ackTimeoutMs * 1000ULL) {
+    attemptFailed = true;
+    failure = TX_TIMEOUT;
+  }
+
+  if (!attemptFailed) return;
+
+  // Back off a random time so nodes that collided do not retry in step
+  if (slot->attempts <= slot->policy.maxRetries && slot->policy.backoffMaxMs > 0) {
+    slot->status = failure;  // Reported if the retries run out
+    slot->retryUs = txNowUs() + (uint64_t)txSlotRandom(slot->policy.backoffMaxMs + 1U) * 1000ULL;
+    slot->state = SLOT_BACKOFF;
+    return;
+  }
+  retryOrFinish(index, failure);
+}
+
+static void releaseSlot(TxSlot* slot) {
+  halCriticalEnter();
+  slot->state = SLOT_FREE;
+  slot->tag++;  // Ignore any callback still in the FIFO for this slot
+  halCriticalExit();
+}
+
+bool txInit() {
+  if (!txReady) {
+    for (int i = 0; i < TX_MAX_IN_FLIGHT; i++) {
+      slots[i].state = SLOT_FREE;
+      slots[i].done = halSignalCreate();
+      if (slots[i].done == nullptr) return false;
+    }
+    txReady = true;
+  }
+
+  fifoHead = 0;
+  fifoCount = 0;
+  return halRadioOnSent(txOnDataSent);
+}
+
+TxHandle txSubmit(const uint8_t* peerAddr, const void* data, size_t length, const TxPolicy& policy) {
+  if (!txReady || length == 0 || length > HAL_RADIO_MAX_PAYLOAD) return TX_INVALID_HANDLE;
+
+  for (int i = 0; i < TX_MAX_IN_FLIGHT; i++) {
+    TxSlot* slot = &slots[i];
+    if (slot->state != SLOT_FREE) continue;
+
+    slot->generation++;
+    slot->attempts = 0;
+    slot->status = TX_PENDING;
+    slot->policy = policy;
+    slot->length = (uint8_t)length;
+    memcpy(slot->peer, peerAddr, HAL_MAC_LEN);
+    memcpy(slot->data, data, length);
+
+    if (!startAttempt(i)) {
+      releaseSlot(slot);
+      return TX_INVALID_HANDLE;
+    }
+    return makeHandle(i);
+  }
+  return TX_INVALID_HANDLE;  // All slots in flight
+}
+
+TxStatus txPoll(TxHandle handle) {
+  TxSlot* slot = slotFor(handle);
+  if (slot == nullptr) return TX_UNKNOWN;
+
+  serviceSlot(handle & 0xFF);
+  if (slot->state != SLOT_FINAL) return TX_PENDING;
+
+  TxStatus status = slot->status;
+  releaseSlot(slot);
+  return status;
+}
+
+TxStatus txAwait(TxHandle handle, uint32_t* latencyUs) {
+  TxSlot* slot = slotFor(handle);
+  if (slot == nullptr) return TX_UNKNOWN;
+  int index = handle & 0xFF;
+
+  for (;;) {
+    serviceSlot(index);
+    if (slot->state == SLOT_FINAL) break;
+
+    // Sleep until the callback fires, this attempt's timeout expires or the backoff ends
+    uint64_t nowUs = txNowUs();
+    uint64_t untilUs = slot->state == SLOT_BACKOFF
+                           ? slot->retryUs
+                           : slot->attemptUs + (uint64_t)slot->policy.ackTimeoutMs * 1000ULL;
+    uint32_t waitMs = nowUs < untilUs ? (uint32_t)((untilUs - nowUs) / 1000) + 1 : 1;
+    halSignalTake(slot->done, waitMs);
+  }
+
+  if (latencyUs != nullptr) {
+    uint64_t endUs = slot->status == TX_TIMEOUT ? txNowUs() : slot->doneUs;
+    *latencyUs = (uint32_t)(endUs - slot->attemptUs);
+  }
+
+  TxStatus status = slot->status;
+  releaseSlot(slot);
+  return status;
+}
+
+int txInFlight() {
+  int count = 0;
+  for (int i = 0; i < TX_MAX_IN_FLIGHT; i++) {
+    if (slots[i].state != SLOT_FREE) count++;
+  }
+  return count;
+}
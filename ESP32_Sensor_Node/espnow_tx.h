@@ -0,0 +1,57 @@
+/*
+ * ESP-NOW Transmit Layer
+ *
+ * Queues frames for ESP-NOW and tracks each one by handle. Completion is
+ * signalled from the send callback through a per-frame semaphore, so
+ * waiters wake at the real radio turnaround instead of polling. Up to
+ * TX_MAX_IN_FLIGHT frames can be outstanding, each with its own ack
+ * timeout, retry count and random backoff before each retry.
+ *
+ * Frames must be submitted and awaited from one task at a time.
+ */
+
+#ifndef ESPNOW_TX_H
+#define ESPNOW_TX_H
+
+#include "hal.h"
+#include "config.h"
+
+#define TX_MAX_IN_FLIGHT 4
+
+typedef int TxHandle;
+#define TX_INVALID_HANDLE (-1)
+
+typedef enum TxStatus {
+  TX_PENDING = 0,   // Waiting for the send callback (or a retry)
+  TX_DELIVERED,     // Peer acked the frame
+  TX_FAILED,        // Peer did not ack after all retries
+  TX_TIMEOUT,       // No send callback within the ack timeout after all retries
+  TX_UNKNOWN        // Handle is invalid or was already released
+} TxStatus;
+
+typedef struct TxPolicy {
+  uint32_t ackTimeoutMs;  // Wait for the send callback per attempt
+  uint8_t maxRetries;     // Extra attempts after the first one fails
+  uint16_t backoffMaxMs;  // Retries wait a random 0..backoffMaxMs first (0 = retry at once)
+} TxPolicy;
+
+// Create the frame slots and register the ESP-NOW send callback
+// Call after halRadioInit()
+bool txInit();
+
+// Queue a frame for a peer. Returns TX_INVALID_HANDLE if the queue is full,
+// the frame is too long or ESP-NOW refused it
+TxHandle txSubmit(const uint8_t* peerAddr, const void* data, size_t length, const TxPolicy& policy);
+
+// Check a frame without blocking (runs due retries and timeouts).
+// Once a final status is returned the handle is released
+TxStatus txPoll(TxHandle handle);
+
+// Block until the frame is delivered, failed or timed out, then release it.
+// latencyUs (optional) gets the send-to-callback time of the last attempt
+TxStatus txAwait(TxHandle handle, uint32_t* latencyUs);
+
+// Number of frames currently queued or in flight
+int txInFlight();
+
+#endif // ESPNOW_TX_H
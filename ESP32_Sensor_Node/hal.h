@@ -0,0 +1,228 @@
+/*
+ * Hardware Abstraction Layer
+ *
+ * Everything the firmware needs from the chip: clock, GPIO, ultrasonic
+ * ping, ADC, NVS, reset reason, deep sleep and the ESP-NOW radio. Two
+ * backends implement it:
+ *   hal_esp32.cpp - Arduino-ESP32 (built when ARDUINO is defined)
+ *   hal_linux.cpp - host simulation with a virtual clock, scriptable echo
+ *                   model, in-memory NVS, RTC memory that survives
+ *                   simulated deep sleep and a lossy ESP-NOW medium
+ *
+ * On the host the Linux backend also provides millis()/delay()/Serial,
+ * so modules that log keep using the Arduino names.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#endif
+
+#define HAL_MAC_LEN 6
+#define HAL_RADIO_MAX_PAYLOAD 250  // ESP-NOW payload limit
+
+// ----- Clock -----
+
+uint32_t halMillis();
+uint64_t halMicros();
+void halDelayMs(uint32_t ms);
+void halDelayUs(uint32_t us);
+
+// ----- GPIO / sensor -----
+
+void halPinOutput(int pin);
+void halPinInput(int pin);
+void halPinWrite(int pin, bool high);
+
+// Fire a 10 us trigger pulse and measure the echo high time.
+// Returns 0 if no echo arrived within timeoutUs
+uint32_t halPingEchoUs(int trigPin, int echoPin, uint32_t timeoutUs);
+
+// One ADC conversion in millivolts at the pin (11 dB attenuation, 0-3.1 V),
+// corrected with the chip's eFuse calibration
+uint32_t halAnalogReadMilliVolts(int pin);
+
+// ----- NVS (one namespace open at a time, like Preferences) -----
+
+bool halNvsOpen(const char* ns, bool readOnly);
+void halNvsClose();
+bool halNvsHasKey(const char* key);
+float halNvsGetFloat(const char* key, float defaultValue);
+void halNvsPutFloat(const char* key, float value);
+uint32_t halNvsGetU32(const char* key, uint32_t defaultValue);
+void halNvsPutU32(const char* key, uint32_t value);
+uint16_t halNvsGetU16(const char* key, uint16_t defaultValue);
+void halNvsPutU16(const char* key, uint16_t value);
+size_t halNvsGetBytes(const char* key, void* out, size_t length);
+// Returns the bytes written (0 = failed; the old value is kept)
+size_t halNvsPutBytes(const char* key, const void* data, size_t length);
+void halNvsRemove(const char* key);
+
+// ----- Reset / sleep -----
+
+enum HalResetReason : uint8_t {
+  HAL_RESET_POWERON = 0,
+  HAL_RESET_DEEPSLEEP,
+  HAL_RESET_OTHER
+};
+
+HalResetReason halResetReason();
+
+// Raw reset reason code for logs (esp_reset_reason_t on ESP32)
+int halResetCode();
+
+// Enter deep sleep; does not return
+void halDeepSleep(uint64_t sleepUs);
+
+// Software reset (RTC memory is kept); does not return
+void halRestart();
+
+// Identifies the running firmware image (changes with every build)
+uint32_t halFirmwareId();
+
+// ----- ESP-NOW radio -----
+
+typedef void (*HalSendCallback)(bool acked);
+typedef void (*HalReceiveCallback)(const uint8_t mac[HAL_MAC_LEN], const uint8_t* data, size_t length);
+
+// WiFi station mode + ESP-NOW init
+bool halRadioInit();
+void halReadMac(uint8_t mac[HAL_MAC_LEN]);
+void halRadioSetChannel(int channel);
+// Register a peer on a channel (modified in place if it already exists)
+bool halRadioSetPeer(const uint8_t mac[HAL_MAC_LEN], int channel);
+void halRadioRemovePeer(const uint8_t mac[HAL_MAC_LEN]);
+// Queue a frame; the send callback reports whether the peer acked it
+bool halRadioSend(const uint8_t mac[HAL_MAC_LEN], const uint8_t* data, size_t length);
+bool halRadioOnSent(HalSendCallback callback);
+// Frames received from any peer while the radio is up (runs in the radio task)
+bool halRadioOnReceive(HalReceiveCallback callback);
+
+// ----- Synchronisation -----
+
+// Binary signal given from the send callback, taken by the waiting task
+typedef void* HalSignal;
+HalSignal halSignalCreate();
+void halSignalGive(HalSignal signal);
+// Returns false if the signal was not given within timeoutMs
+bool halSignalTake(HalSignal signal, uint32_t timeoutMs);
+
+// Short critical section shared with the send callback and other tasks
+// (a spinlock on the ESP32, a recursive mutex on the host)
+void halCriticalEnter();
+void halCriticalExit();
+
+#ifndef ARDUINO
+
+// ----- Host simulation controls (Linux backend only) -----
+
+// Distance the echo model reports at a virtual time (NAN = no echo)
+typedef float (*HalEchoModel)(uint64_t nowUs, void* context);
+
+// Millivolts at the battery ADC pin at a virtual time
+typedef float (*HalBatteryModel)(uint64_t nowUs, void* context);
+
+typedef struct HalSimConfig {
+  int gatewayChannel;          // Channel the simulated Cloud Node listens on
+  uint8_t gatewayMac[HAL_MAC_LEN];
+  uint8_t nodeMac[HAL_MAC_LEN];
+  float lossRate;              // Probability a frame on the right channel is not acked
+  uint32_t ackLatencyUs;       // Send-to-callback time
+  uint32_t radioInitUs;        // Time halRadioInit() takes
+  uint32_t batteryMilliVolts;  // Voltage at the ADC pin (without a battery model)
+  uint32_t seed;               // Loss RNG seed
+  bool quiet;                  // Drop the firmware's Serial output
+  uint32_t serialBaud;         // Console writes block for 10 bits/char at this rate (0 = free)
+} HalSimConfig;
+
+typedef struct HalSimStats {
+  uint32_t wakes;
+  uint64_t awakeUs;            // Total awake time over all wakes
+  uint64_t sleepUs;            // Total deep sleep time
+  uint32_t framesSent;
+  uint32_t framesAcked;
+  uint32_t pings;
+  uint32_t adcReads;           // ADC conversions
+  uint32_t radioInits;         // Wakes that brought the radio up
+  uint32_t nvsReads;           // NVS get calls that found the key
+  uint32_t nvsWrites;          // NVS put/remove calls (flash writes on the chip)
+} HalSimStats;
+
+void halSimConfigure(const HalSimConfig& config);
+
+// Power the node off: clear RTC memory, NVS, the wall clock and the counters
+void halSimReset();
+
+// Copy the last wake's RTC memory into the simulator process, so it can
+// read firmware state (e.g. the energy totals) after a run
+void halSimLoadRtc();
+
+// Move the simulated Cloud Node to a channel as soon as it has acked
+// afterAcks frames in total, which can be in the middle of a wake (e.g.
+// between the channel probe and the data frame)
+void halSimMoveGateway(int channel, uint32_t afterAcks);
+void halSimSetEchoModel(HalEchoModel model, void* context);
+void halSimSetBatteryModel(HalBatteryModel model, void* context);
+
+// Gateway reply to an acked frame (e.g. a slot assignment), delivered to
+// the node's receive callback ackLatencyUs after the ack. Returns the
+// reply length, 0 for no reply
+typedef size_t (*HalGatewayReply)(const uint8_t* frame, size_t length, uint8_t* reply,
+                                  size_t capacity, void* context);
+void halSimSetGatewayReply(HalGatewayReply reply, void* context);
+
+// Run wakes boot() calls (setup + loop) until wakes have completed or the
+// virtual wall clock passes untilUs. Each wake starts with fresh globals;
+// RTC_DATA_ATTR variables and NVS carry over
+void halSimRun(void (*boot)(), uint32_t wakes, uint64_t untilUs);
+
+// Virtual wall clock including deep sleep, and counters
+uint64_t halSimWallUs();
+const HalSimStats& halSimStats();
+
+// Concurrent stages (the wake pipeline's host threads). Every thread runs
+// on its own virtual clock: a new thread starts it where its stages were
+// forked, and after the join the caller moves on to the latest end. Radio
+// callbacks fire on the thread that sent the frame, or on the joining one
+void halSimThreadStart(uint64_t startUs);
+void halSimThreadJoin(uint64_t endUs);
+
+// Arduino names used by the firmware, backed by the virtual clock and stdout
+inline unsigned long millis() { return halMillis(); }
+inline unsigned long micros() { return (unsigned long)halMicros(); }
+inline void delay(uint32_t ms) { halDelayMs(ms); }
+inline void delayMicroseconds(uint32_t us) { halDelayUs(us); }
+
+class HalSerial {
+ public:
+  void begin(unsigned long) {}
+  void flush() {}
+  int available() { return 0; }
+  int read() { return -1; }
+  int printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+  void print(const char* s);
+  void print(char c);
+  void print(int v);
+  void print(unsigned v);
+  void print(long v);
+  void print(unsigned long v);
+  void print(double v, int digits = 2);
+  template <typename T> void println(T v) { print(v); print('\n'); }
+  void println(double v, int digits) { print(v, digits); print('\n'); }
+  void println() { print('\n'); }
+};
+
+extern HalSerial Serial;
+
+#endif // !ARDUINO
+
+#endif // HAL_H
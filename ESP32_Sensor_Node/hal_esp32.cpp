@@ -0,0 +1,238 @@
+/*
+ * Hardware Abstraction Layer - Arduino-ESP32 Backend
+ */
+
+#include "hal.h"
+
+#ifdef ARDUINO
+
+#include <WiFi.h>
+#include <Preferences.h>
+#include <esp_now.h>
+#include "esp_wifi.h"
+#include "esp_mac.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_app_desc.h"
+#include "freertos/semphr.h"
+
+static Preferences halPreferences;
+static HalSendCallback halSendCallback = nullptr;
+static HalReceiveCallback halReceiveCallback = nullptr;
+static portMUX_TYPE halMux = portMUX_INITIALIZER_UNLOCKED;
+
+// ----- Clock -----
+
+uint32_t halMillis() {
+  return millis();
+}
+
+uint64_t halMicros() {
+  return (uint64_t)esp_timer_get_time();
+}
+
+void halDelayMs(uint32_t ms) {
+  delay(ms);
+}
+
+void halDelayUs(uint32_t us) {
+  delayMicroseconds(us);
+}
+
+// ----- GPIO / sensor -----
+
+void halPinOutput(int pin) {
+  pinMode(pin, OUTPUT);
+}
+
+void halPinInput(int pin) {
+  pinMode(pin, INPUT);
+}
+
+void halPinWrite(int pin, bool high) {
+  digitalWrite(pin, high ? HIGH : LOW);
+}
+
+uint32_t halPingEchoUs(int trigPin, int echoPin, uint32_t timeoutUs) {
+  digitalWrite(trigPin, LOW);
+  delayMicroseconds(2);
+
+  digitalWrite(trigPin, HIGH);
+  delayMicroseconds(10);
+  digitalWrite(trigPin, LOW);
+
+  return pulseIn(echoPin, HIGH, timeoutUs);
+}
+
+uint32_t halAnalogReadMilliVolts(int pin) {
+  // Attenuation once per wake; analogReadMilliVolts() applies the eFuse calibration
+  static int attenuatedPin = -1;
+  if (attenuatedPin != pin) {
+    analogSetPinAttenuation(pin, ADC_11db);
+    attenuatedPin = pin;
+  }
+  return analogReadMilliVolts(pin);
+}
+
+// ----- NVS -----
+
+bool halNvsOpen(const char* ns, bool readOnly) {
+  return halPreferences.begin(ns, readOnly);
+}
+
+void halNvsClose() {
+  halPreferences.end();
+}
+
+bool halNvsHasKey(const char* key) {
+  return halPreferences.isKey(key);
+}
+
+float halNvsGetFloat(const char* key, float defaultValue) {
+  return halPreferences.getFloat(key, defaultValue);
+}
+
+void halNvsPutFloat(const char* key, float value) {
+  halPreferences.putFloat(key, value);
+}
+
+uint32_t halNvsGetU32(const char* key, uint32_t defaultValue) {
+  return halPreferences.getUInt(key, defaultValue);
+}
+
+void halNvsPutU32(const char* key, uint32_t value) {
+  halPreferences.putUInt(key, value);
+}
+
+uint16_t halNvsGetU16(const char* key, uint16_t defaultValue) {
+  return halPreferences.getUShort(key, defaultValue);
+}
+
+void halNvsPutU16(const char* key, uint16_t value) {
+  halPreferences.putUShort(key, value);
+}
+
+size_t halNvsGetBytes(const char* key, void* out, size_t length) {
+  return halPreferences.getBytes(key, out, length);
+}
+
+size_t halNvsPutBytes(const char* key, const void* data, size_t length) {
+  return halPreferences.putBytes(key, data, length);
+}
+
+void halNvsRemove(const char* key) {
+  halPreferences.remove(key);
+}
+
+// ----- Reset / sleep -----
+
+HalResetReason halResetReason() {
+  switch (esp_reset_reason()) {
+    case ESP_RST_POWERON:   return HAL_RESET_POWERON;
+    case ESP_RST_DEEPSLEEP: return HAL_RESET_DEEPSLEEP;
+    default:                return HAL_RESET_OTHER;
+  }
+}
+
+int halResetCode() {
+  return (int)esp_reset_reason();
+}
+
+void halDeepSleep(uint64_t sleepUs) {
+  esp_sleep_enable_timer_wakeup(sleepUs);
+  esp_deep_sleep_start();
+}
+
+void halRestart() {
+  ESP.restart();
+}
+
+uint32_t halFirmwareId() {
+  const uint8_t* sha = esp_app_get_description()->app_elf_sha256;
+  return (uint32_t)sha[0] | (uint32_t)sha[1] << 8 | (uint32_t)sha[2] << 16 | (uint32_t)sha[3] << 24;
+}
+
+// ----- ESP-NOW radio -----
+
+static void halOnDataSent(const wifi_tx_info_t *tx_info, esp_now_send_status_t status) {
+  if (halSendCallback != nullptr) {
+    halSendCallback(status == ESP_NOW_SEND_SUCCESS);
+  }
+}
+
+static void halOnDataRecv(const esp_now_recv_info_t *info, const uint8_t *data, int length) {
+  if (halReceiveCallback != nullptr && length > 0) {
+    halReceiveCallback(info->src_addr, data, (size_t)length);
+  }
+}
+
+bool halRadioInit() {
+  WiFi.mode(WIFI_STA);
+  return esp_now_init() == ESP_OK;
+}
+
+void halReadMac(uint8_t mac[HAL_MAC_LEN]) {
+  esp_read_mac(mac, ESP_MAC_WIFI_STA);
+}
+
+void halRadioSetChannel(int channel) {
+  esp_wifi_set_promiscuous(true);
+  esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+  esp_wifi_set_promiscuous(false);
+}
+
+bool halRadioSetPeer(const uint8_t mac[HAL_MAC_LEN], int channel) {
+  esp_now_peer_info_t peerInfo;
+  memset(&peerInfo, 0, sizeof(peerInfo));
+  memcpy(peerInfo.peer_addr, mac, HAL_MAC_LEN);
+  peerInfo.channel = channel;
+  peerInfo.encrypt = false;
+
+  if (esp_now_is_peer_exist(mac)) {
+    return esp_now_mod_peer(&peerInfo) == ESP_OK;
+  }
+  return esp_now_add_peer(&peerInfo) == ESP_OK;
+}
+
+void halRadioRemovePeer(const uint8_t mac[HAL_MAC_LEN]) {
+  esp_now_del_peer(mac);
+}
+
+bool halRadioSend(const uint8_t mac[HAL_MAC_LEN], const uint8_t* data, size_t length) {
+  return esp_now_send(mac, data, length) == ESP_OK;
+}
+
+bool halRadioOnSent(HalSendCallback callback) {
+  halSendCallback = callback;
+  return esp_now_register_send_cb(halOnDataSent) == ESP_OK;
+}
+
+bool halRadioOnReceive(HalReceiveCallback callback) {
+  halReceiveCallback = callback;
+  return esp_now_register_recv_cb(halOnDataRecv) == ESP_OK;
+}
+
+// ----- Synchronisation -----
+
+HalSignal halSignalCreate() {
+  return (HalSignal)xSemaphoreCreateBinary();
+}
+
+void halSignalGive(HalSignal signal) {
+  xSemaphoreGive((SemaphoreHandle_t)signal);
+}
+
+bool halSignalTake(HalSignal signal, uint32_t timeoutMs) {
+  return xSemaphoreTake((SemaphoreHandle_t)signal, pdMS_TO_TICKS(timeoutMs)) == pdTRUE;
+}
+
+void halCriticalEnter() {
+  portENTER_CRITICAL(&halMux);
+}
+
+void halCriticalExit() {
+  portEXIT_CRITICAL(&halMux);
+}
+
+#endif // ARDUINO
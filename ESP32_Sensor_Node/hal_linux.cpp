@@ -0,0 +1,660 @@
+/*
+ * Hardware Abstraction Layer - Linux Simulation Backend
+ *
+ * Each simulated wake runs in a forked child of the simulator, so every
+ * ordinary global starts from its initial value just like after a real
+ * deep sleep. Variables marked RTC_DATA_ATTR are placed in the "rtc_sim"
+ * section (build with -DRTC_DATA_ATTR='__attribute__((section("rtc_sim")))')
+ * and copied through shared memory from one wake to the next, together
+ * with the NVS store, the virtual wall clock and the counters.
+ *
+ * Inside a wake time only moves when the firmware waits (delay, ping,
+ * signal wait), and radio callbacks (acks and gateway replies) fire when
+ * the virtual clock passes their due time, so whole days of wakes run in
+ * milliseconds. Threads started by the wake pipeline each keep their own
+ * virtual clock (halSimThreadStart/halSimThreadJoin), so overlapping
+ * stages cost the longest of them, as on the chip.
+ */
+
+#include "hal.h"
+
+#ifndef ARDUINO
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <mutex>
+#include <thread>
+
+#define SIM_RTC_MAX 16384
+#define SIM_NVS_ENTRIES 64
+#define SIM_NVS_VALUE_MAX 512  // Above the device config record
+#define SIM_MAX_PEERS 4
+#define SIM_MAX_EVENTS 8
+#define SIM_MAX_SIGNALS 8
+
+static const float SIM_SPEED_OF_SOUND_CM_PER_US = 0.0343f;
+static const uint32_t SIM_ADC_CONVERSION_US = 40;  // analogReadMilliVolts() on the ESP32-C3
+
+typedef struct SimNvsEntry {
+  bool used;
+  char ns[16];
+  char key[16];
+  uint16_t length;
+  uint8_t value[SIM_NVS_VALUE_MAX];
+} SimNvsEntry;
+
+// State that outlives a wake (shared between the simulator and its children)
+typedef struct SimShared {
+  HalSimConfig config;
+  HalSimStats stats;
+  uint64_t wallUs;             // Virtual wall clock at the start of the current wake
+  uint64_t lastAwakeUs;        // Set by the child when it goes to sleep
+  uint64_t lastSleepUs;
+  uint32_t rng;
+  int moveChannel;             // Pending gateway move (0 = none)
+  uint32_t moveAfterAcks;      // ... once framesAcked reaches this
+  bool booted;                 // A wake has run (later resets are deep-sleep wakes)
+  bool restarted;              // The last wake ended in halRestart()
+  bool rtcSaved;
+  uint8_t rtc[SIM_RTC_MAX];
+  SimNvsEntry nvs[SIM_NVS_ENTRIES];
+} SimShared;
+
+typedef struct SimPeer {
+  bool used;
+  uint8_t mac[HAL_MAC_LEN];
+  int channel;
+} SimPeer;
+
+typedef struct SimEvent {
+  bool used;
+  std::thread::id owner;       // Thread whose clock the callback fires on
+  uint64_t dueUs;
+  bool acked;
+  uint8_t replyLength;         // Non-zero: a gateway frame for the receive callback
+  uint8_t reply[HAL_RADIO_MAX_PAYLOAD];
+} SimEvent;
+
+// RTC section bounds (weak so host builds without RTC variables still link)
+extern uint8_t __start_rtc_sim[] __attribute__((weak));
+extern uint8_t __stop_rtc_sim[] __attribute__((weak));
+
+static SimShared* shared = nullptr;
+static uint8_t rtcPowerOn[SIM_RTC_MAX];  // Initial RTC image, put back by halSimReset()
+static HalEchoModel echoModel = nullptr;
+static void* echoContext = nullptr;
+static HalBatteryModel batteryModel = nullptr;
+static void* batteryContext = nullptr;
+static HalGatewayReply gatewayReply = nullptr;
+static void* gatewayReplyContext = nullptr;
+
+// Per-wake state (reset by the fork)
+static thread_local uint64_t clockUs = 0;  // Each pipeline thread has its own timeline
+static std::recursive_mutex simMutex;      // Radio, signals and halCriticalEnter()
+static bool radioUp = false;
+static int radioChannel = 1;
+static SimPeer peers[SIM_MAX_PEERS];
+static SimEvent events[SIM_MAX_EVENTS];
+static HalSendCallback sendCallback = nullptr;
+static HalReceiveCallback receiveCallback = nullptr;
+static volatile bool signals[SIM_MAX_SIGNALS];
+static int signalCount = 0;
+static char nvsNamespace[16];
+static bool nvsReadOnly = true;
+
+HalSerial Serial;
+
+static size_t rtcLength() {
+  if (__start_rtc_sim == nullptr || __stop_rtc_sim == nullptr) return 0;
+  return (size_t)(__stop_rtc_sim - __start_rtc_sim);
+}
+
+static SimShared* sim() {
+  if (shared == nullptr) {
+    void* memory = mmap(nullptr, sizeof(SimShared), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+      perror("hal_linux: mmap");
+      exit(1);
+    }
+    shared = (SimShared*)memory;
+    memset(shared, 0, sizeof(SimShared));
+    if (rtcLength() <= SIM_RTC_MAX) memcpy(rtcPowerOn, __start_rtc_sim, rtcLength());
+    shared->config.gatewayChannel = 6;
+    shared->config.lossRate = 0.0f;
+    shared->config.ackLatencyUs = 2000;
+    shared->config.radioInitUs = 120000;
+    shared->config.batteryMilliVolts = 1950;
+    shared->config.seed = 1;
+    shared->rng = 0x9E3779B9u;
+  }
+  return shared;
+}
+
+static float simRandom() {
+  // xorshift32 - kept in shared memory so the loss pattern carries across wakes
+  uint32_t x = sim()->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  sim()->rng = x;
+  return (float)(x >> 8) / 16777216.0f;
+}
+
+// Move the virtual clock to targetUs, firing radio callbacks that fall due on the way
+static void advanceTo(uint64_t targetUs) {
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  std::thread::id self = std::this_thread::get_id();
+  for (;;) {
+    int next = -1;
+    for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+      if (events[i].used && events[i].owner == self && events[i].dueUs <= targetUs &&
+          (next < 0 || events[i].dueUs < events[next].dueUs)) {
+        next = i;
+      }
+    }
+    if (next < 0) break;
+
+    if (events[next].dueUs > clockUs) clockUs = events[next].dueUs;
+    events[next].used = false;
+    if (events[next].replyLength > 0) {
+      if (receiveCallback != nullptr && radioUp) {
+        receiveCallback(sim()->config.gatewayMac, events[next].reply, events[next].replyLength);
+      }
+    } else if (sendCallback != nullptr) {
+      sendCallback(events[next].acked);
+    }
+  }
+  if (targetUs > clockUs) clockUs = targetUs;
+}
+
+// ----- Clock -----
+
+uint32_t halMillis() {
+  return (uint32_t)(clockUs / 1000ULL);
+}
+
+uint64_t halMicros() {
+  return clockUs;
+}
+
+void halDelayMs(uint32_t ms) {
+  advanceTo(clockUs + (uint64_t)ms * 1000ULL);
+}
+
+void halDelayUs(uint32_t us) {
+  advanceTo(clockUs + us);
+}
+
+// ----- GPIO / sensor -----
+
+void halPinOutput(int /*pin*/) {}
+
+void halPinInput(int /*pin*/) {}
+
+void halPinWrite(int /*pin*/, bool /*high*/) {}
+
+uint32_t halPingEchoUs(int /*trigPin*/, int /*echoPin*/, uint32_t timeoutUs) {
+  halDelayUs(12);  // Trigger pulse
+  sim()->stats.pings++;
+
+  float distance = echoModel != nullptr ? echoModel(halSimWallUs(), echoContext) : NAN;
+  if (isnan(distance) || distance <= 0) {
+    halDelayUs(timeoutUs);
+    return 0;
+  }
+
+  uint32_t echoUs = (uint32_t)(2.0f * distance / SIM_SPEED_OF_SOUND_CM_PER_US);
+  if (echoUs > timeoutUs) {
+    halDelayUs(timeoutUs);
+    return 0;
+  }
+  halDelayUs(echoUs);
+  return echoUs;
+}
+
+uint32_t halAnalogReadMilliVolts(int /*pin*/) {
+  halDelayUs(SIM_ADC_CONVERSION_US);
+  sim()->stats.adcReads++;
+
+  if (batteryModel == nullptr) return sim()->config.batteryMilliVolts;
+  float mv = batteryModel(halSimWallUs(), batteryContext);
+  return mv > 0.0f ? (uint32_t)(mv + 0.5f) : 0;
+}
+
+// ----- NVS -----
+
+static SimNvsEntry* nvsFind(const char* key) {
+  for (int i = 0; i < SIM_NVS_ENTRIES; i++) {
+    SimNvsEntry& entry = sim()->nvs[i];
+    if (entry.used && strcmp(entry.ns, nvsNamespace) == 0 && strcmp(entry.key, key) == 0) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+static bool nvsPut(const char* key, const void* data, size_t length) {
+  if (nvsReadOnly || length > SIM_NVS_VALUE_MAX || strlen(key) >= sizeof(SimNvsEntry::key)) return false;
+
+  SimNvsEntry* entry = nvsFind(key);
+  for (int i = 0; entry == nullptr && i < SIM_NVS_ENTRIES; i++) {
+    if (!sim()->nvs[i].used) {
+      entry = &sim()->nvs[i];
+      entry->used = true;
+      strcpy(entry->ns, nvsNamespace);
+      strcpy(entry->key, key);
+    }
+  }
+  if (entry == nullptr) return false;  // Store full
+  entry->length = (uint8_t)length;
+  memcpy(entry->value, data, length);
+  sim()->stats.nvsWrites++;
+  return true;
+}
+
+static bool nvsGet(const char* key, void* out, size_t length) {
+  SimNvsEntry* entry = nvsFind(key);
+  if (entry == nullptr || entry->length != length) return false;
+  memcpy(out, entry->value, length);
+  sim()->stats.nvsReads++;
+  return true;
+}
+
+bool halNvsOpen(const char* ns, bool readOnly) {
+  if (strlen(ns) >= sizeof(nvsNamespace)) return false;
+  strcpy(nvsNamespace, ns);
+  nvsReadOnly = readOnly;
+  return true;
+}
+
+void halNvsClose() {
+  nvsNamespace[0] = '\0';
+  nvsReadOnly = true;
+}
+
+bool halNvsHasKey(const char* key) {
+  return nvsFind(key) != nullptr;
+}
+
+float halNvsGetFloat(const char* key, float defaultValue) {
+  float value;
+  return nvsGet(key, &value, sizeof(value)) ? value : defaultValue;
+}
+
+void halNvsPutFloat(const char* key, float value) {
+  nvsPut(key, &value, sizeof(value));
+}
+
+uint32_t halNvsGetU32(const char* key, uint32_t defaultValue) {
+  uint32_t value;
+  return nvsGet(key, &value, sizeof(value)) ? value : defaultValue;
+}
+
+void halNvsPutU32(const char* key, uint32_t value) {
+  nvsPut(key, &value, sizeof(value));
+}
+
+uint16_t halNvsGetU16(const char* key, uint16_t defaultValue) {
+  uint16_t value;
+  return nvsGet(key, &value, sizeof(value)) ? value : defaultValue;
+}
+
+void halNvsPutU16(const char* key, uint16_t value) {
+  nvsPut(key, &value, sizeof(value));
+}
+
+size_t halNvsGetBytes(const char* key, void* out, size_t length) {
+  SimNvsEntry* entry = nvsFind(key);
+  if (entry == nullptr || entry->length > length) return 0;
+  memcpy(out, entry->value, entry->length);
+  sim()->stats.nvsReads++;
+  return entry->length;
+}
+
+size_t halNvsPutBytes(const char* key, const void* data, size_t length) {
+  return nvsPut(key, data, length) ? length : 0;
+}
+
+void halNvsRemove(const char* key) {
+  SimNvsEntry* entry = nvsReadOnly ? nullptr : nvsFind(key);
+  if (entry == nullptr) return;
+  memset(entry, 0, sizeof(*entry));
+  sim()->stats.nvsWrites++;
+}
+
+// ----- Reset / sleep -----
+
+HalResetReason halResetReason() {
+  if (!sim()->booted) return HAL_RESET_POWERON;
+  return sim()->restarted ? HAL_RESET_OTHER : HAL_RESET_DEEPSLEEP;
+}
+
+int halResetCode() {
+  if (!sim()->booted) return 1;   // ESP_RST_POWERON
+  return sim()->restarted ? 3 : 8;  // ESP_RST_SW / ESP_RST_DEEPSLEEP
+}
+
+// End the wake: keep RTC memory and report the awake time to the simulator
+static void endWake(uint64_t sleepUs, bool restarted) {
+  size_t length = rtcLength();
+  if (length > SIM_RTC_MAX) {
+    fprintf(stderr, "hal_linux: RTC section is %zu bytes, only %d supported\n", length, SIM_RTC_MAX);
+    _exit(1);
+  }
+  memcpy(sim()->rtc, __start_rtc_sim, length);
+  sim()->rtcSaved = true;
+  sim()->lastAwakeUs = clockUs;
+  sim()->lastSleepUs = sleepUs;
+  sim()->restarted = restarted;
+  fflush(stdout);
+  _exit(0);
+}
+
+void halDeepSleep(uint64_t sleepUs) {
+  endWake(sleepUs, false);
+}
+
+void halRestart() {
+  endWake(0, true);
+}
+
+uint32_t halFirmwareId() {
+  // FNV-1a of the build time: a rebuilt simulator is a new image
+  static const char BUILD[] = __DATE__ " " __TIME__;
+  uint32_t hash = 2166136261u;
+  for (const char* p = BUILD; *p != '\0'; p++) {
+    hash = (hash ^ (uint8_t)*p) * 16777619u;
+  }
+  return hash;
+}
+
+// ----- ESP-NOW radio -----
+
+bool halRadioInit() {
+  halDelayUs(sim()->config.radioInitUs);
+  sim()->stats.radioInits++;
+  radioUp = true;
+  return true;
+}
+
+void halReadMac(uint8_t mac[HAL_MAC_LEN]) {
+  memcpy(mac, sim()->config.nodeMac, HAL_MAC_LEN);
+}
+
+void halRadioSetChannel(int channel) {
+  radioChannel = channel;
+}
+
+bool halRadioSetPeer(const uint8_t mac[HAL_MAC_LEN], int channel) {
+  SimPeer* unused = nullptr;
+  for (int i = 0; i < SIM_MAX_PEERS; i++) {
+    if (peers[i].used && memcmp(peers[i].mac, mac, HAL_MAC_LEN) == 0) {
+      peers[i].channel = channel;
+      return true;
+    }
+    if (!peers[i].used && unused == nullptr) unused = &peers[i];
+  }
+  if (unused == nullptr) return false;
+  unused->used = true;
+  memcpy(unused->mac, mac, HAL_MAC_LEN);
+  unused->channel = channel;
+  return true;
+}
+
+void halRadioRemovePeer(const uint8_t mac[HAL_MAC_LEN]) {
+  for (int i = 0; i < SIM_MAX_PEERS; i++) {
+    if (peers[i].used && memcmp(peers[i].mac, mac, HAL_MAC_LEN) == 0) {
+      peers[i].used = false;
+    }
+  }
+}
+
+static SimEvent* freeEvent() {
+  for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+    if (!events[i].used) return &events[i];
+  }
+  return nullptr;
+}
+
+bool halRadioSend(const uint8_t mac[HAL_MAC_LEN], const uint8_t* data, size_t length) {
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  if (!radioUp || length == 0 || length > HAL_RADIO_MAX_PAYLOAD) return false;
+
+  SimPeer* peer = nullptr;
+  for (int i = 0; i < SIM_MAX_PEERS; i++) {
+    if (peers[i].used && memcmp(peers[i].mac, mac, HAL_MAC_LEN) == 0) peer = &peers[i];
+  }
+  // ESP-NOW refuses frames to unknown peers or peers on another channel
+  if (peer == nullptr || (peer->channel != 0 && peer->channel != radioChannel)) return false;
+
+  SimEvent* event = freeEvent();
+  if (event == nullptr) return false;  // Radio queue full
+
+  const HalSimConfig& config = sim()->config;
+  bool heard = radioChannel == config.gatewayChannel &&
+               memcmp(mac, config.gatewayMac, HAL_MAC_LEN) == 0;
+  event->used = true;
+  event->owner = std::this_thread::get_id();
+  event->acked = heard && simRandom() >= config.lossRate;
+  event->replyLength = 0;
+  event->dueUs = clockUs + config.ackLatencyUs;
+
+  sim()->stats.framesSent++;
+  if (event->acked) sim()->stats.framesAcked++;
+
+  // A pending move takes effect right after the ack that triggers it
+  SimShared* state = sim();
+  if (state->moveChannel != 0 && state->stats.framesAcked >= state->moveAfterAcks) {
+    state->config.gatewayChannel = state->moveChannel;
+    state->moveChannel = 0;
+  }
+
+  // The gateway may answer an acked frame one more latency later
+  SimEvent* reply = event->acked && gatewayReply != nullptr ? freeEvent() : nullptr;
+  if (reply != nullptr) {
+    size_t replyLength = gatewayReply(data, length, reply->reply, sizeof(reply->reply),
+                                      gatewayReplyContext);
+    if (replyLength > 0 && replyLength <= sizeof(reply->reply)) {
+      reply->used = true;
+      reply->owner = event->owner;
+      reply->replyLength = (uint8_t)replyLength;
+      reply->dueUs = event->dueUs + config.ackLatencyUs;
+    }
+  }
+  return true;
+}
+
+bool halRadioOnSent(HalSendCallback callback) {
+  sendCallback = callback;
+  return true;
+}
+
+bool halRadioOnReceive(HalReceiveCallback callback) {
+  receiveCallback = callback;
+  return true;
+}
+
+// ----- Synchronisation -----
+
+HalSignal halSignalCreate() {
+  std::lock_guard<std::recursive_mutex> lock(simMutex);
+  if (signalCount >= SIM_MAX_SIGNALS) return nullptr;
+  int index = signalCount++;
+  signals[index] = false;
+  return (HalSignal)&signals[index];
+}
+
+void halSignalGive(HalSignal signal) {
+  *(volatile bool*)signal = true;
+}
+
+bool halSignalTake(HalSignal signal, uint32_t timeoutMs) {
+  volatile bool* given = (volatile bool*)signal;
+  uint64_t deadlineUs = clockUs + (uint64_t)timeoutMs * 1000ULL;
+
+  for (;;) {
+    if (*given) {
+      *given = false;
+      return true;
+    }
+
+    // Jump to the next radio callback, or to the deadline if none comes first
+    uint64_t nextUs = deadlineUs;
+    {
+      std::lock_guard<std::recursive_mutex> lock(simMutex);
+      std::thread::id self = std::this_thread::get_id();
+      for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+        if (events[i].used && events[i].owner == self && events[i].dueUs < nextUs) nextUs = events[i].dueUs;
+      }
+    }
+    if (nextUs >= deadlineUs && clockUs >= deadlineUs) return false;
+    advanceTo(nextUs);
+  }
+}
+
+void halCriticalEnter() {
+  simMutex.lock();
+}
+
+void halCriticalExit() {
+  simMutex.unlock();
+}
+
+// ----- Simulation controls -----
+
+void halSimConfigure(const HalSimConfig& config) {
+  sim()->config = config;
+  // Scramble the seed - xorshift32 from a small seed starts with tiny values
+  uint32_t rng = (config.seed + 0x9E3779B9u) * 2654435761u;
+  sim()->rng = rng != 0 ? rng : 1;
+}
+
+void halSimReset() {
+  SimShared* state = sim();
+  HalSimConfig config = state->config;
+  memset(state, 0, sizeof(SimShared));
+  halSimConfigure(config);
+  if (rtcLength() <= SIM_RTC_MAX) memcpy(__start_rtc_sim, rtcPowerOn, rtcLength());
+}
+
+void halSimLoadRtc() {
+  if (sim()->rtcSaved) {
+    memcpy(__start_rtc_sim, sim()->rtc, rtcLength());
+  }
+}
+
+void halSimMoveGateway(int channel, uint32_t afterAcks) {
+  sim()->moveChannel = channel;
+  sim()->moveAfterAcks = afterAcks;
+}
+
+void halSimSetEchoModel(HalEchoModel model, void* context) {
+  echoModel = model;
+  echoContext = context;
+}
+
+void halSimSetBatteryModel(HalBatteryModel model, void* context) {
+  batteryModel = model;
+  batteryContext = context;
+}
+
+void halSimSetGatewayReply(HalGatewayReply reply, void* context) {
+  gatewayReply = reply;
+  gatewayReplyContext = context;
+}
+
+void halSimRun(void (*boot)(), uint32_t wakes, uint64_t untilUs) {
+  SimShared* state = sim();
+
+  for (uint32_t i = 0; i < wakes && state->wallUs < untilUs; i++) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("hal_linux: fork");
+      return;
+    }
+
+    if (pid == 0) {
+      // Fresh globals from the fork; bring back RTC memory from the last sleep
+      if (state->rtcSaved) {
+        memcpy(__start_rtc_sim, state->rtc, rtcLength());
+      }
+      boot();
+      fprintf(stderr, "hal_linux: wake returned without entering deep sleep\n");
+      _exit(2);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      fprintf(stderr, "hal_linux: wake %u failed (status %d)\n", (unsigned)state->stats.wakes, status);
+      return;
+    }
+
+    state->booted = true;
+    state->stats.wakes++;
+    state->stats.awakeUs += state->lastAwakeUs;
+    state->stats.sleepUs += state->lastSleepUs;
+    state->wallUs += state->lastAwakeUs + state->lastSleepUs;
+  }
+}
+
+uint64_t halSimWallUs() {
+  return sim()->wallUs + clockUs;
+}
+
+void halSimThreadStart(uint64_t startUs) {
+  clockUs = startUs;
+}
+
+void halSimThreadJoin(uint64_t endUs) {
+  {
+    // Callbacks still due belong to this thread now
+    std::lock_guard<std::recursive_mutex> lock(simMutex);
+    std::thread::id self = std::this_thread::get_id();
+    for (int i = 0; i < SIM_MAX_EVENTS; i++) {
+      if (events[i].used) events[i].owner = self;
+    }
+  }
+  advanceTo(endUs);
+}
+
+const HalSimStats& halSimStats() {
+  return sim()->stats;
+}
+
+// ----- Console -----
+
+// Print text, blocking for its time on the wire like a UART without a TX buffer
+static void consoleWrite(const char* text, size_t length) {
+  if (sim()->config.serialBaud > 0) {
+    halDelayUs((uint32_t)(length * 10ULL * 1000000ULL / sim()->config.serialBaud));
+  }
+  if (!sim()->config.quiet) fwrite(text, 1, length, stdout);
+}
+
+int HalSerial::printf(const char* format, ...) {
+  char text[256];
+  va_list args;
+  va_start(args, format);
+  int written = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  if (written < 0) return written;
+  consoleWrite(text, (size_t)written < sizeof(text) ? (size_t)written : sizeof(text) - 1);
+  return written;
+}
+
+void HalSerial::print(const char* s) { consoleWrite(s, strlen(s)); }
+void HalSerial::print(char c) { consoleWrite(&c, 1); }
+void HalSerial::print(int v) { printf("%d", v); }
+void HalSerial::print(unsigned v) { printf("%u", v); }
+void HalSerial::print(long v) { printf("%ld", v); }
+void HalSerial::print(unsigned long v) { printf("%lu", v); }
+void HalSerial::print(double v, int digits) { printf("%.*f", digits, v); }
+
+#endif // !ARDUINO
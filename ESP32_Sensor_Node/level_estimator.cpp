@@ -0,0 +1,144 @@
+/*
+ * Cross-Wake Level Estimator Implementation
+ */
+
+#include "level_estimator.h"
+#include <math.h>
+#include <string.h>
+
+static const uint32_t ESTIMATOR_STATE_MAGIC = 0x4C4B4631;  // "LKF1"
+
+typedef struct Track {
+  float distanceCm;
+  float rateCmPerHour;
+  float p00, p01, p11;  // Covariance of (distance, rate)
+} Track;
+
+typedef struct EstimatorState {
+  uint32_t magic;
+  uint64_t lastMs;       // Node clock of the last fused measurement
+  Track track;
+  uint32_t quickCount;
+  uint32_t fullCount;
+} EstimatorState;
+
+// RTC memory estimator state (survives deep sleep)
+RTC_DATA_ATTR EstimatorState estimatorState;
+
+static bool stateValid() {
+  return estimatorState.magic == ESTIMATOR_STATE_MAGIC;
+}
+
+// Track moved forward to nowMs
+static Track predict(uint64_t nowMs) {
+  Track t = estimatorState.track;
+  if (nowMs <= estimatorState.lastMs) return t;
+
+  float dt = (float)(nowMs - estimatorState.lastMs) / 3600000.0f;
+  float q = LEVEL_ESTIMATOR_ACCEL_CM2_H3;
+  t.distanceCm += t.rateCmPerHour * dt;
+  t.p00 += dt * (2.0f * t.p01 + dt * t.p11) + q * dt * dt * dt / 3.0f + LEVEL_ESTIMATOR_DRIFT_CM2_H * dt;
+  t.p01 += dt * t.p11 + q * dt * dt / 2.0f;
+  t.p11 += q * dt;
+  return t;
+}
+
+static bool insideGate(const Track& t, float measuredCm, float variance) {
+  float innovation = measuredCm - t.distanceCm;
+  float gate = LEVEL_ESTIMATOR_GATE_SIGMA * LEVEL_ESTIMATOR_GATE_SIGMA * (t.p00 + variance);
+  return innovation * innovation <= gate;
+}
+
+static void update(Track& t, float measuredCm, float variance) {
+  float innovation = measuredCm - t.distanceCm;
+  float s = t.p00 + variance;
+  float k0 = t.p00 / s;
+  float k1 = t.p01 / s;
+  t.distanceCm += k0 * innovation;
+  t.rateCmPerHour += k1 * innovation;
+  t.p11 -= k1 * t.p01;
+  t.p01 *= 1.0f - k0;
+  t.p00 *= 1.0f - k0;
+}
+
+bool levelEstimatorCanPredict(uint64_t nowMs) {
+  if (!stateValid()) return false;
+  Track t = predict(nowMs);
+  return t.p00 <= LEVEL_ESTIMATOR_MAX_SIGMA_CM * LEVEL_ESTIMATOR_MAX_SIGMA_CM;
+}
+
+bool levelEstimatorFusePings(const float* pings, int count, uint64_t nowMs) {
+  if (!stateValid() || count <= 0) return false;
+
+  const float variance = LEVEL_ESTIMATOR_PING_SIGMA_CM * LEVEL_ESTIMATOR_PING_SIGMA_CM;
+  Track t = predict(nowMs);
+  // Gate each ping against the track updated with the ones before it, so
+  // the second ping also has to agree with the first
+  for (int i = 0; i < count; i++) {
+    if (!insideGate(t, pings[i], variance)) return false;
+    update(t, pings[i], variance);
+  }
+
+  estimatorState.track = t;
+  estimatorState.lastMs = nowMs;
+  estimatorState.quickCount++;
+  return true;
+}
+
+void levelEstimatorFuseReading(float distanceCm, uint64_t nowMs) {
+  const float variance = LEVEL_ESTIMATOR_BURST_SIGMA_CM * LEVEL_ESTIMATOR_BURST_SIGMA_CM;
+  uint32_t quickCount = stateValid() ? estimatorState.quickCount : 0;
+  uint32_t fullCount = stateValid() ? estimatorState.fullCount : 0;
+
+  Track t;
+  bool tracking = false;
+  if (stateValid()) {
+    t = predict(nowMs);
+    tracking = insideGate(t, distanceCm, variance);
+  }
+
+  if (tracking) {
+    update(t, distanceCm, variance);
+  } else {
+    // New track: distance known, rate not
+    memset(&estimatorState, 0, sizeof(estimatorState));
+    estimatorState.magic = ESTIMATOR_STATE_MAGIC;
+    t.distanceCm = distanceCm;
+    t.rateCmPerHour = 0.0f;
+    t.p00 = variance;
+    t.p01 = 0.0f;
+    t.p11 = LEVEL_ESTIMATOR_RATE_SIGMA_CM_H * LEVEL_ESTIMATOR_RATE_SIGMA_CM_H;
+  }
+
+  estimatorState.track = t;
+  estimatorState.lastMs = nowMs;
+  estimatorState.quickCount = quickCount;
+  estimatorState.fullCount = fullCount + 1;
+}
+
+LevelEstimate levelEstimatorCurrent() {
+  LevelEstimate estimate;
+  memset(&estimate, 0, sizeof(estimate));
+  if (!stateValid()) return estimate;
+
+  const Track& t = estimatorState.track;
+  estimate.distanceCm = t.distanceCm;
+  estimate.rateCmPerHour = t.rateCmPerHour;
+  estimate.sigmaCm = sqrtf(t.p00 > 0.0f ? t.p00 : 0.0f);
+  estimate.confidence = estimate.sigmaCm > 0.0f
+      ? erff(LEVEL_ESTIMATOR_CONFIDENCE_CM / (estimate.sigmaCm * 1.41421356f))
+      : 1.0f;
+  return estimate;
+}
+
+uint32_t levelEstimatorQuickCount() {
+  return stateValid() ? estimatorState.quickCount : 0;
+}
+
+uint32_t levelEstimatorFullCount() {
+  return stateValid() ? estimatorState.fullCount : 0;
+}
+
+void levelEstimatorReset() {
+  memset(&estimatorState, 0, sizeof(estimatorState));
+}
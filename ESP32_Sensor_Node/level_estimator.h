@@ -0,0 +1,51 @@
+/*
+ * Cross-Wake Level Estimator
+ *
+ * 1-D Kalman filter on the sensor distance with a constant-rate model:
+ * the state is distance (cm) and rate (cm/h) with their 2x2 covariance,
+ * kept in RTC memory so each wake starts from a prediction instead of
+ * from nothing. A wake with a usable prediction fires one or two pings
+ * and fuses them; a full burst is needed only for a new track or when
+ * the pings fall outside the innovation gate.
+ *
+ * Time comes from the caller (node clock, ms). No Arduino dependencies,
+ * so the filter can be exercised on the host.
+ */
+
+#ifndef LEVEL_ESTIMATOR_H
+#define LEVEL_ESTIMATOR_H
+
+#include <stdint.h>
+#include "config.h"
+
+typedef struct LevelEstimate {
+  float distanceCm;
+  float rateCmPerHour;  // Positive while the distance grows (level falls)
+  float sigmaCm;        // Standard deviation of distanceCm
+  float confidence;     // 0-1: probability the distance is within LEVEL_ESTIMATOR_CONFIDENCE_CM
+} LevelEstimate;
+
+// True if there is a track whose prediction at nowMs is within
+// LEVEL_ESTIMATOR_MAX_SIGMA_CM, i.e. a few pings are enough
+bool levelEstimatorCanPredict(uint64_t nowMs);
+
+// Fuse count single pings taken at nowMs with the prediction. Returns
+// false and leaves the state untouched if there are none or any of them
+// is outside the gate
+bool levelEstimatorFusePings(const float* pings, int count, uint64_t nowMs);
+
+// Fuse a full (filtered) reading taken at nowMs. Starts a new track if
+// there is none or the reading is outside the gate (refill)
+void levelEstimatorFuseReading(float distanceCm, uint64_t nowMs);
+
+// Current estimate (all zero without a track)
+LevelEstimate levelEstimatorCurrent();
+
+// Wakes served by pings alone and by full readings since power-on
+uint32_t levelEstimatorQuickCount();
+uint32_t levelEstimatorFullCount();
+
+// Drop the track
+void levelEstimatorReset();
+
+#endif // LEVEL_ESTIMATOR_H
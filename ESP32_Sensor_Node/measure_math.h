@@ -0,0 +1,91 @@
+/*
+ * Measurement Math
+ *
+ * The arithmetic of the measurement path in two forms: float, and
+ * integer / fixed point for the ESP32-C3, whose RISC-V core has no FPU
+ * and runs every float operation as a software routine.
+ * ENABLE_FIXED_POINT picks the form the node runs; both stay compiled
+ * here so the host can check one against the other (sim/fixed_bench.cpp).
+ *
+ * Fixed-point distances are Q16.16 cm in an int32_t (q16_t), levels are
+ * Q16 fractions of the span (65536 = full, as in tank_geometry.h) and
+ * voltages are integer mV. Floats come in and go out only at the edges:
+ * config values, the reading struct, the level estimator and logs.
+ *
+ * No Arduino dependencies.
+ */
+
+#ifndef MEASURE_MATH_H
+#define MEASURE_MATH_H
+
+#include <stdint.h>
+#include "config.h"
+
+typedef int32_t q16_t;  // Q16.16
+
+#define Q16_ONE 65536
+#define Q16_SUM_MAX_SAMPLES 52  // Sums of this many SENSOR_MAX_RANGE_CM distances fit an int32_t
+
+// ----- Boundaries -----
+
+static inline q16_t q16FromFloat(float v) {
+  return (q16_t)(v * (float)Q16_ONE + (v < 0.0f ? -0.5f : 0.5f));
+}
+
+static inline float q16ToFloat(q16_t v) {
+  return (float)v * (1.0f / Q16_ONE);
+}
+
+// ----- Echo time to distance (half the round trip) -----
+
+static inline float echoDistanceCm(uint32_t durationUs) {
+  return (durationUs * speedOfSoundCmPerUs) / 2.0f;
+}
+
+// One 32x32->64 multiply by the speed of sound / 2 in Q32
+static inline q16_t echoDistanceQ16(uint32_t durationUs) {
+  const uint64_t halfSpeedQ32 = (uint64_t)(speedOfSoundCmPerUs * 2147483648.0 + 0.5);
+  uint64_t distance = ((uint64_t)durationUs * halfSpeedQ32 + (1u << 15)) >> 16;
+  return distance > INT32_MAX ? INT32_MAX : (q16_t)distance;
+}
+
+static inline bool distanceInRange(float distanceCm) {
+  return distanceCm >= SENSOR_MIN_RANGE_CM && distanceCm <= SENSOR_MAX_RANGE_CM;
+}
+
+static inline bool distanceInRangeQ16(q16_t distance) {
+  return distance >= q16FromFloat(SENSOR_MIN_RANGE_CM) && distance <= q16FromFloat(SENSOR_MAX_RANGE_CM);
+}
+
+// ----- Level (share of the span between emptyCm and fullCm) -----
+
+// Percent, clamped to 0-100
+static inline float levelPercent(float distanceCm, float fullCm, float emptyCm) {
+  float pct = (emptyCm - distanceCm) / (emptyCm - fullCm) * 100.0f;
+  if (pct < 0.0f) pct = 0.0f;
+  if (pct > 100.0f) pct = 100.0f;
+  return pct;
+}
+
+// Q16 fraction, clamped to 0-Q16_ONE
+static inline uint32_t levelQ16(q16_t distance, q16_t full, q16_t empty) {
+  if (distance >= empty) return 0;
+  if (distance <= full) return Q16_ONE;
+  return (uint32_t)(((uint64_t)(uint32_t)(empty - distance) << 16) / (uint32_t)(empty - full));
+}
+
+// ----- Battery (sum of count ADC conversions, mV at the pin) -----
+
+static inline float batteryVoltsFromSum(uint32_t sumMv, int count) {
+  float pinMv = (float)sumMv / (float)count;
+  return pinMv * VOLTAGE_DIVIDER_RATIO / 1000.0f;
+}
+
+// Divider ratio in Q16; rounds once, at the end
+static inline uint32_t batteryMilliVoltsFromSum(uint32_t sumMv, int count) {
+  const uint64_t ratioQ16 = (uint64_t)(VOLTAGE_DIVIDER_RATIO * (float)Q16_ONE + 0.5f);
+  uint64_t divisor = (uint64_t)count << 16;
+  return (uint32_t)(((uint64_t)sumMv * ratioQ16 + divisor / 2) / divisor);
+}
+
+#endif // MEASURE_MATH_H
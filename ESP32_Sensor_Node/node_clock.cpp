@@ -0,0 +1,23 @@
+/*
+ * Node Clock Implementation
+ */
+
+#include "node_clock.h"
+#include "config.h"
+#include "hal.h"
+
+// Time spent before the current boot (previous awake periods + sleeps)
+RTC_DATA_ATTR uint64_t nodeClockOffsetMs = 0;
+
+static uint64_t awakeMs() {
+  return halMillis();
+}
+
+uint64_t nodeClockMs() {
+  return nodeClockOffsetMs + awakeMs();
+}
+
+void nodeClockAddSleep(uint64_t sleepUs) {
+  // millis() restarts from 0 after deep sleep, so fold this wake in too
+  nodeClockOffsetMs += awakeMs() + sleepUs / 1000ULL;
+}
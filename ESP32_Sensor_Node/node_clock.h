@@ -0,0 +1,19 @@
+/*
+ * Node Clock
+ *
+ * Milliseconds since power-on, carried across deep sleep by adding each
+ * sleep period to an offset kept in RTC memory.
+ */
+
+#ifndef NODE_CLOCK_H
+#define NODE_CLOCK_H
+
+#include <stdint.h>
+
+// Milliseconds since power-on, including time spent in deep sleep
+uint64_t nodeClockMs();
+
+// Account for a deep sleep that is about to start
+void nodeClockAddSleep(uint64_t sleepUs);
+
+#endif // NODE_CLOCK_H
@@ -0,0 +1,324 @@
+/*
+ * Deferred Logging Implementation
+ */
+
+#include "node_log.h"
+#include "hal.h"
+#include <string.h>
+
+static const uint32_t LOG_RING_MAGIC = 0x4C4F4731;  // "LOG1"
+static const size_t LOG_LINE_MAX = 160;
+
+// Record: u8 length, u8 level, u8 argc, u8 reserved, u32 ms, format pointer,
+// then per argument a type byte and its value (strings: bytes + NUL)
+typedef struct LogRecordHeader {
+  uint8_t length;
+  uint8_t level;
+  uint8_t count;
+  uint8_t reserved;
+  uint32_t ms;
+  const char* format;
+} LogRecordHeader;
+
+static const size_t LOG_RECORD_MAX = 255;
+
+// Byte ring in RTC memory, so records logged late in a wake survive deep sleep
+typedef struct LogRing {
+  uint32_t magic;
+  uint32_t firmwareId;
+  uint16_t head;       // Next byte written
+  uint16_t tail;       // Oldest record
+  uint16_t used;
+  uint32_t records;
+  uint32_t dropped;    // Records lost to a full ring since the last drain
+  uint32_t droppedTotal;
+  uint8_t data[LOG_RING_BYTES];
+} LogRing;
+
+static RTC_DATA_ATTR LogRing logRing;
+
+static void ringReset() {
+  memset(&logRing, 0, sizeof(logRing));
+  logRing.magic = LOG_RING_MAGIC;
+  logRing.firmwareId = halFirmwareId();
+}
+
+static void ringCopyIn(uint16_t pos, const uint8_t* bytes, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    logRing.data[(pos + i) % LOG_RING_BYTES] = bytes[i];
+  }
+}
+
+static void ringCopyOut(uint16_t pos, uint8_t* bytes, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    bytes[i] = logRing.data[(pos + i) % LOG_RING_BYTES];
+  }
+}
+
+void logBegin() {
+  if (logRing.magic != LOG_RING_MAGIC || logRing.firmwareId != halFirmwareId() ||
+      logRing.used > LOG_RING_BYTES || logRing.head >= LOG_RING_BYTES ||
+      logRing.tail >= LOG_RING_BYTES) {
+    ringReset();  // Power-on, or stored format pointers belong to another image
+  }
+}
+
+// ----- Writing -----
+
+static size_t putValue(uint8_t* out, size_t pos, const void* value, size_t size) {
+  memcpy(out + pos, value, size);
+  return pos + size;
+}
+
+void logWriteArgs(uint8_t level, const char* format, const LogArg* args, uint8_t count) {
+  uint8_t record[LOG_RECORD_MAX];
+  LogRecordHeader header = {0, level, 0, 0, (uint32_t)halMillis(), format};
+  size_t pos = sizeof(header);
+
+  // Encode into a local buffer first, so the critical section is a copy
+  for (uint8_t i = 0; i < count; i++) {
+    const LogArg& arg = args[i];
+    size_t size = arg.type == LOG_ARG_I32 || arg.type == LOG_ARG_U32 ? 4 :
+                  arg.type == LOG_ARG_STR ? 1 : 8;
+    if (pos + 1 + size > LOG_RECORD_MAX) break;
+    record[pos++] = arg.type;
+    switch (arg.type) {
+      case LOG_ARG_I32: pos = putValue(record, pos, &arg.i32, 4); break;
+      case LOG_ARG_U32: pos = putValue(record, pos, &arg.u32, 4); break;
+      case LOG_ARG_I64: pos = putValue(record, pos, &arg.i64, 8); break;
+      case LOG_ARG_U64: pos = putValue(record, pos, &arg.u64, 8); break;
+      case LOG_ARG_F64: pos = putValue(record, pos, &arg.f64, 8); break;
+      case LOG_ARG_STR: {
+        const char* text = arg.str != nullptr ? arg.str : "(null)";
+        size_t length = strnlen(text, LOG_MAX_STRING_LEN);
+        if (length > LOG_RECORD_MAX - pos - 1) length = LOG_RECORD_MAX - pos - 1;
+        pos = putValue(record, pos, text, length);
+        record[pos++] = '\0';
+        break;
+      }
+      default: pos--; continue;
+    }
+    header.count++;
+  }
+  header.length = (uint8_t)pos;
+  memcpy(record, &header, sizeof(header));
+
+  halCriticalEnter();
+  if (logRing.magic != LOG_RING_MAGIC) {
+    ringReset();  // Logged before logBegin()
+  }
+  // Drop the oldest records until this one fits
+  while ((size_t)(LOG_RING_BYTES - logRing.used) < pos) {
+    uint8_t oldest = logRing.data[logRing.tail];
+    if (oldest < sizeof(LogRecordHeader) || oldest > logRing.used) {
+      logRing.head = logRing.tail = logRing.used = 0;  // Corrupt; start over
+      break;
+    }
+    logRing.tail = (uint16_t)((logRing.tail + oldest) % LOG_RING_BYTES);
+    logRing.used = (uint16_t)(logRing.used - oldest);
+    logRing.dropped++;
+    logRing.droppedTotal++;
+  }
+  ringCopyIn(logRing.head, record, pos);
+  logRing.head = (uint16_t)((logRing.head + pos) % LOG_RING_BYTES);
+  logRing.used = (uint16_t)(logRing.used + pos);
+  logRing.records++;
+  halCriticalExit();
+
+#if LOG_DRAIN_MODE == LOG_DRAIN_IMMEDIATE
+  logDrain();
+#endif
+}
+
+// ----- Formatting -----
+
+void logFormatCheck(const char* /*format*/, ...) {
+  // Only referenced from dead branches; see node_log.h
+}
+
+// Append one conversion of a printf format, using its own snprintf call
+static size_t formatOne(char* out, size_t capacity, const char* spec, size_t specLength,
+                        const LogArg& arg) {
+  // spec is "%[flags][width][.precision][length]conv"; rebuild it for the stored type
+  char conversion = spec[specLength - 1];
+  char rebuilt[24];
+  size_t n = 0;
+  for (size_t i = 0; i < specLength - 1 && n < sizeof(rebuilt) - 4; i++) {
+    char c = spec[i];
+    if (c == 'h' || c == 'l' || c == 'z' || c == 'j' || c == 't' || c == 'L') continue;
+    rebuilt[n++] = c;
+  }
+  if (arg.type == LOG_ARG_I64 || arg.type == LOG_ARG_U64) {
+    rebuilt[n++] = 'l';
+    rebuilt[n++] = 'l';
+  }
+  rebuilt[n++] = conversion;
+  rebuilt[n] = '\0';
+
+  int written;
+  switch (arg.type) {
+    case LOG_ARG_I32: written = snprintf(out, capacity, rebuilt, (int)arg.i32); break;
+    case LOG_ARG_U32: written = snprintf(out, capacity, rebuilt, (unsigned)arg.u32); break;
+    case LOG_ARG_I64: written = snprintf(out, capacity, rebuilt, (long long)arg.i64); break;
+    case LOG_ARG_U64: written = snprintf(out, capacity, rebuilt, (unsigned long long)arg.u64); break;
+    case LOG_ARG_F64: written = snprintf(out, capacity, rebuilt, arg.f64); break;
+    default:          written = snprintf(out, capacity, rebuilt, arg.str); break;
+  }
+  if (written < 0) return 0;
+  return (size_t)written < capacity ? (size_t)written : capacity - 1;
+}
+
+static bool argMatches(char conversion, uint8_t type) {
+  if (conversion == 's') return type == LOG_ARG_STR;
+  if (strchr("fFeEgGaA", conversion) != nullptr) return type == LOG_ARG_F64;
+  if (strchr("diouxXc", conversion) != nullptr) {
+    return type != LOG_ARG_STR && type != LOG_ARG_F64;
+  }
+  return false;
+}
+
+size_t logFormat(const char* format, const LogArg* args, uint8_t count, char* buffer, size_t capacity) {
+  if (capacity == 0) return 0;
+  size_t length = 0;
+  uint8_t next = 0;
+
+  for (const char* p = format; *p != '\0' && length < capacity - 1; ) {
+    if (*p != '%') {
+      buffer[length++] = *p++;
+      continue;
+    }
+    if (p[1] == '%') {
+      buffer[length++] = '%';
+      p += 2;
+      continue;
+    }
+    const char* spec = p++;
+    while (*p != '\0' && strchr("-+ #0123456789.hlzjtL", *p) != nullptr) p++;
+    if (*p == '\0') break;
+    size_t specLength = (size_t)(p - spec) + 1;
+    char conversion = *p++;
+
+    if (next < count && argMatches(conversion, args[next].type)) {
+      length += formatOne(buffer + length, capacity - length, spec, specLength, args[next]);
+    } else {
+      length += formatOne(buffer + length, capacity - length, "%s", 2, logArg("?"));
+    }
+    next++;
+  }
+  buffer[length] = '\0';
+  return length;
+}
+
+// ----- Draining -----
+
+static char levelLetter(uint8_t level) {
+  switch (level) {
+    case LOG_LEVEL_ERROR: return 'E';
+    case LOG_LEVEL_WARN:  return 'W';
+    case LOG_LEVEL_INFO:  return 'I';
+    default:              return 'D';
+  }
+}
+
+static size_t getValue(const uint8_t* in, size_t pos, void* value, size_t size) {
+  memcpy(value, in + pos, size);
+  return pos + size;
+}
+
+// Decode a record's arguments; strings point into record
+static uint8_t decodeArgs(const uint8_t* record, size_t length, uint8_t count, LogArg* args) {
+  size_t pos = sizeof(LogRecordHeader);
+  uint8_t decoded = 0;
+  while (decoded < count && pos < length) {
+    LogArg& arg = args[decoded];
+    arg.type = record[pos++];
+    size_t size = arg.type == LOG_ARG_I32 || arg.type == LOG_ARG_U32 ? 4 : 8;
+    if (arg.type == LOG_ARG_STR) {
+      const void* end = memchr(record + pos, '\0', length - pos);
+      if (end == nullptr) break;
+      arg.str = (const char*)record + pos;
+      pos = (const uint8_t*)end - record + 1;
+    } else if (arg.type >= LOG_ARG_I32 && arg.type <= LOG_ARG_F64 && pos + size <= length) {
+      pos = getValue(record, pos, &arg.u64, size);
+    } else {
+      break;  // Corrupt record
+    }
+    decoded++;
+  }
+  return decoded;
+}
+
+// Pop the oldest record. Returns false if the ring is empty
+static bool popRecord(uint8_t* record, uint32_t& dropped) {
+  bool found = false;
+  halCriticalEnter();
+  dropped = logRing.dropped;
+  logRing.dropped = 0;
+  if (logRing.used > 0) {
+    uint8_t length = logRing.data[logRing.tail];
+    if (length < sizeof(LogRecordHeader) || length > logRing.used) {
+      // Corrupt (e.g. RTC memory garbage that passed the magic check)
+      logRing.head = logRing.tail = logRing.used = 0;
+    } else {
+      ringCopyOut(logRing.tail, record, length);
+      logRing.tail = (uint16_t)((logRing.tail + length) % LOG_RING_BYTES);
+      logRing.used = (uint16_t)(logRing.used - length);
+      found = true;
+    }
+  }
+  halCriticalExit();
+  return found;
+}
+
+void logDrain() {
+  static bool draining = false;
+  if (draining) return;  // Never re-entered from IMMEDIATE mode
+  draining = true;
+
+  uint8_t record[LOG_RECORD_MAX];
+  char line[LOG_LINE_MAX];
+  uint32_t dropped;
+  while (true) {
+    bool found = popRecord(record, dropped);
+    if (dropped > 0) {
+      Serial.printf("[log] %u records dropped (ring full)\n", (unsigned)dropped);
+    }
+    if (!found) break;
+
+    LogRecordHeader header;
+    memcpy(&header, record, sizeof(header));
+    LogArg args[LOG_RECORD_MAX / 5];
+    uint8_t limit = (uint8_t)(sizeof(args) / sizeof(args[0]));
+    uint8_t count = decodeArgs(record, header.length, header.count < limit ? header.count : limit, args);
+
+    logFormat(header.format, args, count, line, sizeof(line));
+    Serial.printf("[%lu ms] %c %s\n", (unsigned long)header.ms, levelLetter(header.level), line);
+  }
+
+  draining = false;
+}
+
+void logIdleDelay(uint32_t ms) {
+  uint32_t start = halMillis();
+#if LOG_DRAIN_MODE != LOG_DRAIN_AT_SLEEP
+  logDrain();
+#endif
+  uint32_t elapsed = halMillis() - start;
+  if (elapsed < ms) {
+    halDelayMs(ms - elapsed);
+  }
+}
+
+void logBeforeSleep() {
+#if LOG_DRAIN_MODE == LOG_DRAIN_AT_SLEEP
+  logDrain();
+#endif
+}
+
+uint32_t logRecordCount() {
+  return logRing.records;
+}
+
+uint32_t logDroppedCount() {
+  return logRing.droppedTotal;
+}
@@ -0,0 +1,151 @@
+/*
+ * Deferred Logging
+ *
+ * LOG_E/LOG_W/LOG_I/LOG_D take a printf format and arguments. Levels
+ * above LOG_LEVEL compile out, format string and argument expressions
+ * included. An enabled message is not formatted or printed where it is
+ * logged: a compact binary record (level, millis(), format pointer,
+ * typed arguments, strings copied) goes into a ring in RTC memory, and
+ * records are formatted and printed only when drained (LOG_DRAIN_MODE
+ * in config.h). Printing at 115200 baud costs ~87 us per character, so
+ * this keeps the UART out of the sensor/radio path of a wake.
+ *
+ * The ring survives deep sleep, so with LOG_DRAIN_IDLE a wake's records
+ * come out during the next idle wait (the console delay at boot, the
+ * BLE window). When full, the oldest records are dropped and counted.
+ * Records carry format pointers, so the ring is discarded when the
+ * firmware image changes (halFirmwareId()).
+ *
+ * Format checking still happens at compile time (the macros also pass
+ * the arguments to a never-called printf-attributed function).
+ */
+
+#ifndef NODE_LOG_H
+#define NODE_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+enum LogArgType : uint8_t {
+  LOG_ARG_I32 = 1,
+  LOG_ARG_U32,
+  LOG_ARG_I64,
+  LOG_ARG_U64,
+  LOG_ARG_F64,
+  LOG_ARG_STR
+};
+
+typedef struct LogArg {
+  uint8_t type;
+  union {
+    int32_t i32;
+    uint32_t u32;
+    int64_t i64;
+    uint64_t u64;
+    double f64;
+    const char* str;
+  };
+} LogArg;
+
+// Argument capture, by fundamental type (int32_t is long on the ESP32
+// and int on the host). Arduino String arguments need .c_str()
+inline LogArg logArgSigned(int64_t v) {
+  LogArg a;
+  if (v >= INT32_MIN && v <= INT32_MAX) { a.type = LOG_ARG_I32; a.i32 = (int32_t)v; }
+  else { a.type = LOG_ARG_I64; a.i64 = v; }
+  return a;
+}
+inline LogArg logArgUnsigned(uint64_t v) {
+  LogArg a;
+  if (v <= UINT32_MAX) { a.type = LOG_ARG_U32; a.u32 = (uint32_t)v; }
+  else { a.type = LOG_ARG_U64; a.u64 = v; }
+  return a;
+}
+inline LogArg logArg(bool v) { return logArgSigned(v); }
+inline LogArg logArg(char v) { return logArgSigned(v); }
+inline LogArg logArg(signed char v) { return logArgSigned(v); }
+inline LogArg logArg(unsigned char v) { return logArgUnsigned(v); }
+inline LogArg logArg(short v) { return logArgSigned(v); }
+inline LogArg logArg(unsigned short v) { return logArgUnsigned(v); }
+inline LogArg logArg(int v) { return logArgSigned(v); }
+inline LogArg logArg(unsigned int v) { return logArgUnsigned(v); }
+inline LogArg logArg(long v) { return logArgSigned(v); }
+inline LogArg logArg(unsigned long v) { return logArgUnsigned(v); }
+inline LogArg logArg(long long v) { return logArgSigned(v); }
+inline LogArg logArg(unsigned long long v) { return logArgUnsigned(v); }
+inline LogArg logArg(double v) { LogArg a; a.type = LOG_ARG_F64; a.f64 = v; return a; }
+inline LogArg logArg(float v) { return logArg((double)v); }
+inline LogArg logArg(const char* v) { LogArg a; a.type = LOG_ARG_STR; a.str = v; return a; }
+
+// Store one record (the macros below call this)
+void logWriteArgs(uint8_t level, const char* format, const LogArg* args, uint8_t count);
+
+template <typename... T>
+inline void logWrite(uint8_t level, const char* format, T... values) {
+  const LogArg args[sizeof...(T) + 1] = {logArg(values)..., LogArg()};
+  logWriteArgs(level, format, args, (uint8_t)sizeof...(T));
+}
+
+// Never called: lets the compiler check formats against their arguments
+void logFormatCheck(const char* format, ...) __attribute__((format(printf, 1, 2)));
+
+#define LOG_AT(level, format, ...) do { \
+  if (0) logFormatCheck(format, ##__VA_ARGS__); \
+  logWrite(level, format, ##__VA_ARGS__); \
+} while (0)
+
+// A disabled level: no code, but the arguments still count as used and the
+// format is still checked
+#define LOG_OFF(format, ...) do { \
+  if (0) logFormatCheck(format, ##__VA_ARGS__); \
+} while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_E(format, ...) LOG_AT(LOG_LEVEL_ERROR, format, ##__VA_ARGS__)
+#else
+#define LOG_E(format, ...) LOG_OFF(format, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_W(format, ...) LOG_AT(LOG_LEVEL_WARN, format, ##__VA_ARGS__)
+#else
+#define LOG_W(format, ...) LOG_OFF(format, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_I(format, ...) LOG_AT(LOG_LEVEL_INFO, format, ##__VA_ARGS__)
+#else
+#define LOG_I(format, ...) LOG_OFF(format, ##__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_D(format, ...) LOG_AT(LOG_LEVEL_DEBUG, format, ##__VA_ARGS__)
+#else
+#define LOG_D(format, ...) LOG_OFF(format, ##__VA_ARGS__)
+#endif
+
+// MAC address as one argument list: LOG_I("MAC " LOG_MAC_FMT, LOG_MAC_ARGS(mac))
+#define LOG_MAC_FMT "%02X:%02X:%02X:%02X:%02X:%02X"
+#define LOG_MAC_ARGS(mac) (mac)[0], (mac)[1], (mac)[2], (mac)[3], (mac)[4], (mac)[5]
+
+// Check the ring against this firmware image (call once per wake, early)
+void logBegin();
+
+// Format and print every stored record now
+void logDrain();
+
+// Idle wait: drain (unless LOG_DRAIN_AT_SLEEP) and delay for what is left of ms
+void logIdleDelay(uint32_t ms);
+
+// The wake is done - drain if LOG_DRAIN_AT_SLEEP
+void logBeforeSleep();
+
+// Format one record's message into buffer (host tools, tests). Returns its length
+size_t logFormat(const char* format, const LogArg* args, uint8_t count, char* buffer, size_t capacity);
+
+// Records stored and dropped since power-on
+uint32_t logRecordCount();
+uint32_t logDroppedCount();
+
+#endif // NODE_LOG_H
@@ -0,0 +1,114 @@
+/*
+ * Wake-Cycle Profiler Implementation
+ */
+
+#include "profiler.h"
+
+#if ENABLE_PROFILER
+
+#include "hal.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "esp_timer.h"
+#define PROFILER_PRINTF Serial.printf
+#else
+#include <stdio.h>
+#define PROFILER_PRINTF printf
+#endif
+
+static const char* const phaseNames[PHASE_COUNT] = {
+  "boot", "config", "prov", "radio", "batt", "sensor", "send", "sleep"
+};
+
+// RTC memory history (survives deep sleep)
+RTC_DATA_ATTR ProfileRecord profileHistory[PROFILER_HISTORY_LEN];
+RTC_DATA_ATTR uint32_t profileHistoryCount = 0;  // Total cycles ever recorded
+RTC_DATA_ATTR uint32_t profileLastCycleUs = 0;
+
+static ProfileRecord currentRecord;
+static uint64_t cycleStartUs = 0;
+static bool cycleActive = false;
+
+uint64_t profilerNowUs() {
+#ifdef ARDUINO
+  return (uint64_t)esp_timer_get_time();
+#else
+  return halMicros();
+#endif
+}
+
+void profilerBeginCycle() {
+  memset(&currentRecord, 0, sizeof(currentRecord));
+  currentRecord.cycle = profileHistoryCount;
+  currentRecord.firmware = FIRMWARE_VERSION;
+  cycleStartUs = profilerNowUs();
+  cycleActive = true;
+}
+
+void profilerEndCycle() {
+  if (!cycleActive) return;
+
+  currentRecord.totalUs = (uint32_t)(profilerNowUs() - cycleStartUs);
+  profileHistory[profileHistoryCount % PROFILER_HISTORY_LEN] = currentRecord;
+  profileHistoryCount++;
+  profileLastCycleUs = currentRecord.totalUs;
+  cycleActive = false;
+}
+
+// Called from the wake pipeline's tasks as well as the main one
+void profilerAddPhase(ProfilePhase phase, uint32_t us) {
+  if (phase >= PHASE_COUNT) return;
+  halCriticalEnter();
+  if (cycleActive) currentRecord.phaseUs[phase] += us;
+  halCriticalExit();
+}
+
+uint32_t profilerLastCycleUs() {
+  return profileLastCycleUs;
+}
+
+void profilerDump() {
+  uint32_t stored = profileHistoryCount < PROFILER_HISTORY_LEN ? profileHistoryCount : PROFILER_HISTORY_LEN;
+
+  PROFILER_PRINTF("=== Wake-cycle profile (%u of %u cycles, times in us) ===\n",
+                  (unsigned)stored, (unsigned)profileHistoryCount);
+  PROFILER_PRINTF("cycle    fw     total");
+  for (int p = 0; p < PHASE_COUNT; p++) {
+    PROFILER_PRINTF(" %9s", phaseNames[p]);
+  }
+  PROFILER_PRINTF("\n");
+
+  // Oldest first
+  for (uint32_t i = profileHistoryCount - stored; i < profileHistoryCount; i++) {
+    const ProfileRecord& r = profileHistory[i % PROFILER_HISTORY_LEN];
+    PROFILER_PRINTF("%5u 0x%04X %9u", (unsigned)r.cycle, (unsigned)r.firmware, (unsigned)r.totalUs);
+    for (int p = 0; p < PHASE_COUNT; p++) {
+      PROFILER_PRINTF(" %9u", (unsigned)r.phaseUs[p]);
+    }
+    PROFILER_PRINTF("\n");
+  }
+}
+
+void profilerClear() {
+  memset(profileHistory, 0, sizeof(profileHistory));
+  profileHistoryCount = 0;
+  profileLastCycleUs = 0;
+}
+
+void profilerHandleSerial() {
+#ifdef ARDUINO
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c == 'p') {
+      profilerDump();
+    } else if (c == 'c') {
+      profilerClear();
+      Serial.println("Profile history cleared");
+    }
+  }
+#endif
+}
+
+#endif // ENABLE_PROFILER
@@ -0,0 +1,89 @@
+/*
+ * Wake-Cycle Profiler
+ *
+ * Scoped phase timers with microsecond resolution. Each wake cycle is
+ * stored as one record in a ring kept in RTC memory, so the history
+ * survives deep sleep. Compiles out completely when ENABLE_PROFILER is 0.
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Phases of a wake cycle (order matches the dump columns)
+enum ProfilePhase : uint8_t {
+  PHASE_BOOT = 0,      // Serial start-up delay
+  PHASE_CONFIG_LOAD,   // Loading properties and cloud MAC
+  PHASE_PROVISIONING,  // Cold-boot WiFi/BLE handling
+  PHASE_RADIO_INIT,    // WiFi + ESP-NOW init (includes channel scan)
+  PHASE_BATTERY,       // Battery voltage read
+  PHASE_SENSOR,        // Ultrasonic acquisition
+  PHASE_SEND,          // ESP-NOW transmit (includes rescans)
+  PHASE_SLEEP_PREP,    // Time between send and deep sleep
+  PHASE_COUNT
+};
+
+// One wake cycle
+typedef struct ProfileRecord {
+  uint32_t cycle;                  // Cycle number since power-on
+  uint16_t firmware;               // FIRMWARE_VERSION that recorded it
+  uint16_t reserved;
+  uint32_t totalUs;                // Awake time of the whole cycle
+  uint32_t phaseUs[PHASE_COUNT];   // Time spent in each phase
+} ProfileRecord;
+
+#if ENABLE_PROFILER
+
+// Start a new cycle record
+void profilerBeginCycle();
+
+// Close the current cycle and store it in the RTC ring
+void profilerEndCycle();
+
+// Add time to a phase of the current cycle
+void profilerAddPhase(ProfilePhase phase, uint32_t us);
+
+// Microsecond clock used by the profiler (the HAL's virtual clock on the host)
+uint64_t profilerNowUs();
+
+// Awake time of the last completed cycle (0 if none yet)
+uint32_t profilerLastCycleUs();
+
+// Print the RTC history over Serial
+void profilerDump();
+
+// Clear the RTC history
+void profilerClear();
+
+// Serial commands: 'p' dumps the history, 'c' clears it
+void profilerHandleSerial();
+
+// Times the enclosing scope and adds it to a phase
+class ProfileScope {
+ public:
+  explicit ProfileScope(ProfilePhase phase) : phase_(phase), startUs_(profilerNowUs()) {}
+  ~ProfileScope() { profilerAddPhase(phase_, (uint32_t)(profilerNowUs() - startUs_)); }
+ private:
+  ProfilePhase phase_;
+  uint64_t startUs_;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(phase) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(phase)
+#define PROFILE_BEGIN_CYCLE() profilerBeginCycle()
+#define PROFILE_END_CYCLE() profilerEndCycle()
+#define PROFILE_HANDLE_SERIAL() profilerHandleSerial()
+
+#else
+
+#define PROFILE_SCOPE(phase) do {} while (0)
+#define PROFILE_BEGIN_CYCLE() do {} while (0)
+#define PROFILE_END_CYCLE() do {} while (0)
+#define PROFILE_HANDLE_SERIAL() do {} while (0)
+
+#endif // ENABLE_PROFILER
+
+#endif // PROFILER_H
@@ -0,0 +1,541 @@
+/*
+ * Properties JSON Parser Implementation
+ */
+
+#include "properties_json.h"
+#include <stdio.h>
+#include <string.h>
+
+enum PropsType : uint8_t {
+  PROPS_TYPE_FLOAT = 0,
+  PROPS_TYPE_U32,
+  PROPS_TYPE_U16,
+  PROPS_TYPE_MAC,
+  PROPS_TYPE_SHAPE,          // TankShape name
+  PROPS_TYPE_POINTS          // [[distanceCm, litres], ...] into PropertiesUpdate.geometry
+};
+
+typedef struct PropsFieldSpec {
+  const char* key;
+  uint8_t keyLength;
+  PropsType type;
+  uint16_t offset;           // Destination in PropertiesUpdate
+  bool required;
+  double min;                // Inclusive limits (numbers; pairs for PROPS_TYPE_POINTS)
+  double max;
+} PropsFieldSpec;
+
+#define PROPS_KEY(name) name, (uint8_t)(sizeof(name) - 1)
+
+// Field schema, in PropsField order
+static const PropsFieldSpec PROPS_SCHEMA[] = {
+  {PROPS_KEY("minDistance"), PROPS_TYPE_FLOAT, offsetof(PropertiesUpdate, minDistance), true,
+   1, SENSOR_MAX_RANGE_CM},
+  {PROPS_KEY("maxDistance"), PROPS_TYPE_FLOAT, offsetof(PropertiesUpdate, maxDistance), true,
+   1, SENSOR_MAX_RANGE_CM},
+  {PROPS_KEY("refreshRate"), PROPS_TYPE_U32, offsetof(PropertiesUpdate, refreshRate), true,
+   1, 86400},
+  {PROPS_KEY("totalLitres"), PROPS_TYPE_FLOAT, offsetof(PropertiesUpdate, totalLitres), true,
+   0.1, 1e6},
+  {PROPS_KEY("cloudNodeMAC"), PROPS_TYPE_MAC, offsetof(PropertiesUpdate, cloudNodeMAC), false,
+   0, 0},
+  {PROPS_KEY("deadbandDistance"), PROPS_TYPE_FLOAT, offsetof(PropertiesUpdate, thresholds.distanceCm), false,
+   0, SENSOR_MAX_RANGE_CM},
+  {PROPS_KEY("deadbandLevel"), PROPS_TYPE_FLOAT, offsetof(PropertiesUpdate, thresholds.levelPercent), false,
+   0, 100},
+  {PROPS_KEY("deadbandBattery"), PROPS_TYPE_FLOAT, offsetof(PropertiesUpdate, thresholds.batteryV), false,
+   0, 5},
+  {PROPS_KEY("urgentDelta"), PROPS_TYPE_FLOAT, offsetof(PropertiesUpdate, thresholds.urgentLevelPercent), false,
+   0.1, 100},
+  {PROPS_KEY("heartbeatCycles"), PROPS_TYPE_U16, offsetof(PropertiesUpdate, thresholds.heartbeatCycles), false,
+   1, 65535},
+  {PROPS_KEY("tankShape"), PROPS_TYPE_SHAPE, offsetof(PropertiesUpdate, geometry.shape), false,
+   0, 0},
+  {PROPS_KEY("tankLength"), PROPS_TYPE_FLOAT, offsetof(PropertiesUpdate, geometry.lengthCm), false,
+   1, 10000},
+  {PROPS_KEY("strapping"), PROPS_TYPE_POINTS, offsetof(PropertiesUpdate, geometry), false,
+   2, TANK_CALIBRATION_MAX_POINTS},
+};
+
+// Limits of the numbers in a strapping pair (as minDistance/maxDistance and totalLitres)
+static const double POINT_MIN_DISTANCE = 1;
+static const double POINT_MAX_DISTANCE = SENSOR_MAX_RANGE_CM;
+static const double POINT_MAX_LITRES = 1e6;
+
+static_assert(sizeof(PROPS_SCHEMA) / sizeof(PROPS_SCHEMA[0]) == PROPS_FIELD_COUNT,
+              "PROPS_SCHEMA must have one entry per PropsField");
+static_assert(PROPS_FIELD_COUNT <= 16, "PropertiesUpdate.present holds 16 fields");
+
+// Cursor over the characteristic bytes
+typedef struct PropsCursor {
+  const uint8_t* data;
+  size_t length;
+  size_t pos;
+} PropsCursor;
+
+static PropsResult propsFail(PropsError error, size_t offset, PropsField field) {
+  PropsResult result;
+  result.error = error;
+  result.offset = (uint16_t)offset;
+  result.field = field;
+  return result;
+}
+
+static bool atEnd(const PropsCursor& c) {
+  return c.pos >= c.length;
+}
+
+static uint8_t peek(const PropsCursor& c) {
+  return c.pos < c.length ? c.data[c.pos] : 0;
+}
+
+static void skipWhitespace(PropsCursor& c) {
+  while (c.pos < c.length) {
+    uint8_t ch = c.data[c.pos];
+    if (ch != ' ' && ch != '\t' && ch != '\n' && ch != '\r') break;
+    c.pos++;
+  }
+}
+
+static bool isDigit(uint8_t ch) {
+  return ch >= '0' && ch <= '9';
+}
+
+// First byte of a string, literal, array or object
+static bool isValueStart(uint8_t ch) {
+  return ch == '"' || ch == '{' || ch == '[' || ch == 't' || ch == 'f' || ch == 'n';
+}
+
+static int hexValue(uint8_t ch) {
+  if (ch >= '0' && ch <= '9') return ch - '0';
+  if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+  if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+  return -1;
+}
+
+// String body after the opening quote. Escapes and control characters are
+// rejected (no schema key or value needs them)
+static bool scanString(PropsCursor& c, size_t& start, size_t& length) {
+  start = c.pos;
+  while (c.pos < c.length) {
+    uint8_t ch = c.data[c.pos];
+    if (ch == '"') {
+      length = c.pos - start;
+      c.pos++;
+      return true;
+    }
+    if (ch == '\\' || ch < 0x20) return false;
+    c.pos++;
+  }
+  return false;
+}
+
+// JSON number: -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+// The first 19 significant digits are kept exactly; later ones only scale
+static PropsError scanNumber(PropsCursor& c, double& value) {
+  bool negative = false;
+  if (peek(c) == '-') {
+    negative = true;
+    c.pos++;
+  }
+  if (!isDigit(peek(c))) return PROPS_ERR_NUMBER;
+
+  uint64_t mantissa = 0;
+  int digits = 0;
+  int exponent = 0;
+
+  if (peek(c) == '0') {
+    c.pos++;
+    if (isDigit(peek(c))) return PROPS_ERR_NUMBER;  // No leading zeros
+  } else {
+    while (isDigit(peek(c))) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (peek(c) - '0');
+        if (mantissa != 0) digits++;
+      } else {
+        exponent++;
+      }
+      c.pos++;
+    }
+  }
+
+  if (peek(c) == '.') {
+    c.pos++;
+    if (!isDigit(peek(c))) return PROPS_ERR_NUMBER;
+    while (isDigit(peek(c))) {
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (peek(c) - '0');
+        if (mantissa != 0) digits++;
+        exponent--;
+      }
+      c.pos++;
+    }
+  }
+
+  if (peek(c) == 'e' || peek(c) == 'E') {
+    c.pos++;
+    bool negativeExp = false;
+    if (peek(c) == '+' || peek(c) == '-') {
+      negativeExp = peek(c) == '-';
+      c.pos++;
+    }
+    if (!isDigit(peek(c))) return PROPS_ERR_NUMBER;
+    int e = 0;
+    while (isDigit(peek(c))) {
+      if (e < 10000) e = e * 10 + (peek(c) - '0');
+      c.pos++;
+    }
+    exponent += negativeExp ? -e : e;
+  }
+
+  // Anything past 1e±40 is out of every field's range anyway
+  if (mantissa == 0) {
+    value = 0;
+  } else if (exponent > 40) {
+    value = 1e300;
+  } else if (exponent < -40) {
+    value = 0;
+  } else {
+    value = (double)mantissa;
+    for (int i = 0; i < exponent; i++) value *= 10.0;
+    for (int i = 0; i > exponent; i--) value /= 10.0;
+  }
+  if (negative) value = -value;
+  return PROPS_OK;
+}
+
+// "AABBCCDDEEFF", "AA:BB:CC:DD:EE:FF" or "AA-BB-CC-DD-EE-FF"
+static bool parseMac(const uint8_t* text, size_t length, uint8_t* mac) {
+  size_t step;
+  if (length == 12) {
+    step = 2;
+  } else if (length == 17) {
+    step = 3;
+    uint8_t separator = text[2];
+    if (separator != ':' && separator != '-') return false;
+    for (size_t i = 2; i < length; i += 3) {
+      if (text[i] != separator) return false;
+    }
+  } else {
+    return false;
+  }
+
+  for (int i = 0; i < 6; i++) {
+    int high = hexValue(text[i * step]);
+    int low = hexValue(text[i * step + 1]);
+    if (high < 0 || low < 0) return false;
+    mac[i] = (uint8_t)(high << 4 | low);
+  }
+  return true;
+}
+
+// Shapes with a name; calibrated tanks come from "strapping"
+static bool parseShape(const uint8_t* text, size_t length, uint8_t* shape) {
+  for (int i = 0; i < TANK_SHAPE_CALIBRATED; i++) {
+    const char* name = tankShapeName((TankShape)i);
+    if (strlen(name) == length && memcmp(name, text, length) == 0) {
+      *shape = (uint8_t)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+static PropsField lookupKey(const uint8_t* key, size_t length) {
+  for (int i = 0; i < PROPS_FIELD_COUNT; i++) {
+    if (PROPS_SCHEMA[i].keyLength == length && memcmp(PROPS_SCHEMA[i].key, key, length) == 0) {
+      return (PropsField)i;
+    }
+  }
+  return PROPS_FIELD_NONE;
+}
+
+// One number of a strapping pair, within [min, max]
+static PropsResult parsePointNumber(PropsCursor& c, PropsField field, double min, double max, float& out) {
+  size_t valueStart = c.pos;
+  uint8_t ch = peek(c);
+  if (ch != '-' && !isDigit(ch)) {
+    return propsFail(isValueStart(ch) ? PROPS_ERR_TYPE : PROPS_ERR_SYNTAX, valueStart, field);
+  }
+
+  double value;
+  PropsError error = scanNumber(c, value);
+  if (error != PROPS_OK) return propsFail(error, c.pos, field);
+  if (value < min || value > max) return propsFail(PROPS_ERR_RANGE, valueStart, field);
+  out = (float)value;
+  return propsFail(PROPS_OK, 0, field);
+}
+
+// [[distanceCm, litres], ...] after the opening bracket, into the geometry's points
+static PropsResult parsePoints(PropsCursor& c, PropsField field, size_t valueStart, TankGeometry& geometry) {
+  const PropsFieldSpec& spec = PROPS_SCHEMA[field];
+  int count = 0;
+
+  skipWhitespace(c);
+  if (peek(c) == ']') {
+    c.pos++;
+  } else {
+    for (;;) {
+      uint8_t ch = peek(c);
+      if (ch != '[') {
+        // A number or other value where a pair belongs
+        bool isValue = isValueStart(ch) || ch == '-' || isDigit(ch);
+        return propsFail(isValue ? PROPS_ERR_TYPE : PROPS_ERR_SYNTAX, c.pos, field);
+      }
+      if (count >= spec.max) return propsFail(PROPS_ERR_RANGE, c.pos, field);
+      c.pos++;
+      skipWhitespace(c);
+
+      PropsResult result = parsePointNumber(c, field, POINT_MIN_DISTANCE, POINT_MAX_DISTANCE,
+                                            geometry.pointDistanceCm[count]);
+      if (result.error != PROPS_OK) return result;
+      skipWhitespace(c);
+      if (peek(c) != ',') return propsFail(PROPS_ERR_SYNTAX, c.pos, field);
+      c.pos++;
+      skipWhitespace(c);
+      result = parsePointNumber(c, field, 0, POINT_MAX_LITRES, geometry.pointLitres[count]);
+      if (result.error != PROPS_OK) return result;
+      skipWhitespace(c);
+      if (peek(c) != ']') return propsFail(PROPS_ERR_SYNTAX, c.pos, field);
+      c.pos++;
+      count++;
+
+      skipWhitespace(c);
+      if (peek(c) == ',') {
+        c.pos++;
+        skipWhitespace(c);
+        continue;
+      }
+      if (peek(c) == ']') {
+        c.pos++;
+        break;
+      }
+      return propsFail(PROPS_ERR_SYNTAX, c.pos, field);
+    }
+  }
+
+  if (count < spec.min) return propsFail(PROPS_ERR_RANGE, valueStart, field);
+  geometry.pointCount = (uint8_t)count;
+  return propsFail(PROPS_OK, 0, field);
+}
+
+// Tank fields against each other and the rest: strapping makes the tank
+// calibrated, a capsule needs a length of at least its diameter (the level
+// span) and the points must run in filling order within totalLitres
+static PropsResult checkGeometry(const PropertiesUpdate& out, size_t offset) {
+  const TankGeometry& geometry = out.geometry;
+  bool hasShape = propsHasField(out, PROPS_TANK_SHAPE);
+  bool hasLength = propsHasField(out, PROPS_TANK_LENGTH);
+
+  if (propsHasField(out, PROPS_STRAPPING)) {
+    if (hasShape) return propsFail(PROPS_ERR_INCONSISTENT, offset, PROPS_TANK_SHAPE);
+    for (int i = 0; i < geometry.pointCount; i++) {
+      bool inOrder = i == 0 || (geometry.pointDistanceCm[i] < geometry.pointDistanceCm[i - 1] &&
+                                geometry.pointLitres[i] > geometry.pointLitres[i - 1]);
+      if (!inOrder || geometry.pointLitres[i] > out.totalLitres) {
+        return propsFail(PROPS_ERR_INCONSISTENT, offset, PROPS_STRAPPING);
+      }
+    }
+  }
+
+  if (geometry.shape == TANK_SHAPE_CAPSULE) {
+    if (!hasLength) return propsFail(PROPS_ERR_MISSING, offset, PROPS_TANK_LENGTH);
+    if (geometry.lengthCm < out.maxDistance - out.minDistance) {
+      return propsFail(PROPS_ERR_INCONSISTENT, offset, PROPS_TANK_LENGTH);
+    }
+  } else if (hasLength) {
+    return propsFail(PROPS_ERR_INCONSISTENT, offset, PROPS_TANK_LENGTH);
+  }
+  return propsFail(PROPS_OK, offset, PROPS_FIELD_NONE);
+}
+
+// Parse one value for field into out
+static PropsResult parseValue(PropsCursor& c, PropsField field, PropertiesUpdate& out) {
+  const PropsFieldSpec& spec = PROPS_SCHEMA[field];
+  uint8_t* dest = (uint8_t*)&out + spec.offset;
+  size_t valueStart = c.pos;
+  uint8_t ch = peek(c);
+
+  if (spec.type == PROPS_TYPE_MAC) {
+    if (ch != '"') return propsFail(atEnd(c) ? PROPS_ERR_SYNTAX : PROPS_ERR_TYPE, valueStart, field);
+    c.pos++;
+    size_t start, length;
+    if (!scanString(c, start, length)) return propsFail(PROPS_ERR_SYNTAX, c.pos, field);
+    if (!parseMac(c.data + start, length, dest)) return propsFail(PROPS_ERR_MAC, valueStart, field);
+    return propsFail(PROPS_OK, 0, field);
+  }
+
+  if (spec.type == PROPS_TYPE_SHAPE) {
+    if (ch != '"') return propsFail(atEnd(c) ? PROPS_ERR_SYNTAX : PROPS_ERR_TYPE, valueStart, field);
+    c.pos++;
+    size_t start, length;
+    if (!scanString(c, start, length)) return propsFail(PROPS_ERR_SYNTAX, c.pos, field);
+    if (!parseShape(c.data + start, length, dest)) return propsFail(PROPS_ERR_SHAPE, valueStart, field);
+    return propsFail(PROPS_OK, 0, field);
+  }
+
+  if (spec.type == PROPS_TYPE_POINTS) {
+    if (ch != '[') return propsFail(atEnd(c) ? PROPS_ERR_SYNTAX : PROPS_ERR_TYPE, valueStart, field);
+    c.pos++;
+    return parsePoints(c, field, valueStart, out.geometry);
+  }
+
+  if (ch != '-' && !isDigit(ch)) {
+    // A string, literal, array or object where a number belongs
+    return propsFail(isValueStart(ch) ? PROPS_ERR_TYPE : PROPS_ERR_SYNTAX, valueStart, field);
+  }
+
+  double value;
+  PropsError error = scanNumber(c, value);
+  if (error != PROPS_OK) return propsFail(error, c.pos, field);
+
+  // Doubles this large have no fraction bits (and would overflow the cast)
+  bool integral = value > 9e18 || value < -9e18 || value == (double)(int64_t)value;
+  if (spec.type != PROPS_TYPE_FLOAT && !integral) {
+    return propsFail(PROPS_ERR_NOT_INTEGER, valueStart, field);
+  }
+  if (value < spec.min || value > spec.max) return propsFail(PROPS_ERR_RANGE, valueStart, field);
+
+  switch (spec.type) {
+    case PROPS_TYPE_FLOAT: {
+      float f = (float)value;
+      memcpy(dest, &f, sizeof(f));
+      break;
+    }
+    case PROPS_TYPE_U32: {
+      uint32_t u = (uint32_t)value;
+      memcpy(dest, &u, sizeof(u));
+      break;
+    }
+    case PROPS_TYPE_U16: {
+      uint16_t u = (uint16_t)value;
+      memcpy(dest, &u, sizeof(u));
+      break;
+    }
+    case PROPS_TYPE_MAC:
+    case PROPS_TYPE_SHAPE:
+    case PROPS_TYPE_POINTS:
+      break;
+  }
+  return propsFail(PROPS_OK, 0, field);
+}
+
+PropsResult propsParse(const uint8_t* json, size_t length, const ReportThresholds& thresholds,
+                       PropertiesUpdate& out) {
+  memset(&out, 0, sizeof(out));
+  out.thresholds = thresholds;
+
+  if (length > PROPS_JSON_MAX_LEN) return propsFail(PROPS_ERR_TOO_LONG, PROPS_JSON_MAX_LEN, PROPS_FIELD_NONE);
+
+  // Some BLE apps write the C string terminator too
+  while (length > 0 && json[length - 1] == '\0') length--;
+
+  PropsCursor c = {json, length, 0};
+  skipWhitespace(c);
+  if (atEnd(c)) return propsFail(PROPS_ERR_EMPTY, c.pos, PROPS_FIELD_NONE);
+  if (peek(c) != '{') return propsFail(PROPS_ERR_SYNTAX, c.pos, PROPS_FIELD_NONE);
+  c.pos++;
+  skipWhitespace(c);
+
+  if (peek(c) == '}') {
+    c.pos++;
+  } else {
+    for (;;) {
+      if (peek(c) != '"') return propsFail(PROPS_ERR_SYNTAX, c.pos, PROPS_FIELD_NONE);
+      size_t keyOffset = c.pos;
+      c.pos++;
+      size_t keyStart, keyLength;
+      if (!scanString(c, keyStart, keyLength)) return propsFail(PROPS_ERR_SYNTAX, c.pos, PROPS_FIELD_NONE);
+
+      PropsField field = lookupKey(c.data + keyStart, keyLength);
+      if (field == PROPS_FIELD_NONE) return propsFail(PROPS_ERR_UNKNOWN_KEY, keyOffset, PROPS_FIELD_NONE);
+      if (out.present & (1u << field)) return propsFail(PROPS_ERR_DUPLICATE_KEY, keyOffset, field);
+
+      skipWhitespace(c);
+      if (peek(c) != ':') return propsFail(PROPS_ERR_SYNTAX, c.pos, field);
+      c.pos++;
+      skipWhitespace(c);
+
+      PropsResult result = parseValue(c, field, out);
+      if (result.error != PROPS_OK) return result;
+      out.present |= (uint16_t)(1u << field);
+
+      skipWhitespace(c);
+      if (peek(c) == ',') {
+        c.pos++;
+        skipWhitespace(c);
+        continue;
+      }
+      if (peek(c) == '}') {
+        c.pos++;
+        break;
+      }
+      return propsFail(PROPS_ERR_SYNTAX, c.pos, PROPS_FIELD_NONE);
+    }
+  }
+
+  skipWhitespace(c);
+  if (!atEnd(c)) return propsFail(PROPS_ERR_TRAILING, c.pos, PROPS_FIELD_NONE);
+
+  for (int i = 0; i < PROPS_FIELD_COUNT; i++) {
+    if (PROPS_SCHEMA[i].required && !(out.present & (1u << i))) {
+      return propsFail(PROPS_ERR_MISSING, c.pos, (PropsField)i);
+    }
+  }
+  if (out.minDistance >= out.maxDistance) return propsFail(PROPS_ERR_INCONSISTENT, c.pos, PROPS_MAX_DISTANCE);
+
+  PropsResult geometry = checkGeometry(out, c.pos);
+  if (geometry.error != PROPS_OK) return geometry;
+  if (propsHasField(out, PROPS_STRAPPING)) out.geometry.shape = TANK_SHAPE_CALIBRATED;
+
+  return propsFail(PROPS_OK, c.pos, PROPS_FIELD_NONE);
+}
+
+bool propsHasField(const PropertiesUpdate& update, PropsField field) {
+  return field >= 0 && field < PROPS_FIELD_COUNT && (update.present & (1u << field)) != 0;
+}
+
+bool propsHasGeometry(const PropertiesUpdate& update) {
+  return propsHasField(update, PROPS_TANK_SHAPE) || propsHasField(update, PROPS_STRAPPING);
+}
+
+const char* propsFieldName(PropsField field) {
+  if (field < 0 || field >= PROPS_FIELD_COUNT) return "?";
+  return PROPS_SCHEMA[field].key;
+}
+
+const char* propsErrorName(PropsError error) {
+  switch (error) {
+    case PROPS_OK:                return "ok";
+    case PROPS_ERR_EMPTY:         return "empty";
+    case PROPS_ERR_TOO_LONG:      return "too_long";
+    case PROPS_ERR_SYNTAX:        return "syntax";
+    case PROPS_ERR_TRAILING:      return "trailing";
+    case PROPS_ERR_UNKNOWN_KEY:   return "unknown_key";
+    case PROPS_ERR_DUPLICATE_KEY: return "duplicate_key";
+    case PROPS_ERR_TYPE:          return "type";
+    case PROPS_ERR_NUMBER:        return "number";
+    case PROPS_ERR_NOT_INTEGER:   return "not_integer";
+    case PROPS_ERR_RANGE:         return "out_of_range";
+    case PROPS_ERR_MAC:           return "bad_mac";
+    case PROPS_ERR_MISSING:       return "missing_field";
+    case PROPS_ERR_INCONSISTENT:  return "inconsistent";
+    case PROPS_ERR_SHAPE:         return "bad_shape";
+  }
+  return "?";
+}
+
+size_t propsFormatStatus(const PropsResult& result, char* buffer, size_t capacity) {
+  if (capacity == 0) return 0;
+  int written;
+  if (result.error == PROPS_OK) {
+    written = snprintf(buffer, capacity, "properties_updated");
+  } else if (result.field == PROPS_FIELD_NONE) {
+    written = snprintf(buffer, capacity, "properties_error:%s", propsErrorName(result.error));
+  } else {
+    written = snprintf(buffer, capacity, "properties_error:%s:%s", propsErrorName(result.error),
+                       propsFieldName(result.field));
+  }
+  if (written < 0) return 0;
+  return (size_t)written < capacity ? (size_t)written : capacity - 1;
+}
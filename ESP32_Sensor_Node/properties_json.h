@@ -0,0 +1,105 @@
+/*
+ * Properties JSON Parser
+ *
+ * Single-pass parser for the properties JSON written to the Properties
+ * characteristic. It reads the raw characteristic bytes in place (no
+ * NUL terminator, no copies, no heap) and checks each key against a
+ * fixed field schema: JSON type, integer-ness, range, duplicates and
+ * required fields. Whitespace and key order are free; unknown keys,
+ * nested values and string escapes are rejected. The one exception is
+ * "strapping", an array of [distanceCm, litres] pairs.
+ *
+ * Errors carry a code, the byte offset and the field, formatted for
+ * updatePropertiesStatus() as "properties_error:<code>[:<field>]".
+ *
+ * No Arduino dependencies, so it can be fuzzed and benchmarked on the host.
+ */
+
+#ifndef PROPERTIES_JSON_H
+#define PROPERTIES_JSON_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+#include "report_policy.h"
+#include "tank_geometry.h"
+
+#define PROPS_JSON_MAX_LEN 512     // Longer writes are rejected unread
+#define PROPS_STATUS_MAX_LEN 64    // Longest propsFormatStatus() string plus NUL
+
+// Schema fields (bit i of PropertiesUpdate.present)
+enum PropsField : int8_t {
+  PROPS_FIELD_NONE = -1,
+  PROPS_MIN_DISTANCE = 0,
+  PROPS_MAX_DISTANCE,
+  PROPS_REFRESH_RATE,
+  PROPS_TOTAL_LITRES,
+  PROPS_CLOUD_NODE_MAC,
+  PROPS_DEADBAND_DISTANCE,
+  PROPS_DEADBAND_LEVEL,
+  PROPS_DEADBAND_BATTERY,
+  PROPS_URGENT_DELTA,
+  PROPS_HEARTBEAT_CYCLES,
+  PROPS_TANK_SHAPE,
+  PROPS_TANK_LENGTH,
+  PROPS_STRAPPING,
+  PROPS_FIELD_COUNT
+};
+
+enum PropsError : uint8_t {
+  PROPS_OK = 0,
+  PROPS_ERR_EMPTY,          // Nothing but whitespace
+  PROPS_ERR_TOO_LONG,       // Over PROPS_JSON_MAX_LEN bytes
+  PROPS_ERR_SYNTAX,         // Not a flat JSON object
+  PROPS_ERR_TRAILING,       // Data after the closing brace
+  PROPS_ERR_UNKNOWN_KEY,
+  PROPS_ERR_DUPLICATE_KEY,
+  PROPS_ERR_TYPE,           // Wrong JSON type for the field
+  PROPS_ERR_NUMBER,         // Malformed number
+  PROPS_ERR_NOT_INTEGER,    // Fraction in an integer field
+  PROPS_ERR_RANGE,          // Outside the field's limits
+  PROPS_ERR_MAC,            // Not a MAC address
+  PROPS_ERR_MISSING,        // Required field left out
+  PROPS_ERR_INCONSISTENT,   // minDistance not below maxDistance, tank fields that do not fit
+  PROPS_ERR_SHAPE           // Unknown tankShape
+};
+
+typedef struct PropsResult {
+  PropsError error;
+  uint16_t offset;          // Byte where the error was found
+  PropsField field;         // Field involved, PROPS_FIELD_NONE if none
+} PropsResult;
+
+typedef struct PropertiesUpdate {
+  float minDistance;
+  float maxDistance;
+  uint32_t refreshRate;
+  float totalLitres;
+  uint8_t cloudNodeMAC[6];
+  ReportThresholds thresholds;  // Starts as the current thresholds; sent keys override
+  TankGeometry geometry;        // Set if tankShape or strapping was sent
+  uint16_t present;             // Bit per PropsField that was in the JSON
+} PropertiesUpdate;
+
+// Parse and validate a properties write. thresholds fills in the
+// report-on-change keys that were left out. out is only complete if
+// the result is PROPS_OK
+PropsResult propsParse(const uint8_t* json, size_t length, const ReportThresholds& thresholds,
+                       PropertiesUpdate& out);
+
+// True if the field was in the JSON
+bool propsHasField(const PropertiesUpdate& update, PropsField field);
+
+// True if the JSON set the tank geometry (tankShape or strapping)
+bool propsHasGeometry(const PropertiesUpdate& update);
+
+// JSON key of a field ("?" for PROPS_FIELD_NONE)
+const char* propsFieldName(PropsField field);
+
+// Short code for an error ("ok", "syntax", "out_of_range", ...)
+const char* propsErrorName(PropsError error);
+
+// Status string for the Properties characteristic. Returns its length
+size_t propsFormatStatus(const PropsResult& result, char* buffer, size_t capacity);
+
+#endif // PROPERTIES_JSON_H
@@ -5,6 +5,12 @@
 #include "provisioning.h"
 #include "config.h"
 #include "espnow_comm.h"
+#include "profiler.h"
+#include "config_cache.h"
+#include "report_policy.h"
+#include "properties_json.h"
+#include "device_info.h"
+#include "node_log.h"
 
 // Global variables
 bool provisioningRequested = false;
@@ -17,6 +23,10 @@ BLEServer* pProvisioningServer = nullptr;
 BLECharacteristic* pStatusCharacteristic = nullptr;
 BLECharacteristic* pDeviceInfoCharacteristic = nullptr;
 BLECharacteristic* pPropertiesCharacteristic = nullptr;
+BLECharacteristic* pDeviceInfoTlvCharacteristic = nullptr;
+
+// ATT MTU agreed with the connected client (23 until it asks for more)
+static uint16_t peerMtu = ESP_GATT_DEF_BLE_MTU_SIZE;
 
 // Preferences for storing WiFi credentials
 Preferences preferences;
@@ -25,7 +35,8 @@ Preferences preferences;
 class ServerCallbacks: public BLEServerCallbacks {
     void onConnect(BLEServer* pServer) {
       deviceConnected = true;
-      Serial.println("BLE Client connected for provisioning");
+      peerMtu = ESP_GATT_DEF_BLE_MTU_SIZE;
+      LOG_I("BLE Client connected for provisioning");
       // Send device info when client connects
       delay(500); // Small delay to ensure connection is stable
       sendDeviceInfo();
@@ -33,10 +44,17 @@ class ServerCallbacks: public BLEServerCallbacks {
 
     void onDisconnect(BLEServer* pServer) {
       deviceConnected = false;
-      Serial.println("BLE Client disconnected");
+      LOG_I("BLE Client disconnected");
       // Restart advertising
       BLEDevice::startAdvertising();
     }
+
+    void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+      peerMtu = param->mtu.mtu;
+      LOG_I("BLE MTU %u", (unsigned)peerMtu);
+      // Device info that did not fit the old MTU may fit now
+      if (deviceConnected) sendDeviceInfo();
+    }
 };
 
 // SSID Characteristic callback
@@ -45,8 +63,7 @@ class SSIDCallbacks: public BLECharacteristicCallbacks {
       String value = pCharacteristic->getValue();
       if (value.length() > 0) {
         wifiSSID = value;
-        Serial.print("Received SSID: ");
-        Serial.println(wifiSSID);
+        LOG_I("Received SSID: %s", wifiSSID.c_str());
       }
     }
 };
@@ -57,7 +74,7 @@ class PasswordCallbacks: public BLECharacteristicCallbacks {
       String value = pCharacteristic->getValue();
       if (value.length() > 0) {
         wifiPassword = value;
-        Serial.println("Received Password: ****");
+        LOG_I("Received Password: ****");
         
         // Trigger provisioning when both SSID and password are received
         if (wifiSSID.length() > 0) {
@@ -70,82 +87,38 @@ class PasswordCallbacks: public BLECharacteristicCallbacks {
 // Properties Characteristic callback
 class PropertiesCallbacks: public BLECharacteristicCallbacks {
     void onWrite(BLECharacteristic* pCharacteristic) {
-      String value = pCharacteristic->getValue();
-      if (value.length() > 0) {
-        Serial.print("Received Properties JSON: ");
-        Serial.println(value);
+      // Parsed in place from the characteristic buffer - no String copies
+      const uint8_t* json = pCharacteristic->getData();
+      size_t length = pCharacteristic->getLength();
+      if (json == nullptr || length == 0) return;
+
+      LOG_I("Received Properties JSON (%u bytes)", (unsigned)length);
+
+      // {"minDistance":20.0,"maxDistance":120.0,"refreshRate":300,"totalLitres":900.0,"cloudNodeMAC":"0C:4E:A0:4D:54:8C"}
+      // Optional report-on-change keys keep their current value unless sent:
+      // "deadbandDistance", "deadbandLevel", "deadbandBattery", "urgentDelta", "heartbeatCycles"
+      // Optional tank geometry keeps the stored one unless sent: "tankShape" ("vertical",
+      // "horizontal", "capsule" + "tankLength") or "strapping" ([[distanceCm, litres], ...])
+      PropertiesUpdate update;
+      PropsResult result = propsParse(json, length, reportThresholds, update);
+
+      char status[PROPS_STATUS_MAX_LEN];
+      propsFormatStatus(result, status, sizeof(status));
+
+      if (result.error == PROPS_OK) {
+        saveDeviceProperties(update.minDistance, update.maxDistance, update.refreshRate, update.totalLitres,
+                             update.thresholds,
+                             propsHasField(update, PROPS_CLOUD_NODE_MAC) ? update.cloudNodeMAC : nullptr,
+                             propsHasGeometry(update) ? &update.geometry : nullptr);
+        updatePropertiesStatus(status);
+        LOG_I("✓ Properties saved successfully");
         
-        // Parse JSON: {"minDistance":20.0,"maxDistance":120.0,"refreshRate":300,"totalLitres":900.0,"cloudNodeMAC":"0C:4E:A0:4D:54:8C"}
-        // Simple JSON parsing (Arduino doesn't have built-in JSON, so we parse manually)
-        float minDist = 0, maxDist = 0, totalLitres = 0;
-        uint32_t refreshRate = 0;
-        uint8_t cloudMAC[6] = {0};
-        bool hasCloudMAC = false;
-        
-        int minDistIdx = value.indexOf("\"minDistance\":");
-        int maxDistIdx = value.indexOf("\"maxDistance\":");
-        int refreshIdx = value.indexOf("\"refreshRate\":");
-        int litresIdx = value.indexOf("\"totalLitres\":");
-        int cloudMACIdx = value.indexOf("\"cloudNodeMAC\":");
-        
-        if (minDistIdx != -1) {
-          int startIdx = minDistIdx + 14; // Length of "minDistance":
-          int endIdx = value.indexOf(',', startIdx);
-          if (endIdx == -1) endIdx = value.indexOf('}', startIdx);
-          minDist = value.substring(startIdx, endIdx).toFloat();
-        }
-        
-        if (maxDistIdx != -1) {
-          int startIdx = maxDistIdx + 14; // Length of "maxDistance":
-          int endIdx = value.indexOf(',', startIdx);
-          if (endIdx == -1) endIdx = value.indexOf('}', startIdx);
-          maxDist = value.substring(startIdx, endIdx).toFloat();
-        }
-        
-        if (refreshIdx != -1) {
-          int startIdx = refreshIdx + 14; // Length of "refreshRate":
-          int endIdx = value.indexOf(',', startIdx);
-          if (endIdx == -1) endIdx = value.indexOf('}', startIdx);
-          refreshRate = value.substring(startIdx, endIdx).toInt();
-        }
-        
-        if (litresIdx != -1) {
-          int startIdx = litresIdx + 14; // Length of "totalLitres":
-          int endIdx = value.indexOf(',', startIdx);
-          if (endIdx == -1) endIdx = value.indexOf('}', startIdx);
-          totalLitres = value.substring(startIdx, endIdx).toFloat();
-        }
-        
-        if (cloudMACIdx != -1) {
-          int startIdx = value.indexOf('"', cloudMACIdx + 15) + 1; // Find opening quote
-          int endIdx = value.indexOf('"', startIdx); // Find closing quote
-          String macStr = value.substring(startIdx, endIdx);
-          macStr.replace(":", ""); // Remove colons
-          macStr.toUpperCase();
-          
-          // Parse hex MAC address
-          if (macStr.length() == 12) {
-            for (int i = 0; i < 6; i++) {
-              String byteStr = macStr.substring(i * 2, i * 2 + 2);
-              cloudMAC[i] = (uint8_t)strtol(byteStr.c_str(), NULL, 16);
-            }
-            hasCloudMAC = true;
-          }
-        }
-        
-        // Validate values
-        if (minDist > 0 && maxDist > 0 && refreshRate > 0 && totalLitres > 0 && minDist < maxDist) {
-          saveDeviceProperties(minDist, maxDist, refreshRate, totalLitres, hasCloudMAC ? cloudMAC : nullptr);
-          updatePropertiesStatus("properties_updated");
-          Serial.println("✓ Properties saved successfully");
-          
-          // Send updated device info
-          delay(100);
-          sendDeviceInfo();
-        } else {
-          updatePropertiesStatus("properties_error");
-          Serial.println("✗ Invalid property values received");
-        }
+        // Send updated device info
+        delay(100);
+        sendDeviceInfo();
+      } else {
+        updatePropertiesStatus(status);
+        LOG_W("✗ Invalid properties at byte %u", (unsigned)result.offset);
       }
     }
 };
@@ -154,62 +127,66 @@ void updateProvisioningStatus(String status) {
   if (pStatusCharacteristic != nullptr) {
     pStatusCharacteristic->setValue(status.c_str());
     pStatusCharacteristic->notify();
-    Serial.print("Provisioning Status: ");
-    Serial.println(status);
+    LOG_I("Provisioning Status: %s", status.c_str());
   }
 }
 
-void updatePropertiesStatus(String status) {
+void updatePropertiesStatus(const char* status) {
   if (pPropertiesCharacteristic != nullptr) {
-    pPropertiesCharacteristic->setValue(status.c_str());
+    pPropertiesCharacteristic->setValue(status);
     pPropertiesCharacteristic->notify();
-    Serial.print("Properties Status: ");
-    Serial.println(status);
+    LOG_I("Properties Status: %s", status);
   }
 }
 
 void sendDeviceInfo() {
   if (pDeviceInfoCharacteristic != nullptr) {
-    // Get MAC address
-    String macAddress = WiFi.macAddress();
-    
-    // Format cloud node MAC address
-    String cloudMAC = "";
-    for (int i = 0; i < 6; i++) {
-      if (cloudNodeAddress[i] < 16) cloudMAC += "0";
-      cloudMAC += String(cloudNodeAddress[i], HEX);
-      if (i < 5) cloudMAC += ":";
+    DeviceInfo info;
+    WiFi.macAddress(info.mac);
+    memcpy(info.cloudNodeMAC, cloudNodeAddress, sizeof(info.cloudNodeMAC));
+    info.minDistance = fullDistanceCm;
+    info.maxDistance = emptyDistanceCm;
+    info.refreshRate = refreshRateSeconds;
+    info.totalLitres = tankCapacityLitres;
+    info.thresholds = reportThresholds;
+
+    // Static: the BLE task stack is small, and callbacks do not overlap
+    static char json[DEVICE_INFO_JSON_MAX_LEN];
+    size_t length = deviceInfoWriteJson(info, json, sizeof(json));
+    pDeviceInfoCharacteristic->setValue((uint8_t*)json, length);
+    // A notify longer than the MTU arrives cut short, so skip it; the
+    // client can still read the whole value
+    if (deviceInfoFitsNotify(length, peerMtu)) {
+      pDeviceInfoCharacteristic->notify();
+    } else {
+      LOG_W("Device info JSON (%u bytes) does not fit MTU %u, not notified", (unsigned)length,
+            (unsigned)peerMtu);
     }
-    cloudMAC.toUpperCase();
-    
-    // Create JSON with device info
-    String deviceInfo = "{";
-    deviceInfo += "\"macAddress\":\"" + macAddress + "\",";
-    deviceInfo += "\"deviceType\":\"tank_meter\",";
-    deviceInfo += "\"properties\":{";
-    deviceInfo += "\"minDistance\":" + String(fullDistanceCm, 1) + ",";
-    deviceInfo += "\"maxDistance\":" + String(emptyDistanceCm, 1) + ",";
-    deviceInfo += "\"refreshRate\":" + String(refreshRateSeconds) + ",";
-    deviceInfo += "\"totalLitres\":" + String(tankCapacityLitres, 1) + ",";
-    deviceInfo += "\"cloudNodeMAC\":\"" + cloudMAC + "\"";
-    deviceInfo += "}";
-    deviceInfo += "}";
-    
-    pDeviceInfoCharacteristic->setValue(deviceInfo.c_str());
-    pDeviceInfoCharacteristic->notify();
+
+#if ENABLE_DEVICE_INFO_TLV
+    if (pDeviceInfoTlvCharacteristic != nullptr) {
+      static uint8_t tlv[DEVICE_INFO_TLV_MAX_LEN];
+      size_t tlvLength = deviceInfoWriteTlv(info, tlv, sizeof(tlv));
+      pDeviceInfoTlvCharacteristic->setValue(tlv, tlvLength);
+      if (deviceInfoFitsNotify(tlvLength, peerMtu)) pDeviceInfoTlvCharacteristic->notify();
+    }
+#endif
     
-    Serial.println("Device info sent to frontend:");
-    Serial.println(deviceInfo);
+    LOG_I("Device info sent to frontend (%u bytes JSON)", (unsigned)length);
   }
 }
 
 void initializeProvisioning() {
-  Serial.println("Initializing BLE Provisioning Service...");
+  PROFILE_SCOPE(PHASE_PROVISIONING);
+
+  LOG_I("Initializing BLE Provisioning Service...");
 
   // Create BLE Device (reuse existing BLE if already initialized)
   if (!BLEDevice::getInitialized()) {
     BLEDevice::init("ESP32-IOT-Device");
   }
+  // Offer a large MTU so device info fits one notify
+  BLEDevice::setMTU(BLE_MTU);
 
   // Create BLE Server
   pProvisioningServer = BLEDevice::createServer();
@@ -248,6 +225,15 @@ void initializeProvisioning() {
   pDeviceInfoCharacteristic->addDescriptor(new BLE2902());
   pDeviceInfoCharacteristic->setValue("{}");
 
+#if ENABLE_DEVICE_INFO_TLV
+  // Create Device Info TLV Characteristic (same info, binary)
+  pDeviceInfoTlvCharacteristic = pService->createCharacteristic(
+    DEVICE_INFO_TLV_CHAR_UUID,
+    BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_NOTIFY
+  );
+  pDeviceInfoTlvCharacteristic->addDescriptor(new BLE2902());
+#endif
+
   // Create Properties Characteristic (for receiving updates from frontend)
   pPropertiesCharacteristic = pService->createCharacteristic(
     PROPERTIES_CHAR_UUID,
@@ -268,14 +254,13 @@ void initializeProvisioning() {
   pAdvertising->setMaxPreferred(0x12);
   BLEDevice::startAdvertising();
 
-  Serial.println("✓ BLE Provisioning service started");
-  Serial.println("✓ Device is ready for WiFi provisioning via IoT Dashboard");
+  LOG_I("✓ BLE Provisioning service started - ready for WiFi provisioning via IoT Dashboard");
 }
 
 bool connectToWiFi(String ssid, String password) {
-  Serial.println("Attempting to connect to WiFi...");
-  Serial.print("SSID: ");
-  Serial.println(ssid);
+  PROFILE_SCOPE(PHASE_PROVISIONING);
+
+  LOG_I("Attempting to connect to WiFi SSID: %s", ssid.c_str());
   updateProvisioningStatus("connecting");
   
   WiFi.mode(WIFI_STA);
@@ -283,16 +268,12 @@ bool connectToWiFi(String ssid, String password) {
   
   int attempts = 0;
   while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-    delay(500);
-    Serial.print(".");
+    logIdleDelay(500);
     attempts++;
   }
-  Serial.println();
   
   if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("✓ WiFi connected!");
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());
+    LOG_I("✓ WiFi connected! IP address: %s", WiFi.localIP().toString().c_str());
     updateProvisioningStatus("connected");
     
     // Save credentials
@@ -300,7 +281,7 @@ bool connectToWiFi(String ssid, String password) {
     
     return true;
   } else {
-    Serial.println("✗ Failed to connect to WiFi");
+    LOG_E("✗ Failed to connect to WiFi after %d attempts", attempts);
     updateProvisioningStatus("failed");
     return false;
   }
@@ -309,7 +290,7 @@ bool connectToWiFi(String ssid, String password) {
 bool connectToStoredWiFi() {
   String ssid, password;
   if (getStoredWiFiCredentials(ssid, password)) {
-    Serial.println("Found stored WiFi credentials, attempting connection...");
+    LOG_I("Found stored WiFi credentials, attempting connection...");
     return connectToWiFi(ssid, password);
   }
   return false;
@@ -320,10 +301,10 @@ void handleProvisioning() {
     provisioningRequested = false;
     
     if (connectToWiFi(wifiSSID, wifiPassword)) {
-      Serial.println("✓ Provisioning successful!");
+      LOG_I("✓ Provisioning successful!");
       // WiFi connected, can now proceed with normal operation
     } else {
-      Serial.println("✗ Provisioning failed - WiFi connection unsuccessful");
+      LOG_E("✗ Provisioning failed - WiFi connection unsuccessful");
     }
   }
 }
@@ -340,7 +321,7 @@ void clearStoredWiFiCredentials() {
   preferences.begin("wifi", false);
   preferences.clear();
   preferences.end();
-  Serial.println("WiFi credentials cleared");
+  LOG_I("WiFi credentials cleared");
 }
 
 bool getStoredWiFiCredentials(String& ssid, String& password) {
@@ -360,115 +341,5 @@ void saveWiFiCredentials(String ssid, String password) {
   preferences.putString("ssid", ssid);
   preferences.putString("password", password);
   preferences.end();
-  Serial.println("✓ WiFi credentials saved to NVS");
-}
-
-// Property storage functions
-void saveDeviceProperties(float minDist, float maxDist, uint32_t refreshRate, float totalLitres, uint8_t* cloudMAC) {
-  preferences.begin("device", false);
-  preferences.putFloat("minDist", minDist);
-  preferences.putFloat("maxDist", maxDist);
-  preferences.putUInt("refreshRate", refreshRate);
-  preferences.putFloat("totalLitres", totalLitres);
-  preferences.end();
-  
-  // Update global variables
-  fullDistanceCm = minDist;
-  emptyDistanceCm = maxDist;
-  refreshRateSeconds = refreshRate;
-  tankCapacityLitres = totalLitres;
-  
-  Serial.println("✓ Device properties saved to NVS:");
-  Serial.printf("  Min Distance: %.1f cm\n", minDist);
-  Serial.printf("  Max Distance: %.1f cm\n", maxDist);
-  Serial.printf("  Refresh Rate: %u seconds\n", refreshRate);
-  Serial.printf("  Total Litres: %.1f L\n", totalLitres);
-  
-  // Save cloud node MAC if provided
-  if (cloudMAC != nullptr) {
-    saveCloudNodeMAC(cloudMAC);
-  }
-}
-
-bool loadDeviceProperties() {
-  preferences.begin("device", true); // Read-only
-  
-  if (preferences.isKey("minDist") && preferences.isKey("maxDist") && 
-      preferences.isKey("refreshRate") && preferences.isKey("totalLitres")) {
-    
-    fullDistanceCm = preferences.getFloat("minDist", 20.0f);
-    emptyDistanceCm = preferences.getFloat("maxDist", 120.0f);
-    refreshRateSeconds = preferences.getUInt("refreshRate", 300);
-    tankCapacityLitres = preferences.getFloat("totalLitres", 900.0f);
-    
-    preferences.end();
-    
-    Serial.println("✓ Loaded stored device properties:");
-    Serial.printf("  Min Distance: %.1f cm\n", fullDistanceCm);
-    Serial.printf("  Max Distance: %.1f cm\n", emptyDistanceCm);
-    Serial.printf("  Refresh Rate: %u seconds\n", refreshRateSeconds);
-    Serial.printf("  Total Litres: %.1f L\n", tankCapacityLitres);
-    
-    return true;
-  }
-  
-  preferences.end();
-  return false;
-}
-
-bool hasStoredProperties() {
-  preferences.begin("device", true); // Read-only
-  bool hasProps = preferences.isKey("minDist") && preferences.isKey("maxDist");
-  preferences.end();
-  return hasProps;
-}
-
-void saveCloudNodeMAC(uint8_t* macAddress) {
-  preferences.begin("device", false);
-  preferences.putBytes("cloudMAC", macAddress, 6);
-  preferences.end();
-  
-  // Update global cloud node address
-  memcpy(cloudNodeAddress, macAddress, 6);
-  
-  Serial.println("✓ Cloud Node MAC saved:");
-  Serial.print("  ");
-  for (int i = 0; i < 6; i++) {
-    Serial.printf("%02X", macAddress[i]);
-    if (i < 5) Serial.print(":");
-  }
-  Serial.println();
-  
-  // Update ESP-NOW peer if WiFi is connected
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("Updating ESP-NOW peer with new MAC address...");
-    if (updateCloudNodePeer(macAddress)) {
-      Serial.println("✓ ESP-NOW peer updated successfully");
-    } else {
-      Serial.println("✗ Failed to update ESP-NOW peer - will retry on next boot");
-    }
-  }
-}
-
-bool loadCloudNodeMAC(uint8_t* macAddress) {
-  preferences.begin("device", true); // Read-only
-  
-  if (preferences.isKey("cloudMAC")) {
-    size_t len = preferences.getBytes("cloudMAC", macAddress, 6);
-    preferences.end();
-    
-    if (len == 6) {
-      Serial.println("✓ Loaded stored Cloud Node MAC:");
-      Serial.print("  ");
-      for (int i = 0; i < 6; i++) {
-        Serial.printf("%02X", macAddress[i]);
-        if (i < 5) Serial.print(":");
-      }
-      Serial.println();
-      return true;
-    }
-  }
-  
-  preferences.end();
-  return false;
+  LOG_I("✓ WiFi credentials saved to NVS");
 }
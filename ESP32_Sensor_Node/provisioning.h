@@ -14,6 +14,7 @@
 #include <BLE2902.h>
 #include <WiFi.h>
 #include <Preferences.h>
+#include "device_storage.h"
 
 // BLE Service and Characteristic UUIDs - Must match frontend
 #define SERVICE_UUID        "0000ff00-0000-1000-8000-00805f9b34fb"
@@ -22,6 +23,7 @@
 #define STATUS_CHAR_UUID    "0000ff03-0000-1000-8000-00805f9b34fb"
 #define DEVICE_INFO_CHAR_UUID "0000ff04-0000-1000-8000-00805f9b34fb"
 #define PROPERTIES_CHAR_UUID "0000ff05-0000-1000-8000-00805f9b34fb"
+#define DEVICE_INFO_TLV_CHAR_UUID "0000ff06-0000-1000-8000-00805f9b34fb"
 
 // Provisioning state
 extern bool provisioningRequested;
@@ -32,17 +34,11 @@ extern BLEServer* pProvisioningServer;
 extern BLECharacteristic* pStatusCharacteristic;
 extern BLECharacteristic* pDeviceInfoCharacteristic;
 extern BLECharacteristic* pPropertiesCharacteristic;
+extern BLECharacteristic* pDeviceInfoTlvCharacteristic;
 
 // Send device info (MAC address, device type, and properties)
 void sendDeviceInfo();
 
-// Property storage functions
-void saveDeviceProperties(float minDist, float maxDist, uint32_t refreshRate, float totalLitres, uint8_t* cloudMAC);
-bool loadDeviceProperties();
-bool hasStoredProperties();
-void saveCloudNodeMAC(uint8_t* macAddress);
-bool loadCloudNodeMAC(uint8_t* macAddress);
-
 // Initialize BLE provisioning service
 void initializeProvisioning();
 
@@ -71,6 +67,6 @@ bool getStoredWiFiCredentials(String& ssid, String& password);
 void saveWiFiCredentials(String ssid, String password);
 
 // Update properties status response
-void updatePropertiesStatus(String status);
+void updatePropertiesStatus(const char* status);
 
 #endif // PROVISIONING_H
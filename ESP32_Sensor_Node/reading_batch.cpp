@@ -0,0 +1,173 @@
+/*
+ * Store-and-Forward Reading Batches Implementation
+ */
+
+#include "reading_batch.h"
+#include "wire_format.h"
+#include <string.h>
+
+static const uint32_t READING_RING_MAGIC = 0x52494E47;  // "RING"
+
+typedef struct ReadingRing {
+  uint32_t magic;
+  uint8_t head;                 // Index of the oldest reading
+  uint8_t count;
+  uint16_t wakesSinceSend;
+  float lastSentLevel;          // Level of the newest reading in the last delivered batch
+  bool hasLastSent;
+  bool hasSequence;             // sequence is taken by the pending batch
+  uint16_t sequence;            // v2 sequence number, reused until the batch is delivered
+  struct_message readings[BATCH_MAX_READINGS];
+} ReadingRing;
+
+// RTC memory ring (survives deep sleep)
+RTC_DATA_ATTR ReadingRing readingRing;
+
+static void ringInit() {
+  if (readingRing.magic == READING_RING_MAGIC) return;
+  memset(&readingRing, 0, sizeof(readingRing));
+  readingRing.magic = READING_RING_MAGIC;
+}
+
+static const struct_message& ringAt(int i) {
+  return readingRing.readings[(readingRing.head + i) % BATCH_MAX_READINGS];
+}
+
+void batchAppend(const struct_message& reading) {
+  ringInit();
+
+  if (readingRing.count == BATCH_MAX_READINGS) {
+    // Full - overwrite the oldest
+    readingRing.head = (readingRing.head + 1) % BATCH_MAX_READINGS;
+    readingRing.count--;
+  }
+  readingRing.readings[(readingRing.head + readingRing.count) % BATCH_MAX_READINGS] = reading;
+  readingRing.count++;
+  readingRing.wakesSinceSend++;
+}
+
+int batchCount() {
+  ringInit();
+  return readingRing.count;
+}
+
+uint8_t batchScheduledReasons(uint64_t nowMs) {
+  ringInit();
+  uint8_t reasons = 0;
+
+  // This wake's reading will be number wakesSinceSend + 1
+  if (readingRing.wakesSinceSend + 1 >= BATCH_SEND_EVERY_WAKES) {
+    reasons |= BATCH_REASON_SCHEDULED;
+  }
+  if (readingRing.count > 0 &&
+      (uint32_t)nowMs - ringAt(0).timestamp >= BATCH_MAX_AGE_S * 1000UL) {
+    reasons |= BATCH_REASON_AGE;
+  }
+  return reasons;
+}
+
+uint8_t batchSendReasons(uint64_t nowMs) {
+  ringInit();
+  if (readingRing.count == 0) return 0;
+
+  uint8_t reasons = 0;
+  if (readingRing.wakesSinceSend >= BATCH_SEND_EVERY_WAKES) {
+    reasons |= BATCH_REASON_SCHEDULED;
+  }
+  if ((uint32_t)nowMs - ringAt(0).timestamp >= BATCH_MAX_AGE_S * 1000UL) {
+    reasons |= BATCH_REASON_AGE;
+  }
+  if (readingRing.count == BATCH_MAX_READINGS) {
+    reasons |= BATCH_REASON_FULL;
+  }
+
+  float latestLevel = ringAt(readingRing.count - 1).level_percent;
+  float reference = readingRing.hasLastSent ? readingRing.lastSentLevel : ringAt(0).level_percent;
+  float delta = latestLevel - reference;
+  if (delta < 0) delta = -delta;
+  if (delta >= BATCH_TRIGGER_LEVEL_DELTA) {
+    reasons |= BATCH_REASON_CHANGE;
+  }
+  return reasons;
+}
+
+size_t batchEncodeFrame(uint8_t* out, size_t capacity, uint64_t nowMs, uint8_t reason) {
+  ringInit();
+
+#if WIRE_FORMAT == WIRE_FORMAT_V2
+  // A retry is the same batch to the gateway, so it keeps its number
+  if (!readingRing.hasSequence) {
+    readingRing.sequence = wireNextSequence();
+    readingRing.hasSequence = true;
+  }
+  WireWriter writer;
+  wireBegin(writer, out, capacity, wireLocalNodeId(), readingRing.sequence, reason);
+  for (int i = 0; i < readingRing.count; i++) {
+    const struct_message& reading = ringAt(i);
+    wireAddReading(writer, reading, ((uint32_t)nowMs - reading.timestamp) / 1000UL);
+  }
+  wireAddNodeTlvs(writer);
+  return wireFinish(writer);
+#else
+  size_t length = sizeof(BatchHeader) + readingRing.count * sizeof(struct_message);
+  if (capacity < length) return 0;
+
+  BatchHeader header;
+  memset(&header, 0, sizeof(header));
+  header.magic = BATCH_FRAME_MAGIC;
+  header.version = BATCH_FRAME_VERSION;
+  header.count = readingRing.count;
+  header.recordSize = sizeof(struct_message);
+  header.reason = reason;
+  header.sentAtMs = (uint32_t)nowMs;
+  memcpy(out, &header, sizeof(header));
+
+  uint8_t* record = out + sizeof(header);
+  for (int i = 0; i < readingRing.count; i++) {
+    memcpy(record, &ringAt(i), sizeof(struct_message));
+    record += sizeof(struct_message);
+  }
+  return length;
+#endif
+}
+
+void batchMarkSent() {
+  ringInit();
+  if (readingRing.count > 0) {
+    readingRing.lastSentLevel = ringAt(readingRing.count - 1).level_percent;
+    readingRing.hasLastSent = true;
+  }
+  readingRing.head = 0;
+  readingRing.count = 0;
+  readingRing.wakesSinceSend = 0;
+  readingRing.hasSequence = false;  // The next batch takes the next number
+}
+
+bool batchDecodeFrame(const uint8_t* frame, size_t length, BatchView& view) {
+  if (length < sizeof(BatchHeader)) return false;
+
+  memcpy(&view.header, frame, sizeof(BatchHeader));
+  if (view.header.magic != BATCH_FRAME_MAGIC || view.header.version != BATCH_FRAME_VERSION) {
+    return false;
+  }
+  if (view.header.recordSize == 0 ||
+      length < sizeof(BatchHeader) + (size_t)view.header.count * view.header.recordSize) {
+    return false;
+  }
+
+  view.records = frame + sizeof(BatchHeader);
+  return true;
+}
+
+bool batchReading(const BatchView& view, int index, struct_message& out) {
+  if (index < 0 || index >= view.header.count) return false;
+
+  size_t copy = view.header.recordSize < sizeof(struct_message) ? view.header.recordSize : sizeof(struct_message);
+  memset(&out, 0, sizeof(out));
+  memcpy(&out, view.records + (size_t)index * view.header.recordSize, copy);
+  return true;
+}
+
+uint32_t batchReadingAgeMs(const BatchView& view, const struct_message& reading) {
+  return view.header.sentAtMs - reading.timestamp;
+}
@@ -0,0 +1,88 @@
+/*
+ * Store-and-Forward Reading Batches
+ *
+ * Readings accumulate in a ring buffer in RTC memory across deep sleeps
+ * and go out as one batched ESP-NOW frame every BATCH_SEND_EVERY_WAKES
+ * wakes, when the oldest reading reaches BATCH_MAX_AGE_S, when the ring
+ * is full, or when the level jumps. The radio stays off in between.
+ *
+ * The frame encoder/decoder has no Arduino dependencies so the gateway
+ * and host tests can use it. Multi-byte fields are little-endian (native
+ * on ESP32 and x86/ARM hosts).
+ */
+
+#ifndef READING_BATCH_H
+#define READING_BATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+#define BATCH_FRAME_MAGIC 0xB7
+#define BATCH_FRAME_VERSION 1
+#define BATCH_FRAME_MAX_LEN 250  // ESP-NOW payload limit
+
+// Why a batch was sent (BatchHeader.reason)
+#define BATCH_REASON_SCHEDULED 0x01  // Every N wakes
+#define BATCH_REASON_AGE       0x02  // Oldest reading hit the age limit
+#define BATCH_REASON_FULL      0x04  // Ring buffer full
+#define BATCH_REASON_CHANGE    0x08  // Level changed past the trigger
+#define BATCH_REASON_HEARTBEAT 0x10  // Report-on-change heartbeat
+#define BATCH_REASON_URGENT    0x20  // Report-on-change urgent delta
+
+typedef struct __attribute__((packed)) BatchHeader {
+  uint8_t magic;        // BATCH_FRAME_MAGIC
+  uint8_t version;      // BATCH_FRAME_VERSION
+  uint8_t count;        // Number of readings that follow
+  uint8_t recordSize;   // sizeof(struct_message) on the node
+  uint8_t reason;       // BATCH_REASON_* flags
+  uint8_t reserved[3];
+  uint32_t sentAtMs;    // Node clock when the frame was built
+} BatchHeader;
+
+// Readings that fit in one frame (and the RTC ring capacity)
+#define BATCH_MAX_READINGS ((BATCH_FRAME_MAX_LEN - sizeof(BatchHeader)) / sizeof(struct_message))
+
+// ----- Node side -----
+
+// Add a reading to the RTC ring (drops the oldest when full)
+void batchAppend(const struct_message& reading);
+
+// Number of buffered readings
+int batchCount();
+
+// Reasons to send before taking this wake's reading (wake count / age),
+// 0 if the radio can stay off. Used to start the radio early.
+uint8_t batchScheduledReasons(uint64_t nowMs);
+
+// All reasons to send now, including the ring filling up and a level jump
+// of the latest buffered reading. 0 if the radio can stay off
+uint8_t batchSendReasons(uint64_t nowMs);
+
+// Build a frame from the buffered readings (v2 frame or v1 batch frame,
+// depending on WIRE_FORMAT). Returns the frame length, 0 if it did not fit.
+// Every encode until batchMarkSent() carries the same v2 sequence number
+size_t batchEncodeFrame(uint8_t* out, size_t capacity, uint64_t nowMs, uint8_t reason);
+
+// Drop the buffered readings after the frame was delivered, and release
+// the batch's sequence number
+void batchMarkSent();
+
+// ----- Gateway side -----
+
+typedef struct BatchView {
+  BatchHeader header;
+  const uint8_t* records;  // Points into the frame
+} BatchView;
+
+// Validate a received frame. Returns false if it is not a batch frame
+bool batchDecodeFrame(const uint8_t* frame, size_t length, BatchView& view);
+
+// Copy reading i (0 = oldest) out of a decoded frame
+// Fields beyond the node's record size are zeroed
+bool batchReading(const BatchView& view, int index, struct_message& out);
+
+// Age of a decoded reading when the frame was sent, in milliseconds
+uint32_t batchReadingAgeMs(const BatchView& view, const struct_message& reading);
+
+#endif // READING_BATCH_H
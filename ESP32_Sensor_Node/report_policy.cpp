@@ -0,0 +1,87 @@
+/*
+ * Report-on-Change Transmit Policy Implementation
+ */
+
+#include "report_policy.h"
+#include <string.h>
+
+static const uint32_t REPORT_STATE_MAGIC = 0x52505431;  // "RPT1"
+
+typedef struct ReportState {
+  uint32_t magic;
+  uint16_t suppressed;          // Wakes dropped since the last reported reading
+  uint16_t reserved;
+  float distanceCm;             // Last reported reading
+  float levelPercent;
+  float batteryV;
+} ReportState;
+
+// RTC memory reference reading (survives deep sleep)
+RTC_DATA_ATTR ReportState reportState;
+
+static bool stateValid() {
+  return reportState.magic == REPORT_STATE_MAGIC;
+}
+
+static float absf(float v) {
+  return v < 0 ? -v : v;
+}
+
+ReportDecision reportEvaluate(const struct_message& reading, const ReportThresholds& thresholds) {
+  if (!stateValid()) {
+    return REPORT_FIRST;
+  }
+
+  float levelDelta = absf(reading.level_percent - reportState.levelPercent);
+  if (levelDelta >= thresholds.urgentLevelPercent) {
+    return REPORT_URGENT;
+  }
+  if (absf(reading.distance_cm - reportState.distanceCm) > thresholds.distanceCm ||
+      levelDelta > thresholds.levelPercent ||
+      absf(reading.battery_v - reportState.batteryV) > thresholds.batteryV) {
+    return REPORT_CHANGE;
+  }
+  if (reportState.suppressed + 1 >= thresholds.heartbeatCycles) {
+    return REPORT_HEARTBEAT;
+  }
+  return REPORT_SUPPRESS;
+}
+
+void reportAccept(const struct_message& reading) {
+  memset(&reportState, 0, sizeof(reportState));
+  reportState.magic = REPORT_STATE_MAGIC;
+  reportState.distanceCm = reading.distance_cm;
+  reportState.levelPercent = reading.level_percent;
+  reportState.batteryV = reading.battery_v;
+}
+
+void reportSuppress() {
+  if (stateValid() && reportState.suppressed < 0xFFFF) {
+    reportState.suppressed++;
+  }
+}
+
+uint16_t reportSuppressedCount() {
+  return stateValid() ? reportState.suppressed : 0;
+}
+
+bool reportForcedThisWake(const ReportThresholds& thresholds) {
+  return !stateValid() || reportState.suppressed + 1 >= thresholds.heartbeatCycles;
+}
+
+bool reportThresholdsValid(const ReportThresholds& thresholds) {
+  return thresholds.distanceCm >= 0 && thresholds.levelPercent >= 0 &&
+         thresholds.batteryV >= 0 && thresholds.urgentLevelPercent > 0 &&
+         thresholds.heartbeatCycles >= 1;
+}
+
+const char* reportDecisionName(ReportDecision decision) {
+  switch (decision) {
+    case REPORT_SUPPRESS:  return "suppressed";
+    case REPORT_FIRST:     return "first";
+    case REPORT_CHANGE:    return "change";
+    case REPORT_URGENT:    return "urgent";
+    case REPORT_HEARTBEAT: return "heartbeat";
+  }
+  return "?";
+}
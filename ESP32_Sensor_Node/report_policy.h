@@ -0,0 +1,60 @@
+/*
+ * Report-on-Change Transmit Policy
+ *
+ * Decides per wake whether a reading is worth the radio. The last
+ * reported reading and the number of suppressed wakes live in RTC
+ * memory. A reading is suppressed while distance, level and battery all
+ * stay inside their deadbands; a heartbeat goes out after
+ * heartbeatCycles suppressed wakes, and a large level move is urgent.
+ *
+ * No Arduino dependencies, so the policy can be exercised on the host.
+ */
+
+#ifndef REPORT_POLICY_H
+#define REPORT_POLICY_H
+
+#include <stdint.h>
+#include "config.h"
+
+typedef struct ReportThresholds {
+  float distanceCm;          // Distance deadband
+  float levelPercent;        // Level deadband
+  float batteryV;            // Battery deadband
+  float urgentLevelPercent;  // Level move that must go out straight away
+  uint16_t heartbeatCycles;  // Suppressed wakes before a heartbeat is forced
+} ReportThresholds;
+
+// Active thresholds (defaults from config.h, updated via the properties JSON)
+extern ReportThresholds reportThresholds;
+
+enum ReportDecision : uint8_t {
+  REPORT_SUPPRESS = 0,  // Inside every deadband - keep the radio off
+  REPORT_FIRST,         // Nothing reported since power-on
+  REPORT_CHANGE,        // Outside a deadband
+  REPORT_URGENT,        // Level moved by urgentLevelPercent or more
+  REPORT_HEARTBEAT      // Suppressed for heartbeatCycles wakes
+};
+
+// Compare a reading against the last reported one
+ReportDecision reportEvaluate(const struct_message& reading, const ReportThresholds& thresholds);
+
+// The reading was handed on for delivery - it becomes the new reference
+void reportAccept(const struct_message& reading);
+
+// The reading was dropped - count it towards the heartbeat
+void reportSuppress();
+
+// Suppressed wakes since the last reported reading
+uint16_t reportSuppressedCount();
+
+// True if this wake's reading goes out regardless of its value
+// (nothing reported yet, or the heartbeat is due). Used to start the radio early.
+bool reportForcedThisWake(const ReportThresholds& thresholds);
+
+// Thresholds are usable (deadbands >= 0, urgent > 0, heartbeat >= 1)
+bool reportThresholdsValid(const ReportThresholds& thresholds);
+
+// Short name for logs
+const char* reportDecisionName(ReportDecision decision);
+
+#endif // REPORT_POLICY_H
@@ -3,6 +3,15 @@
  */
 
 #include "sensor.h"
+#include "profiler.h"
+#include "echo_capture.h"
+#include "energy.h"
+#include "node_log.h"
+#include "distance_filter.h"
+#include "measure_math.h"
+#include "level_estimator.h"
+#include "node_clock.h"
+#include "battery.h"
 
 static float clampf(float v, float lo, float hi) {
   if (v < lo) return lo;
@@ -10,98 +19,254 @@ static float clampf(float v, float lo, float hi) {
   return v;
 }
 
-float readDistanceCm() {
+// Distances inside the measurement path (measure_math.h); the public
+// functions take and return float cm
+#if ENABLE_FIXED_POINT
+typedef q16_t Sample;
+static inline Sample sampleFromEcho(uint32_t durationUs) { return echoDistanceQ16(durationUs); }
+static inline bool sampleInRange(Sample d) { return distanceInRangeQ16(d); }
+static inline Sample sampleFromCm(float cm) { return q16FromFloat(cm); }
+static inline float sampleToCm(Sample d) { return SampleMath<Sample>::valid(d) ? q16ToFloat(d) : NAN; }
+#else
+typedef float Sample;
+static inline Sample sampleFromEcho(uint32_t durationUs) { return echoDistanceCm(durationUs); }
+static inline bool sampleInRange(Sample d) { return distanceInRange(d); }
+static inline Sample sampleFromCm(float cm) { return cm; }
+static inline float sampleToCm(Sample d) { return d; }
+#endif
+
+static void sensorPowerOn() {
   // Power on the sensor via NPN transistor
-  pinMode(SENSOR_POWER_PIN, OUTPUT);
-  digitalWrite(SENSOR_POWER_PIN, HIGH);
-  delay(50);  // Allow sensor to stabilize
-  
-  pinMode(TRIG_PIN, OUTPUT);
-  pinMode(ECHO_PIN, INPUT);
-  
-  digitalWrite(TRIG_PIN, LOW);
-  delayMicroseconds(2);
-
-  digitalWrite(TRIG_PIN, HIGH);
-  delayMicroseconds(10);
-  digitalWrite(TRIG_PIN, LOW);
-
-  unsigned long durationUs = pulseIn(ECHO_PIN, HIGH, 30000UL);
+  halPinOutput(SENSOR_POWER_PIN);
+  halPinWrite(SENSOR_POWER_PIN, true);
+  energyBegin(POWER_SENSOR);
+  delay(SENSOR_STABILIZE_MS);  // Allow sensor to stabilize
+
+  halPinOutput(TRIG_PIN);
+  halPinInput(ECHO_PIN);
+#if SENSOR_ECHO_BACKEND == ECHO_BACKEND_INTERRUPT
+  echoCaptureBegin();
+#endif
+}
+
+static void sensorPowerOff() {
+#if SENSOR_ECHO_BACKEND == ECHO_BACKEND_INTERRUPT
+  echoCaptureEnd();
+#endif
+  halPinWrite(SENSOR_POWER_PIN, false);
+  energyEnd(POWER_SENSOR);
+}
+
+// Fire one ping on an already powered sensor
+static Sample pingOnce(unsigned long timeoutUs) {
+#if SENSOR_ECHO_BACKEND == ECHO_BACKEND_INTERRUPT
+  // The reading needs nothing from the CPU until the echo is back, so
+  // await right away: echoAwait() blocks the task rather than spinning,
+  // which hands the flight time to the wake pipeline's radio task
+  uint32_t durationUs = 0;
+  echoStartPing(timeoutUs);
+  if (echoAwait(&durationUs) != ECHO_DONE) {
+    return SampleMath<Sample>::invalid();
+  }
+#else
+  uint32_t durationUs = halPingEchoUs(TRIG_PIN, ECHO_PIN, timeoutUs);
   if (durationUs == 0) {
-    return NAN;
+    return SampleMath<Sample>::invalid();
   }
+#endif
 
-  float distance = (durationUs * speedOfSoundCmPerUs) / 2.0f;
+  Sample distance = sampleFromEcho(durationUs);
 
-  // SR04M-2 range: 20cm to 620cm
-  if (distance < 20.0f || distance > 620.0f) {
-    digitalWrite(SENSOR_POWER_PIN, LOW);  // Power off sensor
-    return NAN;
+  if (!sampleInRange(distance)) {
+    return SampleMath<Sample>::invalid();
   }
 
-  digitalWrite(SENSOR_POWER_PIN, LOW);  // Power off sensor
   return distance;
 }
 
-float readSmoothedDistanceCm() {
-  float vals[samplesPerUpdate];
+unsigned long echoTimeoutUs() {
+  float rangeCm = emptyDistanceCm * ECHO_RANGE_MARGIN;
+  if (!(rangeCm >= SENSOR_MIN_RANGE_CM)) return PER_PING_ECHO_TIMEOUT_US;  // Also catches NAN
+  if (rangeCm > SENSOR_MAX_RANGE_CM) rangeCm = SENSOR_MAX_RANGE_CM;
+
+  return (unsigned long)((2.0f * rangeCm) / speedOfSoundCmPerUs);
+}
+
+unsigned long pingIntervalMs() {
+  unsigned long intervalMs = (unsigned long)(echoTimeoutUs() * ECHO_DECAY_FACTOR / 1000.0f);
+  return intervalMs < ECHO_DECAY_MIN_MS ? ECHO_DECAY_MIN_MS : intervalMs;
+}
+
+// One power-cycled ping (per-ping acquisition)
+static Sample readSinglePing() {
+  sensorPowerOn();
+  Sample distance = pingOnce(PER_PING_ECHO_TIMEOUT_US);
+  sensorPowerOff();
+  return distance;
+}
+
+float readDistanceCm() {
+  return sampleToCm(readSinglePing());
+}
+
+static int readBurst(Sample* out, int count) {
+  unsigned long timeoutUs = echoTimeoutUs();
+  unsigned long intervalMs = pingIntervalMs();
+  int good = 0;
+
+  sensorPowerOn();
+  for (int i = 0; i < count; i++) {
+    if (i > 0) delay(intervalMs);  // Let the previous echo decay
+    Sample d = pingOnce(timeoutUs);
+    if (SampleMath<Sample>::valid(d)) {
+      out[good++] = d;
+    }
+  }
+  sensorPowerOff();
+
+  return good;
+}
+
+int readDistanceBurstCm(float* out, int count) {
+  Sample vals[samplesPerUpdate];
+  if (count > samplesPerUpdate) count = samplesPerUpdate;
+  int good = readBurst(vals, count);
+  for (int i = 0; i < good; i++) out[i] = sampleToCm(vals[i]);
+  return good;
+}
+
+// Spread (max - min) of the samples
+static Sample sampleRange(const Sample* vals, int good) {
+  Sample lo = vals[0];
+  Sample hi = vals[0];
+  for (int i = 1; i < good; i++) {
+    if (vals[i] < lo) lo = vals[i];
+    if (vals[i] > hi) hi = vals[i];
+  }
+  return hi - lo;
+}
+
+float readAdaptiveDistanceCm(int* samplesUsed) {
+  const Sample tolerance = sampleFromCm(adaptiveToleranceCm);
+  Sample vals[adaptiveMaxSamples];
   int good = 0;
+  int taken = 0;
+  bool converged = false;
+
+  // The power governor may allow fewer pings than usual
+  int maxSamples = governorSampleLimit();
+  if (maxSamples > adaptiveMaxSamples) maxSamples = adaptiveMaxSamples;
+  int minSamples = adaptiveMinSamples < maxSamples ? adaptiveMinSamples : maxSamples;
 
-  for (int i = 0; i < samplesPerUpdate; i++) {
-    float d = readDistanceCm();
-    if (!isnan(d)) {
+#if SENSOR_ACQUISITION_MODE == SENSOR_ACQ_BURST
+  unsigned long timeoutUs = echoTimeoutUs();
+  unsigned long intervalMs = pingIntervalMs();
+  sensorPowerOn();
+#endif
+
+  while (taken < maxSamples) {
+#if SENSOR_ACQUISITION_MODE == SENSOR_ACQ_BURST
+    if (taken > 0) delay(intervalMs);  // Let the previous echo decay
+    Sample d = pingOnce(timeoutUs);
+#else
+    if (taken > 0) delay(PER_PING_INTERVAL_MS);
+    Sample d = readSinglePing();
+#endif
+    taken++;
+
+    if (SampleMath<Sample>::valid(d)) {
       vals[good++] = d;
     }
-    delay(120);
+
+    if (good >= minSamples && sampleRange(vals, good) <= tolerance) {
+      converged = true;
+      break;
+    }
   }
 
+#if SENSOR_ACQUISITION_MODE == SENSOR_ACQ_BURST
+  sensorPowerOff();
+#endif
+
+  if (samplesUsed != nullptr) *samplesUsed = taken;
   if (good == 0) return NAN;
 
-  // Simple sort
-  for (int i = 0; i < good - 1; i++) {
-    for (int j = i + 1; j < good; j++) {
-      if (vals[j] < vals[i]) {
-        float t = vals[i];
-        vals[i] = vals[j];
-        vals[j] = t;
-      }
+  if (converged) {
+    // Samples agree - plain mean is as good as the trimmed one
+    Sample sum = 0;
+    for (int i = 0; i < good; i++) sum += vals[i];
+    return sampleToCm(SampleMath<Sample>::mean(sum, good));
+  }
+
+  // Noisy - fall back to the filter chain over everything we took
+  return sampleToCm(DistanceFilterChain::run(vals, good));
+}
+
+// One full reading: adaptive sampler or a fixed burst through the filter chain
+static float readFullDistanceCm() {
+#if ENABLE_ADAPTIVE_SAMPLING
+  int samplesUsed = 0;
+  float distance = readAdaptiveDistanceCm(&samplesUsed);
+  LOG_I("Distance from %d of max %d samples", samplesUsed, governorSampleLimit());
+  return distance;
+#else
+  Sample vals[samplesPerUpdate];
+  int good = 0;
+  int count = governorSampleLimit();
+
+#if SENSOR_ACQUISITION_MODE == SENSOR_ACQ_BURST
+  good = readBurst(vals, count);
+#else
+  for (int i = 0; i < count; i++) {
+    Sample d = readSinglePing();
+    if (SampleMath<Sample>::valid(d)) {
+      vals[good++] = d;
     }
+    delay(PER_PING_INTERVAL_MS);
   }
+#endif
 
-  // Trim extremes if enough values
-  int start = 0;
-  int end = good - 1;
-  if (good >= 5) {
-    start = 1;
-    end = good - 2;
+  return sampleToCm(DistanceFilterChain::run(vals, good));  // NAN if good is 0
+#endif
+}
+
+#if ENABLE_LEVEL_ESTIMATOR
+// A few pings fused with the cross-wake prediction; the full reading only
+// without a usable prediction or when the pings disagree with it
+static float readEstimatedDistanceCm() {
+  uint64_t nowMs = nodeClockMs();
+  bool fused = false;
+
+  if (levelEstimatorCanPredict(nowMs)) {
+    float pings[LEVEL_ESTIMATOR_PINGS];
+    int count = governorSampleLimit() < LEVEL_ESTIMATOR_PINGS ? governorSampleLimit() : LEVEL_ESTIMATOR_PINGS;
+    int good = readDistanceBurstCm(pings, count);
+    fused = levelEstimatorFusePings(pings, good, nowMs);
+    if (!fused) {
+      LOG_I("Estimator: %d of %d pings valid, outside the gate - full reading", good, count);
+    }
   }
 
-  float sum = 0;
-  int count = 0;
-  for (int i = start; i <= end; i++) {
-    sum += vals[i];
-    count++;
+  if (!fused) {
+    float distance = readFullDistanceCm();
+    if (isnan(distance)) return NAN;
+    levelEstimatorFuseReading(distance, nodeClockMs());
   }
 
-  return sum / (float)count;
+  LevelEstimate estimate = levelEstimatorCurrent();
+  LOG_I("Estimate %.2f cm +- %.2f (confidence %.0f %%, rate %.2f cm/h) - %lu quick, %lu full wakes",
+        estimate.distanceCm, estimate.sigmaCm, estimate.confidence * 100.0f, estimate.rateCmPerHour,
+        (unsigned long)levelEstimatorQuickCount(), (unsigned long)levelEstimatorFullCount());
+  return estimate.distanceCm;
 }
+#endif
+
+float readSmoothedDistanceCm() {
+  PROFILE_SCOPE(PHASE_SENSOR);
 
-float readBatteryVoltage() {
-  // ESP32-C3 ADC is 12-bit (0-4095) with default 3.3V reference
-  // Set ADC attenuation to 11dB for 0-3.3V range
-  analogSetAttenuation(ADC_11db);
-  
-  int adcValue = analogRead(BATTERY_VOLTAGE_PIN);
-  
-  Serial.print("ADC Raw Value: "); Serial.println(adcValue);
-  
-  // Convert ADC reading to voltage (3.3V reference, 12-bit ADC)
-  float voltageAtPin = (adcValue / 4095.0f) * 3.3f;
-  
-  Serial.print("Voltage at Pin: "); Serial.print(voltageAtPin, 3); Serial.println("V");
-  
-  // Calculate actual battery voltage using voltage divider ratio
-  float batteryVoltage = voltageAtPin * VOLTAGE_DIVIDER_RATIO;
-  
-  return batteryVoltage;
+#if ENABLE_LEVEL_ESTIMATOR
+  return readEstimatedDistanceCm();
+#else
+  return readFullDistanceCm();
+#endif
 }
@@ -7,18 +7,37 @@
 #ifndef SENSOR_H
 #define SENSOR_H
 
-#include <Arduino.h>
+#include "hal.h"
 #include "config.h"
 
 // Returns distance in cm, or NAN if timeout / invalid
 // Standard trigger/echo mode - works with SR04M-2 RX/TX pins
 float readDistanceCm();
 
-// Take multiple samples and return median-ish (trimmed mean)
-float readSmoothedDistanceCm();
+// Power the sensor up once, fire count (at most samplesPerUpdate) pings
+// spaced by pingIntervalMs() and power it down again. Valid distances are
+// written to out. Returns the number of valid readings
+int readDistanceBurstCm(float* out, int count);
+
+// Echo timeout for burst pings, derived from emptyDistanceCm
+unsigned long echoTimeoutUs();
+
+// Minimum spacing between burst pings so the previous echo has decayed
+unsigned long pingIntervalMs();
 
-// Read battery voltage from voltage divider on ADC pin
-float readBatteryVoltage();
+// Ping until the samples agree within adaptiveToleranceCm (between
+// adaptiveMinSamples and adaptiveMaxSamples pings, fewer if the power
+// governor says so - battery.h). Falls back to the
+// filter chain (DISTANCE_FILTER) when they never agree. samplesUsed (optional) receives the
+// number of pings fired. Returns NAN if no ping was valid
+float readAdaptiveDistanceCm(int* samplesUsed);
+
+// Take multiple samples and reduce them with the DISTANCE_FILTER chain
+// Uses the burst or per-ping path depending on SENSOR_ACQUISITION_MODE,
+// and the adaptive sampler when ENABLE_ADAPTIVE_SAMPLING is set. With
+// ENABLE_LEVEL_ESTIMATOR, returns the cross-wake estimate instead and
+// takes multiple samples only when a few pings do not fit its prediction
+float readSmoothedDistanceCm();
 
 // Helper function to clamp values
 static float clampf(float v, float lo, float hi);
@@ -0,0 +1,219 @@
+/*
+ * Device Info Test
+ *
+ * Checks the device info encoders in device_info.cpp, the way the BLE
+ * frontend sees their output. Exits 1 if any case fails.
+ *
+ * Cases:
+ *   tlv round trip  typical info written and read back: 65 bytes, every
+ *                   field equal after quantisation
+ *   tlv clamp       out-of-range numbers come back at their field limits
+ *   tlv length      a buffer of exactly the TLV length works, one byte
+ *                   less returns 0
+ *   tlv reject      wrong magic or a TLV running past the end is refused;
+ *                   an unknown TLV is skipped
+ *   json exact      typical info (292 bytes) fits a buffer of its length
+ *                   plus the NUL, and one byte less returns 0
+ *   json limits     numbers at their clamp limits give the longest JSON
+ *                   (360 bytes); numbers past them give the same text
+ *   notify fit      payload sizes against ATT MTUs
+ *
+ * The device_info_test target of CMakeLists.txt (see README.md, "Host Simulation").
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "device_info.h"
+
+static const size_t TYPICAL_TLV_LEN = 65;
+static const size_t TYPICAL_JSON_LEN = 292;
+static const size_t LONGEST_JSON_LEN = 360;
+static const float NUMBER_LIMIT = 999999999.0f;  // DEVICE_INFO_NUMBER_LIMIT in device_info.cpp
+
+static int failures = 0;
+
+static void expect(const char* name, bool ok, const char* what) {
+  if (!ok) {
+    printf("FAIL %-15s %s\n", name, what);
+    failures++;
+  }
+}
+
+static bool near(float a, float b, float tolerance) {
+  float d = a - b;
+  return d <= tolerance && d >= -tolerance;
+}
+
+static DeviceInfo typicalInfo() {
+  DeviceInfo info = {
+    {0x24, 0x6F, 0x28, 0xA1, 0xB2, 0xC3},
+    {0x0C, 0x4E, 0xA0, 0x4D, 0x54, 0x8C},
+    20.0f, 120.0f, 300, 900.0f,
+    {1.0f, 1.0f, 0.05f, 5.0f, 12},
+  };
+  return info;
+}
+
+// Every field different from typicalInfo(), so a missed TLV shows
+static DeviceInfo blankInfo() {
+  DeviceInfo info;
+  memset(&info, 0xEE, sizeof(info));
+  info.minDistance = info.maxDistance = info.totalLitres = -1.0f;
+  info.thresholds.distanceCm = info.thresholds.levelPercent = -1.0f;
+  info.thresholds.batteryV = info.thresholds.urgentLevelPercent = -1.0f;
+  return info;
+}
+
+static bool sameInfo(const DeviceInfo& a, const DeviceInfo& b) {
+  return memcmp(a.mac, b.mac, 6) == 0 && memcmp(a.cloudNodeMAC, b.cloudNodeMAC, 6) == 0 &&
+         near(a.minDistance, b.minDistance, 0.05f) && near(a.maxDistance, b.maxDistance, 0.05f) &&
+         a.refreshRate == b.refreshRate && near(a.totalLitres, b.totalLitres, 0.05f) &&
+         near(a.thresholds.distanceCm, b.thresholds.distanceCm, 0.05f) &&
+         near(a.thresholds.levelPercent, b.thresholds.levelPercent, 0.05f) &&
+         near(a.thresholds.batteryV, b.thresholds.batteryV, 0.0005f) &&
+         near(a.thresholds.urgentLevelPercent, b.thresholds.urgentLevelPercent, 0.05f) &&
+         a.thresholds.heartbeatCycles == b.thresholds.heartbeatCycles;
+}
+
+static void testTlvRoundTrip() {
+  DeviceInfo info = typicalInfo();
+  uint8_t tlv[DEVICE_INFO_TLV_MAX_LEN];
+  size_t length = deviceInfoWriteTlv(info, tlv, sizeof(tlv));
+  expect("tlv round trip", length == TYPICAL_TLV_LEN, "65 bytes");
+  expect("tlv round trip", tlv[0] == DEVICE_INFO_MAGIC && tlv[1] == DEVICE_INFO_VERSION, "header");
+
+  DeviceInfo back = blankInfo();
+  expect("tlv round trip", deviceInfoReadTlv(tlv, length, back), "accepted");
+  expect("tlv round trip", sameInfo(info, back), "fields equal");
+  printf("%-15s %u bytes\n", "tlv round trip", (unsigned)length);
+}
+
+static void testTlvClamp() {
+  DeviceInfo info = typicalInfo();
+  info.minDistance = -5.0f;
+  info.maxDistance = 1e9f;
+  info.totalLitres = 1e12f;
+  info.thresholds.batteryV = 100.0f;
+  info.thresholds.levelPercent = NAN;
+  info.refreshRate = 0xFFFFFFFF;
+  info.thresholds.heartbeatCycles = 0xFFFF;
+
+  uint8_t tlv[DEVICE_INFO_TLV_MAX_LEN];
+  size_t length = deviceInfoWriteTlv(info, tlv, sizeof(tlv));
+  DeviceInfo back = blankInfo();
+  expect("tlv clamp", length == TYPICAL_TLV_LEN && deviceInfoReadTlv(tlv, length, back), "written and read");
+  expect("tlv clamp", back.minDistance == 0.0f, "negative distance reads 0");
+  expect("tlv clamp", near(back.maxDistance, 6553.5f, 0.01f), "distance clamps to 6553.5 cm");
+  expect("tlv clamp", near(back.totalLitres, 429496729.5f, 64.0f), "litres clamp to u32 decilitres");
+  expect("tlv clamp", near(back.thresholds.batteryV, 65.535f, 0.0005f), "battery clamps to 65.535 V");
+  expect("tlv clamp", back.thresholds.levelPercent == 0.0f, "NaN reads 0");
+  expect("tlv clamp", back.refreshRate == 0xFFFFFFFF && back.thresholds.heartbeatCycles == 0xFFFF,
+         "integers unchanged");
+  printf("%-15s ok\n", "tlv clamp");
+}
+
+static void testTlvLength() {
+  DeviceInfo info = typicalInfo();
+  uint8_t tlv[DEVICE_INFO_TLV_MAX_LEN];
+  expect("tlv length", deviceInfoWriteTlv(info, tlv, TYPICAL_TLV_LEN) == TYPICAL_TLV_LEN, "exact buffer");
+  expect("tlv length", deviceInfoWriteTlv(info, tlv, TYPICAL_TLV_LEN - 1) == 0, "one byte short");
+  expect("tlv length", deviceInfoWriteTlv(info, tlv, 1) == 0, "no room for the header");
+  printf("%-15s ok\n", "tlv length");
+}
+
+static void testTlvReject() {
+  DeviceInfo info = typicalInfo();
+  uint8_t tlv[DEVICE_INFO_TLV_MAX_LEN + 5];
+  size_t length = deviceInfoWriteTlv(info, tlv, DEVICE_INFO_TLV_MAX_LEN);
+  DeviceInfo back = blankInfo();
+
+  expect("tlv reject", !deviceInfoReadTlv(tlv, 1, back), "too short");
+  expect("tlv reject", !deviceInfoReadTlv(tlv, length - 1, back), "last TLV runs past the end");
+  tlv[0] ^= 0xFF;
+  expect("tlv reject", !deviceInfoReadTlv(tlv, length, back), "wrong magic");
+  tlv[0] ^= 0xFF;
+
+  // A newer writer's field: 3 bytes of an unknown type
+  const uint8_t unknown[5] = {0x7F, 3, 1, 2, 3};
+  memcpy(tlv + length, unknown, sizeof(unknown));
+  back = blankInfo();
+  expect("tlv reject", deviceInfoReadTlv(tlv, length + sizeof(unknown), back) && sameInfo(info, back),
+         "unknown TLV skipped");
+  printf("%-15s ok\n", "tlv reject");
+}
+
+static void testJsonExact() {
+  DeviceInfo info = typicalInfo();
+  char json[DEVICE_INFO_JSON_MAX_LEN];
+  size_t length = deviceInfoWriteJson(info, json, sizeof(json));
+  expect("json exact", length == TYPICAL_JSON_LEN && strlen(json) == length, "292 bytes");
+  expect("json exact", strstr(json, "\"deadbandBattery\":0.05,") != nullptr, "two decimals");
+  expect("json exact", strstr(json, "\"cloudNodeMAC\":\"0C:4E:A0:4D:54:8C\"}}") != nullptr, "ends with MAC");
+
+  char exact[TYPICAL_JSON_LEN + 1];
+  expect("json exact", deviceInfoWriteJson(info, exact, sizeof(exact)) == length &&
+                       strcmp(exact, json) == 0, "fits its length plus the NUL");
+  char shortBuffer[TYPICAL_JSON_LEN];
+  expect("json exact", deviceInfoWriteJson(info, shortBuffer, sizeof(shortBuffer)) == 0 &&
+                       shortBuffer[0] == '\0', "one byte short gives empty string");
+  expect("json exact", deviceInfoWriteJson(info, shortBuffer, 0) == 0, "no buffer");
+  printf("%-15s %u bytes\n", "json exact", (unsigned)length);
+}
+
+static void testJsonLimits() {
+  // The longest text: negative numbers at the limit, largest integers
+  DeviceInfo info = typicalInfo();
+  info.minDistance = info.maxDistance = info.totalLitres = -NUMBER_LIMIT;
+  info.thresholds.distanceCm = info.thresholds.levelPercent = -NUMBER_LIMIT;
+  info.thresholds.batteryV = info.thresholds.urgentLevelPercent = -NUMBER_LIMIT;
+  info.refreshRate = 0xFFFFFFFF;
+  info.thresholds.heartbeatCycles = 0xFFFF;
+
+  char json[DEVICE_INFO_JSON_MAX_LEN];
+  size_t length = deviceInfoWriteJson(info, json, sizeof(json));
+  expect("json limits", length == LONGEST_JSON_LEN, "360 bytes");
+  expect("json limits", length + DEVICE_INFO_ATT_HEADER_LEN <= BLE_MTU, "fits one notify at BLE_MTU");
+  expect("json limits", strstr(json, "\"minDistance\":-999999999.0,") != nullptr, "clamped value");
+
+  char exact[LONGEST_JSON_LEN + 1];
+  expect("json limits", deviceInfoWriteJson(info, exact, sizeof(exact)) == length, "fits its length plus the NUL");
+  expect("json limits", deviceInfoWriteJson(info, exact, LONGEST_JSON_LEN) == 0, "one byte short");
+
+  // Past the limit the text stops growing
+  DeviceInfo beyond = info;
+  beyond.minDistance = beyond.maxDistance = beyond.totalLitres = -1e30f;
+  beyond.thresholds.distanceCm = beyond.thresholds.levelPercent = -1e30f;
+  beyond.thresholds.batteryV = beyond.thresholds.urgentLevelPercent = -INFINITY;
+  char clamped[DEVICE_INFO_JSON_MAX_LEN];
+  expect("json limits", deviceInfoWriteJson(beyond, clamped, sizeof(clamped)) == length &&
+                        strcmp(clamped, json) == 0, "past the limit gives the same text");
+  printf("%-15s %u bytes\n", "json limits", (unsigned)length);
+}
+
+static void testNotifyFit() {
+  expect("notify fit", deviceInfoFitsNotify(20, 23), "20 bytes at the default MTU");
+  expect("notify fit", !deviceInfoFitsNotify(21, 23), "21 bytes at the default MTU");
+  expect("notify fit", !deviceInfoFitsNotify(TYPICAL_TLV_LEN, 23), "TLV at the default MTU");
+  expect("notify fit", deviceInfoFitsNotify(TYPICAL_TLV_LEN, TYPICAL_TLV_LEN + 3), "TLV at 68");
+  expect("notify fit", deviceInfoFitsNotify(LONGEST_JSON_LEN, BLE_MTU), "longest JSON at BLE_MTU");
+  expect("notify fit", !deviceInfoFitsNotify(0, 0) && !deviceInfoFitsNotify(0, 3), "MTU with no payload room");
+  printf("%-15s ok\n", "notify fit");
+}
+
+int main() {
+  testTlvRoundTrip();
+  testTlvClamp();
+  testTlvLength();
+  testTlvReject();
+  testJsonExact();
+  testJsonLimits();
+  testNotifyFit();
+
+  if (failures > 0) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("All device info checks passed\n");
+  return 0;
+}
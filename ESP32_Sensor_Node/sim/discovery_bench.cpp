@@ -0,0 +1,224 @@
+/*
+ * Channel Discovery Benchmark
+ *
+ * Drives discoverChannel() (channel_discovery.h) against a simulated
+ * Cloud Node that hops between WiFi channels, next to the linear scan it
+ * replaced, and reports probes and time per rescan: median, 95th
+ * percentile and worst. A rescan is a wake whose cached channel went
+ * stale because the gateway moved; wakes where it stayed put cost one
+ * send on either side and only feed the score table, as normal sends do
+ * on the node.
+ *
+ * Probe model: every send gets its callback ACK_LATENCY_US later, acked
+ * only on the gateway's channel and then lost with --loss. The linear
+ * scan is the one from before the score table: the saved channel first,
+ * then 1, 6, 11, 2, 3, ...; two attempts per channel with 200 ms after
+ * each miss. The ranked scan probes in score order (last channel on top),
+ * once per channel, DISCOVERY_PASSES passes, ending each probe at the
+ * callback.
+ *
+ * Gateway schedules (--wakes wakes, the gateway moves before a wake):
+ *   flip 1/11     alternates between 1 and 11 every 20 wakes
+ *   hop 1/6/11    5 % of wakes: another of 1, 6, 11
+ *   hop 4/9/13    5 % of wakes: another of 4, 9, 13 (off the prior order)
+ *   roam          5 % of wakes: any other channel
+ *   lossy hop     hop 1/6/11 with 20 % of acked probes lost
+ *
+ * The discovery_bench target of CMakeLists.txt (see README.md, "Channel Management").
+ *
+ * Usage: discovery_bench [--wakes N] [--loss P] [--seed S]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "channel_discovery.h"
+
+static const uint32_t ACK_LATENCY_US = 2000;        // Same as the single-node sim
+static const uint32_t LINEAR_RETRY_DELAY_US = 200000;
+static const int LINEAR_ATTEMPTS = 2;
+static const uint8_t LINEAR_ORDER[DISCOVERY_CHANNELS] = {1, 6, 11, 2, 3, 4, 5, 7, 8, 9, 10, 12, 13};
+
+// The simulated radio: where the gateway is, and what the probes cost
+typedef struct Medium {
+  int gatewayChannel;
+  float loss;
+  std::mt19937* rng;
+  uint32_t probes;
+  uint64_t elapsedUs;
+} Medium;
+
+static Medium medium;
+
+static bool mediumSend(int channel) {
+  medium.probes++;
+  medium.elapsedUs += ACK_LATENCY_US;
+  if (channel != medium.gatewayChannel) return false;
+  return std::uniform_real_distribution<float>(0.0f, 1.0f)(*medium.rng) >= medium.loss;
+}
+
+static bool rankedProbe(int channel, uint32_t ackTimeoutUs, uint32_t* ackUs) {
+  bool acked = mediumSend(channel);
+  if (ackUs != nullptr) *ackUs = ACK_LATENCY_US < ackTimeoutUs ? ACK_LATENCY_US : ackTimeoutUs;
+  return acked;
+}
+
+// The scan from before the score table (saved channel, then the fixed order)
+static int linearScan(int savedChannel) {
+  for (int i = -1; i < DISCOVERY_CHANNELS; i++) {
+    int channel = i < 0 ? savedChannel : LINEAR_ORDER[i];
+    if (channel <= 0 || (i >= 0 && channel == savedChannel)) continue;
+    for (int attempt = 0; attempt < LINEAR_ATTEMPTS; attempt++) {
+      if (mediumSend(channel)) return channel;
+      medium.elapsedUs += LINEAR_RETRY_DELAY_US;
+    }
+  }
+  return 0;
+}
+
+enum Schedule { FLIP_1_11 = 0, HOP_COMMON, HOP_UNCOMMON, ROAM, LOSSY_HOP, SCHEDULE_COUNT };
+
+static const char* const SCHEDULE_NAMES[SCHEDULE_COUNT] = {
+  "flip 1/11", "hop 1/6/11", "hop 4/9/13", "roam", "lossy hop"
+};
+
+// Gateway channel for wake w, given where it was
+static int nextChannel(Schedule schedule, int wake, int current, std::mt19937& rng) {
+  static const int COMMON[3] = {1, 6, 11};
+  static const int UNCOMMON[3] = {4, 9, 13};
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+  switch (schedule) {
+    case FLIP_1_11:
+      return (wake / 20) % 2 == 0 ? 1 : 11;
+    case HOP_COMMON:
+    case LOSSY_HOP:
+    case HOP_UNCOMMON: {
+      const int* set = schedule == HOP_UNCOMMON ? UNCOMMON : COMMON;
+      if (wake > 0 && unit(rng) >= 0.05f) return current;
+      int next = current;
+      while (next == current) next = set[rng() % 3];
+      return next;
+    }
+    case ROAM: {
+      if (wake > 0 && unit(rng) >= 0.05f) return current;
+      int next = current;
+      while (next == current) next = 1 + (int)(rng() % DISCOVERY_CHANNELS);
+      return next;
+    }
+    default:
+      return current;
+  }
+}
+
+typedef struct ScanCost {
+  uint32_t probes;
+  double ms;
+} ScanCost;
+
+typedef struct Side {
+  std::vector<ScanCost> rescans;
+  int cachedChannel;
+  int failed;
+} Side;
+
+static void printSide(const char* name, Side& side) {
+  std::vector<uint32_t> probes;
+  std::vector<double> ms;
+  for (const ScanCost& cost : side.rescans) {
+    probes.push_back(cost.probes);
+    ms.push_back(cost.ms);
+  }
+  if (probes.empty()) {
+    printf("  %-8s no rescans\n", name);
+    return;
+  }
+  std::sort(probes.begin(), probes.end());
+  std::sort(ms.begin(), ms.end());
+  size_t n = probes.size();
+  printf("  %-8s %7zu %7u %7u %7u %9.1f %9.1f %9.1f %7d\n", name, n, probes[n / 2], probes[n * 95 / 100],
+         probes.back(), ms[n / 2], ms[n * 95 / 100], ms.back(), side.failed);
+}
+
+static void runSchedule(Schedule schedule, int wakes, float loss, uint32_t seed) {
+  // Same gateway path and loss pattern for both scans
+  std::mt19937 pathRng(seed);
+  std::vector<int> path(wakes);
+  int channel = 0;
+  for (int w = 0; w < wakes; w++) {
+    channel = nextChannel(schedule, w, channel, pathRng);
+    path[w] = channel;
+  }
+  float scheduleLoss = schedule == LOSSY_HOP ? 0.2f : loss;
+
+  Side linear = {{}, 0, 0};
+  Side ranked = {{}, 0, 0};
+  DiscoveryTable table;
+  memset(&table, 0, sizeof(table));
+  discoveryInit(table);
+
+  for (int pass = 0; pass < 2; pass++) {
+    Side& side = pass == 0 ? linear : ranked;
+    std::mt19937 lossRng(seed * 7919u + 1);
+    medium.rng = &lossRng;
+    medium.loss = scheduleLoss;
+
+    for (int w = 0; w < wakes; w++) {
+      medium.gatewayChannel = path[w];
+      medium.probes = 0;
+      medium.elapsedUs = 0;
+
+      // A normal send on the cached channel; only a miss starts a rescan
+      if (side.cachedChannel > 0 && mediumSend(side.cachedChannel)) {
+        if (pass == 1) discoveryRecord(table, side.cachedChannel, true, ACK_LATENCY_US);
+        continue;
+      }
+      if (pass == 1 && side.cachedChannel > 0) discoveryRecord(table, side.cachedChannel, false, 0);
+
+      int found = pass == 0 ? linearScan(side.cachedChannel)
+                            : discoverChannel(table, side.cachedChannel, rankedProbe);
+      if (found > 0) {
+        side.cachedChannel = found;
+      } else {
+        side.failed++;
+      }
+      ScanCost cost = { medium.probes, medium.elapsedUs / 1000.0 };
+      side.rescans.push_back(cost);
+    }
+  }
+
+  printf("\n%s (%d wakes, %.0f %% loss)\n", SCHEDULE_NAMES[schedule], wakes, 100.0f * scheduleLoss);
+  printf("  %-8s %7s %7s %7s %7s %9s %9s %9s %7s\n", "scan", "rescans", "probes", "p95", "worst",
+         "median ms", "p95 ms", "worst ms", "failed");
+  printSide("linear", linear);
+  printSide("ranked", ranked);
+}
+
+int main(int argc, char** argv) {
+  int wakes = 5000;
+  float loss = 0.0f;
+  uint32_t seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--wakes") == 0 && i + 1 < argc) {
+      wakes = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+      loss = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else {
+      fprintf(stderr, "Usage: %s [--wakes N] [--loss P] [--seed S]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (wakes < 1) wakes = 1;
+
+  printf("Ack latency %.1f ms; linear: %d attempts per channel, %u ms after a miss; ranked: %d passes\n",
+         ACK_LATENCY_US / 1000.0, LINEAR_ATTEMPTS, LINEAR_RETRY_DELAY_US / 1000, DISCOVERY_PASSES);
+  for (int s = 0; s < SCHEDULE_COUNT; s++) {
+    runSchedule((Schedule)s, wakes, loss, seed);
+  }
+  return 0;
+}
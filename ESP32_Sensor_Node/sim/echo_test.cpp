@@ -0,0 +1,176 @@
+/*
+ * Echo Capture Test
+ *
+ * Drives the edge state machine in echo_capture.cpp with synthetic edge
+ * timings on the host clock (echoCaptureSetFakeClockUs), the way the GPIO
+ * interrupt feeds it on the device. Exits 1 if any case fails.
+ *
+ * Cases (5 ms timeout, 1 ms start grace):
+ *   normal          rise, fall 2 ms later: done, 2000 us
+ *   no rise         nothing comes back: pending up to timeout + grace,
+ *                   timeout 1 us after
+ *   stuck high      rise but no fall: timeout 1 us after the pulse passes
+ *                   the gate; a late fall does not revive the ping
+ *   over-wide       a complete pulse wider than the gate: timeout
+ *   early fall      a falling edge before the rise is ignored
+ *   idle edges      edges with no ping armed are ignored
+ *   host await      echoAwait() returns pending instead of blocking
+ *
+ * The echo_test target of CMakeLists.txt (see README.md, "Host Simulation").
+ */
+
+#include <stdio.h>
+#include "echo_capture.h"
+
+static const uint32_t TIMEOUT_US = 5000;
+static const uint32_t GRACE_US = 1000;  // ECHO_START_GRACE_US in echo_capture.cpp
+
+static int failures = 0;
+
+static void expect(const char* name, bool ok, const char* what) {
+  if (!ok) {
+    printf("FAIL %-12s %s\n", name, what);
+    failures++;
+  }
+}
+
+static const char* statusName(EchoStatus status) {
+  switch (status) {
+    case ECHO_IDLE:    return "idle";
+    case ECHO_PENDING: return "pending";
+    case ECHO_DONE:    return "done";
+    case ECHO_TIMEOUT: return "timeout";
+  }
+  return "?";
+}
+
+// Poll at host time nowUs
+static EchoStatus pollAt(uint64_t nowUs, uint32_t* durationUs) {
+  echoCaptureSetFakeClockUs(nowUs);
+  return echoPoll(durationUs);
+}
+
+static void armAt(uint64_t nowUs) {
+  echoCaptureSetFakeClockUs(nowUs);
+  echoStartPing(TIMEOUT_US);
+}
+
+static void testNormal() {
+  const uint64_t t0 = 10000;
+  uint32_t duration = 0;
+  armAt(t0);
+  echoCaptureOnEdge(true, t0 + 200);
+  expect("normal", pollAt(t0 + 1000, &duration) == ECHO_PENDING, "pending while high");
+  echoCaptureOnEdge(false, t0 + 2200);
+  EchoStatus status = pollAt(t0 + 2300, &duration);
+  expect("normal", status == ECHO_DONE, "done after the fall");
+  expect("normal", duration == 2000, "pulse width 2000 us");
+  printf("%-12s %s, %u us\n", "normal", statusName(status), duration);
+}
+
+static void testNoRise() {
+  const uint64_t t0 = 100000;
+  uint32_t duration = 0;
+  armAt(t0);
+  expect("no rise", pollAt(t0 + TIMEOUT_US, &duration) == ECHO_PENDING, "pending at the timeout");
+  expect("no rise", pollAt(t0 + TIMEOUT_US + GRACE_US, &duration) == ECHO_PENDING,
+         "pending through the grace");
+  EchoStatus status = pollAt(t0 + TIMEOUT_US + GRACE_US + 1, &duration);
+  expect("no rise", status == ECHO_TIMEOUT, "timeout after timeout + grace");
+  printf("%-12s %s\n", "no rise", statusName(status));
+}
+
+static void testStuckHigh() {
+  const uint64_t t0 = 200000;
+  const uint64_t rise = t0 + 300;
+  uint32_t duration = 0;
+  armAt(t0);
+  echoCaptureOnEdge(true, rise);
+  expect("stuck high", pollAt(rise + TIMEOUT_US, &duration) == ECHO_PENDING, "pending at the gate");
+  EchoStatus status = pollAt(rise + TIMEOUT_US + 1, &duration);
+  expect("stuck high", status == ECHO_TIMEOUT, "timeout past the gate");
+  echoCaptureOnEdge(false, rise + TIMEOUT_US + 500);
+  expect("stuck high", pollAt(rise + TIMEOUT_US + 600, &duration) == ECHO_TIMEOUT,
+         "late fall leaves it timed out");
+  printf("%-12s %s\n", "stuck high", statusName(status));
+}
+
+static void testOverWide() {
+  const uint64_t t0 = 300000;
+  const uint64_t rise = t0 + 250;
+  uint32_t duration = 12345;
+  armAt(t0);
+  echoCaptureOnEdge(true, rise);
+  echoCaptureOnEdge(false, rise + TIMEOUT_US + 1);  // Complete, but one us too wide
+  EchoStatus status = pollAt(rise + TIMEOUT_US + 10, &duration);
+  expect("over-wide", status == ECHO_TIMEOUT, "timeout for a pulse past the gate");
+  expect("over-wide", duration == 12345, "duration untouched");
+  expect("over-wide", pollAt(rise + TIMEOUT_US + 20, &duration) == ECHO_TIMEOUT, "stays timed out");
+
+  // Exactly at the gate is still a reading
+  armAt(t0 + 50000);
+  echoCaptureOnEdge(true, t0 + 50250);
+  echoCaptureOnEdge(false, t0 + 50250 + TIMEOUT_US);
+  expect("over-wide", pollAt(t0 + 50300 + TIMEOUT_US, &duration) == ECHO_DONE && duration == TIMEOUT_US,
+         "pulse at the gate is done");
+  printf("%-12s %s\n", "over-wide", statusName(status));
+}
+
+static void testEarlyFall() {
+  const uint64_t t0 = 400000;
+  uint32_t duration = 0;
+  armAt(t0);
+  echoCaptureOnEdge(false, t0 + 100);  // Ringing from the trigger, before the echo
+  expect("early fall", pollAt(t0 + 150, &duration) == ECHO_PENDING, "spurious fall ignored");
+  echoCaptureOnEdge(true, t0 + 400);
+  echoCaptureOnEdge(true, t0 + 450);  // Repeated rise keeps the first timestamp
+  echoCaptureOnEdge(false, t0 + 1900);
+  EchoStatus status = pollAt(t0 + 2000, &duration);
+  expect("early fall", status == ECHO_DONE && duration == 1500, "width from the first rise");
+  printf("%-12s %s, %u us\n", "early fall", statusName(status), duration);
+}
+
+static void testIdleEdges() {
+  const uint64_t t0 = 500000;
+  uint32_t duration = 0;
+  echoCaptureBegin();
+  echoCaptureOnEdge(true, t0);
+  echoCaptureOnEdge(false, t0 + 1000);
+  EchoStatus status = pollAt(t0 + 2000, &duration);
+  expect("idle edges", status == ECHO_IDLE, "edges without a ping ignored");
+
+  // A ping armed afterwards starts clean
+  armAt(t0 + 3000);
+  expect("idle edges", pollAt(t0 + 3100, &duration) == ECHO_PENDING, "new ping pending");
+  echoCaptureEnd();
+  printf("%-12s %s\n", "idle edges", statusName(status));
+}
+
+static void testHostAwait() {
+  const uint64_t t0 = 600000;
+  uint32_t duration = 0;
+  armAt(t0);
+  EchoStatus status = echoAwait(&duration);
+  expect("host await", status == ECHO_PENDING, "returns pending");
+  echoCaptureOnEdge(true, t0 + 300);
+  echoCaptureOnEdge(false, t0 + 1300);
+  expect("host await", echoAwait(&duration) == ECHO_DONE && duration == 1000, "done once edges arrive");
+  printf("%-12s %s\n", "host await", statusName(status));
+}
+
+int main() {
+  testNormal();
+  testNoRise();
+  testStuckHigh();
+  testOverWide();
+  testEarlyFall();
+  testIdleEdges();
+  testHostAwait();
+
+  if (failures > 0) {
+    printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  printf("All echo capture checks passed\n");
+  return 0;
+}
@@ -0,0 +1,164 @@
+/*
+ * Energy Regression Benchmark
+ *
+ * Replays standard scenarios through the host simulation, each from a
+ * cold boot, and reports the firmware's own energy totals (energy.cpp):
+ * mAh per day, the split per power state and the projected battery life
+ * on ENERGY_BATTERY_MAH. With --baseline it fails (exit 1) when a
+ * scenario uses more than --tolerance percent above the stored figure,
+ * so firmware changes can be gated on energy.
+ *
+ * The energy_bench target of CMakeLists.txt (see README.md, "Energy Accounting").
+ *
+ * Usage: energy_bench [--days N] [--baseline FILE] [--tolerance PCT] [--write-baseline FILE]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_node.h"
+#include "energy.h"
+
+typedef struct EnergyScenario {
+  const char* name;
+  int gatewayChannel;        // 0 = gateway down (nothing acks)
+  int changeToChannel;       // Gateway alternates with this channel once a day (0 = stays)
+  float lossRate;
+  uint32_t coldBootBleMs;    // BLE window on the first boot
+} EnergyScenario;
+
+static const EnergyScenario scenarios[] = {
+  { "steady",         6, 0,  0.02f, BT_TIMEOUT_MS },
+  { "gateway-down",   0, 0,  0.00f, BT_TIMEOUT_MS },
+  { "channel-change", 6, 11, 0.02f, BT_TIMEOUT_MS },
+  { "cold-boot-prov", 6, 0,  0.02f, PROVISIONING_TIMEOUT_MS },
+  { "lossy-link",     6, 0,  0.30f, BT_TIMEOUT_MS },
+};
+static const int SCENARIO_COUNT = sizeof(scenarios) / sizeof(scenarios[0]);
+
+typedef struct ScenarioResult {
+  float mahPerDay;
+  float stateMah[POWER_STATE_COUNT];
+  uint32_t wakes;
+  float days;
+} ScenarioResult;
+
+static void runScenario(const EnergyScenario& scenario, uint32_t days, ScenarioResult& result) {
+  HalSimConfig config;
+  simDefaultConfig(config);
+  config.gatewayChannel = scenario.gatewayChannel;
+  config.lossRate = scenario.lossRate;
+  simColdBootBleMs = scenario.coldBootBleMs;
+
+  halSimConfigure(config);
+  halSimReset();
+  halSimSetEchoModel(simTankDistance, &simTank);
+
+  // A channel change happens in the middle of a wake, right after the gateway
+  // acks the node's first frame of the day (the channel probe), so the data
+  // frame that follows fails and the node has to rescan
+  for (uint32_t day = 1; day <= days; day++) {
+    halSimRun(simBootSensorNode, UINT32_MAX, (uint64_t)day * SIM_US_PER_DAY);
+    if (scenario.changeToChannel != 0 && day < days) {
+      int channel = day % 2 == 1 ? scenario.changeToChannel : scenario.gatewayChannel;
+      halSimMoveGateway(channel, halSimStats().framesAcked + 1);
+    }
+  }
+
+  // Read the firmware's RTC energy ledger from the last wake
+  halSimLoadRtc();
+  result.mahPerDay = energyMahPerDay();
+  for (int i = 0; i < POWER_STATE_COUNT; i++) {
+    result.stateMah[i] = energyStateMah((PowerState)i);
+  }
+  result.wakes = energyWakes();
+  result.days = energyElapsedHours() / 24.0f;
+}
+
+// Baseline file: one "name mAhPerDay" line per scenario
+static bool readBaseline(const char* path, const char* name, float* mahPerDay) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) return false;
+
+  char line[128];
+  bool found = false;
+  while (!found && fgets(line, sizeof(line), file) != nullptr) {
+    char entry[64];
+    float value = 0;
+    if (line[0] != '#' && sscanf(line, "%63s %f", entry, &value) == 2 && strcmp(entry, name) == 0) {
+      *mahPerDay = value;
+      found = true;
+    }
+  }
+  fclose(file);
+  return found;
+}
+
+int main(int argc, char** argv) {
+  uint32_t days = 7;
+  const char* baselinePath = nullptr;
+  const char* writePath = nullptr;
+  float tolerancePct = 5.0f;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) {
+      days = (uint32_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+      baselinePath = argv[++i];
+    } else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+      tolerancePct = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "--write-baseline") == 0 && i + 1 < argc) {
+      writePath = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--days N] [--baseline FILE] [--tolerance PCT] [--write-baseline FILE]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  ScenarioResult results[SCENARIO_COUNT];
+  bool regressed = false;
+
+  printf("%-15s %6s %9s", "scenario", "wakes", "mAh/day");
+  for (int s = 0; s < POWER_STATE_COUNT; s++) {
+    printf(" %7s", powerStateName((PowerState)s));
+  }
+  printf(" %8s  %s\n", "life(d)", "baseline");
+
+  for (int i = 0; i < SCENARIO_COUNT; i++) {
+    ScenarioResult& result = results[i];
+    runScenario(scenarios[i], days, result);
+
+    printf("%-15s %6u %9.3f", scenarios[i].name, (unsigned)result.wakes, result.mahPerDay);
+    // Per-state split as mAh per day
+    for (int s = 0; s < POWER_STATE_COUNT; s++) {
+      printf(" %7.3f", result.days > 0 ? result.stateMah[s] / result.days : 0.0f);
+    }
+    printf(" %8.0f", result.mahPerDay > 0 ? ENERGY_BATTERY_MAH / result.mahPerDay : 0.0f);
+
+    float baseline = 0;
+    if (baselinePath != nullptr && readBaseline(baselinePath, scenarios[i].name, &baseline)) {
+      float changePct = baseline > 0 ? (result.mahPerDay / baseline - 1.0f) * 100.0f : 0.0f;
+      bool worse = changePct > tolerancePct;
+      printf("  %+.1f%%%s", changePct, worse ? " REGRESSION" : "");
+      regressed = regressed || worse;
+    } else if (baselinePath != nullptr) {
+      printf("  (none)");
+    }
+    printf("\n");
+  }
+
+  if (writePath != nullptr) {
+    FILE* file = fopen(writePath, "w");
+    if (file == nullptr) {
+      perror(writePath);
+      return 1;
+    }
+    fprintf(file, "# energy_bench baseline: scenario mAh/day (%u simulated days)\n", (unsigned)days);
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+      fprintf(file, "%s %.4f\n", scenarios[i].name, results[i].mahPerDay);
+    }
+    fclose(file);
+  }
+
+  return regressed ? 1 : 0;
+}
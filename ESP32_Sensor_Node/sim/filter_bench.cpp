@@ -0,0 +1,272 @@
+/*
+ * Distance Filter Benchmark
+ *
+ * Compares filter chains (distance_filter.h) on synthetic echo bursts
+ * and, optionally, on recorded ones: error against the true distance
+ * (mean, 95th percentile, worst) and time per burst. Also checks that the
+ * sorting networks sort every 0/1 input up to 16 values (0-1 principle)
+ * and that the trimmed-mean chain matches the exchange sort it replaced.
+ * Exits 1 if either check fails.
+ *
+ * Synthetic scenarios (samplesPerUpdate pings per burst, 10 % dropouts):
+ *   clean     Gaussian noise, 0.3 cm
+ *   foam      weak echoes: 30 % of pings read 2-15 cm long
+ *   baffle    25 % of pings echo off a fixed baffle at 35 cm
+ *   sidewall  35 % of pings form a second cluster 8-12 cm long
+ *   spikes    10 % of pings land anywhere in the sensor range
+ *
+ * Recorded bursts (--recorded FILE): one per line, the true distance
+ * followed by the ping distances, in cm, separated by spaces. Lines
+ * starting with # are skipped.
+ *
+ * The filter_bench target of CMakeLists.txt (see README.md, "Host Simulation").
+ *
+ * Usage: filter_bench [--bursts N] [--seed S] [--recorded FILE]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "distance_filter.h"
+
+static const int CAPACITY = samplesPerUpdate;
+
+typedef struct Burst {
+  float truth;
+  float samples[CAPACITY];
+  int count;
+} Burst;
+
+// ----- Chains under test -----
+
+// readSmoothedDistanceCm() before the filter chains
+static float legacyTrimmedMean(const float* samples, int good) {
+  float vals[CAPACITY];
+  memcpy(vals, samples, sizeof(float) * good);
+  for (int i = 0; i < good - 1; i++) {
+    for (int j = i + 1; j < good; j++) {
+      if (vals[j] < vals[i]) {
+        float t = vals[i];
+        vals[i] = vals[j];
+        vals[j] = t;
+      }
+    }
+  }
+  int start = 0;
+  int end = good - 1;
+  if (good >= 5) {
+    start = 1;
+    end = good - 2;
+  }
+  float sum = 0;
+  int count = 0;
+  for (int i = start; i <= end; i++) {
+    sum += vals[i];
+    count++;
+  }
+  return sum / (float)count;
+}
+
+typedef float (*ChainFn)(const float* samples, int count);
+
+template <typename Chain>
+static float runChain(const float* samples, int count) {
+  return Chain::run(samples, count);
+}
+
+typedef struct ChainEntry {
+  const char* name;
+  ChainFn run;
+} ChainEntry;
+
+static const ChainEntry CHAINS[] = {
+  {"legacy sort+trim", legacyTrimmedMean},
+  {"trimmed mean", runChain<FilterChain<CAPACITY, TrimmedMeanEstimate<1, 5>>>},
+  {"median", runChain<FilterChain<CAPACITY, MedianEstimate>>},
+  {"hampel+mean", runChain<FilterChain<CAPACITY, TrimmedMeanEstimate<0>, HampelReject<30>>>},
+  {"hampel+median", runChain<FilterChain<CAPACITY, MedianEstimate, HampelReject<30>>>},
+  {"bin mode 2cm", runChain<FilterChain<CAPACITY, BinModeEstimate<20>>>},
+};
+static const int CHAIN_COUNT = sizeof(CHAINS) / sizeof(CHAINS[0]);
+
+// ----- Checks -----
+
+template <int N>
+static bool networkSortsAllBinaryInputs() {
+  for (uint32_t bits = 0; bits < (1u << N); bits++) {
+    float v[N];
+    for (int i = 0; i < N; i++) v[i] = (float)((bits >> i) & 1);
+    SortNetwork<N>::sort(v);
+    for (int i = 1; i < N; i++) {
+      if (v[i - 1] > v[i]) return false;
+    }
+  }
+  return true;
+}
+
+template <int... N>
+static bool checkNetworks(std::integer_sequence<int, N...>) {
+  bool ok = true;
+  ((ok = networkSortsAllBinaryInputs<N + 1>() && ok), ...);
+  if (!ok) fprintf(stderr, "FAIL: a sorting network left a 0/1 input unsorted\n");
+  return ok;
+}
+
+static bool checkLegacyMatch(const std::vector<Burst>& bursts) {
+  for (const Burst& burst : bursts) {
+    if (burst.count == 0) continue;
+    float a = legacyTrimmedMean(burst.samples, burst.count);
+    float b = CHAINS[1].run(burst.samples, burst.count);
+    if (fabsf(a - b) > 1e-4f * fmaxf(1.0f, fabsf(a))) {
+      fprintf(stderr, "FAIL: trimmed mean chain %.5f vs legacy %.5f\n", b, a);
+      return false;
+    }
+  }
+  return true;
+}
+
+// ----- Synthetic bursts -----
+
+enum Scenario { SCENARIO_CLEAN, SCENARIO_FOAM, SCENARIO_BAFFLE, SCENARIO_SIDEWALL, SCENARIO_SPIKES };
+static const char* const SCENARIO_NAMES[] = {"clean", "foam", "baffle", "sidewall", "spikes"};
+static const int SCENARIO_COUNT = 5;
+
+static std::vector<Burst> makeBursts(Scenario scenario, int count, std::mt19937& rng) {
+  std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+  std::normal_distribution<float> noise(0.0f, 0.3f);
+  std::vector<Burst> bursts((size_t)count);
+
+  for (Burst& burst : bursts) {
+    burst.truth = 40.0f + uniform(rng) * 110.0f;
+    float sidewall = burst.truth + 8.0f + uniform(rng) * 4.0f;
+    burst.count = 0;
+    for (int i = 0; i < CAPACITY; i++) {
+      if (uniform(rng) < 0.10f) continue;  // Dropout
+      float d = burst.truth + noise(rng);
+      float u = uniform(rng);
+      switch (scenario) {
+        case SCENARIO_FOAM:
+          if (u < 0.30f) d += 2.0f + uniform(rng) * 13.0f;
+          break;
+        case SCENARIO_BAFFLE:
+          if (u < 0.25f) d = 35.0f + noise(rng);
+          break;
+        case SCENARIO_SIDEWALL:
+          if (u < 0.35f) d = sidewall + noise(rng);
+          break;
+        case SCENARIO_SPIKES:
+          if (u < 0.10f) d = SENSOR_MIN_RANGE_CM + uniform(rng) * (SENSOR_MAX_RANGE_CM - SENSOR_MIN_RANGE_CM);
+          break;
+        default:
+          break;
+      }
+      burst.samples[burst.count++] = d;
+    }
+  }
+  return bursts;
+}
+
+static bool loadRecorded(const char* path, std::vector<Burst>& bursts) {
+  FILE* file = fopen(path, "r");
+  if (file == nullptr) {
+    fprintf(stderr, "Cannot open %s\n", path);
+    return false;
+  }
+  char line[1024];
+  while (fgets(line, sizeof(line), file) != nullptr) {
+    char* p = line;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '#' || *p == '\n' || *p == '\0') continue;
+
+    Burst burst;
+    char* end;
+    burst.truth = strtof(p, &end);
+    if (end == p) continue;
+    burst.count = 0;
+    for (p = end; burst.count < CAPACITY; p = end) {
+      float d = strtof(p, &end);
+      if (end == p) break;
+      if (!isnan(d)) burst.samples[burst.count++] = d;
+    }
+    bursts.push_back(burst);
+  }
+  fclose(file);
+  return true;
+}
+
+// ----- Report -----
+
+static void report(const char* name, const std::vector<Burst>& bursts) {
+  printf("\n%s (%zu bursts)\n", name, bursts.size());
+  printf("  %-18s %9s %9s %9s %9s\n", "chain", "mean cm", "p95 cm", "max cm", "ns/burst");
+
+  std::vector<float> errors;
+  errors.reserve(bursts.size());
+  for (int c = 0; c < CHAIN_COUNT; c++) {
+    errors.clear();
+    for (const Burst& burst : bursts) {
+      if (burst.count == 0) continue;
+      errors.push_back(fabsf(CHAINS[c].run(burst.samples, burst.count) - burst.truth));
+    }
+    if (errors.empty()) continue;
+
+    volatile float sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < 10; repeat++) {
+      for (const Burst& burst : bursts) {
+        if (burst.count > 0) sink = sink + CHAINS[c].run(burst.samples, burst.count);
+      }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                (10.0 * errors.size());
+
+    double sum = 0;
+    for (float e : errors) sum += e;
+    std::sort(errors.begin(), errors.end());
+    printf("  %-18s %9.3f %9.3f %9.3f %9.1f\n", CHAINS[c].name, sum / errors.size(),
+           errors[errors.size() * 95 / 100], errors.back(), ns);
+  }
+}
+
+int main(int argc, char** argv) {
+  int burstCount = 20000;
+  uint32_t seed = 1;
+  const char* recordedPath = nullptr;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--bursts") == 0 && i + 1 < argc) {
+      burstCount = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else if (strcmp(argv[i], "--recorded") == 0 && i + 1 < argc) {
+      recordedPath = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--bursts N] [--seed S] [--recorded FILE]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  bool ok = checkNetworks(std::make_integer_sequence<int, 16>());
+  printf("Sorting network for %d samples: %d comparators\n", CAPACITY, SortNetwork<CAPACITY>::SIZE);
+
+  std::mt19937 rng(seed);
+  for (int s = 0; s < SCENARIO_COUNT; s++) {
+    std::vector<Burst> bursts = makeBursts((Scenario)s, burstCount, rng);
+    ok = checkLegacyMatch(bursts) && ok;
+    report(SCENARIO_NAMES[s], bursts);
+  }
+
+  if (recordedPath != nullptr) {
+    std::vector<Burst> bursts;
+    if (!loadRecorded(recordedPath, bursts)) return 1;
+    ok = checkLegacyMatch(bursts) && ok;
+    report(recordedPath, bursts);
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,307 @@
+/*
+ * Fixed-Point Measurement Benchmark
+ *
+ * Checks the integer / Q16.16 measurement path (measure_math.h,
+ * ENABLE_FIXED_POINT) against the float one it replaces, then times one
+ * measurement both ways. Exits 1 if any check is outside its limit.
+ *
+ * Checks:
+ *   echo      every echo time up to past the sensor range: distance error
+ *             and range checks that disagree away from the limits
+ *   chains    each filter chain on random bursts (the pings that pass the
+ *             range check, as readBurst() keeps them): worst difference,
+ *             and how many bursts a threshold decides differently
+ *   level     level and litres for every 0.01 cm of distance, per shape
+ *   battery   every oversampled ADC sum: volts vs integer mV
+ *
+ * One measurement is what a wake computes from a burst: samplesPerUpdate
+ * echo times to distances, range checks, DistanceFilterChain, level and
+ * litres through the active strapping table, with the fixed path's float
+ * conversions at the sensor API included. Times are host ns and host
+ * cycles (TSC ticks on x86). The host has an FPU, so the gap here is far
+ * smaller than on the ESP32-C3, where every float operation is a libgcc
+ * call; the counts show the work each path does, not the C3's cycles.
+ *
+ * The fixed_bench target of CMakeLists.txt (see README.md, "Host Simulation").
+ *
+ * Usage: fixed_bench [--bursts N] [--seed S]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "distance_filter.h"
+#include "measure_math.h"
+#include "tank_geometry.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t cycles() { return __rdtsc(); }
+#define HAVE_CYCLES 1
+#else
+static uint64_t cycles() { return 0; }
+#define HAVE_CYCLES 0
+#endif
+
+static const int CAPACITY = samplesPerUpdate;
+static const float Q16_LSB_CM = 1.0f / Q16_ONE;
+
+// Limits
+static const float ECHO_LIMIT_CM = 0.0005f;       // Echo time to distance
+static const float CHAIN_LIMIT_CM = 0.001f;       // Chain result, same decisions
+static const double CHAIN_FLIP_LIMIT = 0.0005;    // Share of bursts decided differently
+static const float LEVEL_LIMIT_PCT = 0.005f;      // Level, % of span (Q16 step: 0.0015 %)
+static const float LITRES_LIMIT_PCT = 0.01f;      // Litres, % of capacity
+static const float BATTERY_LIMIT_MV = 0.51f;      // Integer mV rounds once
+
+static const float FULL_CM = 25.0f;
+static const float EMPTY_CM = 225.0f;
+static const float CAPACITY_L = 1000.0f;
+
+// Echo times of one burst; 0 is a ping that timed out
+typedef struct Burst {
+  uint32_t durationUs[CAPACITY];
+} Burst;
+
+static uint32_t echoTimeUs(float distanceCm) {
+  if (distanceCm <= 0.0f) return 0;
+  return (uint32_t)(2.0f * distanceCm / speedOfSoundCmPerUs + 0.5f);
+}
+
+// Clean and noisy bursts mixed: 0.3 cm noise, 10 % dropouts, 10 % spikes
+static std::vector<Burst> makeBursts(int count, std::mt19937& rng) {
+  std::uniform_real_distribution<float> truthDist(SENSOR_MIN_RANGE_CM + 5.0f, SENSOR_MAX_RANGE_CM - 20.0f);
+  std::uniform_real_distribution<float> anywhere(0.0f, SENSOR_MAX_RANGE_CM + 40.0f);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  std::normal_distribution<float> noise(0.0f, 0.3f);
+
+  std::vector<Burst> bursts(count);
+  for (Burst& burst : bursts) {
+    float truth = truthDist(rng);
+    for (int i = 0; i < CAPACITY; i++) {
+      float u = unit(rng);
+      float d = u < 0.1f ? 0.0f : u < 0.2f ? anywhere(rng) : truth + noise(rng);
+      burst.durationUs[i] = echoTimeUs(d);
+    }
+  }
+  return bursts;
+}
+
+// ----- Both paths, as the node runs them -----
+
+static int floatSamples(const Burst& burst, float* out) {
+  int good = 0;
+  for (int i = 0; i < CAPACITY; i++) {
+    float d = echoDistanceCm(burst.durationUs[i]);
+    if (distanceInRange(d)) out[good++] = d;
+  }
+  return good;
+}
+
+static int fixedSamples(const Burst& burst, q16_t* out) {
+  int good = 0;
+  for (int i = 0; i < CAPACITY; i++) {
+    q16_t d = echoDistanceQ16(burst.durationUs[i]);
+    if (distanceInRangeQ16(d)) out[good++] = d;
+  }
+  return good;
+}
+
+typedef struct Measurement {
+  float levelPercent;
+  float litres;
+} Measurement;
+
+static Measurement measureFloat(const Burst& burst) {
+  float samples[CAPACITY];
+  int good = floatSamples(burst, samples);
+  float d = DistanceFilterChain::run(samples, good);
+  Measurement m = {0.0f, 0.0f};
+  if (isnan(d)) return m;
+  m.levelPercent = levelPercent(d, FULL_CM, EMPTY_CM);
+  m.litres = tankLitres(m.levelPercent, CAPACITY_L);
+  return m;
+}
+
+static Measurement measureFixed(const Burst& burst) {
+  q16_t samples[CAPACITY];
+  int good = fixedSamples(burst, samples);
+  q16_t q = DistanceFilterChain::run(samples, good);
+  Measurement m = {0.0f, 0.0f};
+  if (!SampleMath<q16_t>::valid(q)) return m;
+  float d = q16ToFloat(q);  // readDistanceCm() returns float cm
+  uint32_t level = levelQ16(q16FromFloat(d), q16FromFloat(FULL_CM), q16FromFloat(EMPTY_CM));
+  m.levelPercent = level * (100.0f / Q16_ONE);
+  m.litres = tankLitresAtLevel(level, CAPACITY_L);
+  return m;
+}
+
+// ----- Checks -----
+
+static bool checkEcho() {
+  uint32_t lastUs = echoTimeUs(SENSOR_MAX_RANGE_CM + 50.0f);
+  float worst = 0.0f;
+  uint32_t worstUs = 0;
+  int disagree = 0;
+  for (uint32_t us = 0; us <= lastUs; us++) {
+    float a = echoDistanceCm(us);
+    q16_t q = echoDistanceQ16(us);
+    float e = fabsf(q16ToFloat(q) - a);
+    if (e > worst) {
+      worst = e;
+      worstUs = us;
+    }
+    // Within a couple of LSBs of a limit either answer is right
+    bool nearLimit = fabsf(a - SENSOR_MIN_RANGE_CM) <= 2 * Q16_LSB_CM ||
+                     fabsf(a - SENSOR_MAX_RANGE_CM) <= 2 * Q16_LSB_CM;
+    if (distanceInRange(a) != distanceInRangeQ16(q) && !nearLimit) disagree++;
+  }
+  bool ok = worst <= ECHO_LIMIT_CM && disagree == 0;
+  printf("%-16s %u echo times, worst %.6f cm at %u us, %d range checks disagree  %s\n", "echo",
+         lastUs + 1, worst, worstUs, disagree, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+template <typename Chain>
+static bool checkChain(const char* name, const std::vector<Burst>& bursts) {
+  float worst = 0.0f;
+  int flips = 0;
+  int compared = 0;
+  for (const Burst& burst : bursts) {
+    float a[CAPACITY];
+    q16_t q[CAPACITY];
+    int goodA = floatSamples(burst, a);
+    int goodQ = fixedSamples(burst, q);
+    if (goodA != goodQ) {
+      flips++;
+      continue;
+    }
+    float ra = Chain::run(a, goodA);
+    q16_t rq = Chain::run(q, goodQ);
+    if (isnan(ra) || !SampleMath<q16_t>::valid(rq)) {
+      if (isnan(ra) != !SampleMath<q16_t>::valid(rq)) flips++;
+      continue;
+    }
+    compared++;
+    float e = fabsf(q16ToFloat(rq) - ra);
+    if (e > CHAIN_LIMIT_CM) {
+      flips++;  // A sample fell on the other side of a threshold
+    } else if (e > worst) {
+      worst = e;
+    }
+  }
+  double share = (double)flips / bursts.size();
+  bool ok = share <= CHAIN_FLIP_LIMIT;
+  printf("%-16s %d results, worst %.6f cm, %d decided differently (%.3f %%)  %s\n", name, compared, worst,
+         flips, 100.0 * share, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+static bool checkLevel(const char* name, TankShape shape, float lengthCm) {
+  TankGeometry geometry;
+  tankDefaultGeometry(geometry);
+  geometry.shape = shape;
+  geometry.lengthCm = lengthCm;
+  TankStrapTable table;
+  tankBuildTable(geometry, FULL_CM, EMPTY_CM, CAPACITY_L, table);
+  tankSetTable(table);
+
+  float worstLevel = 0.0f;
+  float worstLitres = 0.0f;
+  for (int hundredths = 0; hundredths <= (int)(EMPTY_CM + 25.0f) * 100; hundredths++) {
+    float d = hundredths / 100.0f;
+    float pct = levelPercent(d, FULL_CM, EMPTY_CM);
+    float litres = tankLitres(pct, CAPACITY_L);
+    uint32_t level = levelQ16(q16FromFloat(d), q16FromFloat(FULL_CM), q16FromFloat(EMPTY_CM));
+    worstLevel = fmaxf(worstLevel, fabsf(level * (100.0f / Q16_ONE) - pct));
+    worstLitres = fmaxf(worstLitres, fabsf(tankLitresAtLevel(level, CAPACITY_L) - litres));
+  }
+  worstLitres = worstLitres * 100.0f / CAPACITY_L;
+  bool ok = worstLevel <= LEVEL_LIMIT_PCT && worstLitres <= LITRES_LIMIT_PCT;
+  printf("%-16s worst level %.6f %%, litres %.6f %% of capacity  %s\n", name, worstLevel, worstLitres,
+         ok ? "ok" : "FAIL");
+  return ok;
+}
+
+static bool checkBattery() {
+  float worst = 0.0f;
+  uint32_t worstSum = 0;
+  uint32_t lastSum = (uint32_t)BATTERY_OVERSAMPLES * 3300;  // ADC full scale, mV
+  for (uint32_t sum = 0; sum <= lastSum; sum++) {
+    float volts = batteryVoltsFromSum(sum, BATTERY_OVERSAMPLES);
+    float e = fabsf(batteryMilliVoltsFromSum(sum, BATTERY_OVERSAMPLES) - volts * 1000.0f);
+    if (e > worst) {
+      worst = e;
+      worstSum = sum;
+    }
+  }
+  bool ok = worst <= BATTERY_LIMIT_MV;
+  printf("%-16s %u sums, worst %.3f mV at sum %u  %s\n", "battery", lastSum + 1, worst, worstSum,
+         ok ? "ok" : "FAIL");
+  return ok;
+}
+
+// ----- Timing -----
+
+static volatile float sink;
+
+template <typename Measure>
+static void timeMeasure(const char* name, const std::vector<Burst>& bursts, Measure measure) {
+  const int repeats = 20;
+  auto start = std::chrono::steady_clock::now();
+  uint64_t c0 = cycles();
+  for (int r = 0; r < repeats; r++) {
+    for (const Burst& burst : bursts) {
+      Measurement m = measure(burst);
+      sink = sink + m.litres;
+    }
+  }
+  uint64_t c1 = cycles();
+  double n = (double)repeats * bursts.size();
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+  if (HAVE_CYCLES) {
+    printf("  %-8s %9.1f ns %9.1f cycles per measurement\n", name, ns, (c1 - c0) / n);
+  } else {
+    printf("  %-8s %9.1f ns per measurement\n", name, ns);
+  }
+}
+
+int main(int argc, char** argv) {
+  int burstCount = 100000;
+  uint32_t seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--bursts") == 0 && i + 1 < argc) {
+      burstCount = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else {
+      fprintf(stderr, "Usage: %s [--bursts N] [--seed S]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (burstCount < 1) burstCount = 1;
+
+  std::mt19937 rng(seed);
+  std::vector<Burst> bursts = makeBursts(burstCount, rng);
+
+  bool ok = checkEcho();
+  ok = checkChain<FilterChain<CAPACITY, TrimmedMeanEstimate<1, 5>>>("trimmed mean", bursts) && ok;
+  ok = checkChain<FilterChain<CAPACITY, MedianEstimate>>("median", bursts) && ok;
+  ok = checkChain<FilterChain<CAPACITY, TrimmedMeanEstimate<0>, HampelReject<30>>>("hampel+mean", bursts) && ok;
+  ok = checkChain<FilterChain<CAPACITY, BinModeEstimate<20>>>("bin mode 2cm", bursts) && ok;
+  ok = checkLevel("level vertical", TANK_SHAPE_VERTICAL, 0.0f) && ok;
+  ok = checkLevel("level capsule", TANK_SHAPE_CAPSULE, 1.5f * (EMPTY_CM - FULL_CM)) && ok;
+  ok = checkLevel("level horizontal", TANK_SHAPE_HORIZONTAL, 0.0f) && ok;  // Left active for the timing
+  ok = checkBattery() && ok;
+
+  printf("\nOne measurement (%d pings, DistanceFilterChain, horizontal table), %d bursts:\n", CAPACITY,
+         burstCount);
+  timeMeasure("float", bursts, measureFloat);
+  timeMeasure("fixed", bursts, measureFixed);
+
+  return ok ? 0 : 1;
+}
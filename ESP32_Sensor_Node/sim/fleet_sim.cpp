@@ -0,0 +1,415 @@
+/*
+ * Fleet Transmit Simulation
+ *
+ * Discrete-event model of many sensor nodes that power on together and
+ * share the Cloud Node's channel. Each wake brings the radio up, sends
+ * one frame and sleeps; the firmware's transmit behaviour is modelled on
+ * top of a simple CSMA medium:
+ *   - a frame is on air for (payload + ENERGY_TX_OVERHEAD_BYTES) at
+ *     ENERGY_TX_BITRATE_KBPS; frames that overlap are both lost
+ *   - a node that senses a frame already on air defers to its end plus a
+ *     random 802.11-style backoff; two nodes starting within the carrier
+ *     sense time do not see each other
+ *   - a lost frame is retried SENSOR_TX_RETRIES times, then the channels
+ *     are probed DISCOVERY_PASSES times (the gateway channel first, as
+ *     the cached channel) and the frame is sent once more
+ * and compared across three policies:
+ *   lockstep  - ENABLE_TX_SLOTS off: fixed sleep, retries at once
+ *   node-id   - sleeps aligned to the node ID slot (tx_slot.cpp) with
+ *               jitter, random retry backoff, assignment listen window
+ *   assigned  - as node-id, but the gateway assigns every node its own
+ *               slot with its first delivered frame
+ * Sleep timers drift by a per-node error of up to --drift-ppm. Prints the
+ * delivery rate (overall and in the first hour after power-on), retries
+ * and rescans per wake and radio-on time per wake after the radio init.
+ *
+ * The fleet_sim target of CMakeLists.txt (see README.md, "Transmit Slots").
+ *
+ * Usage: fleet_sim [--nodes N] [--hours H] [--period S] [--drift-ppm P]
+ *                  [--skew-ms MS] [--spread-ms MS] [--loss P] [--seed S]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <queue>
+#include <vector>
+#include "config.h"
+#include "tx_slot.h"
+#include "wire_format.h"
+
+static const int FLEET_CHANNELS = 13;
+static const uint32_t FLEET_RADIO_INIT_US = 120000;  // Same as the single-node sim
+static const uint32_t FLEET_ACK_WAIT_US = 1000;      // Send callback after the air time
+static const uint32_t FLEET_CCA_US = 20;             // Carrier sense time
+static const uint32_t FLEET_DIFS_US = 28;
+static const uint32_t FLEET_BACKOFF_SLOT_US = 9;
+static const uint32_t FLEET_CONTENTION_WINDOW = 16;
+static const uint32_t FLEET_WAKE_TAIL_US = 5000;     // Logging and sleep setup after the send
+static const size_t FLEET_FRAME_BYTES = WIRE_V2_HEADER_LEN + WIRE_V2_RECORD_LEN + 4;
+
+enum FleetPolicy { POLICY_LOCKSTEP = 0, POLICY_NODE_ID, POLICY_ASSIGNED, POLICY_COUNT };
+
+static const char* policyName(FleetPolicy policy) {
+  switch (policy) {
+    case POLICY_LOCKSTEP: return "lockstep";
+    case POLICY_NODE_ID:  return "node-id";
+    case POLICY_ASSIGNED: return "assigned";
+    default:              return "?";
+  }
+}
+
+typedef struct FleetOptions {
+  uint32_t nodes;
+  double hours;
+  uint32_t periodS;
+  double driftPpm;
+  uint32_t skewMs;          // Spread of the shared power-on
+  uint32_t spreadMs;        // Wake-to-send variation per wake (sensor time)
+  float lossRate;           // Loss of frames that did not collide
+  uint32_t seed;
+} FleetOptions;
+
+// What the node is sending
+enum FleetPhase : uint8_t {
+  PHASE_SEND = 0,     // The frame, with the transmit layer's retries
+  PHASE_PROBE,        // Channel rescan
+  PHASE_RESEND        // The frame once more after the rescan
+};
+
+typedef struct FleetNode {
+  uint16_t nodeId;
+  TxSlotPlan plan;
+  double drift;             // Sleep timer error (fraction)
+  uint64_t clockMs;         // Node clock at the start of the wake
+  uint64_t wakeUs;          // Real time the wake started
+  uint64_t radioReadyUs;
+  FleetPhase phase;
+  uint8_t attempts;
+  int probe;                // Probes done in this rescan
+  bool delivered;
+  int air;                  // Index of the frame on air, -1 if none
+} FleetNode;
+
+typedef struct AirFrame {
+  uint64_t startUs;
+  uint64_t endUs;
+  bool collided;
+  bool active;
+} AirFrame;
+
+enum FleetEventType : uint8_t { EVENT_WAKE = 0, EVENT_TRY_SEND, EVENT_SEND_DONE };
+
+typedef struct FleetEvent {
+  uint64_t timeUs;
+  uint32_t node;
+  FleetEventType type;
+  bool operator>(const FleetEvent& other) const { return timeUs > other.timeUs; }
+} FleetEvent;
+
+typedef struct FleetResult {
+  uint64_t wakes;
+  uint64_t delivered;
+  uint64_t firstHourWakes;
+  uint64_t firstHourDelivered;
+  uint64_t retries;         // Transmit layer retries and post-rescan resends
+  uint64_t rescans;
+  uint64_t collisions;      // Frames lost to overlap
+  std::vector<uint32_t> radioOnUs;
+} FleetResult;
+
+typedef struct Fleet {
+  FleetOptions options;
+  FleetPolicy policy;
+  std::vector<FleetNode> nodes;
+  std::vector<AirFrame> air;
+  std::priority_queue<FleetEvent, std::vector<FleetEvent>, std::greater<FleetEvent>> events;
+  uint32_t rng;
+  uint64_t airUs;           // Air time of one frame
+  uint64_t endUs;
+  FleetResult result;
+} Fleet;
+
+// xorshift32
+static uint32_t fleetNext(Fleet& fleet) {
+  uint32_t x = fleet.rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  fleet.rng = x;
+  return x;
+}
+
+// Uniform in 0..bound-1 (0 if bound is 0)
+static uint32_t fleetRandom(Fleet& fleet, uint32_t bound) {
+  uint32_t x = fleetNext(fleet);
+  return bound != 0 ? x % bound : 0;
+}
+
+static double fleetUniform(Fleet& fleet) {
+  return (double)(fleetNext(fleet) >> 8) / 16777216.0;
+}
+
+static void schedule(Fleet& fleet, uint64_t timeUs, uint32_t node, FleetEventType type) {
+  fleet.events.push({ timeUs, node, type });
+}
+
+// Gateway plan for --policy assigned: one slot per node in the longest allowed frame
+static void assignedPlan(const Fleet& fleet, uint32_t index, TxSlotPlan& plan) {
+  uint32_t maxFrameMs = SLEEP_MIN_S * 1000UL / 2;
+  uint32_t count = fleet.options.nodes;
+  uint32_t widthMs = maxFrameMs / count < TX_SLOT_WIDTH_MS ? maxFrameMs / count : TX_SLOT_WIDTH_MS;
+  if (widthMs == 0) widthMs = 1;
+
+  uint8_t frame[TX_SLOT_ASSIGN_LEN];
+  txSlotEncodeAssignment(frame, sizeof(frame), fleet.nodes[index].nodeId, (uint16_t)index,
+                         (uint16_t)count, (uint16_t)widthMs);
+  txSlotDecodeAssignment(frame, sizeof(frame), fleet.nodes[index].nodeId, plan);
+}
+
+static bool onGatewayChannel(const FleetNode& node) {
+  // The rescan starts each pass on the cached (gateway) channel
+  return node.phase != PHASE_PROBE || node.probe % FLEET_CHANNELS == 0;
+}
+
+static void startWake(Fleet& fleet, uint32_t index, uint64_t nowUs) {
+  FleetNode& node = fleet.nodes[index];
+  node.wakeUs = nowUs;
+  node.radioReadyUs = nowUs + FLEET_RADIO_INIT_US;
+  node.phase = PHASE_SEND;
+  node.attempts = 0;
+  node.probe = 0;
+  node.delivered = false;
+  node.air = -1;
+  uint64_t spreadUs = fleetRandom(fleet, fleet.options.spreadMs * 1000U + 1);
+  schedule(fleet, node.radioReadyUs + spreadUs, index, EVENT_TRY_SEND);
+}
+
+static void endWake(Fleet& fleet, uint32_t index, uint64_t nowUs) {
+  FleetNode& node = fleet.nodes[index];
+  bool slotted = fleet.policy != POLICY_LOCKSTEP;
+
+  uint64_t endUs = nowUs + FLEET_WAKE_TAIL_US;
+  if (slotted && node.delivered) {
+    endUs += TX_SLOT_LISTEN_MS * 1000ULL;
+    if (fleet.policy == POLICY_ASSIGNED && !node.plan.assigned) assignedPlan(fleet, index, node.plan);
+  }
+
+  FleetResult& result = fleet.result;
+  result.wakes++;
+  if (node.delivered) result.delivered++;
+  if (node.wakeUs < 3600ULL * 1000000ULL) {
+    result.firstHourWakes++;
+    if (node.delivered) result.firstHourDelivered++;
+  }
+  result.radioOnUs.push_back((uint32_t)(endUs - node.radioReadyUs));
+
+  // Same steps as enterDeepSleep(): align on the node clock, then sleep on the drifting timer
+  uint64_t nowMs = node.clockMs + (endUs - node.wakeUs) / 1000ULL;
+  uint64_t sleepMs = (uint64_t)fleet.options.periodS * 1000ULL;
+  if (slotted) {
+    uint32_t jitterBound = TX_SLOT_JITTER_MS < node.plan.widthMs ? TX_SLOT_JITTER_MS : node.plan.widthMs;
+    sleepMs = txSlotAlignSleepMs(node.plan, nowMs, sleepMs, fleetRandom(fleet, jitterBound));
+  }
+  node.clockMs = nowMs + sleepMs;
+  uint64_t wakeUs = endUs + (uint64_t)((double)sleepMs * 1000.0 * (1.0 + node.drift));
+  if (wakeUs < fleet.endUs) schedule(fleet, wakeUs, index, EVENT_WAKE);
+}
+
+static void trySend(Fleet& fleet, uint32_t index, uint64_t nowUs) {
+  FleetNode& node = fleet.nodes[index];
+
+  // Other channels: nobody there, the attempt just fails after the air time
+  if (!onGatewayChannel(node)) {
+    schedule(fleet, nowUs + fleet.airUs + FLEET_ACK_WAIT_US, index, EVENT_SEND_DONE);
+    return;
+  }
+
+  // Carrier sense: frames that started more than FLEET_CCA_US ago are heard
+  uint64_t busyUntil = 0;
+  for (const AirFrame& frame : fleet.air) {
+    if (frame.active && frame.endUs > nowUs && frame.startUs + FLEET_CCA_US <= nowUs &&
+        frame.endUs > busyUntil) {
+      busyUntil = frame.endUs;
+    }
+  }
+  if (busyUntil != 0) {
+    uint64_t backoffUs = FLEET_DIFS_US + FLEET_BACKOFF_SLOT_US * fleetRandom(fleet, FLEET_CONTENTION_WINDOW);
+    schedule(fleet, busyUntil + backoffUs, index, EVENT_TRY_SEND);
+    return;
+  }
+
+  AirFrame sent = { nowUs, nowUs + fleet.airUs, false, true };
+  for (AirFrame& frame : fleet.air) {
+    if (frame.active && frame.endUs > nowUs) {
+      frame.collided = true;
+      sent.collided = true;
+    }
+  }
+
+  // Reuse a finished entry
+  node.air = -1;
+  for (size_t i = 0; i < fleet.air.size() && node.air < 0; i++) {
+    if (!fleet.air[i].active) node.air = (int)i;
+  }
+  if (node.air < 0) {
+    node.air = (int)fleet.air.size();
+    fleet.air.push_back(sent);
+  } else {
+    fleet.air[node.air] = sent;
+  }
+  schedule(fleet, sent.endUs + FLEET_ACK_WAIT_US, index, EVENT_SEND_DONE);
+}
+
+static void sendDone(Fleet& fleet, uint32_t index, uint64_t nowUs) {
+  FleetNode& node = fleet.nodes[index];
+  bool acked = false;
+
+  if (node.air >= 0) {
+    AirFrame& frame = fleet.air[node.air];
+    frame.active = false;
+    node.air = -1;
+    if (frame.collided) fleet.result.collisions++;
+    acked = !frame.collided && fleetUniform(fleet) >= fleet.options.lossRate;
+  }
+
+  switch (node.phase) {
+    case PHASE_SEND:
+      node.attempts++;
+      if (acked) {
+        node.delivered = true;
+        endWake(fleet, index, nowUs);
+      } else if (node.attempts <= SENSOR_TX_RETRIES) {
+        fleet.result.retries++;
+        uint64_t backoffUs = fleet.policy != POLICY_LOCKSTEP
+                                 ? fleetRandom(fleet, TX_SLOT_BACKOFF_MAX_MS + 1U) * 1000ULL
+                                 : 0;
+        schedule(fleet, nowUs + backoffUs, index, EVENT_TRY_SEND);
+      } else {
+        fleet.result.rescans++;
+        node.phase = PHASE_PROBE;
+        node.probe = 0;
+        schedule(fleet, nowUs, index, EVENT_TRY_SEND);
+      }
+      break;
+
+    case PHASE_PROBE:
+      if (acked) {
+        fleet.result.retries++;
+        node.phase = PHASE_RESEND;
+        schedule(fleet, nowUs, index, EVENT_TRY_SEND);
+      } else if (++node.probe < FLEET_CHANNELS * DISCOVERY_PASSES) {
+        schedule(fleet, nowUs, index, EVENT_TRY_SEND);
+      } else {
+        endWake(fleet, index, nowUs);
+      }
+      break;
+
+    case PHASE_RESEND:
+      node.delivered = acked;
+      endWake(fleet, index, nowUs);
+      break;
+  }
+}
+
+static void runFleet(const FleetOptions& options, FleetPolicy policy, FleetResult& out) {
+  Fleet* fleet = new Fleet();
+  fleet->options = options;
+  fleet->policy = policy;
+  fleet->rng = (options.seed + 0x9E3779B9u) * 2654435761u;
+  if (fleet->rng == 0) fleet->rng = 1;
+  fleet->airUs = (FLEET_FRAME_BYTES + ENERGY_TX_OVERHEAD_BYTES) * 8ULL * 1000ULL / ENERGY_TX_BITRATE_KBPS;
+  fleet->endUs = (uint64_t)(options.hours * 3600.0 * 1e6);
+
+  fleet->nodes.resize(options.nodes);
+  for (uint32_t i = 0; i < options.nodes; i++) {
+    FleetNode& node = fleet->nodes[i];
+    uint8_t mac[6] = { 0x34, 0x85, 0x18, (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i };
+    node.nodeId = wireNodeIdFromMac(mac);
+    txSlotDefaultPlan(node.nodeId, node.plan);
+    node.drift = (fleetUniform(*fleet) * 2.0 - 1.0) * options.driftPpm * 1e-6;
+    node.clockMs = 0;
+    // Shared power-on: everyone boots within skewMs
+    schedule(*fleet, fleetRandom(*fleet, options.skewMs * 1000U + 1), i, EVENT_WAKE);
+  }
+
+  while (!fleet->events.empty()) {
+    FleetEvent event = fleet->events.top();
+    fleet->events.pop();
+    switch (event.type) {
+      case EVENT_WAKE:      startWake(*fleet, event.node, event.timeUs); break;
+      case EVENT_TRY_SEND:  trySend(*fleet, event.node, event.timeUs); break;
+      case EVENT_SEND_DONE: sendDone(*fleet, event.node, event.timeUs); break;
+    }
+  }
+
+  out = fleet->result;
+  delete fleet;
+}
+
+static double percentileMs(std::vector<uint32_t>& values, double quantile) {
+  if (values.empty()) return 0;
+  size_t rank = (size_t)(quantile * (double)(values.size() - 1));
+  std::nth_element(values.begin(), values.begin() + rank, values.end());
+  return values[rank] / 1000.0;
+}
+
+int main(int argc, char** argv) {
+  FleetOptions options = { 300, 24, 300, 50, 50, 5, 0.02f, 1 };
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--nodes") == 0 && i + 1 < argc) {
+      options.nodes = (uint32_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc) {
+      options.hours = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--period") == 0 && i + 1 < argc) {
+      options.periodS = (uint32_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--drift-ppm") == 0 && i + 1 < argc) {
+      options.driftPpm = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--skew-ms") == 0 && i + 1 < argc) {
+      options.skewMs = (uint32_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--spread-ms") == 0 && i + 1 < argc) {
+      options.spreadMs = (uint32_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+      options.lossRate = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      options.seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else {
+      fprintf(stderr, "Usage: %s [--nodes N] [--hours H] [--period S] [--drift-ppm P]\n"
+                      "          [--skew-ms MS] [--spread-ms MS] [--loss P] [--seed S]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (options.nodes == 0 || options.nodes > 0xFFFF || options.periodS < SLEEP_MIN_S) {
+    fprintf(stderr, "fleet_sim: need 1-65535 nodes and a period of at least %u s\n", (unsigned)SLEEP_MIN_S);
+    return 1;
+  }
+
+  printf("fleet_sim: %u nodes, one channel, %.1f h, %u s period, drift +-%.0f ppm, "
+         "power-on skew %u ms, loss %.0f %%\n",
+         (unsigned)options.nodes, options.hours, (unsigned)options.periodS, options.driftPpm,
+         (unsigned)options.skewMs, options.lossRate * 100.0f);
+  printf("%-9s %8s %9s %10s %8s %8s %10s %12s %12s\n", "policy", "wakes", "delivery", "first hour",
+         "retries", "rescans", "collisions", "radio mean", "radio p99");
+
+  for (int p = 0; p < POLICY_COUNT; p++) {
+    FleetResult result;
+    runFleet(options, (FleetPolicy)p, result);
+
+    double wakes = result.wakes > 0 ? (double)result.wakes : 1.0;
+    double firstHour = result.firstHourWakes > 0 ? (double)result.firstHourWakes : 1.0;
+    double radioTotalUs = 0;
+    for (uint32_t us : result.radioOnUs) radioTotalUs += us;
+
+    printf("%-9s %8llu %8.2f%% %9.2f%% %8.3f %8.3f %10llu %9.2f ms %9.2f ms\n",
+           policyName((FleetPolicy)p), (unsigned long long)result.wakes,
+           100.0 * result.delivered / wakes, 100.0 * result.firstHourDelivered / firstHour,
+           result.retries / wakes, result.rescans / wakes, (unsigned long long)result.collisions,
+           radioTotalUs / wakes / 1000.0, percentileMs(result.radioOnUs, 0.99));
+  }
+  printf("(retries and rescans per wake; radio time after the %u ms radio init)\n",
+         (unsigned)(FLEET_RADIO_INIT_US / 1000));
+  return 0;
+}
@@ -0,0 +1,208 @@
+/*
+ * Properties JSON Benchmark
+ *
+ * Times propsParse() against the String-based parser it replaced (ported
+ * to std::string with the same indexOf/substring/toFloat steps) on
+ * typical properties writes, and counts heap allocations per parse via a
+ * global operator new. Exits 1 if propsParse() allocates or disagrees
+ * with the old parser on a document both accept.
+ *
+ * The props_bench target of CMakeLists.txt (see README.md, "Host Simulation").
+ *
+ * Usage: props_bench [--iterations N]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <new>
+#include <string>
+#include "properties_json.h"
+
+static unsigned long allocations = 0;
+
+void* operator new(size_t size) {
+  allocations++;
+  void* p = malloc(size != 0 ? size : 1);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+
+// ----- The old parser, String calls mapped to std::string -----
+
+static int indexOf(const std::string& s, const std::string& what, int from = 0) {
+  size_t at = s.find(what, (size_t)from);
+  return at == std::string::npos ? -1 : (int)at;
+}
+
+static int indexOf(const std::string& s, char what, int from = 0) {
+  size_t at = s.find(what, (size_t)from);
+  return at == std::string::npos ? -1 : (int)at;
+}
+
+static std::string substring(const std::string& s, int start, int end) {
+  if (end < start) end = (int)s.size();
+  return s.substr((size_t)start, (size_t)(end - start));
+}
+
+static bool legacyReadNumber(const std::string& json, const char* key, float& out) {
+  std::string pattern = std::string("\"") + key + "\":";
+  int keyIdx = indexOf(json, pattern);
+  if (keyIdx == -1) return false;
+  int startIdx = keyIdx + (int)pattern.length();
+  int endIdx = indexOf(json, ',', startIdx);
+  if (endIdx == -1) endIdx = indexOf(json, '}', startIdx);
+  out = (float)atof(substring(json, startIdx, endIdx).c_str());
+  return true;
+}
+
+static bool legacyParse(const uint8_t* data, size_t length, const ReportThresholds& current,
+                        PropertiesUpdate& out) {
+  std::string value((const char*)data, length);  // getValue() copy
+  memset(&out, 0, sizeof(out));
+  out.thresholds = current;
+  const char* keys[] = {"minDistance", "maxDistance", "refreshRate", "totalLitres"};
+  float numbers[4] = {0, 0, 0, 0};
+  for (int i = 0; i < 4; i++) {
+    int idx = indexOf(value, std::string("\"") + keys[i] + "\":");
+    if (idx == -1) continue;
+    int startIdx = idx + 14;
+    int endIdx = indexOf(value, ',', startIdx);
+    if (endIdx == -1) endIdx = indexOf(value, '}', startIdx);
+    numbers[i] = (float)atof(substring(value, startIdx, endIdx).c_str());
+  }
+  out.minDistance = numbers[0];
+  out.maxDistance = numbers[1];
+  out.refreshRate = (uint32_t)numbers[2];
+  out.totalLitres = numbers[3];
+
+  int macIdx = indexOf(value, "\"cloudNodeMAC\":");
+  if (macIdx != -1) {
+    int startIdx = indexOf(value, '"', macIdx + 15) + 1;
+    int endIdx = indexOf(value, '"', startIdx);
+    std::string mac = substring(value, startIdx, endIdx);
+    std::string hex;
+    for (char ch : mac) {
+      if (ch != ':') hex += (char)toupper((unsigned char)ch);
+    }
+    if (hex.length() == 12) {
+      for (int i = 0; i < 6; i++) {
+        out.cloudNodeMAC[i] = (uint8_t)strtol(hex.substr((size_t)i * 2, 2).c_str(), nullptr, 16);
+      }
+      out.present |= 1u << PROPS_CLOUD_NODE_MAC;
+    }
+  }
+
+  float heartbeat = out.thresholds.heartbeatCycles;
+  legacyReadNumber(value, "deadbandDistance", out.thresholds.distanceCm);
+  legacyReadNumber(value, "deadbandLevel", out.thresholds.levelPercent);
+  legacyReadNumber(value, "deadbandBattery", out.thresholds.batteryV);
+  legacyReadNumber(value, "urgentDelta", out.thresholds.urgentLevelPercent);
+  legacyReadNumber(value, "heartbeatCycles", heartbeat);
+  out.thresholds.heartbeatCycles = (heartbeat >= 1 && heartbeat <= 0xFFFF) ? (uint16_t)heartbeat : 0;
+
+  return out.minDistance > 0 && out.maxDistance > 0 && out.refreshRate > 0 && out.totalLitres > 0 &&
+         out.minDistance < out.maxDistance && reportThresholdsValid(out.thresholds);
+}
+
+// ----- Benchmark -----
+
+typedef struct BenchDoc {
+  const char* name;
+  const char* json;
+} BenchDoc;
+
+static const BenchDoc DOCS[] = {
+  {"app write", "{\"minDistance\":20.0,\"maxDistance\":120.0,\"refreshRate\":300,\"totalLitres\":900.0,"
+                "\"cloudNodeMAC\":\"0C:4E:A0:4D:54:8C\"}"},
+  {"with thresholds", "{\"minDistance\":25.5,\"maxDistance\":250.0,\"refreshRate\":600,\"totalLitres\":1500.0,"
+                      "\"cloudNodeMAC\":\"0C:4E:A0:4D:54:8C\",\"deadbandDistance\":1.0,\"deadbandLevel\":0.5,"
+                      "\"deadbandBattery\":0.05,\"urgentDelta\":10.0,\"heartbeatCycles\":24}"},
+  {"minimal", "{\"minDistance\":20,\"maxDistance\":120,\"refreshRate\":300,\"totalLitres\":900}"},
+};
+
+static bool sameUpdate(const PropertiesUpdate& a, const PropertiesUpdate& b) {
+  return a.minDistance == b.minDistance && a.maxDistance == b.maxDistance && a.refreshRate == b.refreshRate &&
+         a.totalLitres == b.totalLitres && a.thresholds.distanceCm == b.thresholds.distanceCm &&
+         a.thresholds.levelPercent == b.thresholds.levelPercent && a.thresholds.batteryV == b.thresholds.batteryV &&
+         a.thresholds.urgentLevelPercent == b.thresholds.urgentLevelPercent &&
+         a.thresholds.heartbeatCycles == b.thresholds.heartbeatCycles &&
+         memcmp(a.cloudNodeMAC, b.cloudNodeMAC, sizeof(a.cloudNodeMAC)) == 0;
+}
+
+template <typename Parse>
+static double timeParser(Parse parse, const uint8_t* json, size_t length, long iterations,
+                         double& allocsPerParse) {
+  static const ReportThresholds current = {
+    REPORT_DEADBAND_DISTANCE_CM, REPORT_DEADBAND_LEVEL_PERCENT, REPORT_DEADBAND_BATTERY_V,
+    REPORT_URGENT_LEVEL_DELTA, REPORT_HEARTBEAT_CYCLES
+  };
+  PropertiesUpdate update;
+  volatile uint32_t sink = 0;
+  unsigned long before = allocations;
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; i++) {
+    parse(json, length, current, update);
+    sink = sink + update.refreshRate;
+  }
+  auto end = std::chrono::steady_clock::now();
+  allocsPerParse = (double)(allocations - before) / iterations;
+  return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+  long iterations = 500000;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = atol(argv[++i]);
+    } else {
+      fprintf(stderr, "Usage: %s [--iterations N]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (iterations < 1) iterations = 1;
+
+  static const ReportThresholds current = {
+    REPORT_DEADBAND_DISTANCE_CM, REPORT_DEADBAND_LEVEL_PERCENT, REPORT_DEADBAND_BATTERY_V,
+    REPORT_URGENT_LEVEL_DELTA, REPORT_HEARTBEAT_CYCLES
+  };
+  bool pass = true;
+
+  printf("props_bench: %ld parses per document\n", iterations);
+  printf("  %-16s %6s  %12s %8s  %12s %8s  %7s\n", "document", "bytes", "legacy ns", "allocs",
+         "propsParse ns", "allocs", "speedup");
+  for (const BenchDoc& doc : DOCS) {
+    const uint8_t* json = (const uint8_t*)doc.json;
+    size_t length = strlen(doc.json);
+
+    PropertiesUpdate legacy, parsed;
+    bool legacyOk = legacyParse(json, length, current, legacy);
+    bool parsedOk = propsParse(json, length, current, parsed).error == PROPS_OK;
+    if (!parsedOk || (legacyOk && !sameUpdate(legacy, parsed))) {
+      printf("  %-16s parsers disagree\n", doc.name);
+      pass = false;
+      continue;
+    }
+
+    double legacyAllocs, parsedAllocs;
+    double legacyNs = timeParser(legacyParse, json, length, iterations, legacyAllocs);
+    double parsedNs = timeParser(
+        [](const uint8_t* j, size_t n, const ReportThresholds& t, PropertiesUpdate& u) { propsParse(j, n, t, u); },
+        json, length, iterations, parsedAllocs);
+    printf("  %-16s %6zu  %12.0f %8.1f  %12.0f %8.1f  %6.1fx\n", doc.name, length, legacyNs, legacyAllocs,
+           parsedNs, parsedAllocs, legacyNs / parsedNs);
+    if (parsedAllocs != 0) pass = false;
+  }
+
+  printf("  result     %s\n", pass ? "PASS" : "FAIL (propsParse allocated or disagreed)");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,268 @@
+/*
+ * Properties JSON Fuzz Target
+ *
+ * Feeds arbitrary bytes to propsParse() and checks, for every input:
+ *   - the result is a known error code at an offset inside the input
+ *   - an accepted update has every required field, in range, with
+ *     minDistance < maxDistance, usable report thresholds and a tank
+ *     geometry that builds a strapping table
+ *   - an accepted update written back out as JSON parses to the same values
+ * Any violation aborts, so the sanitizers and the fuzzer keep the input.
+ *
+ * libFuzzer (clang), from ESP32_Sensor_Node/:
+ *   clang++ -std=gnu++17 -g -O1 -I. -DPROPS_FUZZ_LIBFUZZER -fsanitize=fuzzer,address,undefined \
+ *       sim/props_fuzz.cpp properties_json.cpp report_policy.cpp tank_geometry.cpp -o props_fuzz
+ *   ./props_fuzz -max_len=512
+ *
+ * Standalone (any g++): a deterministic mutation loop over a seed corpus,
+ * or replays the files given on the command line. This is the props_fuzz
+ * target of CMakeLists.txt, built with AddressSanitizer and UBSan.
+ *
+ * Usage: props_fuzz [--iterations N] [--seed S] [FILE...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "properties_json.h"
+
+static const ReportThresholds FUZZ_THRESHOLDS = {
+  REPORT_DEADBAND_DISTANCE_CM, REPORT_DEADBAND_LEVEL_PERCENT, REPORT_DEADBAND_BATTERY_V,
+  REPORT_URGENT_LEVEL_DELTA, REPORT_HEARTBEAT_CYCLES
+};
+
+static void fail(const char* what, const uint8_t* data, size_t size) {
+  fprintf(stderr, "props_fuzz: %s\n  input (%zu bytes): ", what, size);
+  fwrite(data, 1, size, stderr);
+  fprintf(stderr, "\n");
+  abort();
+}
+
+static bool sameFloat(float a, float b) {
+  return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// Write an accepted update back out as properties JSON
+static size_t writeJson(const PropertiesUpdate& u, char* buffer, size_t capacity) {
+  int n = snprintf(buffer, capacity,
+                   "{\"minDistance\":%.9g,\"maxDistance\":%.9g,\"refreshRate\":%u,\"totalLitres\":%.9g,"
+                   "\"deadbandDistance\":%.9g,\"deadbandLevel\":%.9g,\"deadbandBattery\":%.9g,"
+                   "\"urgentDelta\":%.9g,\"heartbeatCycles\":%u",
+                   u.minDistance, u.maxDistance, (unsigned)u.refreshRate, u.totalLitres,
+                   u.thresholds.distanceCm, u.thresholds.levelPercent, u.thresholds.batteryV,
+                   u.thresholds.urgentLevelPercent, (unsigned)u.thresholds.heartbeatCycles);
+  if (propsHasField(u, PROPS_CLOUD_NODE_MAC)) {
+    const uint8_t* m = u.cloudNodeMAC;
+    n += snprintf(buffer + n, capacity - n, ",\"cloudNodeMAC\":\"%02X:%02X:%02X:%02X:%02X:%02X\"",
+                  m[0], m[1], m[2], m[3], m[4], m[5]);
+  }
+  const TankGeometry& g = u.geometry;
+  if (g.shape == TANK_SHAPE_CALIBRATED) {
+    n += snprintf(buffer + n, capacity - n, ",\"strapping\":[");
+    for (int i = 0; i < g.pointCount; i++) {
+      n += snprintf(buffer + n, capacity - n, "%s[%.9g,%.9g]", i > 0 ? "," : "",
+                    g.pointDistanceCm[i], g.pointLitres[i]);
+    }
+    n += snprintf(buffer + n, capacity - n, "]");
+  } else if (propsHasField(u, PROPS_TANK_SHAPE)) {
+    n += snprintf(buffer + n, capacity - n, ",\"tankShape\":\"%s\"", tankShapeName((TankShape)g.shape));
+    if (g.shape == TANK_SHAPE_CAPSULE) {
+      n += snprintf(buffer + n, capacity - n, ",\"tankLength\":%.9g", g.lengthCm);
+    }
+  }
+  n += snprintf(buffer + n, capacity - n, "}");
+  return (size_t)n;
+}
+
+static void checkInput(const uint8_t* data, size_t size) {
+  PropertiesUpdate update;
+  PropsResult result = propsParse(data, size, FUZZ_THRESHOLDS, update);
+
+  if (strcmp(propsErrorName(result.error), "?") == 0) fail("unknown error code", data, size);
+  if (result.offset > size && result.error != PROPS_ERR_TOO_LONG) fail("error offset past the input", data, size);
+
+  char status[PROPS_STATUS_MAX_LEN];
+  size_t statusLength = propsFormatStatus(result, status, sizeof(status));
+  if (statusLength == 0 || statusLength >= sizeof(status) || strlen(status) != statusLength) {
+    fail("status string truncated", data, size);
+  }
+  if (result.error != PROPS_OK) return;
+
+  for (int i = PROPS_MIN_DISTANCE; i <= PROPS_TOTAL_LITRES; i++) {
+    if (!propsHasField(update, (PropsField)i)) fail("accepted without a required field", data, size);
+  }
+  if (!(update.minDistance >= 1 && update.maxDistance <= SENSOR_MAX_RANGE_CM &&
+        update.minDistance < update.maxDistance && update.refreshRate >= 1 &&
+        update.totalLitres > 0 && reportThresholdsValid(update.thresholds))) {
+    fail("accepted an out-of-range value", data, size);
+  }
+  TankStrapTable table;
+  if (propsHasGeometry(update) &&
+      !tankBuildTable(update.geometry, update.minDistance, update.maxDistance, update.totalLitres, table)) {
+    fail("accepted a tank geometry that builds no table", data, size);
+  }
+
+  char json[PROPS_JSON_MAX_LEN];
+  size_t length = writeJson(update, json, sizeof(json));
+  PropertiesUpdate again;
+  PropsResult reparsed = propsParse((const uint8_t*)json, length, FUZZ_THRESHOLDS, again);
+  if (reparsed.error != PROPS_OK) fail("round trip rejected", data, size);
+  if (!sameFloat(again.minDistance, update.minDistance) || !sameFloat(again.maxDistance, update.maxDistance) ||
+      again.refreshRate != update.refreshRate || !sameFloat(again.totalLitres, update.totalLitres) ||
+      !sameFloat(again.thresholds.distanceCm, update.thresholds.distanceCm) ||
+      !sameFloat(again.thresholds.levelPercent, update.thresholds.levelPercent) ||
+      !sameFloat(again.thresholds.batteryV, update.thresholds.batteryV) ||
+      !sameFloat(again.thresholds.urgentLevelPercent, update.thresholds.urgentLevelPercent) ||
+      again.thresholds.heartbeatCycles != update.thresholds.heartbeatCycles ||
+      (propsHasField(update, PROPS_CLOUD_NODE_MAC) &&
+       memcmp(again.cloudNodeMAC, update.cloudNodeMAC, sizeof(update.cloudNodeMAC)) != 0) ||
+      propsHasGeometry(again) != propsHasGeometry(update) ||
+      memcmp(&again.geometry, &update.geometry, sizeof(update.geometry)) != 0) {
+    fail("round trip changed a value", data, size);
+  }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  checkInput(data, size);
+  return 0;
+}
+
+#ifndef PROPS_FUZZ_LIBFUZZER
+
+static const char* const SEEDS[] = {
+  "{\"minDistance\":20.0,\"maxDistance\":120.0,\"refreshRate\":300,\"totalLitres\":900.0,"
+  "\"cloudNodeMAC\":\"0C:4E:A0:4D:54:8C\"}",
+  "{ \"refreshRate\" : 60 , \"totalLitres\" : 1.5e3, \"minDistance\" : 25, \"maxDistance\" : 2.5E2,"
+  " \"deadbandDistance\": 1, \"deadbandLevel\": 0.5, \"deadbandBattery\": 0.05,"
+  " \"urgentDelta\": 10, \"heartbeatCycles\": 12 }",
+  "{\"minDistance\":20,\"maxDistance\":120,\"refreshRate\":300,\"totalLitres\":900,\"cloudNodeMAC\":\"0c4ea04d548c\"}",
+  "{\"minDistance\":120,\"maxDistance\":20,\"refreshRate\":300,\"totalLitres\":900}",
+  "{\"minDistance\":-0.0,\"maxDistance\":1e999,\"refreshRate\":3.5,\"totalLitres\":\"900\"}",
+  "{\"minDistance\":20,\"minDistance\":20,\"extra\":[1,{\"a\":null}],\"cloudNodeMAC\":\"0C-4E-A0:4D\"}",
+  "{\"minDistance\":20,\"maxDistance\":120,\"refreshRate\":300,\"totalLitres\":900,\"tankShape\":\"horizontal\"}",
+  "{\"minDistance\":20,\"maxDistance\":120,\"refreshRate\":300,\"totalLitres\":900,\"tankShape\":\"capsule\","
+  "\"tankLength\":250}",
+  "{\"minDistance\":20,\"maxDistance\":120,\"refreshRate\":300,\"totalLitres\":900,"
+  "\"strapping\":[[118,0],[90,160.5],[60,450],[30,800],[21,895]]}",
+  "{}",
+  "",
+};
+
+// Tokens the mutator splices in
+static const char* const TOKENS[] = {
+  "{", "}", "\"", ":", ",", " ", "-", ".", "e", "E+", "0", "9", "1e38", "true", "null", "[", "\\",
+  "\"minDistance\":", "\"maxDistance\":", "\"refreshRate\":", "\"totalLitres\":", "\"cloudNodeMAC\":",
+  "\"heartbeatCycles\":", "\"urgentDelta\":", "\"deadbandLevel\":", "\"AA:BB:CC:DD:EE:FF\"",
+  "\"tankShape\":", "\"tankLength\":", "\"strapping\":", "\"capsule\"", "[[50,10]]", "],[",
+  "99999999999999999999", "0.000000000000000000001",
+};
+
+static uint64_t rngState = 0x9E3779B97F4A7C15ull;
+
+static uint32_t nextRandom(uint32_t bound) {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 7;
+  rngState ^= rngState << 17;
+  return (uint32_t)(rngState >> 32) % bound;
+}
+
+static size_t mutate(uint8_t* data, size_t size, size_t capacity) {
+  int rounds = 1 + nextRandom(4);
+  for (int r = 0; r < rounds; r++) {
+    switch (nextRandom(5)) {
+      case 0:  // Flip a bit
+        if (size > 0) data[nextRandom(size)] ^= (uint8_t)(1u << nextRandom(8));
+        break;
+      case 1:  // Replace a byte
+        if (size > 0) data[nextRandom(size)] = (uint8_t)nextRandom(256);
+        break;
+      case 2: {  // Delete a run
+        if (size == 0) break;
+        size_t at = nextRandom(size);
+        size_t count = 1 + nextRandom(size - at < 8 ? size - at : 8);
+        memmove(data + at, data + at + count, size - at - count);
+        size -= count;
+        break;
+      }
+      case 3:
+      case 4: {  // Insert a token
+        const char* token = TOKENS[nextRandom(sizeof(TOKENS) / sizeof(TOKENS[0]))];
+        size_t length = strlen(token);
+        if (size + length > capacity) break;
+        size_t at = nextRandom(size + 1);
+        memmove(data + at + length, data + at, size - at);
+        memcpy(data + at, token, length);
+        size += length;
+        break;
+      }
+    }
+  }
+  return size;
+}
+
+static int replayFile(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    fprintf(stderr, "props_fuzz: cannot open %s\n", path);
+    return 1;
+  }
+  static uint8_t data[1 << 16];
+  size_t size = fread(data, 1, sizeof(data), file);
+  fclose(file);
+  checkInput(data, size);
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  long iterations = 2000000;
+  int files = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      rngState = strtoull(argv[++i], nullptr, 0) | 1;
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "Usage: %s [--iterations N] [--seed S] [FILE...]\n", argv[0]);
+      return 1;
+    } else {
+      if (replayFile(argv[i]) != 0) return 1;
+      files++;
+    }
+  }
+  if (files > 0) {
+    printf("props_fuzz: %d file%s OK\n", files, files > 1 ? "s" : "");
+    return 0;
+  }
+
+  const size_t seedCount = sizeof(SEEDS) / sizeof(SEEDS[0]);
+  uint8_t buffer[PROPS_JSON_MAX_LEN + 64];
+  long accepted = 0;
+  long errors[PROPS_ERR_SHAPE + 1] = {0};
+
+  size_t size = 0;
+
+  for (long n = 0; n < iterations; n++) {
+    // Mostly keep mutating the last input; go back to a seed now and then
+    if (n < (long)seedCount || nextRandom(8) == 0) {
+      const char* seed = SEEDS[n % seedCount];
+      size = strlen(seed);
+      memcpy(buffer, seed, size);
+    }
+    if (n >= (long)seedCount) size = mutate(buffer, size, sizeof(buffer));
+
+    checkInput(buffer, size);
+    PropertiesUpdate update;
+    PropsResult result = propsParse(buffer, size, FUZZ_THRESHOLDS, update);
+    errors[result.error]++;
+    if (result.error == PROPS_OK) accepted++;
+  }
+
+  printf("props_fuzz: %ld inputs, %ld accepted, no invariant violations\n", iterations, accepted);
+  for (int e = PROPS_ERR_EMPTY; e <= PROPS_ERR_SHAPE; e++) {
+    printf("  %-14s %ld\n", propsErrorName((PropsError)e), errors[e]);
+  }
+  return 0;
+}
+
+#endif // PROPS_FUZZ_LIBFUZZER
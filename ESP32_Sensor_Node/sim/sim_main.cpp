@@ -0,0 +1,127 @@
+/*
+ * Sensor Node Host Simulation
+ *
+ * Runs the real wake cycle (wake_cycle.cpp and everything below it) on
+ * Linux against hal_linux.cpp: a tank that drains during the day and is
+ * refilled now and then, a Cloud Node on a fixed channel and a lossy
+ * ESP-NOW medium. Prints wake, radio and transmit counts for the run.
+ *
+ * The sensor_sim and sensor_sim_pipelined targets of CMakeLists.txt (see
+ * README.md, "Host Simulation").
+ *
+ * Usage: sensor_sim [--days N] [--loss P] [--channel C] [--seed S] [--assign-slot N]
+ *                   [--legacy-nvs] [--serial-baud B] [--console-ms MS]
+ *                   [--discharge-days D] [--verbose]
+ *
+ * --assign-slot makes the simulated Cloud Node answer every delivered
+ * frame with a transmit slot assignment (tx_slot.h). --legacy-nvs starts
+ * from the per-key NVS entries older firmware wrote, to exercise their
+ * migration into the device config record (device_storage.h).
+ * --serial-baud charges console output to the awake time at that baud
+ * rate and --console-ms adds the sketch's console wait at boot, to
+ * compare LOG_DRAIN_MODE settings (node_log.h). --discharge-days
+ * replaces the fixed 3.9 V battery with a cell that runs flat in D days,
+ * to walk the power governor through its states (battery.h).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim_node.h"
+#include "energy.h"
+#include "tx_slot.h"
+#include "wire_format.h"
+#include "battery.h"
+
+// Gateway reply for --assign-slot: the slot in context, TX_SLOT_COUNT x TX_SLOT_WIDTH_MS frame
+static size_t assignSlotReply(const uint8_t* frame, size_t length, uint8_t* reply,
+                              size_t capacity, void* context) {
+  WireFrame decoded;
+  if (!wireDecode(frame, length, decoded)) return 0;
+  uint16_t slot = *(const uint16_t*)context;
+  return txSlotEncodeAssignment(reply, capacity, decoded.nodeId, slot, TX_SLOT_COUNT, TX_SLOT_WIDTH_MS);
+}
+
+// Device properties as older firmware stored them: one NVS entry per value
+static void seedLegacyNvs(const HalSimConfig& config) {
+  halNvsOpen("device", false);
+  halNvsPutFloat("minDist", 25.0f);
+  halNvsPutFloat("maxDist", 150.0f);
+  halNvsPutU32("refreshRate", 600);
+  halNvsPutFloat("totalLitres", 1200.0f);
+  halNvsPutFloat("dbDist", 2.0f);
+  halNvsPutFloat("dbLevel", 1.5f);
+  halNvsPutFloat("dbBatt", 0.05f);
+  halNvsPutFloat("urgentDelta", 8.0f);
+  halNvsPutU16("heartbeat", 24);
+  halNvsPutBytes("cloudMAC", config.gatewayMac, HAL_MAC_LEN);
+  halNvsClose();
+}
+
+int main(int argc, char** argv) {
+  uint32_t days = 30;
+  int assignSlot = -1;
+  bool legacyNvs = false;
+  bool discharge = false;
+  HalSimConfig config;
+  simDefaultConfig(config);
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) {
+      days = (uint32_t)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+      config.lossRate = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "--channel") == 0 && i + 1 < argc) {
+      config.gatewayChannel = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      config.seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else if (strcmp(argv[i], "--assign-slot") == 0 && i + 1 < argc) {
+      assignSlot = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--legacy-nvs") == 0) {
+      legacyNvs = true;
+    } else if (strcmp(argv[i], "--serial-baud") == 0 && i + 1 < argc) {
+      config.serialBaud = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else if (strcmp(argv[i], "--console-ms") == 0 && i + 1 < argc) {
+      simBootConsoleMs = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else if (strcmp(argv[i], "--discharge-days") == 0 && i + 1 < argc) {
+      simDischarge.days = (float)atof(argv[++i]);
+      discharge = true;
+    } else if (strcmp(argv[i], "--verbose") == 0) {
+      config.quiet = false;
+    } else {
+      fprintf(stderr, "Usage: %s [--days N] [--loss P] [--channel C] [--seed S] [--assign-slot N]\n"
+                      "          [--legacy-nvs] [--serial-baud B] [--console-ms MS]\n"
+                      "          [--discharge-days D] [--verbose]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  halSimConfigure(config);
+  halSimSetEchoModel(simTankDistance, &simTank);
+  if (discharge) halSimSetBatteryModel(simBatteryMilliVolts, &simDischarge);
+  if (legacyNvs) seedLegacyNvs(config);
+  uint32_t seedWrites = halSimStats().nvsWrites;
+  uint16_t slot = (uint16_t)assignSlot;
+  if (assignSlot >= 0) halSimSetGatewayReply(assignSlotReply, &slot);
+  halSimRun(simBootSensorNode, UINT32_MAX, (uint64_t)days * SIM_US_PER_DAY);
+  halSimLoadRtc();
+
+  const HalSimStats& stats = halSimStats();
+  printf("Simulated %u days: %u wakes\n", (unsigned)days, (unsigned)stats.wakes);
+  printf("  awake        %.1f s total, %.1f ms per wake\n",
+         stats.awakeUs / 1e6, stats.wakes ? stats.awakeUs / 1e3 / stats.wakes : 0.0);
+  printf("  radio inits  %u\n", (unsigned)stats.radioInits);
+  printf("  frames       %u sent, %u acked\n", (unsigned)stats.framesSent, (unsigned)stats.framesAcked);
+  printf("  pings        %u\n", (unsigned)stats.pings);
+  printf("  adc reads    %u\n", (unsigned)stats.adcReads);
+  printf("  battery      %.3f V, %s (wakes: %u normal, %u conserve, %u critical)\n", batteryVoltage(),
+         governorStateName(governorState()), (unsigned)governorWakes(GOVERNOR_NORMAL),
+         (unsigned)governorWakes(GOVERNOR_CONSERVE), (unsigned)governorWakes(GOVERNOR_CRITICAL));
+  printf("  nvs          %u reads, %u writes\n", (unsigned)stats.nvsReads,
+         (unsigned)(stats.nvsWrites - seedWrites));
+  const TxSlotPlan& plan = txSlotPlan();
+  printf("  tx slot      %u of %u x %u ms (%s)\n", plan.slot, plan.count, plan.widthMs,
+         plan.assigned ? "assigned" : "node ID");
+  printf("  energy       %.2f mAh/day (%.3f mAh total)\n", energyMahPerDay(), energyTotalMah());
+  return 0;
+}
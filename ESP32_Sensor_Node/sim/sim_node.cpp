@@ -0,0 +1,105 @@
+/*
+ * Simulated Sensor Node Implementation
+ */
+
+#include "sim_node.h"
+#include "config.h"
+#include "profiler.h"
+#include "report_policy.h"
+#include "wake_cycle.h"
+#include "energy.h"
+#include "node_log.h"
+
+// Globals the sketch normally defines (declared extern in config.h / report_policy.h)
+uint8_t cloudNodeAddress[6] = {0x0C, 0x4E, 0xA0, 0x4D, 0x54, 0x8C};
+float emptyDistanceCm = 120.0f;
+float fullDistanceCm = 20.0f;
+float tankCapacityLitres = 900.0f;
+uint32_t refreshRateSeconds = 300;
+ReportThresholds reportThresholds = {
+  REPORT_DEADBAND_DISTANCE_CM, REPORT_DEADBAND_LEVEL_PERCENT, REPORT_DEADBAND_BATTERY_V,
+  REPORT_URGENT_LEVEL_DELTA, REPORT_HEARTBEAT_CYCLES
+};
+
+TankProfile simTank = {80.0f, 3.0f, 95.0f, 10, 0.3f};
+DischargeProfile simDischarge = {60.0f, 15.0f};
+uint32_t simColdBootBleMs = BT_TIMEOUT_MS;
+uint32_t simBootConsoleMs = 0;
+
+static float drainedHoursBefore(uint64_t nowUs) {
+  uint64_t dayStartUs = nowUs - nowUs % SIM_US_PER_DAY;
+  float hourOfDay = (float)(nowUs - dayStartUs) / (float)SIM_US_PER_HOUR;
+  float hours = 0.0f;
+  if (hourOfDay > 7.0f) hours += (hourOfDay < 10.0f ? hourOfDay : 10.0f) - 7.0f;
+  if (hourOfDay > 18.0f) hours += (hourOfDay < 21.0f ? hourOfDay : 21.0f) - 18.0f;
+  return hours;
+}
+
+float simTankDistance(uint64_t nowUs, void* context) {
+  const TankProfile* tank = (const TankProfile*)context;
+
+  uint64_t periodUs = (uint64_t)tank->refillEveryDays * SIM_US_PER_DAY;
+  uint64_t sinceRefillUs = nowUs % periodUs;
+  float level = nowUs < periodUs ? tank->startLevel : tank->refillLevel;
+
+  uint64_t fullDays = sinceRefillUs / SIM_US_PER_DAY;
+  float hours = (float)fullDays * 6.0f + drainedHoursBefore(sinceRefillUs);
+  level -= hours * tank->drainPctPerHour;
+  if (level < 0.0f) level = 0.0f;
+
+  // Deterministic +-noiseCm jitter so repeated runs match
+  uint32_t x = (uint32_t)(nowUs / 1000ULL) * 2654435761u;
+  float jitter = ((float)(x >> 8) / 16777216.0f * 2.0f - 1.0f) * tank->noiseCm;
+
+  return emptyDistanceCm - level / 100.0f * (emptyDistanceCm - fullDistanceCm) + jitter;
+}
+
+// Open-circuit voltage at 100, 90, ... 10, 0 % charge
+static const float CELL_OCV_V[] = {4.20f, 4.06f, 3.98f, 3.92f, 3.87f, 3.82f, 3.79f, 3.77f, 3.74f, 3.68f, 3.30f};
+
+float simBatteryMilliVolts(uint64_t nowUs, void* context) {
+  const DischargeProfile* cell = (const DischargeProfile*)context;
+
+  float used = (float)nowUs / (float)SIM_US_PER_DAY / cell->days * 10.0f;  // Tenths of the charge
+  if (used > 10.0f) used = 10.0f;
+  int step = (int)used;
+  float volts = step >= 10 ? CELL_OCV_V[10]
+                           : CELL_OCV_V[step] + (used - step) * (CELL_OCV_V[step + 1] - CELL_OCV_V[step]);
+
+  // Deterministic noise, different for each conversion
+  uint32_t x = (uint32_t)nowUs * 2246822519u;
+  float noise = ((float)(x >> 8) / 16777216.0f * 2.0f - 1.0f) * cell->noiseMv;
+
+  return volts * 1000.0f / VOLTAGE_DIVIDER_RATIO + noise;
+}
+
+void simDefaultConfig(HalSimConfig& config) {
+  memset(&config, 0, sizeof(config));
+  config.gatewayChannel = 6;
+  memcpy(config.gatewayMac, cloudNodeAddress, HAL_MAC_LEN);
+  const uint8_t nodeMac[HAL_MAC_LEN] = {0x34, 0x85, 0x18, 0x00, 0x00, 0x01};
+  memcpy(config.nodeMac, nodeMac, HAL_MAC_LEN);
+  config.lossRate = 0.05f;
+  config.ackLatencyUs = 2000;
+  config.radioInitUs = 120000;
+  config.batteryMilliVolts = 1950;  // 3.9 V behind the 1:2 divider
+  config.seed = 1;
+  config.quiet = true;
+}
+
+void simBootSensorNode() {
+  PROFILE_BEGIN_CYCLE();
+  Serial.begin(115200);
+  logBegin();
+  logIdleDelay(simBootConsoleMs);
+
+  HalResetReason resetReason = halResetReason();
+  if (resetReason == HAL_RESET_POWERON && simColdBootBleMs > 0) {
+    energyBegin(POWER_BLE);
+    logIdleDelay(simColdBootBleMs);
+    energyEnd(POWER_BLE);
+  }
+
+  loadWakeConfig(resetReason);
+  enterDeepSleep(runWakeCycle());
+}
@@ -0,0 +1,61 @@
+/*
+ * Simulated Sensor Node
+ *
+ * Shared by the host drivers in this directory: the globals the sketch
+ * normally defines, a synthetic tank for the echo model, a discharging
+ * cell for the battery model, the default simulator config and the boot
+ * function that runs one wake.
+ */
+
+#ifndef SIM_NODE_H
+#define SIM_NODE_H
+
+#include <stdint.h>
+#include "hal.h"
+
+static const uint64_t SIM_US_PER_HOUR = 3600ULL * 1000000ULL;
+static const uint64_t SIM_US_PER_DAY = 24ULL * SIM_US_PER_HOUR;
+
+// Synthetic tank: drains drainPctPerHour from 07:00 to 10:00 and 18:00 to
+// 21:00, static otherwise, refilled to refillLevel every refillEveryDays
+typedef struct TankProfile {
+  float startLevel;
+  float drainPctPerHour;
+  float refillLevel;
+  uint32_t refillEveryDays;
+  float noiseCm;
+} TankProfile;
+
+extern TankProfile simTank;
+
+// Li-ion cell that goes from full to empty in days along a typical
+// open-circuit voltage curve, read through the battery divider with
+// +-noiseMv of ADC noise
+typedef struct DischargeProfile {
+  float days;
+  float noiseMv;
+} DischargeProfile;
+
+extern DischargeProfile simDischarge;
+
+// BLE is on for this long on a cold boot before the first reading
+// (pairing window or provisioning); 0 skips it
+extern uint32_t simColdBootBleMs;
+
+// Console wait at the start of every wake, like the sketch's delay after
+// Serial.begin(). Deferred log records drain there either way; 0 adds no wait
+extern uint32_t simBootConsoleMs;
+
+// Echo model for halSimSetEchoModel(); context is a TankProfile
+float simTankDistance(uint64_t nowUs, void* context);
+
+// Battery model for halSimSetBatteryModel(); context is a DischargeProfile
+float simBatteryMilliVolts(uint64_t nowUs, void* context);
+
+// Gateway on channel 6, 5 % loss, 3.9 V battery, quiet console
+void simDefaultConfig(HalSimConfig& config);
+
+// One wake: config load, wake cycle, deep sleep (pass to halSimRun())
+void simBootSensorNode();
+
+#endif // SIM_NODE_H
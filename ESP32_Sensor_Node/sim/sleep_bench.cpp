@@ -0,0 +1,146 @@
+/*
+ * Adaptive Sleep Benchmark
+ *
+ * Drives sleepSchedulerNext() (sleep_scheduler.h) through a simulated
+ * week of tank use and compares it with sleeping a fixed refresh rate:
+ * wakes, sleep lengths, and the largest true level change between two
+ * wakes (what the gateway can miss). Exits 1 if the scheduler ever picks
+ * a sleep outside SLEEP_MIN_S..SLEEP_MAX_S.
+ *
+ * Tank profile (--days days, 1 s steps, starting at 75 %):
+ *   slow burn      -0.02 %/h all the time
+ *   heavy draw     -4 %/h from 18:00 to 20:00 every day
+ *   fill           +20 %/h from 10:00 to 12:00 on day 3
+ *   noise          uniform +/- --noise % on every reading
+ *
+ * Runs (refresh rate --refresh s):
+ *   fixed          the refresh rate every wake
+ *   adaptive       the scheduler, battery healthy
+ *   low battery    the scheduler, battery below SLEEP_LOW_BATTERY_V
+ *
+ * The sleep_bench target of CMakeLists.txt (see README.md, "Sleep Configuration").
+ *
+ * Usage: sleep_bench [--days N] [--refresh S] [--noise PCT] [--seed S]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "sleep_scheduler.h"
+
+static const float START_LEVEL_PCT = 75.0f;
+static const float BURN_PCT_PER_H = -0.02f;
+static const float DRAW_PCT_PER_H = -4.0f;
+static const float FILL_PCT_PER_H = 20.0f;
+static const int FILL_DAY = 3;
+static const float HEALTHY_BATTERY_V = 4.0f;
+
+// True level for every second of the run
+static std::vector<float> buildProfile(int days) {
+  std::vector<float> level((size_t)days * 86400 + 1);
+  float current = START_LEVEL_PCT;
+  for (size_t s = 0; s < level.size(); s++) {
+    level[s] = current;
+    int day = (int)(s / 86400);
+    int hour = (int)(s % 86400) / 3600;
+    float rate = BURN_PCT_PER_H;
+    if (hour >= 18 && hour < 20) rate += DRAW_PCT_PER_H;
+    if (day == FILL_DAY && hour >= 10 && hour < 12) rate += FILL_PCT_PER_H;
+    current += rate / 3600.0f;
+    if (current < 0.0f) current = 0.0f;
+    if (current > 100.0f) current = 100.0f;
+  }
+  return level;
+}
+
+typedef struct RunResult {
+  uint32_t wakes;
+  uint32_t minSleepS;
+  uint32_t medianSleepS;
+  uint32_t maxSleepS;
+  float worstMissPct;
+  bool inBounds;
+} RunResult;
+
+static RunResult runProfile(const std::vector<float>& level, bool adaptive, float batteryV,
+                            uint32_t refreshS, float noisePct, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> noise(-noisePct, noisePct);
+  std::vector<uint32_t> sleeps;
+  RunResult result = {0, 0, 0, 0, 0.0f, true};
+  sleepSchedulerReset();
+
+  size_t end = level.size() - 1;
+  size_t now = 0;
+  while (now < end) {
+    result.wakes++;
+    float reading = level[now] + noise(rng);
+    uint32_t sleepS = refreshS;
+    if (adaptive) {
+      sleepS = sleepSchedulerNext(reading, batteryV, (uint64_t)now * 1000ULL, refreshS);
+      if (sleepS < SLEEP_MIN_S || sleepS > SLEEP_MAX_S) result.inBounds = false;
+    }
+    sleeps.push_back(sleepS);
+
+    size_t next = std::min(end, now + sleepS);
+    float miss = level[next] - level[now];
+    if (miss < 0) miss = -miss;
+    if (miss > result.worstMissPct) result.worstMissPct = miss;
+    now = next;
+  }
+
+  std::sort(sleeps.begin(), sleeps.end());
+  result.minSleepS = sleeps.front();
+  result.medianSleepS = sleeps[sleeps.size() / 2];
+  result.maxSleepS = sleeps.back();
+  return result;
+}
+
+static void printRun(const char* name, const RunResult& r) {
+  printf("  %-12s %7u %9u %9u %9u %11.2f\n", name, r.wakes, r.minSleepS, r.medianSleepS, r.maxSleepS,
+         r.worstMissPct);
+}
+
+int main(int argc, char** argv) {
+  int days = 7;
+  uint32_t refreshS = 300;
+  float noisePct = 0.4f;
+  uint32_t seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--days") == 0 && i + 1 < argc) {
+      days = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--refresh") == 0 && i + 1 < argc) {
+      refreshS = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else if (strcmp(argv[i], "--noise") == 0 && i + 1 < argc) {
+      noisePct = (float)atof(argv[++i]);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = (uint32_t)strtoul(argv[++i], nullptr, 0);
+    } else {
+      fprintf(stderr, "Usage: %s [--days N] [--refresh S] [--noise PCT] [--seed S]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (days < 1) days = 1;
+  if (refreshS < 1) refreshS = 1;
+
+  std::vector<float> level = buildProfile(days);
+  RunResult fixed = runProfile(level, false, HEALTHY_BATTERY_V, refreshS, noisePct, seed);
+  RunResult adaptive = runProfile(level, true, HEALTHY_BATTERY_V, refreshS, noisePct, seed);
+  RunResult lowBattery = runProfile(level, true, SLEEP_LOW_BATTERY_V - 0.1f, refreshS, noisePct, seed);
+
+  printf("%d days, refresh %u s, +/-%.1f %% noise, sleep %u..%u s\n", days, refreshS, noisePct,
+         SLEEP_MIN_S, SLEEP_MAX_S);
+  printf("  %-12s %7s %9s %9s %9s %11s\n", "run", "wakes", "min s", "median s", "max s", "worst miss %");
+  printRun("fixed", fixed);
+  printRun("adaptive", adaptive);
+  printRun("low battery", lowBattery);
+
+  if (!adaptive.inBounds || !lowBattery.inBounds) {
+    printf("Scheduler picked a sleep outside %u..%u s\n", SLEEP_MIN_S, SLEEP_MAX_S);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * Tank Strapping Table Benchmark
+ *
+ * Builds the strapping tables (tank_geometry.h) for each shape and checks
+ * them against the exact formulas at every Q16 level: worst error in % of
+ * capacity, and that the volume never falls as the level rises. Then times
+ * one lookup against the float formula it replaces on the node, in ns and
+ * in host cycles (TSC ticks on x86). Exits 1 if a shape table is off by
+ * more than the limit or not monotonic.
+ *
+ * Cases (level span 100 cm):
+ *   vertical      constant cross-section
+ *   horizontal    horizontal cylinder, flat ends
+ *   capsule 1.0   sphere (length = diameter)
+ *   capsule 1.5   short capsule
+ *   capsule 4.0   long capsule
+ *   calibrated    12 points measured off a horizontal cylinder, compared
+ *                 with the cylinder (shows what sparse points cost, not
+ *                 checked against the limit)
+ *
+ * The tank_bench target of CMakeLists.txt (see README.md, "Host Simulation").
+ * Other table sizes: configure with -DCMAKE_CXX_FLAGS=-DTANK_STRAP_SEGMENTS_LOG2=N
+ *
+ * Usage: tank_bench [--iterations N] [--limit PCT]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "tank_geometry.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t cycles() { return __rdtsc(); }
+#define HAVE_CYCLES 1
+#else
+static uint64_t cycles() { return 0; }
+#define HAVE_CYCLES 0
+#endif
+
+static const float SPAN_CM = 100.0f;
+static const float FULL_CM = 20.0f;
+static const float CAPACITY_L = 1000.0f;
+
+typedef struct BenchCase {
+  const char* name;
+  TankShape shape;
+  double lengthRatio;
+  bool checked;
+} BenchCase;
+
+static const BenchCase CASES[] = {
+  {"vertical", TANK_SHAPE_VERTICAL, 1.0, true},
+  {"horizontal", TANK_SHAPE_HORIZONTAL, 1.0, true},
+  {"capsule 1.0", TANK_SHAPE_CAPSULE, 1.0, true},
+  {"capsule 1.5", TANK_SHAPE_CAPSULE, 1.5, true},
+  {"capsule 4.0", TANK_SHAPE_CAPSULE, 4.0, true},
+  {"calibrated", TANK_SHAPE_CALIBRATED, 1.0, false},
+};
+
+// Shape the case is compared with (calibrated points come off a cylinder)
+static TankShape referenceShape(const BenchCase& c) {
+  return c.shape == TANK_SHAPE_CALIBRATED ? TANK_SHAPE_HORIZONTAL : c.shape;
+}
+
+static TankGeometry caseGeometry(const BenchCase& c) {
+  TankGeometry geometry;
+  tankDefaultGeometry(geometry);
+  geometry.shape = c.shape;
+  geometry.lengthCm = (float)(c.lengthRatio * SPAN_CM);
+  if (c.shape == TANK_SHAPE_CALIBRATED) {
+    // Like a dipstick calibration: a reading every 1/13 of the height
+    int count = TANK_CALIBRATION_MAX_POINTS;
+    geometry.pointCount = (uint8_t)count;
+    for (int i = 0; i < count; i++) {
+      double level = (i + 1.0) / (count + 1.0);
+      geometry.pointDistanceCm[i] = (float)(FULL_CM + SPAN_CM * (1.0 - level));
+      geometry.pointLitres[i] = (float)(CAPACITY_L * tankShapeFraction(TANK_SHAPE_HORIZONTAL, 1.0, level));
+    }
+  }
+  return geometry;
+}
+
+// Float formula a node without a table would evaluate per reading
+static float formulaFraction(TankShape shape, float lengthRatio, float level) {
+  float c = 1.0f - 2.0f * level;
+  float cylinder = (acosf(c) - c * sqrtf(1.0f - c * c)) / (float)M_PI;
+  if (shape == TANK_SHAPE_HORIZONTAL) return cylinder;
+  if (shape != TANK_SHAPE_CAPSULE) return level;
+  float straight = (lengthRatio - 1.0f) * (float)M_PI / 4.0f;
+  float cap = (float)M_PI * level * level * (1.5f - level) / 3.0f;
+  return (straight * cylinder + cap) / (straight + (float)M_PI / 6.0f);
+}
+
+static volatile uint32_t sink;
+
+int main(int argc, char** argv) {
+  long iterations = 2000000;
+  double limitPercent = 0.1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+      iterations = atol(argv[++i]);
+    } else if (strcmp(argv[i], "--limit") == 0 && i + 1 < argc) {
+      limitPercent = atof(argv[++i]);
+    } else {
+      fprintf(stderr, "Usage: %s [--iterations N] [--limit PCT]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (iterations < 1) iterations = 1;
+
+  // Same pseudo-random levels for every timing run
+  std::vector<uint32_t> levels(4096);
+  uint32_t rng = 12345;
+  for (size_t i = 0; i < levels.size(); i++) {
+    rng = rng * 1664525u + 1013904223u;
+    levels[i] = rng >> 15;  // 0..131071, about half of them past full
+    if (levels[i] > TANK_LEVEL_FULL) levels[i] -= TANK_LEVEL_FULL;
+  }
+  const size_t mask = levels.size() - 1;
+
+  printf("Strapping table: %d segments, %d bytes; limit %.3f %% of capacity; %ld lookups per timing\n\n",
+         TANK_STRAP_SEGMENTS, (int)sizeof(TankStrapTable), limitPercent, iterations);
+  printf("%-12s %10s %10s %10s %9s %9s %9s %9s\n", "case", "max err %", "at level", "build us",
+         "table ns", "formula", "table cy", "formula");
+
+  bool ok = true;
+  for (const BenchCase& c : CASES) {
+    TankGeometry geometry = caseGeometry(c);
+    TankStrapTable table;
+
+    auto buildStart = std::chrono::steady_clock::now();
+    bool built = tankBuildTable(geometry, FULL_CM, FULL_CM + SPAN_CM, CAPACITY_L, table);
+    double buildUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - buildStart).count();
+    if (!built || table.shape != c.shape) {
+      printf("%-12s table not built\n", c.name);
+      ok = false;
+      continue;
+    }
+
+    // Every Q16 level
+    double worst = 0.0;
+    double worstLevel = 0.0;
+    bool monotonic = true;
+    uint16_t previous = 0;
+    for (uint32_t q = 0; q <= TANK_LEVEL_FULL; q++) {
+      uint16_t value = tankLookup(table, q);
+      if (value < previous) monotonic = false;
+      previous = value;
+      double level = (double)q / TANK_LEVEL_FULL;
+      double exact = tankShapeFraction(referenceShape(c), c.lengthRatio, level);
+      double error = fabs((double)value / TANK_FRACTION_FULL - exact) * 100.0;
+      if (error > worst) {
+        worst = error;
+        worstLevel = level * 100.0;
+      }
+    }
+
+    // Lookup as tankLitres() does it, against the formula in float
+    uint64_t cycleStart = cycles();
+    auto start = std::chrono::steady_clock::now();
+    uint32_t acc = 0;
+    for (long n = 0; n < iterations; n++) {
+      acc += tankLookup(table, levels[n & mask]);
+    }
+    double tableNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                     iterations;
+    double tableCycles = (double)(cycles() - cycleStart) / iterations;
+    sink = acc;
+
+    float ratio = (float)c.lengthRatio;
+    TankShape shape = referenceShape(c);
+    cycleStart = cycles();
+    start = std::chrono::steady_clock::now();
+    float facc = 0.0f;
+    for (long n = 0; n < iterations; n++) {
+      float level = (float)levels[n & mask] * (1.0f / TANK_LEVEL_FULL);
+      facc += formulaFraction(shape, ratio, level > 1.0f ? 1.0f : level);
+    }
+    double formulaNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                       iterations;
+    double formulaCycles = (double)(cycles() - cycleStart) / iterations;
+    sink = (uint32_t)facc;
+
+    bool pass = !c.checked || (worst <= limitPercent && monotonic);
+    if (!pass) ok = false;
+    printf("%-12s %10.4f %10.2f %10.1f %9.2f %9.2f", c.name, worst, worstLevel, buildUs, tableNs, formulaNs);
+    if (HAVE_CYCLES) {
+      printf(" %9.1f %9.1f", tableCycles, formulaCycles);
+    } else {
+      printf(" %9s %9s", "-", "-");
+    }
+    printf("%s%s\n", monotonic ? "" : "  NOT MONOTONIC", pass ? "" : "  FAIL");
+  }
+
+  printf("\n%s\n", ok ? "All shape tables within the limit" : "Shape table check FAILED");
+  return ok ? 0 : 1;
+}
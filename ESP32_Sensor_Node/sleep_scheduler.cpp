@@ -0,0 +1,98 @@
+/*
+ * Adaptive Sleep Scheduler Implementation
+ */
+
+#include "sleep_scheduler.h"
+#include <string.h>
+
+static const uint32_t SLEEP_STATE_MAGIC = 0x534C5031;  // "SLP1"
+
+typedef struct SleepState {
+  uint32_t magic;
+  uint32_t lastSleepS;       // Length of the last scheduled sleep
+  uint64_t lastMs;           // Node clock of the previous reading
+  float lastLevel;           // Level of the previous reading
+  float ratePctPerHour;      // Smoothed absolute level rate
+  uint8_t mode;              // SleepMode of the last decision
+  uint8_t reserved[3];
+} SleepState;
+
+// RTC memory scheduler state (survives deep sleep)
+RTC_DATA_ATTR SleepState sleepState;
+
+static bool stateValid() {
+  return sleepState.magic == SLEEP_STATE_MAGIC;
+}
+
+static uint32_t clampSeconds(float s, uint32_t lo, uint32_t hi) {
+  if (s < (float)lo) return lo;
+  if (s > (float)hi) return hi;
+  return (uint32_t)s;
+}
+
+uint32_t sleepSchedulerNext(float levelPercent, float batteryV, uint64_t nowMs,
+                            uint32_t refreshRateSeconds) {
+  uint32_t base = clampSeconds((float)refreshRateSeconds, SLEEP_MIN_S, SLEEP_MAX_S);
+
+  if (!stateValid()) {
+    memset(&sleepState, 0, sizeof(sleepState));
+    sleepState.magic = SLEEP_STATE_MAGIC;
+    sleepState.lastMs = nowMs;
+    sleepState.lastLevel = levelPercent;
+    sleepState.lastSleepS = base;
+    sleepState.mode = SLEEP_MODE_BASE;
+    return base;
+  }
+
+  // Level rate since the previous reading; changes inside the noise band count as none
+  if (nowMs > sleepState.lastMs) {
+    float delta = levelPercent - sleepState.lastLevel;
+    if (delta < 0) delta = -delta;
+    if (delta <= SLEEP_LEVEL_NOISE_PCT) delta = 0;
+    float hours = (float)(nowMs - sleepState.lastMs) / 3600000.0f;
+    float rate = delta / hours;
+    sleepState.ratePctPerHour += SLEEP_RATE_SMOOTHING * (rate - sleepState.ratePctPerHour);
+  }
+  sleepState.lastMs = nowMs;
+  sleepState.lastLevel = levelPercent;
+
+  float rate = sleepState.ratePctPerHour;
+  bool lowBattery = batteryV > 0 && batteryV < SLEEP_LOW_BATTERY_V;
+  uint32_t next;
+
+  if (lowBattery || rate < SLEEP_STATIC_RATE_PCT_PER_H) {
+    // Stretch from wherever we are (at least the refresh rate) toward the ceiling
+    uint32_t from = sleepState.lastSleepS > base ? sleepState.lastSleepS : base;
+    next = clampSeconds(from * SLEEP_STRETCH_FACTOR, base, SLEEP_MAX_S);
+    sleepState.mode = lowBattery ? SLEEP_MODE_LOW_BATTERY : SLEEP_MODE_STATIC;
+  } else {
+    // Aim for SLEEP_TARGET_DELTA_PCT of level change per wake
+    next = clampSeconds(SLEEP_TARGET_DELTA_PCT / rate * 3600.0f, SLEEP_MIN_S, base);
+    sleepState.mode = next < base ? SLEEP_MODE_FAST : SLEEP_MODE_BASE;
+  }
+
+  sleepState.lastSleepS = next;
+  return next;
+}
+
+float sleepSchedulerRatePctPerHour() {
+  return stateValid() ? sleepState.ratePctPerHour : 0.0f;
+}
+
+SleepMode sleepSchedulerMode() {
+  return stateValid() ? (SleepMode)sleepState.mode : SLEEP_MODE_BASE;
+}
+
+const char* sleepModeName(SleepMode mode) {
+  switch (mode) {
+    case SLEEP_MODE_BASE:        return "refresh rate";
+    case SLEEP_MODE_FAST:        return "level moving";
+    case SLEEP_MODE_STATIC:      return "level static";
+    case SLEEP_MODE_LOW_BATTERY: return "low battery";
+  }
+  return "?";
+}
+
+void sleepSchedulerReset() {
+  memset(&sleepState, 0, sizeof(sleepState));
+}
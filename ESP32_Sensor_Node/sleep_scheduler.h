@@ -0,0 +1,44 @@
+/*
+ * Adaptive Sleep Scheduler
+ *
+ * Picks the next deep sleep length from the configured refresh rate and
+ * how fast the level is moving. While the tank fills or drains quickly
+ * the sleep shrinks so each wake sees about SLEEP_TARGET_DELTA_PCT of
+ * change (never below SLEEP_MIN_S). While the tank is static, or the
+ * battery is low, it stretches by SLEEP_STRETCH_FACTOR per wake up to
+ * SLEEP_MAX_S. The level-rate estimate lives in RTC memory.
+ *
+ * No Arduino dependencies, so it can be simulated on the host.
+ */
+
+#ifndef SLEEP_SCHEDULER_H
+#define SLEEP_SCHEDULER_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Why the last sleep length was chosen
+enum SleepMode : uint8_t {
+  SLEEP_MODE_BASE = 0,    // Configured refresh rate
+  SLEEP_MODE_FAST,        // Level moving quickly - shortened
+  SLEEP_MODE_STATIC,      // Level static - stretched
+  SLEEP_MODE_LOW_BATTERY  // Battery low - stretched
+};
+
+// Feed this wake's reading and get the next sleep length in seconds
+uint32_t sleepSchedulerNext(float levelPercent, float batteryV, uint64_t nowMs,
+                            uint32_t refreshRateSeconds);
+
+// Smoothed level rate in percent per hour (0 until two readings are known)
+float sleepSchedulerRatePctPerHour();
+
+// Reason for the last sleepSchedulerNext() result
+SleepMode sleepSchedulerMode();
+
+// Short name for logs
+const char* sleepModeName(SleepMode mode);
+
+// Forget the rate history (next wake uses the refresh rate)
+void sleepSchedulerReset();
+
+#endif // SLEEP_SCHEDULER_H
@@ -0,0 +1,165 @@
+/*
+ * Tank Geometry and Strapping Table Implementation
+ */
+
+#include "tank_geometry.h"
+#include <math.h>
+#include <string.h>
+
+static_assert(TANK_STRAP_SEGMENTS_LOG2 >= 1 && TANK_STRAP_SEGMENTS_LOG2 <= 8,
+              "TANK_STRAP_SEGMENTS_LOG2 must be 1..8");
+static_assert(TANK_CALIBRATION_MAX_POINTS >= 2, "calibration needs at least two points");
+
+static const int LEVEL_SHIFT = 16 - TANK_STRAP_SEGMENTS_LOG2;  // Q16 level bits below the index
+static const uint32_t LEVEL_MASK = (1u << LEVEL_SHIFT) - 1;
+
+static TankStrapTable activeTable;
+static bool activeSet = false;
+
+// Volume fraction of a horizontal cylinder filled to level (0-1) of its diameter
+static double cylinderFraction(double level) {
+  double c = 1.0 - 2.0 * level;
+  return (acos(c) - c * sqrt(1.0 - c * c)) / M_PI;
+}
+
+double tankShapeFraction(TankShape shape, double lengthRatio, double level) {
+  if (level <= 0.0) return 0.0;
+  if (level >= 1.0) return 1.0;
+
+  switch (shape) {
+    case TANK_SHAPE_HORIZONTAL:
+      return cylinderFraction(level);
+    case TANK_SHAPE_CAPSULE: {
+      // Unit diameter: straight section of lengthRatio - 1 plus one sphere
+      // made of the two ends, whose cap holds pi h^2 (3r - h) / 3
+      double straight = lengthRatio > 1.0 ? lengthRatio - 1.0 : 0.0;
+      double cylinder = M_PI / 4.0 * straight;
+      double sphere = M_PI / 6.0;
+      double cap = M_PI * level * level * (1.5 - level) / 3.0;
+      return (cylinder * cylinderFraction(level) + cap) / (cylinder + sphere);
+    }
+    default:
+      return level;
+  }
+}
+
+// Fraction at level from the calibration points, taken as a piecewise
+// linear curve through (0, 0) and (1, 1) beyond the outermost points
+static double calibratedFraction(const double* levels, const double* fractions, int count, double level) {
+  double lowLevel = 0.0, lowFraction = 0.0;
+  for (int i = 0; i <= count; i++) {
+    double highLevel = i < count ? levels[i] : 1.0;
+    double highFraction = i < count ? fractions[i] : 1.0;
+    if (level <= highLevel) {
+      if (highLevel <= lowLevel) return highFraction;
+      return lowFraction + (highFraction - lowFraction) * (level - lowLevel) / (highLevel - lowLevel);
+    }
+    lowLevel = highLevel;
+    lowFraction = highFraction;
+  }
+  return 1.0;
+}
+
+static uint16_t quantize(double fraction) {
+  if (fraction <= 0.0) return 0;
+  if (fraction >= 1.0) return TANK_FRACTION_FULL;
+  return (uint16_t)(fraction * TANK_FRACTION_FULL + 0.5);
+}
+
+// Fill table from fraction(level); keeps it non-decreasing so the lookup
+// never has to handle a negative step
+template <typename Fraction>
+static void fillTable(TankStrapTable& table, TankShape shape, Fraction fraction) {
+  memset(&table, 0, sizeof(table));
+  table.shape = (uint8_t)shape;
+  uint16_t previous = 0;
+  for (int i = 0; i < TANK_STRAP_POINTS; i++) {
+    uint16_t value = quantize(fraction((double)i / TANK_STRAP_SEGMENTS));
+    if (value < previous) value = previous;
+    table.volume[i] = value;
+    previous = value;
+  }
+}
+
+bool tankBuildTable(const TankGeometry& geometry, float fullDistanceCm, float emptyDistanceCm,
+                    float capacityLitres, TankStrapTable& table) {
+  // Same float difference propsParse() checks tankLength against
+  double span = emptyDistanceCm - fullDistanceCm;
+  TankShape shape = (TankShape)geometry.shape;
+  bool valid = span > 0.0 && capacityLitres > 0.0f;
+
+  if (valid && shape == TANK_SHAPE_CAPSULE) {
+    double ratio = geometry.lengthCm / span;
+    valid = ratio >= 1.0;
+    if (valid) {
+      fillTable(table, shape, [ratio](double level) {
+        return tankShapeFraction(TANK_SHAPE_CAPSULE, ratio, level);
+      });
+      return true;
+    }
+  } else if (valid && shape == TANK_SHAPE_CALIBRATED) {
+    int count = geometry.pointCount;
+    valid = count >= 2 && count <= TANK_CALIBRATION_MAX_POINTS;
+    double levels[TANK_CALIBRATION_MAX_POINTS];
+    double fractions[TANK_CALIBRATION_MAX_POINTS];
+    for (int i = 0; valid && i < count; i++) {
+      levels[i] = ((double)emptyDistanceCm - geometry.pointDistanceCm[i]) / span;
+      fractions[i] = geometry.pointLitres[i] / capacityLitres;
+      valid = fractions[i] >= 0.0 && fractions[i] <= 1.0 &&
+              (i == 0 || (levels[i] > levels[i - 1] && fractions[i] > fractions[i - 1]));
+    }
+    if (valid) {
+      fillTable(table, shape, [&levels, &fractions, count](double level) {
+        return calibratedFraction(levels, fractions, count, level);
+      });
+      return true;
+    }
+  } else if (valid && shape < TANK_SHAPE_COUNT) {
+    fillTable(table, shape, [shape](double level) {
+      return tankShapeFraction(shape, 1.0, level);
+    });
+    return true;
+  }
+
+  fillTable(table, TANK_SHAPE_VERTICAL, [](double level) { return level; });
+  return false;
+}
+
+uint16_t tankLookup(const TankStrapTable& table, uint32_t levelQ16) {
+  if (levelQ16 >= TANK_LEVEL_FULL) return table.volume[TANK_STRAP_SEGMENTS];
+  uint32_t index = levelQ16 >> LEVEL_SHIFT;
+  uint32_t low = table.volume[index];
+  uint32_t step = table.volume[index + 1] - low;
+  return (uint16_t)(low + ((step * (levelQ16 & LEVEL_MASK)) >> LEVEL_SHIFT));
+}
+
+void tankSetTable(const TankStrapTable& table) {
+  activeTable = table;
+  activeSet = true;
+}
+
+const TankStrapTable& tankActiveTable() {
+  if (!activeSet) {
+    TankGeometry geometry;
+    tankDefaultGeometry(geometry);
+    tankBuildTable(geometry, 0.0f, 1.0f, 1.0f, activeTable);
+    activeSet = true;
+  }
+  return activeTable;
+}
+
+float tankLitres(float levelPercent, float capacityLitres) {
+  if (levelPercent <= 0.0f) return 0.0f;
+  uint32_t levelQ16 = levelPercent >= 100.0f ? TANK_LEVEL_FULL
+                                             : (uint32_t)(levelPercent * (TANK_LEVEL_FULL / 100.0f) + 0.5f);
+  return tankLitresAtLevel(levelQ16, capacityLitres);
+}
+
+float tankLitresAtLevel(uint32_t levelQ16, float capacityLitres) {
+  return tankLookup(tankActiveTable(), levelQ16) * (capacityLitres / TANK_FRACTION_FULL);
+}
+
+void tankDefaultGeometry(TankGeometry& geometry) {
+  memset(&geometry, 0, sizeof(geometry));
+  geometry.shape = TANK_SHAPE_VERTICAL;
+}
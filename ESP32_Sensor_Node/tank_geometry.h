@@ -0,0 +1,94 @@
+/*
+ * Tank Geometry and Strapping Table
+ *
+ * Maps the level (0-100 % of the span between emptyDistanceCm and
+ * fullDistanceCm) to the fraction of tankCapacityLitres in the tank.
+ * For anything but a vertical tank that map is non-linear, so it is
+ * tabulated once, when the properties are written: TANK_STRAP_SEGMENTS + 1
+ * volume fractions at evenly spaced levels, built from the shape formula
+ * or from the user's calibration points. Every reading is then an index
+ * and a fixed-point linear interpolation, no trigonometry on the node.
+ *
+ * Shapes lying on their side take the level span as the inside diameter,
+ * so the sensor's empty and full distances should be the bottom and top
+ * of the shell.
+ *
+ * No Arduino dependencies, so the tables can be checked on the host.
+ */
+
+#ifndef TANK_GEOMETRY_H
+#define TANK_GEOMETRY_H
+
+#include <stdint.h>
+#include "config.h"
+
+#define TANK_STRAP_SEGMENTS (1 << TANK_STRAP_SEGMENTS_LOG2)
+#define TANK_STRAP_POINTS (TANK_STRAP_SEGMENTS + 1)
+#define TANK_FRACTION_FULL 65535   // Table value of a full tank
+#define TANK_LEVEL_FULL 65536      // Q16 level of a full tank
+
+enum TankShape : uint8_t {
+  TANK_SHAPE_VERTICAL = 0,   // Constant cross-section (litres follow the level)
+  TANK_SHAPE_HORIZONTAL,     // Horizontal cylinder with flat ends
+  TANK_SHAPE_CAPSULE,        // Horizontal cylinder with hemispherical ends
+  TANK_SHAPE_CALIBRATED,     // Interpolated from the user's calibration points
+  TANK_SHAPE_COUNT
+};
+
+// What the user configured (no padding, so records compare with memcmp)
+typedef struct TankGeometry {
+  uint8_t shape;             // TankShape
+  uint8_t pointCount;        // Calibration points used (TANK_SHAPE_CALIBRATED)
+  uint16_t reserved;
+  float lengthCm;            // Overall length, end to end (TANK_SHAPE_CAPSULE)
+  float pointDistanceCm[TANK_CALIBRATION_MAX_POINTS];  // In filling order:
+  float pointLitres[TANK_CALIBRATION_MAX_POINTS];      // distance falls, litres rise
+} TankGeometry;
+
+// Volume fraction at level i / TANK_STRAP_SEGMENTS, non-decreasing
+typedef struct TankStrapTable {
+  uint8_t shape;             // TankShape it was built for
+  uint8_t reserved;
+  uint16_t volume[TANK_STRAP_POINTS];  // TANK_FRACTION_FULL = tankCapacityLitres
+} TankStrapTable;
+
+// Build the table for geometry over the given span and capacity. Falls
+// back to the vertical table and returns false if the geometry does not
+// fit (capsule shorter than its diameter, calibration out of order)
+bool tankBuildTable(const TankGeometry& geometry, float fullDistanceCm, float emptyDistanceCm,
+                    float capacityLitres, TankStrapTable& table);
+
+// Exact volume fraction of a shape at level (0-1). lengthRatio is the
+// overall length over the diameter (capsule only). The reference the
+// tables are built from and checked against
+double tankShapeFraction(TankShape shape, double lengthRatio, double level);
+
+// Volume fraction (TANK_FRACTION_FULL = full) at a Q16 level
+// (TANK_LEVEL_FULL = full). Constant time, integer only
+uint16_t tankLookup(const TankStrapTable& table, uint32_t levelQ16);
+
+// Table used by tankLitres() (vertical until one is set)
+void tankSetTable(const TankStrapTable& table);
+const TankStrapTable& tankActiveTable();
+
+// Litres at levelPercent through the active table
+float tankLitres(float levelPercent, float capacityLitres);
+
+// Litres at a Q16 level through the active table
+float tankLitresAtLevel(uint32_t levelQ16, float capacityLitres);
+
+// Vertical tank geometry (the default)
+void tankDefaultGeometry(TankGeometry& geometry);
+
+static inline const char* tankShapeName(TankShape shape) {
+  switch (shape) {
+    case TANK_SHAPE_VERTICAL:   return "vertical";
+    case TANK_SHAPE_HORIZONTAL: return "horizontal";
+    case TANK_SHAPE_CAPSULE:    return "capsule";
+    case TANK_SHAPE_CALIBRATED: return "calibrated";
+    default: break;
+  }
+  return "?";
+}
+
+#endif // TANK_GEOMETRY_H
@@ -0,0 +1,136 @@
+/*
+ * Transmit Slot Scheduler Implementation
+ */
+
+#include "tx_slot.h"
+#include <string.h>
+
+static const uint32_t TX_SLOT_STATE_MAGIC = 0x534C5431;  // "SLT1"
+
+// Longest frame an assignment may ask for: two frames must fit in the shortest sleep
+static const uint32_t TX_SLOT_MAX_FRAME_MS = SLEEP_MIN_S * 1000UL / 2;
+
+typedef struct TxSlotState {
+  uint32_t magic;
+  uint32_t rng;              // xorshift32 state for jitter and backoff
+  TxSlotPlan plan;
+} TxSlotState;
+
+// RTC memory slot state (survives deep sleep)
+RTC_DATA_ATTR TxSlotState txSlotState;
+static uint16_t localNodeId = 0;
+
+static void put16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+void txSlotDefaultPlan(uint16_t nodeId, TxSlotPlan& plan) {
+  plan.slot = nodeId % TX_SLOT_COUNT;
+  plan.count = TX_SLOT_COUNT;
+  plan.widthMs = TX_SLOT_WIDTH_MS;
+  plan.assigned = false;
+}
+
+uint64_t txSlotAlignSleepMs(const TxSlotPlan& plan, uint64_t nowMs, uint64_t sleepMs,
+                            uint32_t jitterMs) {
+  uint64_t frameMs = (uint64_t)plan.count * plan.widthMs;
+  if (frameMs == 0 || sleepMs < 2 * frameMs) return sleepMs;
+
+  // Slot start in the frame the wake falls in, then the closest copy of it
+  uint64_t wakeMs = nowMs + sleepMs;
+  uint64_t alignedMs = wakeMs - wakeMs % frameMs + (uint64_t)plan.slot * plan.widthMs + jitterMs;
+  if (alignedMs >= wakeMs + frameMs / 2) {
+    alignedMs -= frameMs;
+  } else if (alignedMs + frameMs / 2 < wakeMs) {
+    alignedMs += frameMs;
+  }
+  return alignedMs - nowMs;
+}
+
+size_t txSlotEncodeAssignment(uint8_t* buffer, size_t capacity, uint16_t nodeId,
+                              uint16_t slot, uint16_t count, uint16_t widthMs) {
+  if (capacity < TX_SLOT_ASSIGN_LEN) return 0;
+  buffer[0] = TX_SLOT_ASSIGN_MAGIC;
+  buffer[1] = TX_SLOT_ASSIGN_VERSION;
+  put16(buffer + 2, nodeId);
+  put16(buffer + 4, slot);
+  put16(buffer + 6, count);
+  put16(buffer + 8, widthMs);
+  return TX_SLOT_ASSIGN_LEN;
+}
+
+bool txSlotDecodeAssignment(const uint8_t* frame, size_t length, uint16_t nodeId, TxSlotPlan& plan) {
+  if (length < TX_SLOT_ASSIGN_LEN || frame[0] != TX_SLOT_ASSIGN_MAGIC ||
+      frame[1] != TX_SLOT_ASSIGN_VERSION || get16(frame + 2) != nodeId) {
+    return false;
+  }
+
+  uint16_t slot = get16(frame + 4);
+  if (slot == TX_SLOT_UNASSIGNED) {
+    txSlotDefaultPlan(nodeId, plan);
+    return true;
+  }
+
+  uint16_t count = get16(frame + 6);
+  uint16_t widthMs = get16(frame + 8);
+  if (count == 0 || widthMs == 0 || slot >= count ||
+      (uint32_t)count * widthMs > TX_SLOT_MAX_FRAME_MS) {
+    return false;
+  }
+  plan.slot = slot;
+  plan.count = count;
+  plan.widthMs = widthMs;
+  plan.assigned = true;
+  return true;
+}
+
+void txSlotBegin(uint16_t nodeId) {
+  localNodeId = nodeId;
+  if (txSlotState.magic == TX_SLOT_STATE_MAGIC) return;
+
+  memset(&txSlotState, 0, sizeof(txSlotState));
+  txSlotState.magic = TX_SLOT_STATE_MAGIC;
+  // Seed from the node ID so nodes in the same slot draw different jitter
+  uint32_t seed = ((uint32_t)nodeId + 0x9E3779B9u) * 2654435761u;
+  txSlotState.rng = seed != 0 ? seed : 1;
+  txSlotDefaultPlan(nodeId, txSlotState.plan);
+}
+
+const TxSlotPlan& txSlotPlan() {
+  return txSlotState.plan;
+}
+
+bool txSlotApplyAssignment(const uint8_t* frame, size_t length) {
+  if (txSlotState.magic != TX_SLOT_STATE_MAGIC) return false;
+
+  TxSlotPlan plan;
+  if (!txSlotDecodeAssignment(frame, length, localNodeId, plan)) return false;
+  TxSlotPlan& current = txSlotState.plan;
+  if (plan.slot == current.slot && plan.count == current.count &&
+      plan.widthMs == current.widthMs && plan.assigned == current.assigned) {
+    return false;
+  }
+  current = plan;
+  return true;
+}
+
+uint64_t txSlotAlignSleepUs(uint64_t nowMs, uint64_t sleepUs) {
+  const TxSlotPlan& plan = txSlotState.plan;
+  uint32_t jitterMs = txSlotRandom(TX_SLOT_JITTER_MS < plan.widthMs ? TX_SLOT_JITTER_MS : plan.widthMs);
+  return txSlotAlignSleepMs(plan, nowMs, sleepUs / 1000ULL, jitterMs) * 1000ULL;
+}
+
+uint32_t txSlotRandom(uint32_t bound) {
+  if (bound == 0) return 0;
+  uint32_t x = txSlotState.rng != 0 ? txSlotState.rng : 1;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  txSlotState.rng = x;
+  return x % bound;
+}
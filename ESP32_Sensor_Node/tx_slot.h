@@ -0,0 +1,75 @@
+/*
+ * Transmit Slot Scheduler
+ *
+ * Nodes that power on together wake, and transmit, in lockstep. This
+ * module trims each deep sleep so the next wake starts in the node's own
+ * slot of a repeating frame (TX_SLOT_COUNT slots of TX_SLOT_WIDTH_MS on
+ * the node clock), plus a little random jitter. The slot is the node ID
+ * modulo the slot count unless the gateway assigned one:
+ *
+ *   Slot assignment (gateway -> node, TX_SLOT_ASSIGN_LEN bytes)
+ *     0  u8   TX_SLOT_ASSIGN_MAGIC
+ *     1  u8   TX_SLOT_ASSIGN_VERSION
+ *     2  u16  node ID (wireNodeIdFromMac)
+ *     4  u16  slot index (TX_SLOT_UNASSIGNED = back to the node ID slot)
+ *     6  u16  slot count
+ *     8  u16  slot width in ms
+ *
+ * The assignment and the jitter/backoff RNG live in RTC memory. No
+ * Arduino dependencies, so the fleet simulator uses the same code.
+ */
+
+#ifndef TX_SLOT_H
+#define TX_SLOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+#define TX_SLOT_ASSIGN_MAGIC 0xC5
+#define TX_SLOT_ASSIGN_VERSION 1
+#define TX_SLOT_ASSIGN_LEN 10
+#define TX_SLOT_UNASSIGNED 0xFFFF
+
+typedef struct TxSlotPlan {
+  uint16_t slot;       // Index in the frame
+  uint16_t count;      // Slots per frame
+  uint16_t widthMs;
+  bool assigned;       // Set by the gateway rather than derived from the node ID
+} TxSlotPlan;
+
+// Default plan for a node: slot nodeId % TX_SLOT_COUNT
+void txSlotDefaultPlan(uint16_t nodeId, TxSlotPlan& plan);
+
+// Sleep length (ms) that moves a wake due at nowMs + sleepMs to the
+// nearest start of the plan's slot, plus jitterMs. Sleeps shorter than
+// two frames are returned unchanged
+uint64_t txSlotAlignSleepMs(const TxSlotPlan& plan, uint64_t nowMs, uint64_t sleepMs,
+                            uint32_t jitterMs);
+
+// Build an assignment frame (gateway side). Returns its length, or 0 if it does not fit
+size_t txSlotEncodeAssignment(uint8_t* buffer, size_t capacity, uint16_t nodeId,
+                              uint16_t slot, uint16_t count, uint16_t widthMs);
+
+// Parse an assignment frame addressed to nodeId. Returns false if it is
+// not one, is for another node or is out of range
+bool txSlotDecodeAssignment(const uint8_t* frame, size_t length, uint16_t nodeId, TxSlotPlan& plan);
+
+// ----- This node (RTC state) -----
+
+// Load the plan for this wake (call once the node ID is known)
+void txSlotBegin(uint16_t nodeId);
+
+// Current plan
+const TxSlotPlan& txSlotPlan();
+
+// Apply an assignment frame from the gateway. Returns true if it changed the plan
+bool txSlotApplyAssignment(const uint8_t* frame, size_t length);
+
+// Deep sleep length that lands the next wake in this node's slot
+uint64_t txSlotAlignSleepUs(uint64_t nowMs, uint64_t sleepUs);
+
+// Uniform random number in 0..bound-1 (0 if bound is 0)
+uint32_t txSlotRandom(uint32_t bound);
+
+#endif // TX_SLOT_H
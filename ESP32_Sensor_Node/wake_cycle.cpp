@@ -0,0 +1,253 @@
+/*
+ * Wake Cycle Implementation
+ */
+
+#include "wake_cycle.h"
+#include "sensor.h"
+#include "battery.h"
+#include "espnow_comm.h"
+#include "device_storage.h"
+#include "profiler.h"
+#include "config_cache.h"
+#include "wake_pipeline.h"
+#include "node_clock.h"
+#include "reading_batch.h"
+#include "wire_format.h"
+#include "report_policy.h"
+#include "sleep_scheduler.h"
+#include "energy.h"
+#include "tx_slot.h"
+#include "node_log.h"
+#include "level_estimator.h"
+#include "tank_geometry.h"
+#include "measure_math.h"
+
+// Latest reading (also the frame sent when batching is off)
+static struct_message sensorData;
+
+// Radio state (brought up by the wake pipeline)
+static bool radioReady = false;
+
+// Charge the wake so far, then reset (RTC memory is kept)
+static void restartNode() {
+  energyEndWake(0);
+  halRestart();
+}
+
+bool bringUpRadio() {
+  if (radioReady) return true;
+
+  // Print MAC address
+  uint8_t ownMac[HAL_MAC_LEN];
+  halReadMac(ownMac);
+  LOG_I("Sensor Node MAC Address: " LOG_MAC_FMT, LOG_MAC_ARGS(ownMac));
+  LOG_I("Target Cloud Node MAC: " LOG_MAC_FMT " (must match your Cloud Node's MAC)",
+        LOG_MAC_ARGS(cloudNodeAddress));
+
+  // Initialize ESP-NOW and find Cloud Node
+  radioReady = initializeESPNOW();
+  return radioReady;
+}
+
+void loadWakeConfig(HalResetReason resetReason) {
+  // Node ID carried in every v2 frame
+  uint8_t ownMac[HAL_MAC_LEN];
+  halReadMac(ownMac);
+  wireSetLocalNodeId(wireNodeIdFromMac(ownMac));
+  txSlotBegin(wireLocalNodeId());
+
+  PROFILE_SCOPE(PHASE_CONFIG_LOAD);
+
+  // Deep-sleep wakes use the RTC config cache
+  if (resetReason == HAL_RESET_DEEPSLEEP && restoreConfigSnapshot()) {
+    LOG_I("✓ Config restored from RTC memory (NVS skipped)");
+    return;
+  }
+
+  // Load stored device properties (if any)
+  if (hasStoredProperties()) {
+    loadDeviceProperties();
+  } else {
+    LOG_I("No stored properties - using defaults: %.1f-%.1f cm, %u s, %.1f L",
+          fullDistanceCm, emptyDistanceCm, (unsigned)refreshRateSeconds, tankCapacityLitres);
+  }
+
+  // Load stored cloud node MAC address (if any)
+  if (!loadCloudNodeMAC(cloudNodeAddress)) {
+    LOG_I("No stored Cloud Node MAC - using default from code: " LOG_MAC_FMT,
+          LOG_MAC_ARGS(cloudNodeAddress));
+  }
+
+  // Cache for the following deep-sleep wakes
+  refreshConfigSnapshot();
+}
+
+uint64_t runWakeCycle() {
+  LOG_I("Loop start - Reading sensor");
+
+#if ENABLE_BATCHING
+  // Only start the radio early if this wake is due to send anyway
+  bool radioNeeded = (batchScheduledReasons(nodeClockMs()) & governorSendMask()) != 0;
+#else
+  bool radioNeeded = true;
+#endif
+#if ENABLE_REPORT_ON_CHANGE
+  // A heartbeat (or the first reading) goes out whatever the value
+  bool heartbeatAllowed = (governorSendMask() & BATCH_REASON_HEARTBEAT) != 0;
+#if ENABLE_BATCHING
+  radioNeeded = radioNeeded || (heartbeatAllowed && reportForcedThisWake(reportThresholds));
+#else
+  radioNeeded = heartbeatAllowed && reportForcedThisWake(reportThresholds);
+#endif
+#endif
+
+  // Radio bring-up, battery and sensor run concurrently and join here
+  WakeStages stages = { radioNeeded ? bringUpRadio : nullptr, readBatteryVoltage, readSmoothedDistanceCm };
+  WakeResults wake;
+  runWakePipeline(stages, wake);
+
+  LOG_D("Wake pipeline joined in %lu ms (radio %lu, battery %lu, sensor %lu) - saved %lu ms",
+        (unsigned long)(wake.wallUs / 1000), (unsigned long)(wake.radioUs / 1000),
+        (unsigned long)(wake.batteryUs / 1000), (unsigned long)(wake.sensorUs / 1000),
+        (unsigned long)(wakePipelineSavingUs(wake) / 1000));
+
+  if (radioNeeded && !wake.radioReady) {
+    LOG_E("ESP-NOW initialization failed");
+    restartNode();
+  }
+
+  float batteryVoltage = wake.batteryVoltage;
+  if (governorUpdate()) {
+    LOG_W("Power governor: %s at %.3f V (trend %.1f mV/day)", governorStateName(governorState()),
+          batteryVoltage, batteryTrendMvPerDay());
+  }
+  float d = wake.distanceCm;
+  
+  if (isnan(d)) {
+    LOG_W("Distance read FAILED - using fallback value");
+    d = 80.0f;
+  } else {
+    LOG_D("Distance read OK");
+#if ENABLE_LEVEL_ESTIMATOR
+    LevelEstimate estimate = levelEstimatorCurrent();
+    wireSetEstimate(estimate.sigmaCm, estimate.confidence);
+#endif
+  }
+
+  // Calculate values
+  sensorData.distance_cm = d;
+#if ENABLE_FIXED_POINT
+  uint32_t level = levelQ16(q16FromFloat(d), q16FromFloat(fullDistanceCm), q16FromFloat(emptyDistanceCm));
+  sensorData.level_percent = level * (100.0f / Q16_ONE);
+  sensorData.litres_remaining = tankLitresAtLevel(level, tankCapacityLitres);
+#else
+  float pct = levelPercent(d, fullDistanceCm, emptyDistanceCm);  // Clamped to 0-100 %
+  sensorData.level_percent = pct;
+  sensorData.litres_remaining = tankLitres(pct, tankCapacityLitres);
+#endif
+  sensorData.timestamp = (uint32_t)nodeClockMs();
+  sensorData.battery_v = batteryVoltage;
+#if ENABLE_PROFILER && PROFILER_IN_FRAME
+  sensorData.last_cycle_us = profilerLastCycleUs();
+#endif
+  LOG_I("Battery %.2f V, distance %.2f cm, level %.2f %%, %.2f L", batteryVoltage,
+        sensorData.distance_cm, sensorData.level_percent, sensorData.litres_remaining);
+
+#if ENABLE_REPORT_ON_CHANGE
+  // Drop readings that stay inside the deadbands of the last reported one
+  ReportDecision report = reportEvaluate(sensorData, reportThresholds);
+  LOG_I("Report policy: %s (%u suppressed)",
+        reportDecisionName(report), (unsigned)reportSuppressedCount());
+  bool reportReading = report != REPORT_SUPPRESS;
+  if (report == REPORT_HEARTBEAT && !heartbeatAllowed) {
+    reportReading = false;  // Non-essential while the governor saves power
+  }
+  if (!reportReading) {
+    reportSuppress();
+  }
+#else
+  bool reportReading = true;
+#endif
+
+#if ENABLE_BATCHING
+  // Buffer the reading - the batch goes out only when due or triggered
+  uint8_t batchReasons = 0;
+  if (reportReading) {
+    batchAppend(sensorData);
+#if ENABLE_REPORT_ON_CHANGE
+    reportAccept(sensorData);
+    if (report == REPORT_HEARTBEAT) batchReasons |= BATCH_REASON_HEARTBEAT;
+    if (report == REPORT_URGENT) batchReasons |= BATCH_REASON_URGENT;
+#endif
+  }
+  batchReasons |= batchSendReasons(nodeClockMs());
+  batchReasons &= governorSendMask();
+
+  if (batchReasons != 0) {
+    if (!bringUpRadio()) {
+      LOG_E("ESP-NOW initialization failed");
+      restartNode();
+    }
+
+    uint8_t frame[BATCH_FRAME_MAX_LEN];
+    size_t frameLength = batchEncodeFrame(frame, sizeof(frame), nodeClockMs(), batchReasons);
+    LOG_I("Sending batch of %d readings (reason 0x%02X)", batchCount(), batchReasons);
+
+    // Handles retries and channel rescanning internally; keep the batch if it fails
+    if (sendFrame(frame, frameLength)) {
+      batchMarkSent();
+    }
+  } else {
+    LOG_I("Reading buffered (%d stored) - radio stays off", batchCount());
+  }
+#else
+  if (reportReading) {
+    if (!bringUpRadio()) {
+      LOG_E("ESP-NOW initialization failed");
+      restartNode();
+    }
+
+    // Send sensor data (handles retries and channel rescanning internally)
+    if (sendSensorData(sensorData)) {
+#if ENABLE_REPORT_ON_CHANGE
+      reportAccept(sensorData);
+#endif
+    }
+  } else {
+    LOG_I("Reading inside deadbands - radio stays off");
+  }
+#endif
+
+#if ENABLE_ADAPTIVE_SLEEP
+  uint32_t sleepS = sleepSchedulerNext(sensorData.level_percent, batteryVoltage,
+                                       nodeClockMs(), refreshRateSeconds);
+  LOG_I("Sleep %lu s (%s, level rate %.2f %%/h)", (unsigned long)sleepS,
+        sleepModeName(sleepSchedulerMode()), sleepSchedulerRatePctPerHour());
+#else
+  uint32_t sleepS = refreshRateSeconds;
+#endif
+  if (governorState() != GOVERNOR_NORMAL) {
+    sleepS = governorSleepS(sleepS);
+    LOG_I("Sleep stretched to %lu s (%s power)", (unsigned long)sleepS, governorStateName(governorState()));
+  }
+  return (uint64_t)sleepS * 1000000ULL;
+}
+
+void enterDeepSleep(uint64_t sleepUs) {
+  PROFILE_END_CYCLE();
+
+#if ENABLE_TX_SLOTS
+  // Wake (and transmit) in this node's slot rather than in step with the others
+  sleepUs = txSlotAlignSleepUs(nodeClockMs(), sleepUs);
+#endif
+
+  energyEndWake(sleepUs);
+  LOG_I("Energy: wake %.4f mAh, %.2f mAh/day over %.1f h (~%.0f days on %.0f mAh)",
+        energyLastWakeMah(), energyMahPerDay(), energyElapsedHours(),
+        energyProjectedDays(ENERGY_BATTERY_MAH), ENERGY_BATTERY_MAH);
+  logBeforeSleep();
+  Serial.flush();
+
+  nodeClockAddSleep(sleepUs);
+  halDeepSleep(sleepUs);
+}
@@ -0,0 +1,30 @@
+/*
+ * Wake Cycle
+ *
+ * One wake of the sensor node, independent of BLE provisioning: config
+ * load, the pipelined radio/battery/sensor stages, the report and batch
+ * decisions, transmit and the choice of the next sleep. Only uses the
+ * HAL, so the same code runs on the ESP32 and in the host simulation.
+ */
+
+#ifndef WAKE_CYCLE_H
+#define WAKE_CYCLE_H
+
+#include <stdint.h>
+#include "hal.h"
+#include "config.h"
+
+// Pipeline stage: ESP-NOW up with the Cloud Node peer confirmed
+// (does nothing if the radio is already up)
+bool bringUpRadio();
+
+// Set the node ID and load the config (RTC snapshot on deep-sleep wakes, NVS otherwise)
+void loadWakeConfig(HalResetReason resetReason);
+
+// Read, decide and transmit. Returns the next deep sleep length in microseconds
+uint64_t runWakeCycle();
+
+// Close the profiler cycle, advance the node clock and deep sleep (does not return)
+void enterDeepSleep(uint64_t sleepUs);
+
+#endif // WAKE_CYCLE_H
@@ -0,0 +1,110 @@
+/*
+ * Pipelined Wake Cycle Implementation
+ */
+
+#include "wake_pipeline.h"
+#include "hal.h"
+
+#ifdef ARDUINO
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#else
+#include <thread>
+#endif
+
+static const uint32_t RADIO_TASK_STACK = 8192;   // WiFi/ESP-NOW init needs a deep stack
+
+static void runRadioStage(const WakeStages& stages, WakeResults& results) {
+  if (stages.radioUp == nullptr) return;
+  uint64_t start = halMicros();
+  results.radioReady = stages.radioUp();
+  results.radioUs = (uint32_t)(halMicros() - start);
+}
+
+static void runBatteryStage(const WakeStages& stages, WakeResults& results) {
+  uint64_t start = halMicros();
+  results.batteryVoltage = stages.readBattery();
+  results.batteryUs = (uint32_t)(halMicros() - start);
+}
+
+static void runSensorStage(const WakeStages& stages, WakeResults& results) {
+  uint64_t start = halMicros();
+  results.distanceCm = stages.readDistance();
+  results.sensorUs = (uint32_t)(halMicros() - start);
+}
+
+#ifdef ARDUINO
+static const EventBits_t RADIO_DONE_BIT = 1 << 0;
+
+typedef struct PipelineRun {
+  const WakeStages* stages;
+  WakeResults* results;
+  EventGroupHandle_t done;
+} PipelineRun;
+
+static void radioTask(void* arg) {
+  PipelineRun* run = (PipelineRun*)arg;
+  runRadioStage(*run->stages, *run->results);
+  xEventGroupSetBits(run->done, RADIO_DONE_BIT);
+  vTaskDelete(NULL);
+}
+
+#endif
+
+void runWakePipeline(const WakeStages& stages, WakeResults& results) {
+  results = WakeResults();
+  uint64_t start = halMicros();
+
+  // The battery is sampled before the radio draws any current, so WiFi
+  // and ESP-NOW bring-up cannot sag the reading. The burst is a few ms.
+  runBatteryStage(stages, results);
+
+#if !ENABLE_WAKE_PIPELINE
+  runRadioStage(stages, results);
+  runSensorStage(stages, results);
+#elif defined(ARDUINO)
+  PipelineRun run = { &stages, &results, xEventGroupCreate() };
+  EventBits_t waitBits = 0;
+
+  if (stages.radioUp == nullptr) {
+    // Radio stays off this wake
+  } else if (run.done != NULL &&
+      xTaskCreate(radioTask, "wake_radio", RADIO_TASK_STACK, &run, 1, NULL) == pdPASS) {
+    waitBits |= RADIO_DONE_BIT;
+  } else {
+    runRadioStage(stages, results);  // No task - run inline
+  }
+
+  // Sensor acquisition runs on the calling task
+  runSensorStage(stages, results);
+
+  // Join before transmit
+  if (waitBits != 0) {
+    xEventGroupWaitBits(run.done, waitBits, pdFALSE, pdTRUE, portMAX_DELAY);
+  }
+  if (run.done != NULL) {
+    vEventGroupDelete(run.done);
+  }
+#else
+  // A host thread on the simulated clock: the radio starts at the fork,
+  // and the join waits for it if it ends after the sensor
+  uint64_t forkUs = halMicros();
+  uint64_t radioEndUs = forkUs;
+  std::thread radio([&]() {
+    halSimThreadStart(forkUs);
+    runRadioStage(stages, results);
+    radioEndUs = halMicros();
+  });
+  runSensorStage(stages, results);
+  radio.join();
+  halSimThreadJoin(radioEndUs);
+#endif
+
+  results.wallUs = (uint32_t)(halMicros() - start);
+}
+
+uint32_t wakePipelineSavingUs(const WakeResults& results) {
+  uint32_t serialUs = results.radioUs + results.batteryUs + results.sensorUs;
+  return serialUs > results.wallUs ? serialUs - results.wallUs : 0;
+}
@@ -0,0 +1,46 @@
+/*
+ * Pipelined Wake Cycle
+ *
+ * Samples the battery, then runs radio bring-up and sensor acquisition
+ * concurrently and joins them before transmit. The battery goes first
+ * so the radio's current draw cannot sag its reading. The stages are plain
+ * function pointers so the pipeline can run on a Linux host against
+ * stand-ins (std::thread there, FreeRTOS tasks on the ESP32). Stage
+ * times come from halMicros(), the simulated clock on the host.
+ *
+ * Stages share the energy and profiler accumulators, which take
+ * halCriticalEnter() around every update.
+ */
+
+#ifndef WAKE_PIPELINE_H
+#define WAKE_PIPELINE_H
+
+#include <stdint.h>
+#include "config.h"
+
+// Stages of a wake cycle
+typedef struct WakeStages {
+  bool (*radioUp)();        // WiFi + ESP-NOW up and peer channel confirmed (nullptr = radio stays off)
+  float (*readBattery)();   // Battery voltage
+  float (*readDistance)();  // Distance in cm (NAN on failure)
+} WakeStages;
+
+// Results of one pipeline run
+typedef struct WakeResults {
+  bool radioReady;
+  float batteryVoltage;
+  float distanceCm;
+  uint32_t radioUs;         // Time spent in each stage
+  uint32_t batteryUs;
+  uint32_t sensorUs;
+  uint32_t wallUs;          // Wall-clock time until all stages joined
+} WakeResults;
+
+// Run all stages and wait for them to finish. The battery is always read
+// first; with ENABLE_WAKE_PIPELINE set to 0 the others follow one by one.
+void runWakePipeline(const WakeStages& stages, WakeResults& results);
+
+// Time saved against running the stages one after another
+uint32_t wakePipelineSavingUs(const WakeResults& results);
+
+#endif // WAKE_PIPELINE_H
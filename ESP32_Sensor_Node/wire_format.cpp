@@ -0,0 +1,191 @@
+/*
+ * Sensor Frame Wire Format v2 Implementation
+ */
+
+#include "wire_format.h"
+#include "profiler.h"
+#include <string.h>
+
+// Sequence number survives deep sleep so the gateway can spot gaps
+RTC_DATA_ATTR uint16_t wireSequence = 0;
+static uint16_t localNodeId = 0;
+static bool estimateSet = false;
+static float estimateSigmaCm = 0.0f;
+static float estimateConfidence = 0.0f;
+
+static void put16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static uint16_t get16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Round and clamp a scaled value into 0..max
+static uint32_t quantize(float value, float scale, uint32_t max) {
+  if (!(value > 0.0f)) return 0;  // Also catches NAN
+  float scaled = value * scale + 0.5f;
+  if (scaled >= (float)max) return max;
+  return (uint32_t)scaled;
+}
+
+void wireBegin(WireWriter& writer, uint8_t* buffer, size_t capacity,
+               uint16_t nodeId, uint16_t sequence, uint8_t flags) {
+  writer.buffer = buffer;
+  writer.capacity = capacity;
+  writer.length = 0;
+  writer.count = 0;
+  writer.inTlvs = false;
+  writer.overflow = capacity < WIRE_V2_HEADER_LEN;
+  if (writer.overflow) return;
+
+  buffer[0] = WIRE_V2_MAGIC;
+  buffer[1] = WIRE_V2_VERSION;
+  put16(buffer + 2, nodeId);
+  put16(buffer + 4, sequence);
+  buffer[6] = 0;  // Patched by wireFinish
+  buffer[7] = flags;
+  writer.length = WIRE_V2_HEADER_LEN;
+}
+
+bool wireAddReading(WireWriter& writer, const struct_message& reading, uint32_t ageS) {
+  if (writer.overflow || writer.inTlvs || writer.count == 255 ||
+      writer.length + WIRE_V2_RECORD_LEN > writer.capacity) {
+    writer.overflow = true;
+    return false;
+  }
+
+  uint8_t* p = writer.buffer + writer.length;
+  put16(p, (uint16_t)quantize(reading.distance_cm, 10.0f, 0xFFFF));
+  p[2] = (uint8_t)quantize(reading.level_percent, 2.0f, 200);
+  p[3] = 0;
+  put16(p + 4, (uint16_t)quantize(reading.battery_v, 1000.0f, 0xFFFF));
+  put16(p + 6, (uint16_t)quantize(reading.litres_remaining, 1.0f, 0xFFFF));
+  put16(p + 8, (uint16_t)(ageS > 0xFFFF ? 0xFFFF : ageS));
+
+  writer.length += WIRE_V2_RECORD_LEN;
+  writer.count++;
+  return true;
+}
+
+bool wireAddTlv(WireWriter& writer, uint8_t type, const void* value, uint8_t length) {
+  if (writer.overflow || writer.length + 2 + length > writer.capacity) {
+    writer.overflow = true;
+    return false;
+  }
+
+  uint8_t* p = writer.buffer + writer.length;
+  p[0] = type;
+  p[1] = length;
+  memcpy(p + 2, value, length);
+  writer.length += 2 + length;
+  writer.inTlvs = true;
+  return true;
+}
+
+size_t wireFinish(WireWriter& writer) {
+  if (writer.overflow) return 0;
+  writer.buffer[6] = writer.count;
+  return writer.length;
+}
+
+bool wireAddNodeTlvs(WireWriter& writer) {
+  uint8_t firmware[2];
+  put16(firmware, FIRMWARE_VERSION);
+  bool ok = wireAddTlv(writer, WIRE_TLV_FIRMWARE, firmware, sizeof(firmware));
+
+#if ENABLE_PROFILER && PROFILER_IN_FRAME
+  uint32_t cycleUs = profilerLastCycleUs();
+  uint8_t cycle[4] = { (uint8_t)cycleUs, (uint8_t)(cycleUs >> 8), (uint8_t)(cycleUs >> 16), (uint8_t)(cycleUs >> 24) };
+  ok = ok && wireAddTlv(writer, WIRE_TLV_CYCLE_US, cycle, sizeof(cycle));
+#endif
+
+  if (estimateSet) {
+    float sigmaTenthMm = estimateSigmaCm * 100.0f;
+    uint8_t value[3];
+    put16(value, sigmaTenthMm < 65535.0f ? (uint16_t)(sigmaTenthMm + 0.5f) : 65535);
+    value[2] = (uint8_t)(estimateConfidence * 100.0f + 0.5f);
+    ok = ok && wireAddTlv(writer, WIRE_TLV_ESTIMATE, value, sizeof(value));
+  }
+  return ok;
+}
+
+void wireSetEstimate(float sigmaCm, float confidence) {
+  estimateSet = true;
+  estimateSigmaCm = sigmaCm;
+  estimateConfidence = confidence;
+}
+
+uint16_t wireNodeIdFromMac(const uint8_t mac[6]) {
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < 6; i++) {
+    hash ^= mac[i];
+    hash *= 16777619u;
+  }
+  return (uint16_t)(hash ^ (hash >> 16));
+}
+
+void wireSetLocalNodeId(uint16_t nodeId) {
+  localNodeId = nodeId;
+}
+
+uint16_t wireLocalNodeId() {
+  return localNodeId;
+}
+
+uint16_t wireNextSequence() {
+  return wireSequence++;
+}
+
+bool wireDecode(const uint8_t* frame, size_t length, WireFrame& out) {
+  if (length < WIRE_V2_HEADER_LEN || frame[0] != WIRE_V2_MAGIC || frame[1] != WIRE_V2_VERSION) {
+    return false;
+  }
+
+  out.nodeId = get16(frame + 2);
+  out.sequence = get16(frame + 4);
+  out.count = frame[6];
+  out.flags = frame[7];
+
+  size_t recordsEnd = WIRE_V2_HEADER_LEN + (size_t)out.count * WIRE_V2_RECORD_LEN;
+  if (length < recordsEnd) return false;
+  out.records = frame + WIRE_V2_HEADER_LEN;
+  out.tlvs = frame + recordsEnd;
+  out.tlvLength = length - recordsEnd;
+
+  // TLVs must tile the rest of the frame exactly
+  size_t offset = 0;
+  while (offset < out.tlvLength) {
+    if (offset + 2 > out.tlvLength) return false;
+    offset += 2 + out.tlvs[offset + 1];
+  }
+  return offset == out.tlvLength;
+}
+
+bool wireReading(const WireFrame& frame, int index, WireReading& out) {
+  if (index < 0 || index >= frame.count) return false;
+
+  const uint8_t* p = frame.records + (size_t)index * WIRE_V2_RECORD_LEN;
+  out.distance_cm = get16(p) / 10.0f;
+  out.level_percent = p[2] / 2.0f;
+  out.battery_v = get16(p + 4) / 1000.0f;
+  out.litres_remaining = (float)get16(p + 6);
+  out.ageS = get16(p + 8);
+  return true;
+}
+
+bool wireFindTlv(const WireFrame& frame, uint8_t type, const uint8_t** value, uint8_t* length) {
+  size_t offset = 0;
+  while (offset + 2 <= frame.tlvLength) {
+    uint8_t tlvType = frame.tlvs[offset];
+    uint8_t tlvLength = frame.tlvs[offset + 1];
+    if (tlvType == type) {
+      *value = frame.tlvs + offset + 2;
+      *length = tlvLength;
+      return true;
+    }
+    offset += 2 + tlvLength;
+  }
+  return false;
+}
@@ -0,0 +1,115 @@
+/*
+ * Sensor Frame Wire Format v2
+ *
+ * Compact, versioned encoding of sensor readings. All fields are fixed
+ * width and little-endian, written byte by byte, so node and gateway no
+ * longer depend on matching struct padding.
+ *
+ *   Header (8 bytes)
+ *     0  u8   WIRE_V2_MAGIC
+ *     1  u8   WIRE_V2_VERSION
+ *     2  u16  node ID (hash of the node MAC)
+ *     4  u16  sequence number
+ *     6  u8   record count
+ *     7  u8   flags (send reason, see BATCH_REASON_*)
+ *   Records (WIRE_V2_RECORD_LEN bytes each, oldest first)
+ *     0  u16  distance in mm (cm tenths)
+ *     2  u8   level in half percent (0-200)
+ *     3  u8   reserved
+ *     4  u16  battery in mV
+ *     6  u16  litres remaining
+ *     8  u16  age in seconds when the frame was built
+ *   Extension TLVs until the end of the frame
+ *     u8 type, u8 length, value
+ *
+ * The encoder writes into a caller-provided buffer and never allocates.
+ * The decoder has no Arduino dependencies so the gateway can use it.
+ */
+
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+#define WIRE_V2_MAGIC 0xC2
+#define WIRE_V2_VERSION 2
+#define WIRE_V2_HEADER_LEN 8
+#define WIRE_V2_RECORD_LEN 10
+
+// Extension TLV types (unknown types are skipped by the decoder)
+#define WIRE_TLV_FIRMWARE  0x01  // u16 FIRMWARE_VERSION
+#define WIRE_TLV_CYCLE_US  0x02  // u32 awake time of the previous cycle (profiler)
+#define WIRE_TLV_ESTIMATE  0x03  // u16 sigma in 0.1 mm, u8 confidence in % (level estimator)
+
+// ----- Encoder (node) -----
+
+typedef struct WireWriter {
+  uint8_t* buffer;
+  size_t capacity;
+  size_t length;
+  uint8_t count;
+  bool inTlvs;      // Records can no longer be added
+  bool overflow;    // Something did not fit
+} WireWriter;
+
+// Start a frame in buffer
+void wireBegin(WireWriter& writer, uint8_t* buffer, size_t capacity,
+               uint16_t nodeId, uint16_t sequence, uint8_t flags);
+
+// Add a reading; ageS is how long ago it was taken. Records must come before TLVs
+bool wireAddReading(WireWriter& writer, const struct_message& reading, uint32_t ageS);
+
+// Add an extension TLV
+bool wireAddTlv(WireWriter& writer, uint8_t type, const void* value, uint8_t length);
+
+// Finish the frame. Returns its length, or 0 if anything overflowed
+size_t wireFinish(WireWriter& writer);
+
+// Add the TLVs every node frame carries (firmware version, profiler data,
+// level estimator confidence once set)
+bool wireAddNodeTlvs(WireWriter& writer);
+
+// Sigma and confidence of the newest reading's level estimate, sent as
+// WIRE_TLV_ESTIMATE from now on
+void wireSetEstimate(float sigmaCm, float confidence);
+
+// 16-bit node ID from a MAC address (FNV-1a folded to 16 bits)
+uint16_t wireNodeIdFromMac(const uint8_t mac[6]);
+
+// Node ID and sequence counter used by frames this node sends
+void wireSetLocalNodeId(uint16_t nodeId);
+uint16_t wireLocalNodeId();
+uint16_t wireNextSequence();
+
+// ----- Decoder (gateway) -----
+
+typedef struct WireFrame {
+  uint16_t nodeId;
+  uint16_t sequence;
+  uint8_t count;
+  uint8_t flags;
+  const uint8_t* records;   // Points into the frame
+  const uint8_t* tlvs;
+  size_t tlvLength;
+} WireFrame;
+
+typedef struct WireReading {
+  float distance_cm;
+  float level_percent;
+  float litres_remaining;
+  float battery_v;
+  uint32_t ageS;
+} WireReading;
+
+// Validate a v2 frame. Returns false if it is not one
+bool wireDecode(const uint8_t* frame, size_t length, WireFrame& out);
+
+// Reading i of a decoded frame (0 = oldest)
+bool wireReading(const WireFrame& frame, int index, WireReading& out);
+
+// Find a TLV. Returns false if it is missing
+bool wireFindTlv(const WireFrame& frame, uint8_t type, const uint8_t** value, uint8_t* length);
+
+#endif // WIRE_FORMAT_H
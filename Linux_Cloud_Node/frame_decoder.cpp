@@ -0,0 +1,77 @@
+/*
+ * Sensor Frame Decoder Implementation
+ */
+
+#include "frame_decoder.h"
+#include "reading_batch.h"
+#include <string.h>
+
+// A node built with PROFILER_IN_FRAME appends last_cycle_us to struct_message
+static const size_t LEGACY_BASE_LEN = offsetof(struct_message, battery_v) + sizeof(float);
+
+static void fromStruct(const struct_message& reading, uint32_t ageS, WireReading& out) {
+  out.distance_cm = reading.distance_cm;
+  out.level_percent = reading.level_percent;
+  out.litres_remaining = reading.litres_remaining;
+  out.battery_v = reading.battery_v;
+  out.ageS = ageS;
+}
+
+bool ingestDecode(const uint8_t* payload, size_t length, IngestDecoded& out) {
+  out.format = INGEST_FORMAT_UNKNOWN;
+  out.hasSequence = false;
+  out.sequence = 0;
+  out.nodeId = 0;
+  out.flags = 0;
+  out.count = 0;
+
+  WireFrame frame;
+  if (wireDecode(payload, length, frame)) {
+    if (frame.count > INGEST_MAX_READINGS) return false;
+    out.format = INGEST_FORMAT_V2;
+    out.hasSequence = true;
+    out.sequence = frame.sequence;
+    out.nodeId = frame.nodeId;
+    out.flags = frame.flags;
+    for (int i = 0; i < frame.count; i++) {
+      wireReading(frame, i, out.readings[i]);
+    }
+    out.count = frame.count;
+    return true;
+  }
+
+  BatchView batch;
+  if (batchDecodeFrame(payload, length, batch)) {
+    if (batch.header.count > INGEST_MAX_READINGS) return false;
+    out.format = INGEST_FORMAT_BATCH_V1;
+    out.flags = batch.header.reason;
+    for (int i = 0; i < batch.header.count; i++) {
+      struct_message reading;
+      batchReading(batch, i, reading);
+      fromStruct(reading, batchReadingAgeMs(batch, reading) / 1000, out.readings[i]);
+    }
+    out.count = batch.header.count;
+    return true;
+  }
+
+  if (length == LEGACY_BASE_LEN || length == LEGACY_BASE_LEN + sizeof(uint32_t)) {
+    struct_message reading;
+    memset(&reading, 0, sizeof(reading));
+    memcpy(&reading, payload, length < sizeof(reading) ? length : sizeof(reading));
+    out.format = INGEST_FORMAT_LEGACY;
+    fromStruct(reading, 0, out.readings[0]);
+    out.count = 1;
+    return true;
+  }
+
+  return false;
+}
+
+const char* ingestFormatName(IngestFormat format) {
+  switch (format) {
+    case INGEST_FORMAT_V2:       return "v2";
+    case INGEST_FORMAT_BATCH_V1: return "batch";
+    case INGEST_FORMAT_LEGACY:   return "legacy";
+    default:                     return "unknown";
+  }
+}
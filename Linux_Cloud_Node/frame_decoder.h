@@ -0,0 +1,43 @@
+/*
+ * Sensor Frame Decoder
+ *
+ * Turns an ESP-NOW payload from a Sensor Node into readings, whatever
+ * wire format the node was built with:
+ *   v2 frames        (WIRE_FORMAT_V2, wire_format.h) - carry a sequence number
+ *   v1 batch frames  (WIRE_FORMAT_LEGACY with batching, reading_batch.h)
+ *   raw struct_message (WIRE_FORMAT_LEGACY without batching)
+ * Uses the node's own decoders, so both sides stay in step.
+ */
+
+#ifndef FRAME_DECODER_H
+#define FRAME_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ingest_config.h"
+#include "wire_format.h"
+
+enum IngestFormat : uint8_t {
+  INGEST_FORMAT_UNKNOWN = 0,
+  INGEST_FORMAT_V2,
+  INGEST_FORMAT_BATCH_V1,
+  INGEST_FORMAT_LEGACY
+};
+
+typedef struct IngestDecoded {
+  IngestFormat format;
+  bool hasSequence;       // Only v2 frames are numbered
+  uint16_t sequence;
+  uint16_t nodeId;        // v2 node ID, 0 otherwise
+  uint8_t flags;          // BATCH_REASON_* (v2 and batch frames)
+  uint8_t count;
+  WireReading readings[INGEST_MAX_READINGS];  // Oldest first
+} IngestDecoded;
+
+// Decode a payload. Returns false (format UNKNOWN) if it is none of the above
+bool ingestDecode(const uint8_t* payload, size_t length, IngestDecoded& out);
+
+// Short name for logs
+const char* ingestFormatName(IngestFormat format);
+
+#endif // FRAME_DECODER_H
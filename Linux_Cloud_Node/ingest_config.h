@@ -0,0 +1,34 @@
+/*
+ * Ingest Daemon Configuration
+ *
+ * Sizes and defaults of the Linux Cloud Node receiver
+ */
+
+#ifndef INGEST_CONFIG_H
+#define INGEST_CONFIG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// ----------- Frames -----------
+#define INGEST_MAX_PAYLOAD 250        // ESP-NOW payload limit
+#define INGEST_MAX_READINGS 24        // Readings in the largest v2 frame
+
+// ----------- Threads and queues -----------
+static const int INGEST_MAX_RECEIVERS = 8;
+static const int INGEST_MAX_WORKERS = 16;
+static const size_t INGEST_WORKER_QUEUE_DEPTH = 16384;  // Frames per worker (MPSC, power of two)
+static const size_t INGEST_SINK_QUEUE_DEPTH = 16384;    // Records per worker (SPSC, power of two)
+static const int INGEST_RECEIVE_BATCH = 64;             // Frames per transport receive call
+static const int INGEST_RECEIVE_TIMEOUT_MS = 100;       // So receive threads notice shutdown
+static const int INGEST_IDLE_SPINS = 256;               // Empty polls before a worker yields
+static const int INGEST_IDLE_SLEEP_US = 50;             // Sleep once yielding did not help
+
+// ----------- Node table -----------
+static const uint32_t INGEST_TABLE_CAPACITY = 8192;     // Slots per worker shard (power of two)
+
+// ----------- Transports -----------
+static const uint16_t INGEST_UDP_PORT = 47800;
+static const int INGEST_SERIAL_BAUD = 921600;
+
+#endif // INGEST_CONFIG_H
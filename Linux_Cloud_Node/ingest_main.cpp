@@ -0,0 +1,156 @@
+/*
+ * Linux Cloud Node - Ingest Daemon
+ *
+ * Receives Sensor Node frames from UDP and/or a serial dongle, keeps the
+ * per-node state and prints one JSON line per reading on stdout. Counters
+ * and ingest latency go to stderr every --stats seconds.
+ *
+ * Usage: cloud_ingest [--udp [ADDR:]PORT] [--udp-threads N] [--serial DEV]
+ *                     [--baud N] [--workers N] [--stats S] [--quiet]
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include "ingest_pipeline.h"
+
+static std::atomic<bool> stopRequested(false);
+
+static void onSignal(int) {
+  stopRequested.store(true);
+}
+
+static void printMac(FILE* out, const uint8_t mac[6]) {
+  fprintf(out, "%02X:%02X:%02X:%02X:%02X:%02X", mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+// Sink: one JSON object per reading (runs on the sink thread)
+static void printReading(const IngestRecord& record, void* context) {
+  FILE* out = (FILE*)context;
+  fprintf(out, "{\"mac\":\"");
+  printMac(out, record.mac);
+  fprintf(out, "\",\"format\":\"%s\",\"node\":%u,", ingestFormatName((IngestFormat)record.format),
+          (unsigned)record.nodeId);
+  if (record.hasSequence) fprintf(out, "\"seq\":%u,", (unsigned)record.sequence);
+  fprintf(out, "\"channel\":%u,\"rssi\":%d,\"flags\":%u,\"distance\":%.1f,\"level\":%.1f,"
+          "\"litres\":%.0f,\"battery\":%.3f,\"age\":%u}\n",
+          (unsigned)record.channel, (int)record.rssi, (unsigned)record.flags,
+          record.reading.distance_cm, record.reading.level_percent,
+          record.reading.litres_remaining, record.reading.battery_v, (unsigned)record.reading.ageS);
+}
+
+static void printStats(const IngestStats& stats) {
+  fprintf(stderr, "ingest: %llu frames, %u nodes, %llu readings, %llu lost, %llu dup, "
+          "%llu undecodable, drops %llu/%llu/%llu (queue/table/sink), "
+          "latency p50 %.1f us p99 %.1f us\n",
+          (unsigned long long)stats.received, (unsigned)stats.nodes,
+          (unsigned long long)stats.readings, (unsigned long long)stats.lost,
+          (unsigned long long)stats.duplicates, (unsigned long long)stats.undecodable,
+          (unsigned long long)stats.queueDrops, (unsigned long long)stats.tableFull,
+          (unsigned long long)stats.sinkDrops,
+          stats.latency.percentile(0.50) / 1000.0, stats.latency.percentile(0.99) / 1000.0);
+}
+
+static void usage(const char* name) {
+  fprintf(stderr, "Usage: %s [--udp [ADDR:]PORT] [--udp-threads N] [--serial DEV] [--baud N]\n"
+                  "          [--workers N] [--stats S] [--quiet]\n", name);
+}
+
+int main(int argc, char** argv) {
+  const char* udpSpec = nullptr;
+  const char* serialDevice = nullptr;
+  int udpThreads = 1;
+  int baud = INGEST_SERIAL_BAUD;
+  int statsSeconds = 10;
+  bool quiet = false;
+
+  IngestOptions options;
+  options.workers = 2;
+  options.tableCapacity = INGEST_TABLE_CAPACITY;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--udp") == 0 && i + 1 < argc) {
+      udpSpec = argv[++i];
+    } else if (strcmp(argv[i], "--udp-threads") == 0 && i + 1 < argc) {
+      udpThreads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--serial") == 0 && i + 1 < argc) {
+      serialDevice = argv[++i];
+    } else if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+      baud = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--workers") == 0 && i + 1 < argc) {
+      options.workers = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+      statsSeconds = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--quiet") == 0) {
+      quiet = true;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (udpSpec == nullptr && serialDevice == nullptr) {
+    udpSpec = "0.0.0.0";  // Default: UDP on all interfaces, default port
+  }
+
+  options.sink = quiet ? nullptr : printReading;
+  options.sinkContext = stdout;
+
+  IngestTransport transports[INGEST_MAX_RECEIVERS];
+  int transportCount = 0;
+
+  if (udpSpec != nullptr) {
+    // "ADDR:PORT", "PORT" or "ADDR"
+    char address[64] = "0.0.0.0";
+    uint16_t port = INGEST_UDP_PORT;
+    const char* colon = strrchr(udpSpec, ':');
+    if (colon != nullptr) {
+      snprintf(address, sizeof(address), "%.*s", (int)(colon - udpSpec), udpSpec);
+      port = (uint16_t)atoi(colon + 1);
+    } else if (strchr(udpSpec, '.') == nullptr) {
+      port = (uint16_t)atoi(udpSpec);
+    } else {
+      snprintf(address, sizeof(address), "%s", udpSpec);
+    }
+
+    if (udpThreads < 1) udpThreads = 1;
+    for (int i = 0; i < udpThreads && transportCount < INGEST_MAX_RECEIVERS; i++) {
+      if (!transportOpenUdp(transports[transportCount], address, port, udpThreads > 1)) return 1;
+      transportCount++;
+    }
+    fprintf(stderr, "ingest: listening on udp %s:%u (%d socket%s)\n", address, (unsigned)port,
+            transportCount, transportCount > 1 ? "s" : "");
+  }
+
+  if (serialDevice != nullptr && transportCount < INGEST_MAX_RECEIVERS) {
+    if (!transportOpenSerial(transports[transportCount], serialDevice, baud)) return 1;
+    transportCount++;
+    fprintf(stderr, "ingest: reading dongle on %s at %d baud\n", serialDevice, baud);
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  if (!ingestStart(options, transports, transportCount)) {
+    fprintf(stderr, "ingest: could not start the pipeline\n");
+    return 1;
+  }
+
+  IngestStats* stats = new IngestStats();
+  int elapsed = 0;
+  while (!stopRequested.load()) {
+    sleep(1);
+    if (statsSeconds > 0 && ++elapsed % statsSeconds == 0) {
+      ingestGetStats(*stats);
+      printStats(*stats);
+    }
+  }
+
+  ingestStop();
+  ingestGetStats(*stats);
+  printStats(*stats);
+  delete stats;
+  return 0;
+}
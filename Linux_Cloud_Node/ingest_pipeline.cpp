@@ -0,0 +1,302 @@
+/*
+ * Ingest Pipeline Implementation
+ */
+
+#include "ingest_pipeline.h"
+#include "ingest_queue.h"
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+
+typedef MpscQueue<IngestFrame, INGEST_WORKER_QUEUE_DEPTH> WorkerInbox;
+typedef SpscQueue<IngestRecord, INGEST_SINK_QUEUE_DEPTH> WorkerOutbox;
+
+typedef struct IngestWorker {
+  WorkerInbox* inbox;
+  WorkerOutbox* outbox;
+  NodeTable table;
+  LatencyHistogram latency;
+  // Written by the worker only, read by ingestGetStats()
+  std::atomic<uint64_t> processed;
+  std::atomic<uint64_t> undecodable;
+  std::atomic<uint64_t> tableFull;
+  std::atomic<uint64_t> readings;
+  std::atomic<uint64_t> lost;
+  std::atomic<uint64_t> duplicates;
+  std::atomic<uint64_t> sinkDrops;
+  std::atomic<uint32_t> nodes;
+  std::thread thread;
+} IngestWorker;
+
+typedef struct IngestReceiver {
+  IngestTransport transport;
+  std::atomic<uint64_t> received;
+  std::atomic<uint64_t> queueDrops;
+  std::thread thread;
+} IngestReceiver;
+
+static IngestOptions options;
+static IngestWorker* workers[INGEST_MAX_WORKERS];
+static IngestReceiver* receivers[INGEST_MAX_RECEIVERS];
+static int workerCount = 0;
+static int receiverCount = 0;
+static std::thread sinkThread;
+
+// Shutdown runs in stages so every queue drains before its consumer exits
+static std::atomic<bool> receiving(false);
+static std::atomic<bool> processing(false);
+static std::atomic<bool> sinking(false);
+
+// Single-writer counter bump (no locked read-modify-write needed)
+static inline void bump(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+  counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+static int workerFor(const uint8_t mac[6]) {
+  // High hash bits pick the worker; the shard's table indexes with the low bits
+  uint32_t hash = nodeKeyHash(nodeKeyFromMac(mac));
+  return (int)(((uint64_t)hash * (uint64_t)workerCount) >> 32);
+}
+
+// Idle backoff: spin, then yield, then sleep
+static void idle(int& emptyPolls) {
+  emptyPolls++;
+  if (emptyPolls < INGEST_IDLE_SPINS) return;
+  if (emptyPolls < INGEST_IDLE_SPINS * 2) {
+    std::this_thread::yield();
+    return;
+  }
+  std::this_thread::sleep_for(std::chrono::microseconds(INGEST_IDLE_SLEEP_US));
+}
+
+static void receiveLoop(IngestReceiver* receiver) {
+  IngestFrame* frames = new IngestFrame[INGEST_RECEIVE_BATCH];
+  IngestTransport& transport = receiver->transport;
+
+  while (receiving.load(std::memory_order_acquire)) {
+    int count = transport.receive(transport.context, frames, INGEST_RECEIVE_BATCH,
+                                  INGEST_RECEIVE_TIMEOUT_MS);
+    if (count < 0) break;  // Transport gone
+
+    uint64_t drops = 0;
+    for (int i = 0; i < count; i++) {
+      if (!workers[workerFor(frames[i].mac)]->inbox->push(frames[i])) drops++;
+    }
+    bump(receiver->received, (uint64_t)count);
+    if (drops > 0) bump(receiver->queueDrops, drops);
+  }
+  delete[] frames;
+}
+
+static void processFrame(IngestWorker* worker, const IngestFrame& frame) {
+  bump(worker->processed);
+
+  IngestDecoded decoded;
+  if (!ingestDecode(frame.payload, frame.length, decoded)) {
+    bump(worker->undecodable);
+    return;
+  }
+
+  NodeState* node = nodeTableUpsert(worker->table, frame.mac);
+  if (node == nullptr) {
+    bump(worker->tableFull);
+    return;
+  }
+  worker->nodes.store(worker->table.count, std::memory_order_relaxed);
+
+  int known = 0;  // Leading readings of this frame that were ingested before
+  if (decoded.hasSequence && node->hasSequence) {
+    uint16_t step = (uint16_t)(decoded.sequence - node->lastSequence);
+    if (step == 0) {
+      // The node retried a batch we already have (its ack was lost). A
+      // batch keeps its number until acked, so newer readings may follow
+      if (decoded.count <= node->lastCount) {
+        node->duplicates++;
+        bump(worker->duplicates);
+        return;
+      }
+      known = node->lastCount;
+    } else if (step < 0x8000) {
+      node->lost += step - 1;
+      bump(worker->lost, step - 1);
+    }
+    // A backwards jump is a node power cycle (the counter lives in RTC memory)
+  }
+
+  node->hasSequence = decoded.hasSequence;
+  node->lastSequence = decoded.sequence;
+  node->lastCount = decoded.count;
+  node->nodeId = decoded.nodeId;
+  node->channel = frame.channel;
+  node->rssi = frame.rssi;
+  node->lastFormat = decoded.format;
+  node->lastFlags = decoded.flags;
+  node->lastSeenNs = frame.rxNs;
+  node->frames++;
+  node->readings += decoded.count - known;
+  if (decoded.count > 0) node->last = decoded.readings[decoded.count - 1];
+  bump(worker->readings, decoded.count - known);
+
+  worker->latency.record(ingestNowNs() - frame.rxNs);
+
+  if (options.sink == nullptr) return;
+  IngestRecord record;
+  record.rxNs = frame.rxNs;
+  memcpy(record.mac, frame.mac, 6);
+  record.channel = frame.channel;
+  record.rssi = frame.rssi;
+  record.nodeId = decoded.nodeId;
+  record.sequence = decoded.sequence;
+  record.hasSequence = decoded.hasSequence;
+  record.format = decoded.format;
+  record.flags = decoded.flags;
+  for (int i = known; i < decoded.count; i++) {
+    record.reading = decoded.readings[i];
+    if (!worker->outbox->push(record)) bump(worker->sinkDrops);
+  }
+}
+
+static void workerLoop(IngestWorker* worker) {
+  IngestFrame frame;
+  int emptyPolls = 0;
+
+  for (;;) {
+    if (worker->inbox->pop(frame)) {
+      processFrame(worker, frame);
+      emptyPolls = 0;
+      continue;
+    }
+    // Receivers are stopped before this flag drops, so the inbox is final
+    if (!processing.load(std::memory_order_acquire)) break;
+    idle(emptyPolls);
+  }
+}
+
+static void sinkLoop() {
+  IngestRecord record;
+  int emptyPolls = 0;
+
+  for (;;) {
+    bool any = false;
+    for (int i = 0; i < workerCount; i++) {
+      // Bounded per worker so one busy shard cannot starve the others
+      for (int n = 0; n < 64 && workers[i]->outbox->pop(record); n++) {
+        options.sink(record, options.sinkContext);
+        any = true;
+      }
+    }
+    if (any) {
+      emptyPolls = 0;
+      continue;
+    }
+    if (!sinking.load(std::memory_order_acquire)) break;
+    idle(emptyPolls);
+  }
+}
+
+static void freeWorkers() {
+  for (int i = 0; i < workerCount; i++) {
+    nodeTableFree(workers[i]->table);
+    delete workers[i]->inbox;
+    delete workers[i]->outbox;
+    delete workers[i];
+    workers[i] = nullptr;
+  }
+  workerCount = 0;
+}
+
+bool ingestStart(const IngestOptions& opts, const IngestTransport* transports, int count) {
+  if (opts.workers < 1 || opts.workers > INGEST_MAX_WORKERS ||
+      count < 1 || count > INGEST_MAX_RECEIVERS || workerCount != 0) {
+    return false;
+  }
+  options = opts;
+
+  for (int i = 0; i < opts.workers; i++) {
+    IngestWorker* worker = new (std::nothrow) IngestWorker();
+    if (worker == nullptr) {
+      freeWorkers();
+      return false;
+    }
+    workers[workerCount++] = worker;
+    worker->inbox = new (std::nothrow) WorkerInbox();
+    worker->outbox = opts.sink != nullptr ? new (std::nothrow) WorkerOutbox() : nullptr;
+    if (worker->inbox == nullptr || (opts.sink != nullptr && worker->outbox == nullptr) ||
+        !nodeTableInit(worker->table, opts.tableCapacity)) {
+      freeWorkers();
+      return false;
+    }
+  }
+
+  receiving.store(true, std::memory_order_release);
+  processing.store(true, std::memory_order_release);
+  sinking.store(true, std::memory_order_release);
+
+  for (int i = 0; i < workerCount; i++) {
+    workers[i]->thread = std::thread(workerLoop, workers[i]);
+  }
+  if (opts.sink != nullptr) {
+    sinkThread = std::thread(sinkLoop);
+  }
+  for (int i = 0; i < count; i++) {
+    IngestReceiver* receiver = new IngestReceiver();
+    receiver->transport = transports[i];
+    receivers[receiverCount++] = receiver;
+    receiver->thread = std::thread(receiveLoop, receiver);
+  }
+  return true;
+}
+
+void ingestStop() {
+  receiving.store(false, std::memory_order_release);
+  for (int i = 0; i < receiverCount; i++) {
+    receivers[i]->thread.join();
+  }
+
+  processing.store(false, std::memory_order_release);
+  for (int i = 0; i < workerCount; i++) {
+    workers[i]->thread.join();
+  }
+
+  sinking.store(false, std::memory_order_release);
+  if (sinkThread.joinable()) sinkThread.join();
+
+  for (int i = 0; i < receiverCount; i++) {
+    IngestTransport& transport = receivers[i]->transport;
+    if (transport.close != nullptr) transport.close(transport.context);
+  }
+}
+
+void ingestGetStats(IngestStats& out) {
+  out.received = out.queueDrops = out.processed = out.undecodable = 0;
+  out.tableFull = out.readings = out.lost = out.duplicates = out.sinkDrops = 0;
+  out.nodes = 0;
+  out.latency.clear();
+
+  for (int i = 0; i < receiverCount; i++) {
+    out.received += receivers[i]->received.load(std::memory_order_relaxed);
+    out.queueDrops += receivers[i]->queueDrops.load(std::memory_order_relaxed);
+  }
+  for (int i = 0; i < workerCount; i++) {
+    IngestWorker* worker = workers[i];
+    out.processed += worker->processed.load(std::memory_order_relaxed);
+    out.undecodable += worker->undecodable.load(std::memory_order_relaxed);
+    out.tableFull += worker->tableFull.load(std::memory_order_relaxed);
+    out.readings += worker->readings.load(std::memory_order_relaxed);
+    out.lost += worker->lost.load(std::memory_order_relaxed);
+    out.duplicates += worker->duplicates.load(std::memory_order_relaxed);
+    out.sinkDrops += worker->sinkDrops.load(std::memory_order_relaxed);
+    out.nodes += worker->nodes.load(std::memory_order_relaxed);
+    out.latency.merge(worker->latency);
+  }
+}
+
+bool ingestFindNode(const uint8_t mac[6], NodeState& out) {
+  if (workerCount == 0) return false;
+  NodeState* node = nodeTableFind(workers[workerFor(mac)]->table, mac);
+  if (node == nullptr) return false;
+  memcpy(&out, node, sizeof(out));
+  return true;
+}
@@ -0,0 +1,75 @@
+/*
+ * Ingest Pipeline
+ *
+ *   transports -> receive threads --MPSC--> workers --SPSC--> sink thread
+ *
+ * Each transport gets a receive thread. Frames are routed to a worker by
+ * the hash of the sender MAC, so a node is always handled by the same
+ * worker. Each worker owns its node-table shard, decodes the payload,
+ * updates the node state and records the ingest latency (receive stamp
+ * to state updated). Decoded readings go to the sink through one SPSC
+ * queue per worker; the sink callback runs on its own thread so slow
+ * output never stalls ingest. Frames are dropped and counted, never
+ * blocked on, when a queue is full.
+ */
+
+#ifndef INGEST_PIPELINE_H
+#define INGEST_PIPELINE_H
+
+#include <stdint.h>
+#include "transport.h"
+#include "frame_decoder.h"
+#include "node_table.h"
+#include "latency_histogram.h"
+
+// One decoded reading handed to the sink
+typedef struct IngestRecord {
+  uint64_t rxNs;
+  uint8_t mac[6];
+  uint8_t channel;
+  int8_t rssi;
+  uint16_t nodeId;
+  uint16_t sequence;
+  bool hasSequence;
+  uint8_t format;             // IngestFormat
+  uint8_t flags;
+  WireReading reading;
+} IngestRecord;
+
+typedef void (*IngestSink)(const IngestRecord& record, void* context);
+
+typedef struct IngestOptions {
+  int workers;                // 1..INGEST_MAX_WORKERS
+  uint32_t tableCapacity;     // Node slots per worker
+  IngestSink sink;            // nullptr = no per-reading output
+  void* sinkContext;
+} IngestOptions;
+
+typedef struct IngestStats {
+  uint64_t received;          // Frames handed over by transports
+  uint64_t queueDrops;        // Worker queue full
+  uint64_t processed;         // Frames taken by workers
+  uint64_t undecodable;
+  uint64_t tableFull;         // New node with no room in its shard
+  uint64_t readings;
+  uint64_t lost;              // Sequence gaps over all nodes
+  uint64_t duplicates;
+  uint64_t sinkDrops;         // Sink queue full
+  uint32_t nodes;
+  LatencyHistogram latency;   // Ingest latency, ns
+} IngestStats;
+
+// Start the threads. Transports are owned by the pipeline from here on
+bool ingestStart(const IngestOptions& options, const IngestTransport* transports, int count);
+
+// Stop receiving, drain the queues, join every thread and close the transports
+void ingestStop();
+
+// Counters and merged latency since ingestStart()
+void ingestGetStats(IngestStats& out);
+
+// Copy of one node's state (taken from its worker shard without locking,
+// so fields may straddle an update). Returns false if the node is unknown
+bool ingestFindNode(const uint8_t mac[6], NodeState& out);
+
+#endif // INGEST_PIPELINE_H
@@ -0,0 +1,121 @@
+/*
+ * Lock-Free Ingest Queues
+ *
+ * Bounded rings used to hand frames between threads without locks.
+ *   SpscQueue - one producer, one consumer (worker -> sink)
+ *   MpscQueue - many producers, one consumer (receivers -> worker). Each
+ *               cell carries a sequence number so producers claim cells
+ *               with one CAS and the consumer sees a cell only once it
+ *               has been written (Vyukov's bounded queue).
+ * Capacity must be a power of two. push() returns false when full - the
+ * caller decides whether to drop or retry. Items are copied in and out.
+ */
+
+#ifndef INGEST_QUEUE_H
+#define INGEST_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#define INGEST_CACHE_LINE 64
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+ public:
+  SpscQueue() : head_(0), tail_(0) {}
+
+  bool push(const T& item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - headCache_ == Capacity) {
+      headCache_ = head_.load(std::memory_order_acquire);
+      if (tail - headCache_ == Capacity) return false;
+    }
+    items_[tail & (Capacity - 1)] = item;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tailCache_) {
+      tailCache_ = tail_.load(std::memory_order_acquire);
+      if (head == tailCache_) return false;
+    }
+    item = items_[head & (Capacity - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+ private:
+  // Consumer side
+  alignas(INGEST_CACHE_LINE) std::atomic<size_t> head_;
+  size_t tailCache_ = 0;
+  // Producer side
+  alignas(INGEST_CACHE_LINE) std::atomic<size_t> tail_;
+  size_t headCache_ = 0;
+  alignas(INGEST_CACHE_LINE) T items_[Capacity];
+};
+
+template <typename T, size_t Capacity>
+class MpscQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+ public:
+  MpscQueue() : head_(0), tail_(0) {
+    for (size_t i = 0; i < Capacity; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  bool push(const T& item) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells_[tail & (Capacity - 1)];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)sequence - (intptr_t)tail;
+      if (diff == 0) {
+        // Cell is free for this lap - claim it
+        if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) break;
+      } else if (diff < 0) {
+        return false;  // Full: the consumer has not freed this cell yet
+      } else {
+        tail = tail_.load(std::memory_order_relaxed);  // Another producer took it
+      }
+    }
+    cell->item = item;
+    cell->sequence.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T& item) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    Cell* cell = &cells_[head & (Capacity - 1)];
+    size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    if ((intptr_t)sequence - (intptr_t)(head + 1) < 0) return false;  // Not written yet
+
+    item = cell->item;
+    cell->sequence.store(head + Capacity, std::memory_order_release);
+    head_.store(head + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T item;
+  };
+
+  alignas(INGEST_CACHE_LINE) std::atomic<size_t> head_;  // Consumer only
+  alignas(INGEST_CACHE_LINE) std::atomic<size_t> tail_;  // Shared by producers
+  alignas(INGEST_CACHE_LINE) Cell cells_[Capacity];
+};
+
+#endif // INGEST_QUEUE_H
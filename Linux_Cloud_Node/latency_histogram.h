@@ -0,0 +1,78 @@
+/*
+ * Latency Histogram
+ *
+ * Log-linear buckets over nanoseconds: values below 2^SUB_BITS are
+ * exact, above that each power of two is split into 2^SUB_BITS buckets
+ * (about 3 % relative error). Recording is one relaxed atomic add, so a
+ * worker can record while the stats thread reads and merges.
+ */
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <atomic>
+
+class LatencyHistogram {
+ public:
+  static const int SUB_BITS = 5;
+  static const int SUB_COUNT = 1 << SUB_BITS;
+  static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+  LatencyHistogram() { clear(); }
+
+  void clear() {
+    for (int i = 0; i < BUCKETS; i++) buckets_[i].store(0, std::memory_order_relaxed);
+  }
+
+  void record(uint64_t ns) {
+    buckets_[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Add another histogram's counts (snapshot of a live one is fine)
+  void merge(const LatencyHistogram& other) {
+    for (int i = 0; i < BUCKETS; i++) {
+      uint64_t n = other.buckets_[i].load(std::memory_order_relaxed);
+      if (n != 0) buckets_[i].fetch_add(n, std::memory_order_relaxed);
+    }
+  }
+
+  uint64_t count() const {
+    uint64_t total = 0;
+    for (int i = 0; i < BUCKETS; i++) total += buckets_[i].load(std::memory_order_relaxed);
+    return total;
+  }
+
+  // Upper bound of the bucket holding the given quantile (0..1), 0 if empty
+  uint64_t percentile(double quantile) const {
+    uint64_t total = count();
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)(quantile * (double)(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKETS; i++) {
+      seen += buckets_[i].load(std::memory_order_relaxed);
+      if (seen >= rank) return bucketUpper(i);
+    }
+    return bucketUpper(BUCKETS - 1);
+  }
+
+ private:
+  static int bucketOf(uint64_t ns) {
+    if (ns < (uint64_t)SUB_COUNT) return (int)ns;
+    int top = 63 - __builtin_clzll(ns);           // Position of the highest set bit
+    int shift = top - SUB_BITS;
+    int sub = (int)((ns >> shift) & (SUB_COUNT - 1));
+    return (shift + 1) * SUB_COUNT + sub;
+  }
+
+  static uint64_t bucketUpper(int bucket) {
+    if (bucket < SUB_COUNT) return (uint64_t)bucket;
+    int shift = bucket / SUB_COUNT - 1;
+    uint64_t sub = (uint64_t)(bucket % SUB_COUNT);
+    return ((SUB_COUNT + sub + 1) << shift) - 1;
+  }
+
+  std::atomic<uint64_t> buckets_[BUCKETS];
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,141 @@
+/*
+ * Load Profile Implementation
+ */
+
+#include "load_profile.h"
+#include "transport.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <chrono>
+#include <thread>
+
+#define LOAD_SEND_BATCH 64
+
+void loadNodeMac(uint32_t index, uint8_t mac[6]) {
+  mac[0] = 0x02;  // Locally administered, unicast
+  mac[1] = 0x5E;
+  mac[2] = (uint8_t)(index >> 24);
+  mac[3] = (uint8_t)(index >> 16);
+  mac[4] = (uint8_t)(index >> 8);
+  mac[5] = (uint8_t)index;
+}
+
+bool loadGeneratorInit(LoadGenerator& generator, const LoadProfile& profile) {
+  if (profile.nodes == 0) return false;
+  generator.profile = profile;
+  if (generator.profile.readingsPerFrame == 0) generator.profile.readingsPerFrame = 1;
+  generator.cursor = 0;
+  generator.sequences = (uint16_t*)calloc(profile.nodes, sizeof(uint16_t));
+  return generator.sequences != nullptr;
+}
+
+void loadGeneratorFree(LoadGenerator& generator) {
+  free(generator.sequences);
+  generator.sequences = nullptr;
+}
+
+// Plausible reading for a node: level drifts with the sequence number
+static void syntheticReading(uint32_t node, uint16_t sequence, struct_message& out) {
+  memset(&out, 0, sizeof(out));
+  float level = (float)((node * 37 + sequence) % 200) / 2.0f;
+  out.level_percent = level;
+  out.distance_cm = 120.0f - level;
+  out.litres_remaining = level * 9.0f;
+  out.battery_v = 3.70f + (float)(node % 50) / 100.0f;
+  out.timestamp = (uint32_t)sequence * 300000UL;
+}
+
+size_t loadNextRecord(LoadGenerator& generator, uint8_t* out, size_t capacity) {
+  const LoadProfile& profile = generator.profile;
+  uint32_t slot = generator.cursor;
+  generator.cursor = (generator.cursor + 1) % profile.nodes;
+  uint32_t node = profile.firstNode + slot;
+  uint16_t sequence = generator.sequences[slot]++;
+
+  uint8_t mac[6];
+  loadNodeMac(node, mac);
+
+  uint8_t payload[INGEST_MAX_PAYLOAD];
+  size_t length = 0;
+  struct_message reading;
+
+  if (profile.format == INGEST_FORMAT_LEGACY) {
+    syntheticReading(node, sequence, reading);
+    memcpy(payload, &reading, sizeof(reading));
+    length = sizeof(reading);
+  } else {
+    WireWriter writer;
+    wireBegin(writer, payload, sizeof(payload), wireNodeIdFromMac(mac), sequence, 0x01);
+    for (int i = 0; i < profile.readingsPerFrame; i++) {
+      syntheticReading(node, sequence, reading);
+      wireAddReading(writer, reading, (uint32_t)(profile.readingsPerFrame - 1 - i) * 300);
+    }
+    wireAddNodeTlvs(writer);
+    length = wireFinish(writer);
+  }
+  if (length == 0) return 0;
+
+  return bridgeBuildRecord(out, capacity, mac, 6, (int8_t)(-40 - (int)(node % 50)), payload, length);
+}
+
+uint64_t loadRunUdpSender(const LoadSender& sender, const std::atomic<bool>* stop) {
+  LoadGenerator generator;
+  if (!loadGeneratorInit(generator, sender.profile)) return 0;
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in target;
+  memset(&target, 0, sizeof(target));
+  target.sin_family = AF_INET;
+  target.sin_port = htons(sender.port);
+  if (fd < 0 || inet_pton(AF_INET, sender.host, &target.sin_addr) != 1 ||
+      connect(fd, (struct sockaddr*)&target, sizeof(target)) < 0) {
+    perror("loadgen: socket");
+    if (fd >= 0) close(fd);
+    loadGeneratorFree(generator);
+    return 0;
+  }
+
+  static thread_local uint8_t records[LOAD_SEND_BATCH][BRIDGE_HEADER_LEN + INGEST_MAX_PAYLOAD];
+  struct iovec iov[LOAD_SEND_BATCH];
+  struct mmsghdr messages[LOAD_SEND_BATCH];
+
+  typedef std::chrono::steady_clock Clock;
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(
+                                      std::chrono::duration<double>(sender.seconds));
+  uint64_t sent = 0;
+
+  while (Clock::now() < end && (stop == nullptr || !stop->load(std::memory_order_relaxed))) {
+    int batch = LOAD_SEND_BATCH;
+    if (sender.framesPerSecond > 0) {
+      // Pace against the schedule: frames due by now minus frames already sent
+      double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+      uint64_t due = (uint64_t)(elapsed * sender.framesPerSecond);
+      if (due <= sent) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        continue;
+      }
+      if (due - sent < (uint64_t)batch) batch = (int)(due - sent);
+    }
+
+    for (int i = 0; i < batch; i++) {
+      size_t length = loadNextRecord(generator, records[i], sizeof(records[i]));
+      iov[i].iov_base = records[i];
+      iov[i].iov_len = length;
+      memset(&messages[i].msg_hdr, 0, sizeof(messages[i].msg_hdr));
+      messages[i].msg_hdr.msg_iov = &iov[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+    }
+    int done = sendmmsg(fd, messages, batch, 0);
+    if (done > 0) sent += (uint64_t)done;
+  }
+
+  close(fd);
+  loadGeneratorFree(generator);
+  return sent;
+}
@@ -0,0 +1,52 @@
+/*
+ * Load Profile
+ *
+ * Synthetic Sensor Node traffic for the load generator and the benchmark.
+ * Node i gets a fixed MAC and its own sequence counter; frames are built
+ * with the node's wire format encoder (wire_format.cpp) and wrapped in a
+ * bridge record, exactly as the dongle or UDP stand-in would deliver them.
+ */
+
+#ifndef LOAD_PROFILE_H
+#define LOAD_PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "frame_decoder.h"
+
+typedef struct LoadProfile {
+  uint32_t firstNode;         // Index of the first simulated node
+  uint32_t nodes;             // Nodes this generator speaks for
+  IngestFormat format;        // INGEST_FORMAT_V2 or INGEST_FORMAT_LEGACY
+  uint8_t readingsPerFrame;   // v2 only (batched readings)
+} LoadProfile;
+
+typedef struct LoadGenerator {
+  LoadProfile profile;
+  uint32_t cursor;            // Next node (round robin)
+  uint16_t* sequences;        // Per node
+} LoadGenerator;
+
+// MAC of simulated node index (locally administered, 02:...)
+void loadNodeMac(uint32_t index, uint8_t mac[6]);
+
+bool loadGeneratorInit(LoadGenerator& generator, const LoadProfile& profile);
+void loadGeneratorFree(LoadGenerator& generator);
+
+// Next node's next frame as a bridge record. Returns its length (0 on error)
+size_t loadNextRecord(LoadGenerator& generator, uint8_t* out, size_t capacity);
+
+typedef struct LoadSender {
+  const char* host;
+  uint16_t port;
+  double framesPerSecond;     // 0 = as fast as possible
+  double seconds;
+  LoadProfile profile;
+} LoadSender;
+
+// Send bridge records over UDP until seconds elapse or stop is set.
+// Returns the number of datagrams sent
+uint64_t loadRunUdpSender(const LoadSender& sender, const std::atomic<bool>* stop);
+
+#endif // LOAD_PROFILE_H
@@ -0,0 +1,74 @@
+/*
+ * Node Table Implementation
+ */
+
+#include "node_table.h"
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t nodeKeyFromMac(const uint8_t mac[6]) {
+  uint64_t key = 1ULL << 48;
+  for (int i = 0; i < 6; i++) {
+    key |= (uint64_t)mac[i] << (8 * (5 - i));
+  }
+  return key;
+}
+
+uint32_t nodeKeyHash(uint64_t key) {
+  // splitmix64 finalizer - MACs from one vendor share their upper bytes
+  key ^= key >> 30;
+  key *= 0xBF58476D1CE4E5B9ULL;
+  key ^= key >> 27;
+  key *= 0x94D049BB133111EBULL;
+  key ^= key >> 31;
+  return (uint32_t)key;
+}
+
+bool nodeTableInit(NodeTable& table, uint32_t capacity) {
+  uint32_t size = 16;
+  while (size < capacity) size <<= 1;
+
+  table.slots = (NodeState*)calloc(size, sizeof(NodeState));
+  table.capacity = table.slots != nullptr ? size : 0;
+  table.count = 0;
+  return table.slots != nullptr;
+}
+
+void nodeTableFree(NodeTable& table) {
+  free(table.slots);
+  table.slots = nullptr;
+  table.capacity = 0;
+  table.count = 0;
+}
+
+// Slot holding key, or the empty slot where it would go
+static NodeState* probe(NodeTable& table, uint64_t key) {
+  uint32_t mask = table.capacity - 1;
+  uint32_t index = nodeKeyHash(key) & mask;
+  for (;;) {
+    NodeState* slot = &table.slots[index];
+    if (slot->key == key || slot->key == 0) return slot;
+    index = (index + 1) & mask;
+  }
+}
+
+NodeState* nodeTableFind(NodeTable& table, const uint8_t mac[6]) {
+  if (table.capacity == 0) return nullptr;
+  NodeState* slot = probe(table, nodeKeyFromMac(mac));
+  return slot->key != 0 ? slot : nullptr;
+}
+
+NodeState* nodeTableUpsert(NodeTable& table, const uint8_t mac[6]) {
+  if (table.capacity == 0) return nullptr;
+
+  uint64_t key = nodeKeyFromMac(mac);
+  NodeState* slot = probe(table, key);
+  if (slot->key == key) return slot;
+
+  // Keep probe chains short (and guarantee an empty slot ends every probe)
+  if ((table.count + 1) * 8 > table.capacity * 7) return nullptr;
+  slot->key = key;
+  memcpy(slot->mac, mac, 6);
+  table.count++;
+  return slot;
+}
@@ -0,0 +1,58 @@
+/*
+ * Node Table
+ *
+ * Per-node state keyed by MAC address in a flat open-addressing hash
+ * table: one array of slots, linear probing, no per-node allocation.
+ * Each ingest worker owns one table (nodes are sharded by MAC hash), so
+ * a table only ever has one writer and needs no locking.
+ */
+
+#ifndef NODE_TABLE_H
+#define NODE_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame_decoder.h"
+
+typedef struct NodeState {
+  uint64_t key;               // nodeKeyFromMac(); 0 = empty slot
+  uint8_t mac[6];
+  uint8_t channel;            // Channel the last frame arrived on
+  int8_t rssi;
+  uint16_t nodeId;            // v2 node ID (0 for legacy frames)
+  uint16_t lastSequence;
+  bool hasSequence;
+  uint8_t lastCount;          // Readings in the frame with lastSequence
+  uint8_t lastFormat;         // IngestFormat of the last frame
+  uint8_t lastFlags;          // Send reasons of the last frame
+  WireReading last;           // Newest reading
+  uint64_t lastSeenNs;
+  uint32_t frames;
+  uint32_t readings;
+  uint32_t lost;              // Frames missing from the sequence
+  uint32_t duplicates;        // Frames seen twice with nothing new (node retries)
+} NodeState;
+
+typedef struct NodeTable {
+  NodeState* slots;
+  uint32_t capacity;          // Power of two
+  uint32_t count;
+} NodeTable;
+
+// 48-bit MAC with a marker bit, so no MAC maps to the empty key
+uint64_t nodeKeyFromMac(const uint8_t mac[6]);
+
+// Well-mixed hash of a key (also used to pick the worker)
+uint32_t nodeKeyHash(uint64_t key);
+
+// Allocate capacity slots (rounded up to a power of two)
+bool nodeTableInit(NodeTable& table, uint32_t capacity);
+void nodeTableFree(NodeTable& table);
+
+// Existing entry, or nullptr
+NodeState* nodeTableFind(NodeTable& table, const uint8_t mac[6]);
+
+// Existing or new entry. Returns nullptr when the table is 7/8 full
+NodeState* nodeTableUpsert(NodeTable& table, const uint8_t mac[6]);
+
+#endif // NODE_TABLE_H
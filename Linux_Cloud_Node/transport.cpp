@@ -0,0 +1,48 @@
+/*
+ * Ingest Transports - Shared Helpers
+ */
+
+#include "transport.h"
+#include <string.h>
+#include <time.h>
+
+uint64_t ingestNowNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+bool bridgeParseRecord(const uint8_t* record, size_t length, IngestFrame& frame) {
+  if (length <= BRIDGE_HEADER_LEN || length - BRIDGE_HEADER_LEN > INGEST_MAX_PAYLOAD) {
+    return false;
+  }
+  memcpy(frame.mac, record, 6);
+  frame.channel = record[6];
+  frame.rssi = (int8_t)record[7];
+  frame.length = (uint8_t)(length - BRIDGE_HEADER_LEN);
+  memcpy(frame.payload, record + BRIDGE_HEADER_LEN, frame.length);
+  return true;
+}
+
+size_t bridgeBuildRecord(uint8_t* out, size_t capacity, const uint8_t mac[6], uint8_t channel,
+                         int8_t rssi, const uint8_t* payload, size_t length) {
+  if (length == 0 || length > INGEST_MAX_PAYLOAD || capacity < BRIDGE_HEADER_LEN + length) {
+    return 0;
+  }
+  memcpy(out, mac, 6);
+  out[6] = channel;
+  out[7] = (uint8_t)rssi;
+  memcpy(out + BRIDGE_HEADER_LEN, payload, length);
+  return BRIDGE_HEADER_LEN + length;
+}
+
+uint8_t bridgeCrc8(const uint8_t* data, size_t length) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,70 @@
+/*
+ * Ingest Transports
+ *
+ * A transport delivers ESP-NOW frames heard by the Cloud Node. Each one
+ * is a receive function plus its context, so the pipeline does not care
+ * where frames come from:
+ *   UDP    - local stand-in for ESP-NOW; one bridge record per datagram
+ *   Serial - an ESP32 dongle forwarding what it hears over USB serial,
+ *            one bridge record per SLIP-like packet (see below)
+ *
+ * Bridge record (the dongle's view of one received ESP-NOW frame)
+ *   0  u8[6] source MAC
+ *   6  u8    WiFi channel
+ *   7  i8    RSSI in dBm
+ *   8  ...   ESP-NOW payload (1-250 bytes)
+ *
+ * Serial packet: 0x7E, u8 record length, record, u8 CRC-8 (poly 0x07)
+ * over the record. Bad packets are skipped by resyncing on the next 0x7E.
+ */
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "ingest_config.h"
+
+#define BRIDGE_HEADER_LEN 8
+#define BRIDGE_SERIAL_SYNC 0x7E
+
+// One received frame as it travels through the pipeline
+typedef struct IngestFrame {
+  uint64_t rxNs;                        // Receive time (ingestNowNs())
+  uint8_t mac[6];
+  uint8_t channel;
+  int8_t rssi;
+  uint8_t length;                       // Payload length
+  uint8_t payload[INGEST_MAX_PAYLOAD];
+} IngestFrame;
+
+typedef struct IngestTransport {
+  const char* name;
+  void* context;
+  // Fill up to max frames, waiting at most timeoutMs for the first one.
+  // Returns the count (0 on timeout), or -1 if the transport failed
+  int (*receive)(void* context, IngestFrame* frames, int max, int timeoutMs);
+  void (*close)(void* context);
+} IngestTransport;
+
+// Monotonic clock used for receive stamps and latency
+uint64_t ingestNowNs();
+
+// Parse a bridge record into frame (rxNs is left alone)
+bool bridgeParseRecord(const uint8_t* record, size_t length, IngestFrame& frame);
+
+// Build a bridge record. Returns its length, 0 if it does not fit
+size_t bridgeBuildRecord(uint8_t* out, size_t capacity, const uint8_t mac[6], uint8_t channel,
+                         int8_t rssi, const uint8_t* payload, size_t length);
+
+// CRC-8 (poly 0x07, init 0) used by the serial framing
+uint8_t bridgeCrc8(const uint8_t* data, size_t length);
+
+// UDP socket bound to address:port (address may be nullptr for any).
+// With reusePort several transports can share the port (SO_REUSEPORT)
+bool transportOpenUdp(IngestTransport& out, const char* address, uint16_t port, bool reusePort);
+
+// Serial dongle at device (8N1, raw)
+bool transportOpenSerial(IngestTransport& out, const char* device, int baud);
+
+#endif // TRANSPORT_H
@@ -0,0 +1,150 @@
+/*
+ * Ingest Transport - Serial Dongle
+ *
+ * An ESP32 on the Cloud Node's channel forwards every ESP-NOW frame it
+ * hears as a framed bridge record (see transport.h). The deframer keeps
+ * partial packets between reads and resyncs on the next sync byte after
+ * a bad length or CRC.
+ */
+
+#include "transport.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define SERIAL_PACKET_MAX (2 + BRIDGE_HEADER_LEN + INGEST_MAX_PAYLOAD + 1)
+
+typedef struct SerialTransport {
+  int fd;
+  uint8_t pending[SERIAL_PACKET_MAX * 4];
+  size_t pendingLength;
+  uint32_t badPackets;
+} SerialTransport;
+
+static speed_t baudConstant(int baud) {
+  switch (baud) {
+    case 115200:  return B115200;
+    case 230400:  return B230400;
+    case 460800:  return B460800;
+    case 921600:  return B921600;
+    case 1000000: return B1000000;
+    case 2000000: return B2000000;
+    default:      return 0;
+  }
+}
+
+// Pull complete packets out of the pending bytes
+static int serialDeframe(SerialTransport* serial, IngestFrame* frames, int max, uint64_t nowNs) {
+  int count = 0;
+  size_t offset = 0;
+
+  while (count < max && offset < serial->pendingLength) {
+    if (serial->pending[offset] != BRIDGE_SERIAL_SYNC) {
+      offset++;
+      continue;
+    }
+    if (serial->pendingLength - offset < 2) break;  // Need the length byte
+
+    size_t recordLength = serial->pending[offset + 1];
+    if (recordLength <= BRIDGE_HEADER_LEN) {
+      serial->badPackets++;
+      offset++;
+      continue;
+    }
+    size_t packetLength = 2 + recordLength + 1;
+    if (serial->pendingLength - offset < packetLength) break;  // Rest still in flight
+
+    const uint8_t* record = serial->pending + offset + 2;
+    if (bridgeCrc8(record, recordLength) != record[recordLength] ||
+        !bridgeParseRecord(record, recordLength, frames[count])) {
+      serial->badPackets++;
+      offset++;
+      continue;
+    }
+    frames[count].rxNs = nowNs;
+    count++;
+    offset += packetLength;
+  }
+
+  memmove(serial->pending, serial->pending + offset, serial->pendingLength - offset);
+  serial->pendingLength -= offset;
+  return count;
+}
+
+static int serialReceive(void* context, IngestFrame* frames, int max, int timeoutMs) {
+  SerialTransport* serial = (SerialTransport*)context;
+
+  // Packets left over from the last read come first
+  int count = serialDeframe(serial, frames, max, ingestNowNs());
+  if (count > 0) return count;
+
+  struct pollfd pfd = { serial->fd, POLLIN, 0 };
+  int ready = poll(&pfd, 1, timeoutMs);
+  if (ready <= 0) return 0;
+  if (pfd.revents & (POLLERR | POLLHUP)) return -1;  // Dongle unplugged
+
+  ssize_t got = read(serial->fd, serial->pending + serial->pendingLength,
+                     sizeof(serial->pending) - serial->pendingLength);
+  if (got < 0) return 0;
+  if (got == 0) return -1;
+  serial->pendingLength += (size_t)got;
+
+  return serialDeframe(serial, frames, max, ingestNowNs());
+}
+
+static void serialClose(void* context) {
+  SerialTransport* serial = (SerialTransport*)context;
+  if (serial->badPackets > 0) {
+    fprintf(stderr, "serial: %u bad packets skipped\n", serial->badPackets);
+  }
+  close(serial->fd);
+  free(serial);
+}
+
+bool transportOpenSerial(IngestTransport& out, const char* device, int baud) {
+  speed_t speed = baudConstant(baud);
+  if (speed == 0) {
+    fprintf(stderr, "serial: unsupported baud rate %d\n", baud);
+    return false;
+  }
+
+  int fd = open(device, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0) {
+    perror(device);
+    return false;
+  }
+
+  struct termios tty;
+  if (tcgetattr(fd, &tty) != 0) {
+    perror("serial: tcgetattr");
+    close(fd);
+    return false;
+  }
+  cfmakeraw(&tty);
+  cfsetispeed(&tty, speed);
+  cfsetospeed(&tty, speed);
+  tty.c_cflag |= CLOCAL | CREAD;
+  tty.c_cflag &= ~(CSTOPB | CRTSCTS);
+  if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+    perror("serial: tcsetattr");
+    close(fd);
+    return false;
+  }
+
+  SerialTransport* serial = (SerialTransport*)calloc(1, sizeof(SerialTransport));
+  if (serial == nullptr) {
+    close(fd);
+    return false;
+  }
+  serial->fd = fd;
+
+  out.name = "serial";
+  out.context = serial;
+  out.receive = serialReceive;
+  out.close = serialClose;
+  return true;
+}
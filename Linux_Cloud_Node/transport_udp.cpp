@@ -0,0 +1,105 @@
+/*
+ * Ingest Transport - UDP
+ *
+ * Local stand-in for ESP-NOW: every datagram is one bridge record.
+ * Datagrams are pulled in batches with recvmmsg() so one system call
+ * covers up to INGEST_RECEIVE_BATCH frames.
+ */
+
+#include "transport.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+typedef struct UdpTransport {
+  int fd;
+  uint8_t buffers[INGEST_RECEIVE_BATCH][BRIDGE_HEADER_LEN + INGEST_MAX_PAYLOAD + 1];
+  struct iovec iov[INGEST_RECEIVE_BATCH];
+  struct mmsghdr messages[INGEST_RECEIVE_BATCH];
+} UdpTransport;
+
+static int udpReceive(void* context, IngestFrame* frames, int max, int timeoutMs) {
+  UdpTransport* udp = (UdpTransport*)context;
+  if (max > INGEST_RECEIVE_BATCH) max = INGEST_RECEIVE_BATCH;
+
+  struct pollfd pfd = { udp->fd, POLLIN, 0 };
+  int ready = poll(&pfd, 1, timeoutMs);
+  if (ready < 0) return 0;  // EINTR - let the caller check for shutdown
+  if (ready == 0) return 0;
+
+  for (int i = 0; i < max; i++) {
+    udp->iov[i].iov_base = udp->buffers[i];
+    udp->iov[i].iov_len = sizeof(udp->buffers[i]);
+    memset(&udp->messages[i].msg_hdr, 0, sizeof(udp->messages[i].msg_hdr));
+    udp->messages[i].msg_hdr.msg_iov = &udp->iov[i];
+    udp->messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int received = recvmmsg(udp->fd, udp->messages, max, MSG_DONTWAIT, nullptr);
+  if (received <= 0) return 0;
+
+  uint64_t nowNs = ingestNowNs();
+  int count = 0;
+  for (int i = 0; i < received; i++) {
+    // Oversized datagrams were truncated - drop them like malformed records
+    if (udp->messages[i].msg_hdr.msg_flags & MSG_TRUNC) continue;
+    if (bridgeParseRecord(udp->buffers[i], udp->messages[i].msg_len, frames[count])) {
+      frames[count].rxNs = nowNs;
+      count++;
+    }
+  }
+  return count;
+}
+
+static void udpClose(void* context) {
+  UdpTransport* udp = (UdpTransport*)context;
+  close(udp->fd);
+  free(udp);
+}
+
+bool transportOpenUdp(IngestTransport& out, const char* address, uint16_t port, bool reusePort) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (fd < 0) {
+    perror("udp: socket");
+    return false;
+  }
+
+  int one = 1;
+  if (reusePort) setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+  int bufferBytes = 8 * 1024 * 1024;  // Absorb bursts from many nodes
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferBytes, sizeof(bufferBytes));
+
+  struct sockaddr_in bindAddr;
+  memset(&bindAddr, 0, sizeof(bindAddr));
+  bindAddr.sin_family = AF_INET;
+  bindAddr.sin_port = htons(port);
+  bindAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (address != nullptr && inet_pton(AF_INET, address, &bindAddr.sin_addr) != 1) {
+    fprintf(stderr, "udp: bad address %s\n", address);
+    close(fd);
+    return false;
+  }
+  if (bind(fd, (struct sockaddr*)&bindAddr, sizeof(bindAddr)) < 0) {
+    perror("udp: bind");
+    close(fd);
+    return false;
+  }
+
+  UdpTransport* udp = (UdpTransport*)calloc(1, sizeof(UdpTransport));
+  if (udp == nullptr) {
+    close(fd);
+    return false;
+  }
+  udp->fd = fd;
+
+  out.name = "udp";
+  out.context = udp;
+  out.receive = udpReceive;
+  out.close = udpClose;
+  return true;
+}